@@ -68,6 +68,7 @@ cdef extern from "<datoviz/datoviz.h>":
         DvzTransformType transform;
 
     ctypedef struct DvzPanel:
+        DvzScene* scene
         DvzGrid* grid
         DvzDataCoords data_coords
         uint32_t row
@@ -187,6 +188,11 @@ cdef extern from "<datoviz/datoviz.h>":
         DVZ_DTYPE_MAT2 = 31
         DVZ_DTYPE_MAT3 = 32
         DVZ_DTYPE_MAT4 = 33
+        DVZ_DTYPE_HALF = 34
+        DVZ_DTYPE_HVEC2 = 35
+        DVZ_DTYPE_HVEC3 = 36
+        DVZ_DTYPE_HVEC4 = 37
+        DVZ_DTYPE_VEC3_HILO = 38
 
     ctypedef enum DvzArrayCopyType:
         DVZ_ARRAY_COPY_NONE = 0
@@ -227,8 +233,9 @@ cdef extern from "<datoviz/datoviz.h>":
         DVZ_VISUAL_AXES_2D = 28
         DVZ_VISUAL_AXES_3D = 29
         DVZ_VISUAL_COLORMAP = 30
-        DVZ_VISUAL_COUNT = 31
-        DVZ_VISUAL_CUSTOM = 32
+        DVZ_VISUAL_POINT_CMAP = 31
+        DVZ_VISUAL_COUNT = 32
+        DVZ_VISUAL_CUSTOM = 33
 
     ctypedef enum DvzAxisLevel:
         DVZ_AXES_LEVEL_MINOR = 0
@@ -248,6 +255,7 @@ cdef extern from "<datoviz/datoviz.h>":
         DVZ_CANVAS_FLAGS_NONE = 0x0000
         DVZ_CANVAS_FLAGS_IMGUI = 0x0001
         DVZ_CANVAS_FLAGS_FPS = 0x0003
+        DVZ_CANVAS_FLAGS_ON_DEMAND = 0x0008
         DVZ_CANVAS_FLAGS_DPI_SCALE_050 = 0x1000
         DVZ_CANVAS_FLAGS_DPI_SCALE_100 = 0x2000
         DVZ_CANVAS_FLAGS_DPI_SCALE_150 = 0x3000
@@ -535,7 +543,13 @@ cdef extern from "<datoviz/datoviz.h>":
 
     ctypedef enum DvzGraphicsFlags:
         DVZ_GRAPHICS_FLAGS_DEPTH_TEST_DISABLE = 0x0000
+        DVZ_GRAPHICS_FLAGS_VOLUME_BRICKED = 0x0001
+        DVZ_GRAPHICS_FLAGS_POS_SNORM16 = 0x0040
+        DVZ_GRAPHICS_FLAGS_POS_HALF = 0x0080
         DVZ_GRAPHICS_FLAGS_DEPTH_TEST_ENABLE = 0x0100
+        DVZ_GRAPHICS_FLAGS_PATH_COMPACT = 0x0200
+        DVZ_GRAPHICS_FLAGS_POS_DOUBLE = 0x0400
+        DVZ_GRAPHICS_FLAGS_SEGMENT_INSTANCED = 0x0800
 
     ctypedef enum DvzMarkerType:
         DVZ_MARKER_DISC = 0
@@ -841,6 +855,7 @@ cdef extern from "<datoviz/datoviz.h>":
         DVZ_PROP_INDEX = 30
         DVZ_PROP_SCALE = 31
         DVZ_PROP_TRANSFORM = 32
+        DVZ_PROP_VALUE = 33
 
     ctypedef enum DvzSourceKind:
         DVZ_SOURCE_KIND_NONE = 0
@@ -925,8 +940,9 @@ cdef extern from "<datoviz/datoviz.h>":
         DVZ_GRAPHICS_MESH = 15
         DVZ_GRAPHICS_FAKE_SPHERE = 16
         DVZ_GRAPHICS_VOLUME = 17
-        DVZ_GRAPHICS_COUNT = 18
-        DVZ_GRAPHICS_CUSTOM = 19
+        DVZ_GRAPHICS_POINT_CMAP = 18
+        DVZ_GRAPHICS_COUNT = 19
+        DVZ_GRAPHICS_CUSTOM = 20
 
     ctypedef enum DvzTextureAxis:
         DVZ_TEXTURE_AXIS_U = 0
@@ -969,10 +985,13 @@ cdef extern from "<datoviz/datoviz.h>":
     ctypedef struct DvzMouseMoveEvent:
         vec2 pos
         int modifiers
+        vec2 delta
+        uint32_t count
 
     ctypedef struct DvzMouseWheelEvent:
         vec2 dir
         int modifiers
+        uint32_t count
 
     ctypedef struct DvzMouseDragEvent:
         vec2 pos
@@ -1095,13 +1114,14 @@ cdef extern from "<datoviz/datoviz.h>":
     # from file: canvas.h
     DvzCanvas* dvz_canvas(DvzGpu* gpu, uint32_t width, uint32_t height, int flags)
     void dvz_canvas_clear_color(DvzCanvas* canvas, float red, float green, float blue)
-    void dvz_event_callback(DvzCanvas* canvas, DvzEventType type, double param, DvzEventMode mode, DvzEventCallback callback, void* user_data)
+    void dvz_event_callback(DvzCanvas* canvas, DvzEventType type, double param, DvzEventMode mode, DvzEventCallback callback, void* user_data) nogil
     void dvz_canvas_to_close(DvzCanvas* canvas)
+    void dvz_canvas_request_frame(DvzCanvas* canvas)
     void dvz_screenshot_file(DvzCanvas* canvas, const char* png_path)
     void dvz_canvas_video(DvzCanvas* canvas, int framerate, int bitrate, const char* path, bint record)
     void dvz_canvas_pause(DvzCanvas* canvas, bint record)
     void dvz_canvas_stop(DvzCanvas* canvas)
-    void dvz_app_run(DvzApp* app, uint64_t frame_count)
+    void dvz_app_run(DvzApp* app, uint64_t frame_count) nogil
 
     # from file: context.h
     DvzTexture* dvz_ctx_texture(DvzContext* context, uint32_t dims, uvec3 size, VkFormat format)
@@ -1129,6 +1149,8 @@ cdef extern from "<datoviz/datoviz.h>":
 
     # from file: scene.h
     DvzScene* dvz_scene(DvzCanvas* canvas, uint32_t n_rows, uint32_t n_cols)
+    void dvz_scene_lock(DvzScene* scene) nogil
+    void dvz_scene_unlock(DvzScene* scene) nogil
     void dvz_scene_destroy(DvzScene* scene)
     DvzPanel* dvz_scene_panel(DvzScene* scene, uint32_t row, uint32_t col, DvzControllerType type, int flags)
     DvzVisual* dvz_scene_visual(DvzPanel* panel, DvzVisualType type, int flags)
@@ -1137,7 +1159,7 @@ cdef extern from "<datoviz/datoviz.h>":
     void dvz_upload_buffers(DvzCanvas* canvas, DvzBufferRegions br, VkDeviceSize offset, VkDeviceSize size, void* data)
     void dvz_download_buffers(DvzCanvas* canvas, DvzBufferRegions br, VkDeviceSize offset, VkDeviceSize size, void* data)
     void dvz_copy_buffers(DvzCanvas* canvas, DvzBufferRegions src, VkDeviceSize src_offset, DvzBufferRegions dst, VkDeviceSize dst_offset, VkDeviceSize size)
-    void dvz_upload_texture(DvzCanvas* canvas, DvzTexture* texture, uvec3 offset, uvec3 shape, VkDeviceSize size, void* data)
+    void dvz_upload_texture(DvzCanvas* canvas, DvzTexture* texture, uvec3 offset, uvec3 shape, VkDeviceSize size, void* data) nogil
     void dvz_download_texture(DvzCanvas* canvas, DvzTexture* texture, uvec3 offset, uvec3 shape, VkDeviceSize size, void* data)
     void dvz_copy_texture(DvzCanvas* canvas, DvzTexture* src, uvec3 src_offset, DvzTexture* dst, uvec3 dst_offset, uvec3 shape, VkDeviceSize size)
 
@@ -1145,14 +1167,15 @@ cdef extern from "<datoviz/datoviz.h>":
     void dvz_transform(DvzPanel* panel, DvzCDS source, dvec3 pos_in, DvzCDS target, dvec3 pos_out)
 
     # from file: visuals.h
-    void dvz_visual_data(DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count, const void* data)
+    void dvz_visual_data(DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count, const void* data) nogil
+    void dvz_visual_data_strided(DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count, const void* data, DvzDataType dtype, int64_t item_stride, int64_t component_stride) nogil
     void dvz_visual_data_source(DvzVisual* visual, DvzSourceType source_type, uint32_t source_idx, uint32_t first_item, uint32_t item_count, uint32_t data_item_count, const void* data)
     void dvz_visual_texture(DvzVisual* visual, DvzSourceType source_type, uint32_t source_idx, DvzTexture* texture)
     DvzProp* dvz_prop_get(DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx)
 
     # from file: vklite.h
     DvzApp* dvz_app(DvzBackend backend)
-    int dvz_app_destroy(DvzApp* app)
+    int dvz_app_destroy(DvzApp* app) nogil
     DvzGpu* dvz_gpu(DvzApp* app, uint32_t idx)
 
 
@@ -4,12 +4,15 @@
 # Imports
 # -------------------------------------------------------------------------------------------------
 
+from collections import deque
 from functools import wraps, partial
 import logging
+import threading
 
 cimport numpy as np
 import numpy as np
 from cpython.ref cimport Py_INCREF
+from libc.stdint cimport int64_t, uint32_t, uint64_t
 from libc.stdio cimport printf
 
 cimport datoviz.cydatoviz as cv
@@ -40,6 +43,7 @@ ctypedef np.uint32_t UINT
 
 DEFAULT_WIDTH = 1024
 DEFAULT_HEIGHT = 768
+DEFAULT_CALLBACK_QUEUE_SIZE = 256
 
 
 # TODO: add more keys
@@ -99,6 +103,7 @@ _EVENTS ={
 
 _VISUALS = {
     'point': cv.DVZ_VISUAL_POINT,
+    'point_cmap': cv.DVZ_VISUAL_POINT_CMAP,
     'marker': cv.DVZ_VISUAL_MARKER,
     'mesh': cv.DVZ_VISUAL_MESH,
     'path': cv.DVZ_VISUAL_PATH,
@@ -110,6 +115,11 @@ _VISUALS = {
     'line_strip': cv.DVZ_VISUAL_LINE_STRIP,
 }
 
+_BACKENDS = {
+    'glfw': cv.DVZ_BACKEND_GLFW,
+    'offscreen': cv.DVZ_BACKEND_OFFSCREEN,
+}
+
 _CONTROLLERS = {
     'panzoom': cv.DVZ_CONTROLLER_PANZOOM,
     'axes': cv.DVZ_CONTROLLER_AXES_2D,
@@ -152,6 +162,7 @@ _PROPS = {
     'transferx': cv.DVZ_PROP_TRANSFER_X,
     'transfery': cv.DVZ_PROP_TRANSFER_Y,
     'clip': cv.DVZ_PROP_CLIP,
+    'value': cv.DVZ_PROP_VALUE,
 }
 
 _DTYPES = {
@@ -193,6 +204,23 @@ _DTYPES = {
     cv.DVZ_DTYPE_MAT2: (np.float32, (2, 2)),
     cv.DVZ_DTYPE_MAT3: (np.float32, (3, 3)),
     cv.DVZ_DTYPE_MAT4: (np.float32, (4, 4)),
+
+    cv.DVZ_DTYPE_HALF: (np.float16, 1),
+    cv.DVZ_DTYPE_HVEC2: (np.float16, 2),
+    cv.DVZ_DTYPE_HVEC3: (np.float16, 3),
+    cv.DVZ_DTYPE_HVEC4: (np.float16, 4),
+    cv.DVZ_DTYPE_VEC3_HILO: (np.float32, 6),
+}
+
+# Scalar dtypes accepted by dvz_visual_data_strided(), in native byte order.
+_SCALAR_DTYPES = {
+    np.dtype(np.uint8): cv.DVZ_DTYPE_CHAR,
+    np.dtype(np.uint16): cv.DVZ_DTYPE_USHORT,
+    np.dtype(np.int16): cv.DVZ_DTYPE_SHORT,
+    np.dtype(np.uint32): cv.DVZ_DTYPE_UINT,
+    np.dtype(np.int32): cv.DVZ_DTYPE_INT,
+    np.dtype(np.float32): cv.DVZ_DTYPE_FLOAT,
+    np.dtype(np.double): cv.DVZ_DTYPE_DOUBLE,
 }
 
 _TRANSFORMS = {
@@ -384,6 +412,11 @@ _MARKER_TYPES = {
     'vbar': cv.DVZ_MARKER_VBAR,
 }
 
+_CALLBACK_POLICIES = ('sync', 'drop', 'drop_oldest', 'coalesce')
+
+# Only the latest pending event matters for these high-frequency events.
+_COALESCED_EVENTS = ('mouse_move', 'mouse_wheel', 'frame', 'timer')
+
 
 
 # -------------------------------------------------------------------------------------------------
@@ -421,9 +454,8 @@ def _get_prop(name):
 # -------------------------------------------------------------------------------------------------
 
 def _validate_data(dt, nc, data):
-    data = data.astype(dt)
-    if not data.flags['C_CONTIGUOUS']:
-        data = np.ascontiguousarray(data)
+    # NOTE: no copy if the array is already contiguous with the right dtype.
+    data = np.ascontiguousarray(data, dtype=dt)
     if not hasattr(nc, '__len__'):
         nc = (nc,)
     nd = len(nc)  # expected dimension of the data - 1
@@ -437,6 +469,24 @@ def _validate_data(dt, nc, data):
 
 
 
+def _strided_layout(dt, nc, data):
+    # Return the number of items, and the item and component strides in bytes, of an array that
+    # can be passed as is to dvz_visual_data_strided(), or None if the array needs to be validated
+    # and copied first.
+    if hasattr(nc, '__len__') or np.dtype(dt) not in _SCALAR_DTYPES:
+        return None
+    if data.dtype not in _SCALAR_DTYPES or data.size == 0:
+        return None
+    if data.ndim == 1 and nc == 1:
+        return data.shape[0], data.strides[0], data.itemsize
+    if data.ndim == 1 and data.shape[0] == nc:
+        return 1, 0, data.strides[0]
+    if data.ndim == 2 and data.shape[1] == nc:
+        return data.shape[0], data.strides[0], data.strides[1]
+    return None
+
+
+
 cdef _get_ev_args(cv.DvzEvent c_ev):
     cdef float* fvalue
     cdef int* ivalue
@@ -493,9 +543,102 @@ cdef _get_ev_args(cv.DvzEvent c_ev):
 
 
 
-# NOTE: this function may run in a background thread if using async callbacks
-# It should not acquire the GIL
-cdef _wrapped_callback(cv.DvzCanvas* c_canvas, cv.DvzEvent c_ev):
+# -------------------------------------------------------------------------------------------------
+# Callback dispatcher
+# -------------------------------------------------------------------------------------------------
+
+def _callback_policy(ev_name, policy=None):
+    if policy is None:
+        policy = 'coalesce' if ev_name in _COALESCED_EVENTS else 'drop'
+    if policy not in _CALLBACK_POLICIES:
+        raise ValueError(f"unknown callback policy {policy}, expected one of {_CALLBACK_POLICIES}")
+    return policy
+
+
+
+def _call_callback(f, args, kwargs):
+    try:
+        f(*args, **kwargs)
+    except Exception:
+        logger.exception("error in callback %s", getattr(f, '__name__', f))
+
+
+
+class _CallbackDispatcher:
+    """Run the Python callbacks in a dedicated thread, off the render loop.
+
+    The C event threads only enqueue the callback arguments in a bounded queue. When the queue is
+    full, the new event is dropped with the `drop` policy, and the oldest pending event with the
+    `drop_oldest` policy. With the `coalesce` policy, a pending event of the same callback is
+    replaced by the new one, so that a slow callback always processes the latest event.
+
+    """
+
+    def __init__(self, maxsize=DEFAULT_CALLBACK_QUEUE_SIZE):
+        assert maxsize > 0
+        self.maxsize = maxsize
+        self.dropped = 0  # number of discarded events
+        self._queue = deque()
+        self._pending = {}  # coalesced callback => its pending entry in the queue
+        self._cond = threading.Condition()
+        self._stopping = False
+        self._thread = threading.Thread(
+            target=self._run, name='datoviz-callbacks', daemon=True)
+        self._thread.start()
+
+    def _discard(self, entry):
+        self.dropped += 1
+        if self._pending.get(entry[0]) is entry:
+            del self._pending[entry[0]]
+
+    def submit(self, key, f, args, kwargs, policy):
+        with self._cond:
+            if self._stopping:
+                return
+            if policy == 'coalesce':
+                entry = self._pending.get(key)
+                if entry is not None:
+                    entry[2] = args
+                    entry[3] = kwargs
+                    return
+            if len(self._queue) >= self.maxsize:
+                if policy != 'drop_oldest':
+                    self.dropped += 1
+                    return
+                self._discard(self._queue.popleft())
+            entry = [key, f, args, kwargs]
+            if policy == 'coalesce':
+                self._pending[key] = entry
+            self._queue.append(entry)
+            self._cond.notify()
+
+    def _run(self):
+        while True:
+            with self._cond:
+                while not self._queue and not self._stopping:
+                    self._cond.wait()
+                if self._stopping:
+                    break
+                entry = self._queue.popleft()
+                if self._pending.get(entry[0]) is entry:
+                    del self._pending[entry[0]]
+            _call_callback(*entry[1:])
+
+    def stop(self):
+        # NOTE: the pending events are discarded.
+        with self._cond:
+            self._stopping = True
+            self._queue.clear()
+            self._pending.clear()
+            self._cond.notify()
+        if self._thread is not threading.current_thread():
+            self._thread.join()
+
+
+
+# NOTE: this function runs in the C event threads, without the GIL, so it needs to acquire it.
+# It only enqueues the event in the dispatcher, except for the callbacks with the sync policy.
+cdef void _wrapped_callback(cv.DvzCanvas* c_canvas, cv.DvzEvent c_ev) noexcept with gil:
     cdef object tup
     if c_ev.user_data != NULL:
         tup = <object>c_ev.user_data
@@ -503,7 +646,7 @@ cdef _wrapped_callback(cv.DvzCanvas* c_canvas, cv.DvzEvent c_ev):
         # For each type of event, get the arguments to the function
         ev_args, ev_kwargs = _get_ev_args(c_ev)
 
-        f, args = tup
+        f, args, policy, dispatcher = tup
 
         # This is the control type the callback was registered for.
         name = args[0] if args else None
@@ -514,29 +657,36 @@ cdef _wrapped_callback(cv.DvzCanvas* c_canvas, cv.DvzEvent c_ev):
             if c_ev.u.g.control.name != name:
                 return
 
-        try:
-            f(*ev_args, **ev_kwargs)
-        except Exception as e:
-            print("Error: %s" % e)
+        if policy == 'sync':
+            _call_callback(f, ev_args, ev_kwargs)
+        else:
+            dispatcher.submit(tup, f, ev_args, ev_kwargs, policy)
 
 
 
 cdef _add_event_callback(
-    cv.DvzCanvas* c_canvas, cv.DvzEventType evtype, double param, f, args,
-    cv.DvzEventMode mode=cv.DVZ_EVENT_MODE_SYNC):
+    cv.DvzCanvas* c_canvas, cv.DvzEventType evtype, double param, f, args, policy, dispatcher):
 
     cdef void* ptr_to_obj
-    tup = (f, args)
+    tup = (f, args, policy, dispatcher)
 
     # IMPORTANT: need to either keep a reference of this tuple object somewhere in the class,
     # or increase the ref, otherwise this tuple will be deleted by the time we call it in the
     # C callback function.
     Py_INCREF(tup)
 
+    # The sync callbacks are called directly by the render loop, the other ones by the C event
+    # thread which forwards them to the dispatcher.
+    cdef cv.DvzEventMode mode = cv.DVZ_EVENT_MODE_ASYNC
+    if policy == 'sync':
+        mode = cv.DVZ_EVENT_MODE_SYNC
+
+    # NOTE: release the GIL as registering a callback waits for the C event thread, which may be
+    # waiting for the GIL.
     ptr_to_obj = <void*>tup
-    cv.dvz_event_callback(
-        c_canvas, evtype, param, mode,
-        <cv.DvzEventCallback>_wrapped_callback, ptr_to_obj)
+    with nogil:
+        cv.dvz_event_callback(
+            c_canvas, evtype, param, mode, <cv.DvzEventCallback>_wrapped_callback, ptr_to_obj)
 
 
 
@@ -571,25 +721,33 @@ cdef class App:
 
     cdef cv.DvzApp* _c_app
     cdef cv.DvzGpu* _c_gpu
+    cdef readonly object dispatcher
 
     _canvases = []
 
-    def __cinit__(self):
-        self._c_app = cv.dvz_app(cv.DVZ_BACKEND_GLFW)
+    def __cinit__(self, backend='glfw', int callback_queue_size=DEFAULT_CALLBACK_QUEUE_SIZE):
+        self._c_app = cv.dvz_app(_BACKENDS[backend])
         if self._c_app is NULL:
             raise MemoryError()
         self._c_gpu = cv.dvz_gpu(self._c_app, 0);
         if self._c_gpu is NULL:
             raise MemoryError()
+        self.dispatcher = _CallbackDispatcher(callback_queue_size)
 
     def __dealloc__(self):
         self.destroy()
 
     def destroy(self):
-        if self._c_app is not NULL:
+        if self.dispatcher is not None:
+            self.dispatcher.stop()
+            self.dispatcher = None
+        cdef cv.DvzApp* c_app = self._c_app
+        if c_app is not NULL:
             for c in self._canvases:
                 c.destroy()
-            cv.dvz_app_destroy(self._c_app)
+            # NOTE: the C event threads may be waiting for the GIL before they can be stopped.
+            with nogil:
+                cv.dvz_app_destroy(c_app)
             self._c_app = NULL
 
     def canvas(
@@ -612,17 +770,24 @@ cdef class App:
         self._canvases.append(c)
         return c
 
+    cdef _run(self, uint64_t n_frames):
+        # NOTE: the event loop runs without the GIL, so that the dispatcher thread can run the
+        # Python callbacks while the frames are being rendered.
+        cdef cv.DvzApp* c_app = self._c_app
+        with nogil:
+            cv.dvz_app_run(c_app, n_frames)
+
     def run(self, int n_frames=0, unicode screenshot=None, unicode video=None):
         # HACK: run a few frames to render the image, make a screenshot, and run the event loop.
         if screenshot and self._canvases:
-            cv.dvz_app_run(self._c_app, 5)
+            self._run(5)
             self._canvases[0].screenshot(screenshot)
         if video and self._canvases:
             self._canvases[0].video(video)
-        cv.dvz_app_run(self._c_app, n_frames)
+        self._run(n_frames)
 
     def run_one_frame(self):
-        cv.dvz_app_run(self._c_app, 1)
+        self._run(1)
 
 
 
@@ -692,7 +857,7 @@ cdef class Canvas:
     def gui(self, unicode title):
         c_gui = cv.dvz_gui(self._c_canvas, title, 0)
         gui = Gui()
-        gui.create(self._c_canvas, c_gui)
+        gui.create(self._c_canvas, c_gui, self._app.dispatcher)
         return gui
 
     def _texture(self, source_type, arr, filtering='nearest'):
@@ -744,15 +909,22 @@ cdef class Canvas:
             if panel._c_panel == c_panel:
                 return panel
 
-    def _connect(self, evtype_py, f, param=0, cv.DvzEventMode mode=cv.DVZ_EVENT_MODE_ASYNC):
+    def _connect(self, evtype_py, f, param=0, policy=None):
         cdef cv.DvzEventType evtype
         evtype = _EVENTS.get(evtype_py, 0)
-        _add_event_callback(self._c_canvas, evtype, param, f, (), mode=mode)
-
-    def connect(self, f):
+        policy = _callback_policy(evtype_py, policy)
+        _add_event_callback(
+            self._c_canvas, evtype, param, f, (), policy, self._app.dispatcher)
+
+    def connect(self, f=None, policy=None):
+        # The policy is one of 'coalesce', 'drop', 'drop_oldest' (run the callback in the
+        # dispatcher thread), or 'sync' (run the callback directly in the render loop).
+        if f is None:
+            return partial(self.connect, policy=policy)
         assert f.__name__.startswith('on_')
         ev_name = f.__name__[3:]
-        self._connect(ev_name, f)
+        self._connect(ev_name, f, policy=policy)
+        return f
 
     # def connect_async(self, f):
     #     assert f.__name__.startswith('on_')
@@ -886,12 +1058,15 @@ cdef class Texture:
         cdef size = arr.size
         cdef item_size = np.dtype(arr.dtype).itemsize
 
-        cdef int s
+        cdef cv.VkDeviceSize s
         s = size * item_size
         # printf("canvas=%d, tex=%d, size=%d, data=%d\n", self._c_canvas, self._c_texture, s, &value.data[0])
-        cv.dvz_upload_texture(
-            self._c_canvas, self._c_texture, DVZ_ZERO_OFFSET, DVZ_ZERO_OFFSET,
-            size * item_size, &arr.data[0])
+        cdef cv.DvzCanvas* c_canvas = self._c_canvas
+        cdef cv.DvzTexture* c_texture = self._c_texture
+        cdef void* c_data = &arr.data[0]
+        with nogil:
+            cv.dvz_upload_texture(
+                c_canvas, c_texture, DVZ_ZERO_OFFSET, DVZ_ZERO_OFFSET, s, c_data)
 
 
 # -------------------------------------------------------------------------------------------------
@@ -911,13 +1086,40 @@ cdef class Visual:
         self._c_context = c_visual.canvas.gpu.context
         self.vtype = vtype
 
-    def data(self, name, np.ndarray value, idx=0):
-        prop_type = _get_prop(name)
+    def data(self, name, np.ndarray value, uint32_t idx=0):
+        cdef cv.DvzPropType prop_type = _get_prop(name)
         c_prop = cv.dvz_prop_get(self._c_visual, prop_type, idx)
         dtype, nc = _DTYPES[c_prop.dtype]
+
+        # NOTE: the copies below run without the GIL, and with the scene data locked as this
+        # method may be called from the dispatcher thread while the render loop bakes the data.
+        cdef cv.DvzVisual* c_visual = self._c_visual
+        cdef cv.DvzScene* c_scene = self._c_panel.scene
+        cdef uint32_t N
+        cdef int64_t item_stride, component_stride
+        cdef cv.DvzDataType c_dtype
+        cdef const void* c_data
+
+        layout = _strided_layout(dtype, nc, value)
+        if layout is not None:
+            # Zero-copy path: the C library converts the strided array to the prop dtype while
+            # copying it to the prop array.
+            N, item_stride, component_stride = layout
+            c_dtype = _SCALAR_DTYPES[value.dtype]
+            c_data = <const void*>value.data
+            with nogil:
+                cv.dvz_scene_lock(c_scene)
+                cv.dvz_visual_data_strided(
+                    c_visual, prop_type, idx, N, c_data, c_dtype, item_stride, component_stride)
+                cv.dvz_scene_unlock(c_scene)
+            return
         value = _validate_data(dtype, nc, value)
         N = value.shape[0]
-        cv.dvz_visual_data(self._c_visual, prop_type, idx, N, &value.data[0])
+        c_data = <const void*>value.data
+        with nogil:
+            cv.dvz_scene_lock(c_scene)
+            cv.dvz_visual_data(c_visual, prop_type, idx, N, c_data)
+            cv.dvz_scene_unlock(c_scene)
 
     def texture(self, Texture tex, idx=0):
         # Bind the texture with the visual for the specified source.
@@ -1007,16 +1209,16 @@ cdef class GuiControl:
 cdef class Gui:
     cdef cv.DvzCanvas* _c_canvas
     cdef cv.DvzGui* _c_gui
+    cdef object _dispatcher
     _controls = {}
 
-    cdef create(self, cv.DvzCanvas* c_canvas, cv.DvzGui* c_gui):
+    cdef create(self, cv.DvzCanvas* c_canvas, cv.DvzGui* c_gui, dispatcher):
         self._c_canvas = c_canvas
         self._c_gui = c_gui
+        self._dispatcher = dispatcher
 
     def control(self, unicode ctype, unicode name, **kwargs):
-        cdef cv.DvzEventMode mode
-        # is_async = kwargs.pop('mode', None) == 'async'
-        mode = cv.DVZ_EVENT_MODE_ASYNC #  if is_async else cv.DVZ_EVENT_MODE_SYNC
+        policy = _callback_policy('gui', kwargs.pop('policy', None))
         ctrl = _CONTROLS.get(ctype, 0)
         cdef char* c_name = name
 
@@ -1050,7 +1252,8 @@ cdef class Gui:
         def wrap(f):
             cdef cv.DvzEventType evtype
             evtype = cv.DVZ_EVENT_GUI
-            _add_event_callback(self._c_canvas, evtype, 0, f, (name,), mode=mode)
+            _add_event_callback(
+                self._c_canvas, evtype, 0, f, (name,), policy, self._dispatcher)
 
         return wrap
 
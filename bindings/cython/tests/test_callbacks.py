@@ -0,0 +1,100 @@
+"""
+Frame-time jitter of the offscreen render loop with a slow Python callback.
+
+The Python callbacks run in the dispatcher thread, while the event loop runs without the GIL, so
+that a callback sleeping for longer than a frame does not stall the rendering.
+
+"""
+
+import time
+
+import numpy as np
+import numpy.random as nr
+import pytest
+
+from datoviz import App
+
+
+N_FRAMES = 60
+SLEEP = .05  # duration of the slow callback, in seconds
+
+
+@pytest.fixture
+def app():
+    app = App(backend='offscreen')
+    yield app
+    app.destroy()
+
+
+def _frame_times(app, policy):
+    canvas = app.canvas()
+    visual = canvas.panel(controller='panzoom').visual('point')
+    visual.data('pos', nr.randn(10_000, 3))
+
+    # Timestamps of the frames, recorded by a fast callback called by the render loop.
+    times = []
+
+    @canvas.connect(policy='sync')
+    def on_frame():
+        times.append(time.perf_counter())
+
+    calls = []
+
+    def on_frame_slow():
+        time.sleep(SLEEP)
+        calls.append(time.perf_counter())
+
+    canvas._connect('frame', on_frame_slow, policy=policy)
+
+    app.run(N_FRAMES)
+    return np.diff(times), calls
+
+
+def test_callback_jitter(app):
+    intervals, calls = _frame_times(app, 'coalesce')
+    assert len(intervals) >= N_FRAMES - 2
+    median, p95 = np.percentile(intervals, [50, 95])
+    print(f"frame time: median {median * 1e3:.1f} ms, p95 {p95 * 1e3:.1f} ms")
+
+    # The frames are not slowed down by the slow callback.
+    assert median < SLEEP / 2
+    assert p95 < SLEEP
+
+    # The frame events were coalesced while the slow callback was running.
+    assert 0 < len(calls) < N_FRAMES
+
+
+def test_callback_sync(app):
+    # With the sync policy, the slow callback runs in the render loop and stalls every frame.
+    intervals, calls = _frame_times(app, 'sync')
+    assert np.median(intervals) >= SLEEP
+    assert len(calls) == N_FRAMES
+
+
+@pytest.mark.parametrize('policy', ['coalesce', 'sync'])
+def test_callback_data(app, policy):
+    # The visual data is updated from a timer callback, in the dispatcher thread, and from a
+    # frame callback, while the render loop bakes it. The sizes change, so that the prop arrays
+    # are reallocated at every update.
+    canvas = app.canvas()
+    visual = canvas.panel(controller='panzoom').visual('point')
+    visual.data('pos', nr.randn(1_000, 3))
+
+    sizes = []
+
+    def on_timer():
+        n = nr.randint(1_000, 100_000)
+        visual.data('pos', nr.randn(n, 3))
+        sizes.append(n)
+
+    def on_frame():
+        n = nr.randint(1_000, 100_000)
+        visual.data('pos', nr.randn(n, 3))
+        visual.data('color', np.full((n, 4), 255, dtype=np.uint8))
+        sizes.append(n)
+
+    canvas._connect('timer', on_timer, param=.001, policy='coalesce')
+    canvas._connect('frame', on_frame, policy=policy)
+
+    app.run(N_FRAMES)
+    assert len(sizes) > N_FRAMES / 2
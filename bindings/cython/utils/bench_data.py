@@ -0,0 +1,40 @@
+"""
+Benchmark of the ingestion of NumPy arrays by Visual.data(), in bytes per second.
+
+Arrays that are contiguous with the prop dtype, strided, or with another scalar dtype are passed
+as is to the C library, which converts and copies them to the prop array in a single pass.
+Other arrays (here, half floats) are first copied by NumPy.
+
+"""
+
+import time
+
+import numpy as np
+import numpy.random as nr
+
+from datoviz import canvas
+
+
+N = 20_000_000
+N_REPEATS = 5
+
+
+def bench(visual, name, arr):
+    visual.data('pos', arr)  # warmup
+    t0 = time.perf_counter()
+    for _ in range(N_REPEATS):
+        visual.data('pos', arr)
+    dt = (time.perf_counter() - t0) / N_REPEATS
+    size = arr.dtype.itemsize * arr.shape[0] * 3
+    print(f"{name:>20s}: {size / 1e6:8.1f} MB in {dt * 1e3:7.1f} ms, {size / dt / 1e9:5.2f} GB/s")
+
+
+if __name__ == '__main__':
+    c = canvas()
+    visual = c.panel().visual('point')
+
+    pos = nr.randn(N, 4)
+    bench(visual, 'float64 contiguous', np.ascontiguousarray(pos[:, :3]))
+    bench(visual, 'float64 strided', pos[:, :3])
+    bench(visual, 'float32 contiguous', pos[:, :3].astype(np.float32))
+    bench(visual, 'float16 (copy)', pos[:, :3].astype(np.float16))
@@ -39,6 +39,18 @@ STRUCTS = (
     'DvzTimerEvent',
     'DvzViewport',
 )
+# Functions that may be called without holding the GIL: the event loop, the functions that wait
+# for the event threads, and the data uploads.
+NOGIL_FUNCS = (
+    'dvz_app_run',
+    'dvz_app_destroy',
+    'dvz_event_callback',
+    'dvz_scene_lock',
+    'dvz_scene_unlock',
+    'dvz_upload_texture',
+    'dvz_visual_data',
+    'dvz_visual_data_strided',
+)
 
 ENUM_START = '# ENUM START'
 ENUM_END = '# ENUM END'
@@ -256,7 +268,8 @@ def _gen_cython_func(name, func):
             dtype = 'bint'
         args_s.append(f'{dtype} {argname}')
     args = ', '.join(args_s)
-    return f'{out} {name}({args})'
+    nogil = ' nogil' if name in NOGIL_FUNCS else ''
+    return f'{out} {name}({args}){nogil}'
 
 
 if __name__ == '__main__':
@@ -0,0 +1,367 @@
+#include "bench.h"
+#include "../include/datoviz/builtin_visuals.h"
+#include "../include/datoviz/density.h"
+#include "../include/datoviz/histogram.h"
+#include "../include/datoviz/replay.h"
+#include "../include/datoviz/scene.h"
+#include "../include/datoviz/transforms.h"
+#include "../src/ticks.h"
+#include "../src/transforms_utils.h"
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+static dvec3* _bench_pos(uint32_t n)
+{
+    dvec3* pos = calloc(n, sizeof(dvec3));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        RANDN_POS(pos[i])
+    }
+    return pos;
+}
+
+
+
+/*************************************************************************************************/
+/*  Visual data                                                                                  */
+/*************************************************************************************************/
+
+int bench_visual_data(Bench* bench)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+
+    const uint32_t N = 1000000;
+    dvec3* pos = _bench_pos(N);
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, N, pos);
+    dvz_app_run(app, 1);
+
+    // Copy to the prop array, baking, and upload, which is synchronous when the app is not
+    // running.
+    bench->items = N;
+    while (bench_iter(bench))
+    {
+        dvz_visual_data(visual, DVZ_PROP_POS, 0, N, pos);
+        dvz_visual_update(visual, panel->viewport, panel->data_coords, NULL);
+    }
+
+    dvz_scene_destroy(scene);
+    FREE(pos);
+    return dvz_app_destroy(app);
+}
+
+
+
+/*************************************************************************************************/
+/*  Transforms                                                                                   */
+/*************************************************************************************************/
+
+int bench_transform_pos(Bench* bench)
+{
+    const uint32_t N = 1000000;
+    DvzArray pos_in = dvz_array(N, DVZ_DTYPE_DVEC3);
+    DvzArray pos_out = dvz_array(N, DVZ_DTYPE_DVEC3);
+    dvec3* pos = _bench_pos(N);
+    memcpy(pos_in.data, pos, N * sizeof(dvec3));
+
+    DvzDataCoords coords = {0};
+    coords.box = _box_bounding(&pos_in);
+    coords.transform = DVZ_TRANSFORM_CARTESIAN;
+
+    bench->items = N;
+    while (bench_iter(bench))
+        dvz_transform_pos(coords, &pos_in, &pos_out, false);
+
+    dvz_array_destroy(&pos_in);
+    dvz_array_destroy(&pos_out);
+    FREE(pos);
+    return 0;
+}
+
+
+
+/*************************************************************************************************/
+/*  Density map                                                                                  */
+/*************************************************************************************************/
+
+int bench_density(Bench* bench)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzDensity* density = dvz_density(canvas, canvas->viewport.size_framebuffer);
+
+    const uint32_t N = 10000000;
+    vec2* pos = calloc(N, sizeof(vec2));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        pos[i][0] = .25 * dvz_rand_normal();
+        pos[i][1] = .25 * dvz_rand_normal();
+    }
+    dvz_density_data(density, N, pos, NULL);
+
+    // Aggregation with eq-hist of all points in a new view, as with a panzoom interaction,
+    // including the wait for the GPU.
+    double z = 1;
+    bench->items = N;
+    while (bench_iter(bench))
+    {
+        z *= 1.01;
+        dvz_density_update(
+            density, (dvec4){-1 / z, -1 / z, +1 / z, +1 / z}, canvas->viewport.size_framebuffer);
+        dvz_density_wait(density);
+    }
+
+    dvz_density_destroy(density);
+    FREE(pos);
+    return dvz_app_destroy(app);
+}
+
+
+
+/*************************************************************************************************/
+/*  Histogram                                                                                    */
+/*************************************************************************************************/
+
+int bench_histogram(Bench* bench)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzHistogram* histogram = dvz_histogram(canvas, 1000);
+
+    const uint32_t N = 10000000;
+    float* samples = calloc(N, sizeof(float));
+    for (uint32_t i = 0; i < N; i++)
+        samples[i] = dvz_rand_normal();
+    dvz_histogram_data(histogram, N, samples);
+
+    // Binning of all samples in a new range, and the bars, including the wait for the GPU.
+    float r = 4;
+    bench->items = N;
+    while (bench_iter(bench))
+    {
+        r *= .99;
+        dvz_histogram_range(histogram, -r, +r);
+        dvz_histogram_update(histogram);
+        dvz_fences_wait(&histogram->fences, 0);
+    }
+
+    dvz_histogram_destroy(histogram);
+    FREE(samples);
+    return dvz_app_destroy(app);
+}
+
+
+
+/*************************************************************************************************/
+/*  Ticks                                                                                        */
+/*************************************************************************************************/
+
+int bench_ticks(Bench* bench)
+{
+    DvzAxesContext ctx = {0};
+    ctx.coord = DVZ_AXES_COORD_X;
+    ctx.size_viewport = 2000;
+    ctx.size_glyph = 5;
+    ctx.extensions = 1;
+
+    // Extended Wilkinson algorithm on ranges with various orders of magnitude.
+    const uint32_t N = 100;
+    DvzAxesTicks ticks = {0};
+    double x0 = 0, x1 = 0;
+    bench->items = N;
+    while (bench_iter(bench))
+    {
+        for (uint32_t i = 0; i < N; i++)
+        {
+            x0 = -1.2345 * pow(10, (int)(i % 10) - 5);
+            x1 = x0 + 3.14159 * pow(10, (int)(i % 7) - 3);
+            ticks = dvz_ticks(x0, x1, ctx);
+            dvz_ticks_destroy(&ticks);
+        }
+    }
+    return 0;
+}
+
+
+
+/*************************************************************************************************/
+/*  Scene fill                                                                                   */
+/*************************************************************************************************/
+
+int bench_scene_fill(Bench* bench)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_NONE, 0);
+
+    const uint32_t N = 100;
+    const uint32_t visual_count = 100;
+    dvec3* pos = _bench_pos(N);
+    DvzVisual** visuals = calloc(visual_count, sizeof(DvzVisual*));
+    for (uint32_t i = 0; i < visual_count; i++)
+    {
+        visuals[i] = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+        dvz_visual_data(visuals[i], DVZ_PROP_POS, 0, N, pos);
+    }
+    dvz_app_run(app, 1);
+
+    // Frames with a refill, where the command buffers of all visuals are recorded again.
+    bench->items = visual_count;
+    while (bench_iter(bench))
+    {
+        for (uint32_t i = 0; i < visual_count; i++)
+            visuals[i]->fill_version++;
+        dvz_canvas_to_refill(canvas);
+        dvz_app_run(app, 1);
+    }
+
+    dvz_scene_destroy(scene);
+    FREE(visuals);
+    FREE(pos);
+    return dvz_app_destroy(app);
+}
+
+
+
+/*************************************************************************************************/
+/*  Screenshot                                                                                   */
+/*************************************************************************************************/
+
+int bench_screenshot(Bench* bench)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+
+    const uint32_t N = 10000;
+    dvec3* pos = _bench_pos(N);
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, N, pos);
+    dvz_app_run(app, 3);
+
+    uint8_t* rgb = NULL;
+    bench->items = TEST_WIDTH * TEST_HEIGHT;
+    while (bench_iter(bench))
+    {
+        rgb = dvz_screenshot(canvas, false);
+        FREE(rgb);
+    }
+
+    dvz_scene_destroy(scene);
+    FREE(pos);
+    return dvz_app_destroy(app);
+}
+
+
+
+/*************************************************************************************************/
+/*  Event dispatch                                                                               */
+/*************************************************************************************************/
+
+static void _bench_mouse_move(DvzCanvas* canvas, DvzEvent ev)
+{
+    ASSERT(ev.user_data != NULL);
+    (*(uint64_t*)ev.user_data)++;
+}
+
+int bench_event_dispatch(Bench* bench)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    uint64_t count = 0;
+    dvz_event_callback(
+        canvas, DVZ_EVENT_MOUSE_MOVE, 0, DVZ_EVENT_MODE_SYNC, _bench_mouse_move, &count);
+
+    // Mouse move events dispatched to a sync callback.
+    const uint32_t N = 10000;
+    vec2 pos = {0};
+    bench->items = N;
+    while (bench_iter(bench))
+    {
+        for (uint32_t i = 0; i < N; i++)
+        {
+            pos[0] = i % TEST_WIDTH;
+            dvz_event_mouse_move(canvas, pos, 0);
+        }
+    }
+    int res = count == (uint64_t)N * (bench->warmup + bench->repeat) ? 0 : 1;
+    dvz_app_destroy(app);
+    return res;
+}
+
+
+
+/*************************************************************************************************/
+/*  Event replay                                                                                 */
+/*************************************************************************************************/
+
+// Left drag over a number of frames.
+static void _bench_drag(DvzCanvas* canvas, vec2 pos, uint32_t n_frames)
+{
+    dvz_event_mouse_move(canvas, pos, 0);
+    dvz_event_mouse_press(canvas, DVZ_MOUSE_BUTTON_LEFT, 0);
+    for (uint32_t i = 0; i < n_frames; i++)
+    {
+        pos[0] += 2;
+        pos[1] += 1;
+        dvz_event_mouse_move(canvas, pos, 0);
+        dvz_app_run(canvas->app, 1);
+    }
+    dvz_event_mouse_release(canvas, DVZ_MOUSE_BUTTON_LEFT, 0);
+    dvz_app_run(canvas->app, 1);
+}
+
+int bench_event_replay(Bench* bench)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzScene* scene = dvz_scene(canvas, 1, 2);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_AXES_2D, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+    DvzPanel* other = dvz_scene_panel(scene, 0, 1, DVZ_CONTROLLER_ARCBALL, 0);
+    DvzVisual* other_visual = dvz_scene_visual(other, DVZ_VISUAL_POINT, 0);
+
+    const uint32_t N = 10000;
+    dvec3* pos = _bench_pos(N);
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(other_visual, DVZ_PROP_POS, 0, N, pos);
+    dvz_app_run(app, 3);
+
+    // Record drags in the panzoom panel with axes, then in the arcball panel.
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/bench_events.bin", ARTIFACTS_DIR);
+    DvzEventRecorder* recorder = dvz_event_record(canvas, path);
+    ASSERT(recorder != NULL);
+    _bench_drag(canvas, (vec2){TEST_WIDTH / 8, TEST_HEIGHT / 4}, 50);
+    _bench_drag(canvas, (vec2){TEST_WIDTH * 5 / 8, TEST_HEIGHT / 4}, 50);
+    dvz_event_record_stop(canvas);
+
+    // Replay at maximal speed, the interact callbacks and the axes updates run at every frame.
+    DvzEventReplay* replay = dvz_event_replay(canvas, path);
+    ASSERT(replay != NULL);
+    bench->items = replay->record_count;
+    while (bench_iter(bench))
+        dvz_event_replay_run(replay, DVZ_REPLAY_FLAGS_MAX_SPEED);
+
+    dvz_event_replay_destroy(replay);
+    dvz_scene_destroy(scene);
+    FREE(pos);
+    return dvz_app_destroy(app);
+}
@@ -0,0 +1,266 @@
+#ifndef DVZ_BENCH_HEADER
+#define DVZ_BENCH_HEADER
+
+#include "utils.h"
+#include <inttypes.h>
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define BENCH_WARMUP    3
+#define BENCH_REPEAT    20
+#define BENCH_MAX_CASES 64
+
+// Relative increase of the median duration above which a benchmark is flagged as a regression.
+#define BENCH_THRESHOLD .1
+
+
+
+/*************************************************************************************************/
+/*  Typedefs                                                                                     */
+/*************************************************************************************************/
+
+typedef struct Bench Bench;
+typedef struct BenchCase BenchCase;
+typedef struct BenchStats BenchStats;
+
+// Benchmark callbacks.
+typedef int (*BenchFunction)(Bench*);
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+struct Bench
+{
+    const char* name;
+    uint32_t warmup; // number of untimed iterations
+    uint32_t repeat; // number of timed iterations
+    uint64_t items;  // number of items processed by one iteration, to compute the throughput
+
+    uint32_t iter;   // current iteration, including the warmup
+    DvzClock clock;  // start of the current iteration
+    double* samples; // duration of the timed iterations, in seconds
+};
+
+
+
+struct BenchStats
+{
+    char name[64];
+    uint32_t count;
+    uint64_t items;
+    double min, mean, stddev, p50, p90, p99, max; // in seconds
+    double throughput;                            // in items per second
+};
+
+
+
+struct BenchCase
+{
+    const char* name;
+    BenchFunction function;
+};
+
+
+
+/*************************************************************************************************/
+/*  Macros                                                                                       */
+/*************************************************************************************************/
+
+#define BENCH_CASE(func)                                                                          \
+    {                                                                                             \
+#func, func                                                                               \
+    }
+
+
+
+/*************************************************************************************************/
+/*  Benchmark loop                                                                               */
+/*************************************************************************************************/
+
+// Run the next iteration of a benchmark. The benchmark functions set up their data, then time
+// their code with:
+//
+//     while (bench_iter(bench)) { ... }
+//
+static bool bench_iter(Bench* bench)
+{
+    ASSERT(bench != NULL);
+    ASSERT(bench->samples != NULL);
+
+    // Record the duration of the iteration that has just ended, unless it was a warmup one.
+    double elapsed = _clock_get(&bench->clock);
+    if (bench->iter > bench->warmup)
+        bench->samples[bench->iter - bench->warmup - 1] = elapsed;
+
+    if (bench->iter == bench->warmup + bench->repeat)
+        return false;
+    bench->iter++;
+    _clock_init(&bench->clock);
+    return true;
+}
+
+
+
+/*************************************************************************************************/
+/*  Statistics                                                                                   */
+/*************************************************************************************************/
+
+static int _compare_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Linear interpolation between the closest ranks of a sorted array.
+static double _percentile(const double* sorted, uint32_t count, double p)
+{
+    ASSERT(count > 0);
+    double x = p * (count - 1);
+    uint32_t i = (uint32_t)x;
+    if (i + 1 >= count)
+        return sorted[count - 1];
+    return sorted[i] + (x - i) * (sorted[i + 1] - sorted[i]);
+}
+
+static BenchStats bench_stats(Bench* bench)
+{
+    ASSERT(bench != NULL);
+    BenchStats stats = {0};
+    strncpy(stats.name, bench->name, sizeof(stats.name) - 1);
+    stats.items = bench->items;
+
+    // Only the completed iterations are taken into account.
+    uint32_t count = bench->iter > bench->warmup ? bench->iter - bench->warmup : 0;
+    count = MIN(count, bench->repeat);
+    stats.count = count;
+    if (count == 0)
+        return stats;
+
+    double* sorted = calloc(count, sizeof(double));
+    memcpy(sorted, bench->samples, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), _compare_double);
+
+    double sum = 0, sum2 = 0;
+    for (uint32_t i = 0; i < count; i++)
+        sum += sorted[i];
+    stats.mean = sum / count;
+    for (uint32_t i = 0; i < count; i++)
+        sum2 += (sorted[i] - stats.mean) * (sorted[i] - stats.mean);
+    stats.stddev = count > 1 ? sqrt(sum2 / (count - 1)) : 0;
+
+    stats.min = sorted[0];
+    stats.max = sorted[count - 1];
+    stats.p50 = _percentile(sorted, count, .5);
+    stats.p90 = _percentile(sorted, count, .9);
+    stats.p99 = _percentile(sorted, count, .99);
+    if (bench->items > 0 && stats.p50 > 0)
+        stats.throughput = bench->items / stats.p50;
+
+    FREE(sorted);
+    return stats;
+}
+
+
+
+/*************************************************************************************************/
+/*  JSON output                                                                                  */
+/*************************************************************************************************/
+
+// The benchmarks are written one per line, so that bench_load() can read them back without a
+// JSON parser.
+static int bench_save(const char* path, const char* gpu_name, uint32_t count, BenchStats* stats)
+{
+    ASSERT(path != NULL);
+    ASSERT(stats != NULL || count == 0);
+
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        log_error("unable to open %s", path);
+        return 1;
+    }
+    fprintf(fp, "{\"gpu\": \"%s\", \"benchmarks\": [", gpu_name != NULL ? gpu_name : "");
+    for (uint32_t i = 0; i < count; i++)
+    {
+        fprintf(
+            fp,
+            "%s\n{\"name\": \"%s\", \"count\": %d, \"items\": %" PRIu64 ", \"min\": %.9f, "
+            "\"mean\": %.9f, \"stddev\": %.9f, \"p50\": %.9f, \"p90\": %.9f, \"p99\": %.9f, "
+            "\"max\": %.9f, \"throughput\": %.3f}",
+            i > 0 ? "," : "", stats[i].name, stats[i].count, stats[i].items, stats[i].min,
+            stats[i].mean, stats[i].stddev, stats[i].p50, stats[i].p90, stats[i].p99,
+            stats[i].max, stats[i].throughput);
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    log_info("benchmark results written to %s", path);
+    return 0;
+}
+
+// Return the number of benchmarks read from a file written by bench_save().
+static uint32_t bench_load(const char* path, char* gpu_name, uint32_t max_count, BenchStats* stats)
+{
+    ASSERT(path != NULL);
+    ASSERT(gpu_name != NULL);
+    ASSERT(stats != NULL);
+
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        log_error("unable to open %s", path);
+        return 0;
+    }
+
+    char line[1024] = {0};
+    uint32_t count = 0;
+    BenchStats* s = NULL;
+    int n = 0;
+    while (fgets(line, sizeof(line), fp) != NULL && count < max_count)
+    {
+        if (strncmp(line, "{\"gpu\": \"", 9) == 0)
+        {
+            sscanf(line, "{\"gpu\": \"%255[^\"]\"", gpu_name);
+            continue;
+        }
+        s = &stats[count];
+        *s = (BenchStats){0};
+        n = sscanf(
+            line,
+            "{\"name\": \"%63[^\"]\", \"count\": %u, \"items\": %" SCNu64 ", \"min\": %lf, "
+            "\"mean\": %lf, \"stddev\": %lf, \"p50\": %lf, \"p90\": %lf, \"p99\": %lf, "
+            "\"max\": %lf, \"throughput\": %lf",
+            s->name, &s->count, &s->items, &s->min, &s->mean, &s->stddev, &s->p50, &s->p90,
+            &s->p99, &s->max, &s->throughput);
+        if (n == 11)
+            count++;
+    }
+    fclose(fp);
+    return count;
+}
+
+
+
+/*************************************************************************************************/
+/*  Benchmarks                                                                                   */
+/*************************************************************************************************/
+
+int bench_visual_data(Bench* bench);
+int bench_transform_pos(Bench* bench);
+int bench_density(Bench* bench);
+int bench_histogram(Bench* bench);
+int bench_ticks(Bench* bench);
+int bench_scene_fill(Bench* bench);
+int bench_screenshot(Bench* bench);
+int bench_event_dispatch(Bench* bench);
+int bench_event_replay(Bench* bench);
+
+
+
+#endif
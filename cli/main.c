@@ -1,12 +1,14 @@
 #include <datoviz/datoviz.h>
 #include <unistd.h>
 
+#include "bench.h"
 #include "test_array.h"
 #include "test_builtin_visuals.h"
 #include "test_canvas.h"
 #include "test_common.h"
 #include "test_graphics.h"
 #include "test_interact.h"
+#include "test_mesh.h"
 #include "test_panel.h"
 #include "test_scene.h"
 #include "test_transforms.h"
@@ -38,6 +40,7 @@ static TestCase TEST_CASES[] = {
     CASE_FIXTURE_NONE(test_vklite_images),         //
     CASE_FIXTURE_NONE(test_vklite_sampler),        //
     CASE_FIXTURE_NONE(test_vklite_barrier),        //
+    CASE_FIXTURE_NONE(test_vklite_barrier_buffer), //
     CASE_FIXTURE_NONE(test_vklite_submit),         //
     CASE_FIXTURE_NONE(test_vklite_blank),          //
     CASE_FIXTURE_NONE(test_vklite_graphics),       //
@@ -46,28 +49,39 @@ static TestCase TEST_CASES[] = {
     CASE_FIXTURE_NONE(test_shader_compile),        //
 
     // context
-    CASE_FIXTURE_NONE(test_fifo_1),      //
-    CASE_FIXTURE_NONE(test_fifo_2),      //
-    CASE_FIXTURE_NONE(test_fifo_3),      //
-    CASE_FIXTURE_NONE(test_default_app), //
+    CASE_FIXTURE_NONE(test_fifo_1),                 //
+    CASE_FIXTURE_NONE(test_fifo_2),                 //
+    CASE_FIXTURE_NONE(test_fifo_3),                 //
+    CASE_FIXTURE_NONE(test_fifo_merge),             //
+    CASE_FIXTURE_NONE(test_jobs),                   //
+    CASE_FIXTURE_NONE(test_log),                    //
+    CASE_FIXTURE_NONE(test_log_bench),              //
+    CASE_FIXTURE_NONE(test_default_app),            //
+    CASE_FIXTURE_NONE(test_context_lazy),           //
+    CASE_FIXTURE_NONE(test_context_buffers_resize), //
+    CASE_FIXTURE_NONE(test_context_buffers_align),  //
 
     // canvas
-    CASE_FIXTURE_NONE(test_canvas_transfer_buffer),  //
-    CASE_FIXTURE_NONE(test_canvas_transfer_texture), //
-    CASE_FIXTURE_NONE(test_canvas_1),                //
-    CASE_FIXTURE_NONE(test_canvas_2),                //
-    CASE_FIXTURE_NONE(test_canvas_3),                //
-    CASE_FIXTURE_NONE(test_canvas_4),                //
-    CASE_FIXTURE_NONE(test_canvas_5),                //
-    CASE_FIXTURE_NONE(test_canvas_6),                //
-    CASE_FIXTURE_NONE(test_canvas_7),                //
-    CASE_FIXTURE_NONE(test_canvas_8),                //
-    CASE_FIXTURE_NONE(test_canvas_depth),            //
-    CASE_FIXTURE_NONE(test_canvas_append),           //
-    CASE_FIXTURE_NONE(test_canvas_particles),        //
-    CASE_FIXTURE_NONE(test_canvas_offscreen),        //
-    CASE_FIXTURE_NONE(test_canvas_gui_1),            //
-    CASE_FIXTURE_NONE(test_canvas_screencast),       //
+    CASE_FIXTURE_NONE(test_canvas_transfer_buffer),      //
+    CASE_FIXTURE_NONE(test_canvas_transfer_texture),     //
+    CASE_FIXTURE_NONE(test_canvas_texture_stream),       //
+    CASE_FIXTURE_NONE(test_canvas_texture_stream_bench), //
+    CASE_FIXTURE_NONE(test_canvas_1),                    //
+    CASE_FIXTURE_NONE(test_canvas_2),                    //
+    CASE_FIXTURE_NONE(test_canvas_3),                    //
+    CASE_FIXTURE_NONE(test_canvas_4),                    //
+    CASE_FIXTURE_NONE(test_canvas_5),                    //
+    CASE_FIXTURE_NONE(test_canvas_6),                    //
+    CASE_FIXTURE_NONE(test_canvas_7),                    //
+    CASE_FIXTURE_NONE(test_canvas_8),                    //
+    CASE_FIXTURE_NONE(test_canvas_depth),                //
+    CASE_FIXTURE_NONE(test_canvas_append),               //
+    CASE_FIXTURE_NONE(test_canvas_particles),            //
+    CASE_FIXTURE_NONE(test_canvas_offscreen),            //
+    CASE_FIXTURE_NONE(test_canvas_on_demand),            //
+    CASE_FIXTURE_NONE(test_canvas_coalesce),             //
+    CASE_FIXTURE_NONE(test_canvas_gui_1),                //
+    CASE_FIXTURE_NONE(test_canvas_screencast),           //
 
     // graphics
     CASE_FIXTURE_NONE(test_graphics_dynamic), //
@@ -89,22 +103,26 @@ static TestCase TEST_CASES[] = {
     // generate marker screenshots:
     CASE_FIXTURE_NONE(test_graphics_marker_screenshots), //
 
-    CASE_FIXTURE_NONE(test_graphics_segment),    //
-    CASE_FIXTURE_NONE(test_graphics_path),       //
-    CASE_FIXTURE_NONE(test_graphics_text),       //
-    CASE_FIXTURE_NONE(test_graphics_image_1),    //
-    CASE_FIXTURE_NONE(test_graphics_image_cmap), //
+    CASE_FIXTURE_NONE(test_graphics_segment),           //
+    CASE_FIXTURE_NONE(test_graphics_segment_instanced), //
+    CASE_FIXTURE_NONE(test_graphics_segment_bench),     //
+    CASE_FIXTURE_NONE(test_graphics_path),              //
+    CASE_FIXTURE_NONE(test_graphics_text),              //
+    CASE_FIXTURE_NONE(test_graphics_text_bench),        //
+    CASE_FIXTURE_NONE(test_graphics_image_1),           //
+    CASE_FIXTURE_NONE(test_graphics_image_cmap),        //
 
     CASE_FIXTURE_NONE(test_graphics_volume_1),     //
     CASE_FIXTURE_NONE(test_graphics_volume_slice), //
     CASE_FIXTURE_NONE(test_graphics_mesh),         //
 
     // transforms
-    CASE_FIXTURE_NONE(test_transforms_1), //
-    CASE_FIXTURE_NONE(test_transforms_2), //
-    CASE_FIXTURE_NONE(test_transforms_3), //
-    CASE_FIXTURE_NONE(test_transforms_4), //
-    CASE_FIXTURE_NONE(test_transforms_5), //
+    CASE_FIXTURE_NONE(test_transforms_1),      //
+    CASE_FIXTURE_NONE(test_transforms_2),      //
+    CASE_FIXTURE_NONE(test_transforms_3),      //
+    CASE_FIXTURE_NONE(test_transforms_4),      //
+    CASE_FIXTURE_NONE(test_transforms_5),      //
+    CASE_FIXTURE_NONE(test_transforms_double), //
 
     // array
     CASE_FIXTURE_NONE(test_array_1),    //
@@ -118,12 +136,21 @@ static TestCase TEST_CASES[] = {
     CASE_FIXTURE_NONE(test_array_mvp),  //
     CASE_FIXTURE_NONE(test_array_3D),   //
 
+    // mesh
+    CASE_FIXTURE_NONE(test_mesh_normals),  //
+    CASE_FIXTURE_NONE(test_mesh_optimize), //
+    CASE_FIXTURE_NONE(test_mesh_obj),      //
+    CASE_FIXTURE_NONE(test_mesh_ply),      //
+    CASE_FIXTURE_NONE(test_mesh_stl),      //
+    CASE_FIXTURE_NONE(test_mesh_load),     //
+
     // visuals
-    CASE_FIXTURE_NONE(test_visuals_1), //
-    CASE_FIXTURE_NONE(test_visuals_2), //
-    CASE_FIXTURE_NONE(test_visuals_3), //
-    CASE_FIXTURE_NONE(test_visuals_4), //
-    CASE_FIXTURE_NONE(test_visuals_5), //
+    CASE_FIXTURE_NONE(test_visuals_1),      //
+    CASE_FIXTURE_NONE(test_visuals_2),      //
+    CASE_FIXTURE_NONE(test_visuals_3),      //
+    CASE_FIXTURE_NONE(test_visuals_4),      //
+    CASE_FIXTURE_NONE(test_visuals_5),      //
+    CASE_FIXTURE_NONE(test_visuals_memory), //
 
     // interact
     CASE_FIXTURE_NONE(test_interact_1),       //
@@ -135,26 +162,36 @@ static TestCase TEST_CASES[] = {
     CASE_FIXTURE_NONE(test_panel_1), //
 
     // builtin visuals
-    CASE_FIXTURE_NONE(test_visuals_point),          //
-    CASE_FIXTURE_NONE(test_visuals_line),           //
-    CASE_FIXTURE_NONE(test_visuals_line_strip),     //
-    CASE_FIXTURE_NONE(test_visuals_triangle),       //
-    CASE_FIXTURE_NONE(test_visuals_triangle_strip), //
+    CASE_FIXTURE_NONE(test_visuals_point),            //
+    CASE_FIXTURE_NONE(test_visuals_point_cmap),       //
+    CASE_FIXTURE_NONE(test_visuals_point_cmap_bench), //
+    CASE_FIXTURE_NONE(test_visuals_line),             //
+    CASE_FIXTURE_NONE(test_visuals_line_strip),       //
+    CASE_FIXTURE_NONE(test_visuals_triangle),         //
+    CASE_FIXTURE_NONE(test_visuals_triangle_strip),   //
 #if !OS_MACOS
     CASE_FIXTURE_NONE(test_visuals_triangle_fan), //
 #endif
 
-    CASE_FIXTURE_NONE(test_visuals_marker),         //
-    CASE_FIXTURE_NONE(test_visuals_polygon),        //
-    CASE_FIXTURE_NONE(test_visuals_path),           //
-    CASE_FIXTURE_NONE(test_visuals_image_1),        //
-    CASE_FIXTURE_NONE(test_visuals_image_cmap),     //
-    CASE_FIXTURE_NONE(test_visuals_axes_2D_1),      //
-    CASE_FIXTURE_NONE(test_visuals_axes_2D_update), //
-
-    CASE_FIXTURE_NONE(test_visuals_mesh),         //
-    CASE_FIXTURE_NONE(test_visuals_volume_1),     //
-    CASE_FIXTURE_NONE(test_visuals_volume_slice), //
+    CASE_FIXTURE_NONE(test_visuals_marker),             //
+    CASE_FIXTURE_NONE(test_visuals_compact_pos),        //
+    CASE_FIXTURE_NONE(test_visuals_polygon),            //
+    CASE_FIXTURE_NONE(test_visuals_path),               //
+    CASE_FIXTURE_NONE(test_visuals_path_compact),       //
+    CASE_FIXTURE_NONE(test_visuals_image_1),            //
+    CASE_FIXTURE_NONE(test_visuals_image_cmap),         //
+    CASE_FIXTURE_NONE(test_visuals_image_tiled),        //
+    CASE_FIXTURE_NONE(test_visuals_image_tiled_stream), //
+    CASE_FIXTURE_NONE(test_visuals_density),            //
+    CASE_FIXTURE_NONE(test_visuals_histogram),          //
+    CASE_FIXTURE_NONE(test_visuals_histogram_grow),     //
+    CASE_FIXTURE_NONE(test_visuals_axes_2D_1),          //
+    CASE_FIXTURE_NONE(test_visuals_axes_2D_update),     //
+
+    CASE_FIXTURE_NONE(test_visuals_mesh),           //
+    CASE_FIXTURE_NONE(test_visuals_volume_1),       //
+    CASE_FIXTURE_NONE(test_visuals_volume_slice),   //
+    CASE_FIXTURE_NONE(test_visuals_volume_bricked), //
 
     // axes
     CASE_FIXTURE_NONE(test_axes_1), //
@@ -162,17 +199,43 @@ static TestCase TEST_CASES[] = {
     CASE_FIXTURE_NONE(test_axes_3), //
 
     // scene
-    CASE_FIXTURE_NONE(test_scene_0),        //
-    CASE_FIXTURE_NONE(test_scene_1),        //
-    CASE_FIXTURE_NONE(test_scene_mesh),     //
-    CASE_FIXTURE_NONE(test_scene_axes),     //
-    CASE_FIXTURE_NONE(test_scene_logistic), //
+    CASE_FIXTURE_NONE(test_scene_0),           //
+    CASE_FIXTURE_NONE(test_scene_1),           //
+    CASE_FIXTURE_NONE(test_scene_mesh),        //
+    CASE_FIXTURE_NONE(test_scene_axes),        //
+    CASE_FIXTURE_NONE(test_scene_logistic),    //
+    CASE_FIXTURE_NONE(test_scene_profiler),    //
+    CASE_FIXTURE_NONE(test_scene_refill),      //
+    CASE_FIXTURE_NONE(test_scene_buffer_grow), //
+    CASE_FIXTURE_NONE(test_scene_threads),     //
+    CASE_FIXTURE_NONE(test_scene_double),      //
+    CASE_FIXTURE_NONE(test_scene_memory),      //
+    CASE_FIXTURE_NONE(test_scene_replay),      //
 
 };
 static uint32_t N_TESTS = sizeof(TEST_CASES) / sizeof(TestCase);
 
 
 
+/*************************************************************************************************/
+/*  List of benchmarks                                                                           */
+/*************************************************************************************************/
+
+static BenchCase BENCH_CASES[] = {
+    BENCH_CASE(bench_visual_data),    //
+    BENCH_CASE(bench_transform_pos),  //
+    BENCH_CASE(bench_density),        //
+    BENCH_CASE(bench_histogram),      //
+    BENCH_CASE(bench_ticks),          //
+    BENCH_CASE(bench_scene_fill),     //
+    BENCH_CASE(bench_screenshot),     //
+    BENCH_CASE(bench_event_dispatch), //
+    BENCH_CASE(bench_event_replay),   //
+};
+static uint32_t N_BENCHES = sizeof(BENCH_CASES) / sizeof(BenchCase);
+
+
+
 /*************************************************************************************************/
 /*  Tests utils                                                                                  */
 /*************************************************************************************************/
@@ -293,6 +356,128 @@ static int test(int argc, char** argv)
     return res;
 }
 
+// Return the value of a command-line option, or NULL if the option is not set.
+static const char* _cli_option(int argc, char** argv, const char* option)
+{
+    for (int i = 1; i < argc - 1; i++)
+        if (strcmp(argv[i], option) == 0)
+            return argv[i + 1];
+    return NULL;
+}
+
+static int bench(int argc, char** argv)
+{
+    // argv: bench, [<name>], [--warmup <n>], [--repeat <n>], [--output <path.json>]
+    const char* name = argc >= 2 && argv[1][0] != '-' ? argv[1] : NULL;
+    const char* opt = _cli_option(argc, argv, "--warmup");
+    uint32_t warmup = opt != NULL ? (uint32_t)atoi(opt) : BENCH_WARMUP;
+    opt = _cli_option(argc, argv, "--repeat");
+    uint32_t repeat = opt != NULL ? (uint32_t)MAX(atoi(opt), 1) : BENCH_REPEAT;
+    opt = _cli_option(argc, argv, "--output");
+    char path[1024] = {0};
+    if (opt != NULL)
+        strncpy(path, opt, sizeof(path) - 1);
+    else
+        snprintf(path, sizeof(path), "%s/bench.json", ARTIFACTS_DIR);
+
+    // Name of the GPU, to make sure the results are compared on the same device.
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    char gpu_name[256] = {0};
+    strncpy(gpu_name, dvz_gpu(app, 0)->name, sizeof(gpu_name) - 1);
+    dvz_app_destroy(app);
+
+    BenchStats stats[BENCH_MAX_CASES] = {0};
+    Bench b = {0};
+    uint32_t count = 0;
+    int res = 0, cur_res = 0;
+    printf(
+        "%-24s %8s %10s %10s %10s %10s %14s\n", "benchmark", "runs", "min (ms)", "p50 (ms)",
+        "p90 (ms)", "p99 (ms)", "items/s");
+    for (uint32_t i = 0; i < N_BENCHES && count < BENCH_MAX_CASES; i++)
+    {
+        if (name != NULL && strstr(BENCH_CASES[i].name, name) == NULL)
+            continue;
+
+        srand(0);
+        b = (Bench){0};
+        b.name = BENCH_CASES[i].name;
+        b.warmup = warmup;
+        b.repeat = repeat;
+        b.samples = calloc(repeat, sizeof(double));
+        cur_res = BENCH_CASES[i].function(&b);
+        res += cur_res == 0 ? 0 : 1;
+
+        stats[count] = bench_stats(&b);
+        printf(
+            "%-24s %8d %10.3f %10.3f %10.3f %10.3f %14.4g%s\n", stats[count].name,
+            stats[count].count, 1000 * stats[count].min, 1000 * stats[count].p50,
+            1000 * stats[count].p90, 1000 * stats[count].p99, stats[count].throughput,
+            cur_res == 0 ? "" : " FAILED");
+        count++;
+        FREE(b.samples);
+    }
+
+    if (bench_save(path, gpu_name, count, stats) != 0)
+        res++;
+    return res;
+}
+
+static int compare(int argc, char** argv)
+{
+    // argv: compare, <baseline.json>, <current.json>, [--threshold <ratio>]
+    if (argc < 3)
+    {
+        log_error("usage: compare <baseline.json> <current.json> [--threshold <ratio>]");
+        return 1;
+    }
+    const char* opt = _cli_option(argc, argv, "--threshold");
+    double threshold = opt != NULL ? atof(opt) : BENCH_THRESHOLD;
+
+    char gpu0[256] = {0}, gpu1[256] = {0};
+    BenchStats* base = calloc(BENCH_MAX_CASES, sizeof(BenchStats));
+    BenchStats* cur = calloc(BENCH_MAX_CASES, sizeof(BenchStats));
+    uint32_t n0 = bench_load(argv[1], gpu0, BENCH_MAX_CASES, base);
+    uint32_t n1 = bench_load(argv[2], gpu1, BENCH_MAX_CASES, cur);
+    if (strcmp(gpu0, gpu1) != 0)
+        log_warn("comparing benchmarks run on different GPUs: %s and %s", gpu0, gpu1);
+
+    // A benchmark regresses when its median duration increases by more than the threshold.
+    int regressions = 0;
+    double ratio = 0;
+    bool found = false;
+    for (uint32_t i = 0; i < n1; i++)
+    {
+        found = false;
+        for (uint32_t j = 0; j < n0 && !found; j++)
+        {
+            if (strcmp(cur[i].name, base[j].name) != 0)
+                continue;
+            found = true;
+            ratio = base[j].p50 > 0 ? cur[i].p50 / base[j].p50 : 1;
+            printf(
+                "%-24s %10.3f ms %10.3f ms %+7.1f%%", cur[i].name, 1000 * base[j].p50,
+                1000 * cur[i].p50, 100 * (ratio - 1));
+            if (ratio > 1 + threshold)
+            {
+                printf("\x1b[31m REGRESSION\x1b[0m\n");
+                regressions++;
+            }
+            else
+                printf("\n");
+        }
+        if (!found)
+            printf("%-24s %13s %10.3f ms\n", cur[i].name, "(new)", 1000 * cur[i].p50);
+    }
+    if (regressions > 0)
+        printf(
+            "\x1b[31m%d benchmark(s) regressed by more than %.0f%%.\x1b[0m\n", regressions,
+            100 * threshold);
+
+    FREE(base);
+    FREE(cur);
+    return regressions > 0 || n1 == 0 ? 1 : 0;
+}
+
 static int info(int argc, char** argv)
 {
     DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
@@ -323,7 +508,7 @@ int main(int argc, char** argv)
     log_set_level_env();
     if (argc <= 1)
     {
-        log_error("specify a command: info, demo, test");
+        log_error("specify a command: info, demo, test, bench, compare");
         return 1;
     }
     ASSERT(argc >= 2);
@@ -331,5 +516,7 @@ int main(int argc, char** argv)
     SWITCH_CLI_ARG(info)
     SWITCH_CLI_ARG(test)
     SWITCH_CLI_ARG(demo)
+    SWITCH_CLI_ARG(bench)
+    SWITCH_CLI_ARG(compare)
     return res;
 }
@@ -70,6 +70,16 @@ static void _common_data(DvzVisual* visual)
         canvas, DVZ_EVENT_REFILL, 0, DVZ_EVENT_MODE_SYNC, _visual_canvas_fill, visual);
 }
 
+// Average duration of the bake callback of a visual, in seconds.
+static double _bake_visual(DvzVisual* visual, uint32_t n_repeats)
+{
+    DvzClock clock = {0};
+    _clock_init(&clock);
+    for (uint32_t i = 0; i < n_repeats; i++)
+        visual->callback_bake(visual, (DvzVisualDataEvent){0});
+    return _clock_get(&clock) / n_repeats;
+}
+
 #define INIT                                                                                      \
     DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);                                                      \
     DvzGpu* gpu = dvz_gpu(app, 0);                                                                \
@@ -137,6 +147,168 @@ int test_visuals_point(TestContext* context)
 
 
 
+// Points on a grid, with values at a quarter of the colormap texels for the range [0, 10], and
+// at the middle of the texels for the range [2.5, 7.5], so that the CPU and GPU colormaps match.
+static void _point_cmap_data(uint32_t n, dvec3* pos, double* values, float* fvalues)
+{
+    for (uint32_t i = 0; i < n * n; i++)
+    {
+        pos[i][0] = -.95 + 1.9 * (i % n) / (n - 1.0);
+        pos[i][1] = -.95 + 1.9 * (i / n) / (n - 1.0);
+        values[i] = 10 * ((i % 256) + .25) / 256.0;
+        fvalues[i] = (float)values[i];
+    }
+}
+
+// Maximum difference between two screenshots, and number of lit pixel components.
+static uint32_t _screenshot_diff(DvzCanvas* canvas0, DvzCanvas* canvas1, uint32_t* lit)
+{
+    uint8_t* rgb0 = dvz_screenshot(canvas0, false);
+    uint8_t* rgb1 = dvz_screenshot(canvas1, false);
+    uint32_t max_diff = 0;
+    *lit = 0;
+    for (uint32_t i = 0; i < TEST_WIDTH * TEST_HEIGHT * 3; i++)
+    {
+        *lit += rgb0[i] > 0;
+        max_diff = MAX(max_diff, (uint32_t)abs((int)rgb0[i] - (int)rgb1[i]));
+    }
+    FREE(rgb0);
+    FREE(rgb1);
+    return max_diff;
+}
+
+int test_visuals_point_cmap(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+
+    // The same points, colormapped on the CPU and in the vertex shader in two canvases.
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzCanvas* canvas_cmap = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzVisual visual = dvz_visual(canvas);
+    DvzVisual visual_cmap = dvz_visual(canvas_cmap);
+    dvz_visual_builtin(&visual, DVZ_VISUAL_POINT, 0);
+    dvz_visual_builtin(&visual_cmap, DVZ_VISUAL_POINT_CMAP, 0);
+
+    const uint32_t n = 48, N = n * n;
+    dvec3* pos = calloc(N, sizeof(dvec3));
+    double* values = calloc(N, sizeof(double));
+    float* fvalues = calloc(N, sizeof(float));
+    cvec4* color = calloc(N, sizeof(cvec4));
+    _point_cmap_data(n, pos, values, fvalues);
+    float size = 5;
+
+    // CPU colormap.
+    dvz_colormap_array(DVZ_CMAP_VIRIDIS, N, values, 0, 10, color);
+    dvz_visual_data(&visual, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(&visual, DVZ_PROP_COLOR, 0, N, color);
+    dvz_visual_data(&visual, DVZ_PROP_MARKER_SIZE, 0, 1, &size);
+
+    // GPU colormap.
+    dvz_visual_data(&visual_cmap, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(&visual_cmap, DVZ_PROP_VALUE, 0, N, fvalues);
+    dvz_visual_data(&visual_cmap, DVZ_PROP_RANGE, 0, 1, (vec2){0, 10});
+    dvz_visual_data(&visual_cmap, DVZ_PROP_MARKER_SIZE, 0, 1, &size);
+    dvz_visual_texture(
+        &visual_cmap, DVZ_SOURCE_TYPE_COLOR_TEXTURE, 0, dvz_ctx_color_texture(gpu->context));
+
+    _common_data(&visual);
+    _common_data(&visual_cmap);
+    dvz_app_run(app, 5);
+
+    // The colors come from the same colormap texels.
+    uint32_t lit = 0;
+    uint32_t max_diff = _screenshot_diff(canvas, canvas_cmap, &lit);
+    log_debug("%d lit pixel components, max difference %d", lit, max_diff);
+    AT(lit > 1000);
+    AT(max_diff == 0);
+
+    // Recolor with another range and colormap: on the GPU, only the params are updated.
+    dvz_colormap_array(DVZ_CMAP_HSV, N, values, 2.5, 7.5, color);
+    dvz_visual_data(&visual, DVZ_PROP_COLOR, 0, N, color);
+    dvz_visual_update(&visual, canvas->viewport, (DvzDataCoords){0}, NULL);
+
+    DvzColormap cmap = DVZ_CMAP_HSV;
+    dvz_visual_data(&visual_cmap, DVZ_PROP_RANGE, 0, 1, (vec2){2.5, 7.5});
+    dvz_visual_data(&visual_cmap, DVZ_PROP_COLORMAP, 0, 1, &cmap);
+    DvzSource* source = dvz_source_get(&visual_cmap, DVZ_SOURCE_TYPE_PARAM, 0);
+    AT(source->obj.request == DVZ_VISUAL_REQUEST_UPLOAD);
+    source = dvz_source_get(&visual_cmap, DVZ_SOURCE_TYPE_VERTEX, 0);
+    AT(source->obj.request != DVZ_VISUAL_REQUEST_UPLOAD);
+    dvz_visual_update(&visual_cmap, canvas_cmap->viewport, (DvzDataCoords){0}, NULL);
+
+    dvz_app_run(app, 5);
+    max_diff = _screenshot_diff(canvas, canvas_cmap, &lit);
+    log_debug("%d lit pixel components, max difference %d", lit, max_diff);
+    AT(lit > 1000);
+    AT(max_diff == 0);
+
+    FREE(pos);
+    FREE(values);
+    FREE(fvalues);
+    FREE(color);
+    dvz_visual_destroy(&visual);
+    dvz_visual_destroy(&visual_cmap);
+    TEST_END
+}
+
+int test_visuals_point_cmap_bench(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzContext* ctx = gpu->context;
+
+    // CPU recolor of 50M points: colormap and upload of the vertex buffer, in chunks of 1M points
+    // to bound the memory usage of the test.
+    const uint32_t N = 50000000, C = 1000000;
+    double* values = calloc(C, sizeof(double));
+    cvec4* color = calloc(C, sizeof(cvec4));
+    DvzVertex* vertices = calloc(C, sizeof(DvzVertex));
+    for (uint32_t i = 0; i < C; i++)
+        values[i] = dvz_rand_float();
+    DvzBufferRegions br = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_VERTEX, 1, C * sizeof(DvzVertex));
+
+    DvzClock clock = {0};
+    _clock_init(&clock);
+    for (uint32_t k = 0; k < N / C; k++)
+    {
+        dvz_colormap_array(DVZ_CMAP_VIRIDIS, C, values, 0, 1, color);
+        for (uint32_t i = 0; i < C; i++)
+            memcpy(vertices[i].color, color[i], sizeof(cvec4));
+        dvz_upload_buffers(canvas, br, 0, C * sizeof(DvzVertex), vertices);
+    }
+    double dt_cpu = _clock_get(&clock);
+
+    // GPU recolor: update of the params uniform buffer, independent of the number of points.
+    const uint32_t n_repeats = 100;
+    DvzVisual visual = dvz_visual(canvas);
+    dvz_visual_builtin(&visual, DVZ_VISUAL_POINT_CMAP, 0);
+    dvz_visual_data(&visual, DVZ_PROP_POS, 0, 1, (dvec3[]){{0, 0, 0}});
+    dvz_visual_data(&visual, DVZ_PROP_VALUE, 0, 1, (float[]){.5});
+    _common_data(&visual);
+    _clock_init(&clock);
+    for (uint32_t k = 0; k < n_repeats; k++)
+    {
+        dvz_visual_data(&visual, DVZ_PROP_RANGE, 0, 1, (vec2){0, 1 + k});
+        dvz_visual_update(&visual, canvas->viewport, (DvzDataCoords){0}, NULL);
+    }
+    double dt_gpu = _clock_get(&clock) / n_repeats;
+
+    log_info(
+        "recolor of %dM points: %.1f ms on the CPU, %.3f ms with the GPU colormap", N / C,
+        dt_cpu * 1e3, dt_gpu * 1e3);
+    AT(dt_gpu < dt_cpu);
+
+    FREE(values);
+    FREE(color);
+    FREE(vertices);
+    dvz_visual_destroy(&visual);
+    TEST_END
+}
+
+
+
 int test_visuals_marker(TestContext* context)
 {
     INIT;
@@ -175,6 +347,114 @@ int test_visuals_marker(TestContext* context)
 
 
 
+// Maximum error between the original positions and the positions stored in a vertex buffer.
+static double _pos_error(DvzArray* arr, dvec3* pos, uint32_t n, int flags, bool relative)
+{
+    double err = 0, x = 0, y = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        int16_t* v = (int16_t*)dvz_array_item(arr, i); // the position is the first vertex field
+        for (uint32_t j = 0; j < 3; j++)
+        {
+            x = pos[i][j];
+            if ((flags & DVZ_GRAPHICS_FLAGS_POS_SNORM16) != 0)
+                y = v[j] / 32767.0;
+            else if ((flags & DVZ_GRAPHICS_FLAGS_POS_HALF) != 0)
+                y = _half_to_float((uint16_t)v[j]);
+            else
+                y = ((float*)v)[j];
+            err = MAX(err, fabs(x - y) / (relative ? MAX(fabs(x), 1e-3) : 1));
+        }
+    }
+    return err;
+}
+
+int test_visuals_compact_pos(TestContext* context)
+{
+    INIT;
+
+    const uint32_t N = 1000000;
+    dvec3* pos = calloc(N, sizeof(dvec3));
+    cvec4* color = calloc(N, sizeof(cvec4));
+    float* size = calloc(N, sizeof(float));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        pos[i][0] = -1 + 2 * dvz_rand_float();
+        pos[i][1] = -1 + 2 * dvz_rand_float();
+        RAND_COLOR(color[i])
+        color[i][3] = 192;
+        size[i] = 2 + 20 * dvz_rand_float();
+    }
+
+    // Point visuals with regular, SNORM16, and half-float positions: compare the vertex memory,
+    // the bake throughput, and the position accuracy.
+    int flags[] = {0, DVZ_GRAPHICS_FLAGS_POS_SNORM16, DVZ_GRAPHICS_FLAGS_POS_HALF};
+    const char* names[] = {"float", "snorm16", "half"};
+    VkDeviceSize sizes[3] = {0};
+    double errors[3] = {0};
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        DvzVisual point = dvz_visual(canvas);
+        dvz_visual_builtin(&point, DVZ_VISUAL_POINT, flags[k]);
+        dvz_visual_data(&point, DVZ_PROP_POS, 0, N, pos);
+        dvz_visual_data(&point, DVZ_PROP_COLOR, 0, N, color);
+        double dt = _bake_visual(&point, 5);
+
+        DvzArray* arr = &dvz_source_get(&point, DVZ_SOURCE_TYPE_VERTEX, 0)->arr;
+        AT(arr->item_count == N);
+        sizes[k] = arr->item_count * arr->item_size;
+        errors[k] = _pos_error(arr, pos, N, flags[k], flags[k] == DVZ_GRAPHICS_FLAGS_POS_HALF);
+        log_info(
+            "%s positions: %s, baked at %.1f Mpoints/s, max error %.2e", names[k],
+            pretty_size(sizes[k]), N / dt * 1e-6, errors[k]);
+        dvz_visual_destroy(&point);
+    }
+    AT(4 * sizes[1] == 3 * sizes[0]);
+    AT(sizes[2] == sizes[1]);
+    AT(errors[0] < 1e-7);
+    // SNORM16: absolute error of half a quantization step. Half: relative error of 2^-11.
+    AT(errors[1] <= .5 / 32767 + 1e-9);
+    AT(errors[2] <= 1.0 / 2048 + 1e-9);
+
+    // Line visual: the segment start and end positions are cast in consecutive vertices.
+    DvzVisual line = dvz_visual(canvas);
+    dvz_visual_builtin(&line, DVZ_VISUAL_LINE, DVZ_GRAPHICS_FLAGS_POS_SNORM16);
+    dvz_visual_data(&line, DVZ_PROP_POS, 0, N / 2, pos);
+    dvz_visual_data(&line, DVZ_PROP_POS, 1, N / 2, pos + N / 2);
+    dvz_visual_data(&line, DVZ_PROP_COLOR, 0, N / 2, color);
+    _bake_visual(&line, 1);
+    DvzArray* arr = &dvz_source_get(&line, DVZ_SOURCE_TYPE_VERTEX, 0)->arr;
+    AT(arr->item_count == N);
+    AT(arr->item_size == sizeof(DvzVertexCompact));
+    DvzVertexCompact* vertex = dvz_array_item(arr, 1);
+    AT(vertex->pos[0] == _double_to_snorm16(pos[N / 2][0]));
+    AT(vertex->color[0] == color[0][0]);
+    dvz_visual_destroy(&line);
+
+    // Marker visual with SNORM16 positions and 8-bit sizes.
+    DvzVisual visual = dvz_visual(canvas);
+    dvz_visual_builtin(&visual, DVZ_VISUAL_MARKER, DVZ_GRAPHICS_FLAGS_POS_SNORM16);
+    dvz_visual_data(&visual, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(&visual, DVZ_PROP_COLOR, 0, N, color);
+    dvz_visual_data(&visual, DVZ_PROP_MARKER_SIZE, 0, N, size);
+    _bake_visual(&visual, 1);
+    arr = &dvz_source_get(&visual, DVZ_SOURCE_TYPE_VERTEX, 0)->arr;
+    AT(arr->item_size == sizeof(DvzGraphicsMarkerCompactVertex));
+    AT(arr->item_size < sizeof(DvzGraphicsMarkerVertex));
+    DvzGraphicsMarkerCompactVertex* marker = dvz_array_item(arr, 0);
+    AT(fabs(marker->size - size[0] * canvas->dpi_scaling) <= .5 + 1e-6);
+    AT(marker->color[3] == 192);
+
+    RUN;
+    SCREENSHOT("marker_compact")
+    FREE(pos);
+    FREE(color);
+    FREE(size);
+    END;
+}
+
+
+
 int test_visuals_line(TestContext* context)
 {
     INIT;
@@ -388,7 +668,7 @@ int test_visuals_axes_2D_1(TestContext* context)
     INIT;
     dvz_canvas_clear_color(canvas, 1, 1, 1);
 
-    DvzFontAtlas* atlas = &gpu->context->font_atlas;
+    DvzFontAtlas* atlas = dvz_ctx_font_atlas(gpu->context);
     ASSERT(strlen(atlas->font_str) > 0);
 
     DvzVisual visual = dvz_visual(canvas);
@@ -485,7 +765,7 @@ int test_visuals_axes_2D_update(TestContext* context)
     INIT;
     dvz_canvas_clear_color(canvas, 1, 1, 1);
 
-    DvzFontAtlas* atlas = &gpu->context->font_atlas;
+    DvzFontAtlas* atlas = dvz_ctx_font_atlas(gpu->context);
     ASSERT(strlen(atlas->font_str) > 0);
 
     DvzVisual visual = dvz_visual(canvas);
@@ -601,6 +881,106 @@ int test_visuals_path(TestContext* context)
 
 
 
+int test_visuals_path_compact(TestContext* context)
+{
+    INIT;
+
+    DvzVisual visual = dvz_visual(canvas);
+    dvz_visual_builtin(&visual, DVZ_VISUAL_PATH, DVZ_GRAPHICS_FLAGS_PATH_COMPACT);
+    DvzVisual visual_ref = dvz_visual(canvas);
+    dvz_visual_builtin(&visual_ref, DVZ_VISUAL_PATH, 0);
+
+    // Set paths.
+    const uint32_t n_paths = 10;
+    const uint32_t n_points = 100000;
+    const uint32_t N = n_paths * n_points;
+
+    dvec3* points = calloc(N, sizeof(dvec3));
+    cvec4* colors = calloc(N, sizeof(cvec4));
+    uint32_t* path_lengths = calloc(n_paths, sizeof(uint32_t));
+    uint32_t k = 0;
+    double t = 0;
+    for (uint32_t i = 0; i < n_paths; i++)
+    {
+        path_lengths[i] = n_points;
+        for (uint32_t j = 0; j < n_points; j++)
+        {
+            t = -1 + 2 * j / (float)(n_points - 1);
+            points[k][0] = .9 * t;
+            points[k][1] = .05 * sin(20 * M_2PI * t) - .8 + 1.6 * i / (float)(n_paths - 1);
+            dvz_colormap_scale(DVZ_CMAP_HSV, j, 0, n_points - 1, colors[k]);
+            k++;
+        }
+    }
+
+    DvzVisual* visuals[] = {&visual, &visual_ref};
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        dvz_visual_data(visuals[i], DVZ_PROP_POS, 0, N, points);
+        dvz_visual_data(visuals[i], DVZ_PROP_COLOR, 0, N, colors);
+        dvz_visual_data(visuals[i], DVZ_PROP_LENGTH, 0, n_paths, path_lengths);
+        dvz_visual_data(visuals[i], DVZ_PROP_LINE_WIDTH, 0, 1, (float[]){5});
+    }
+
+    // Compare the vertex memory and the bake time of the compact and regular representations.
+    double dt = _bake_visual(&visual, 5);
+    double dt_ref = _bake_visual(&visual_ref, 5);
+    DvzArray* arr = &dvz_source_get(&visual, DVZ_SOURCE_TYPE_VERTEX, 0)->arr;
+    DvzArray* arr_ref = &dvz_source_get(&visual_ref, DVZ_SOURCE_TYPE_VERTEX, 0)->arr;
+    VkDeviceSize size = arr->item_count * arr->item_size;
+    VkDeviceSize size_ref = arr_ref->item_count * arr_ref->item_size;
+    // NOTE: pretty_size() uses a static buffer, so it is called once per log call.
+    log_info("path with %d points: compact %s baked in %.3f ms", N, pretty_size(size), dt * 1000);
+    log_info(
+        "path with %d points: regular %s baked in %.3f ms", N, pretty_size(size_ref),
+        dt_ref * 1000);
+    AT(arr->item_count == N + 3 * n_paths);
+    AT(3 * size < size_ref);
+
+    // The points are stored once, between the padding points.
+    DvzGraphicsPathCompactVertex* vertex = dvz_array_item(arr, 1);
+    AT(vertex->pos[0] == (float)points[0][0]);
+    AT(vertex->color[3] == colors[0][3]);
+    vertex = dvz_array_item(arr, 0);
+    AT(vertex->color[3] == 0);
+
+    // Closed path: the compact vertex buffer is [P(n-1) | P0..P(n-1) | P0 | P1], so that the
+    // last point is joined to the first one.
+    const uint32_t n_closed = 5;
+    dvz_visual_data(&visual, DVZ_PROP_POS, 0, n_closed, points);
+    dvz_visual_data(&visual, DVZ_PROP_COLOR, 0, n_closed, colors);
+    dvz_visual_data(&visual, DVZ_PROP_LENGTH, 0, 1, (uint32_t[]){n_closed});
+    dvz_visual_data(&visual, DVZ_PROP_TOPOLOGY, 0, 1, (int32_t[]){DVZ_PATH_CLOSED});
+    _bake_visual(&visual, 1);
+    AT(arr->item_count == n_closed + 3);
+    vertex = (DvzGraphicsPathCompactVertex*)arr->data;
+    vec3 expected = {0};
+    for (uint32_t j = 0; j < n_closed + 3; j++)
+    {
+        _vec3_cast((const dvec3*)&points[(j + n_closed - 1) % n_closed], &expected);
+        AT(memcmp(vertex[j].pos, expected, sizeof(vec3)) == 0);
+    }
+    // The closing joint is a join and not a cap: the point after the last point is the first one.
+    AT(memcmp(vertex[n_closed].pos, vertex[n_closed + 1].pos, sizeof(vec3)) != 0);
+
+    // Back to the open paths for the screenshot.
+    dvz_visual_data(&visual, DVZ_PROP_POS, 0, N, points);
+    dvz_visual_data(&visual, DVZ_PROP_COLOR, 0, N, colors);
+    dvz_visual_data(&visual, DVZ_PROP_LENGTH, 0, n_paths, path_lengths);
+    dvz_visual_data(&visual, DVZ_PROP_TOPOLOGY, 0, 1, (int32_t[]){DVZ_PATH_OPEN});
+
+    dvz_visual_destroy(&visual_ref);
+    FREE(points);
+    FREE(colors);
+    FREE(path_lengths);
+
+    RUN;
+    SCREENSHOT("path_compact")
+    END;
+}
+
+
+
 /*************************************************************************************************/
 /* Polygon visual tests                                                                          */
 /*************************************************************************************************/
@@ -682,6 +1062,8 @@ int test_visuals_image_1(TestContext* context)
     dvz_visual_texture(&visual, DVZ_SOURCE_TYPE_IMAGE, 0, texture);
 
     RUN;
+    // The mip levels of a bound texture can no longer be allocated.
+    AT(texture->is_bound);
     SCREENSHOT("image")
     END;
 }
@@ -708,7 +1090,7 @@ int test_visuals_image_cmap(TestContext* context)
 
     // First texture.
     dvz_visual_texture(
-        &visual, DVZ_SOURCE_TYPE_COLOR_TEXTURE, 0, gpu->context->color_texture.texture);
+        &visual, DVZ_SOURCE_TYPE_COLOR_TEXTURE, 0, dvz_ctx_color_texture(gpu->context));
 
     // Random texture.
     // NOTE: use a uint16 texture here
@@ -733,6 +1115,661 @@ int test_visuals_image_cmap(TestContext* context)
 
 
 
+static void _tiled_pixel(uint32_t x, uint32_t y, cvec4 out)
+{
+    out[0] = (uint8_t)(x % 256);
+    out[1] = (uint8_t)(y % 256);
+    out[2] = (uint8_t)((x ^ y) % 256);
+    out[3] = 255;
+}
+
+// Update the tiled image until all tiles covering the view are in the atlas.
+static void _tiles_stream(DvzTiles* tiles, dvec4 view, uvec2 size)
+{
+    bool done = false;
+    for (uint32_t i = 0; i < 64 && !done; i++)
+    {
+        dvz_tiles_update(tiles, view, size);
+        dvz_tiles_wait(tiles);
+        done = true;
+        for (uint32_t k = 0; k < tiles->wanted_count; k++)
+            done &= tiles->tile_slot[tiles->wanted[k]] >= 0;
+    }
+    // Last update to compute the quads with the new tiles.
+    dvz_tiles_update(tiles, view, size);
+}
+
+int test_visuals_image_tiled(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    // 1000x700 image, 64x64 tiles, 5 levels, 176 + 48 + 12 + 4 + 1 tiles, 64 atlas slots.
+    const uint32_t width = 1000, height = 700;
+    cvec4* image = calloc(width * height, sizeof(cvec4));
+    for (uint32_t y = 0; y < height; y++)
+        for (uint32_t x = 0; x < width; x++)
+            _tiled_pixel(x, y, image[y * width + x]);
+    DvzTiles* tiles = dvz_tiles_image(canvas, (uvec2){width, height}, 64, (uvec2){8, 8}, image);
+    FREE(image);
+    AT(tiles->level_count == 5);
+    AT(tiles->tile_count == 241);
+    AT(tiles->slot_count == 64);
+
+    DvzVisual visual = dvz_visual(canvas);
+    dvz_visual_builtin(&visual, DVZ_VISUAL_IMAGE, 0);
+    dvz_tiles_visual(tiles, &visual);
+
+    // Full view: level 1 would require 65 tiles with its coarser levels, so level 2 is selected.
+    dvec4 view = {-1, -1, +1, +1};
+    uvec2 size = {800, 600};
+    dvz_tiles_budget(tiles, 1);
+    dvz_tiles_update(tiles, view, size);
+    DvzTileStats stats = dvz_tiles_stats(tiles);
+    AT(stats.level == 2);
+    AT(stats.drawn == 0);
+
+    // The coarsest tile is loaded first, and drawn in place of all tiles of the selected level.
+    dvz_tiles_wait(tiles);
+    dvz_tiles_update(tiles, view, size);
+    stats = dvz_tiles_stats(tiles);
+    AT(stats.uploads == 1);
+    AT(dvz_tiles_slot(tiles, 4, (uvec2){0, 0}) >= 0);
+    AT(stats.drawn == 12);
+    AT(stats.fallback == 12);
+
+    // Once all tiles are loaded, they are drawn at the selected level.
+    dvz_tiles_budget(tiles, DVZ_TILE_UPLOAD_BUDGET);
+    _tiles_stream(tiles, view, size);
+    stats = dvz_tiles_stats(tiles);
+    AT(stats.resident == 17);
+    AT(stats.drawn == 12);
+    AT(stats.fallback == 0);
+    AT(dvz_prop_size(dvz_prop_get(&visual, DVZ_PROP_POS, 0)) == 12);
+
+    // Check a tile in the atlas, with its apron, against the pyramid.
+    const uint32_t S = tiles->slot_size;
+    int32_t slot = dvz_tiles_slot(tiles, 2, (uvec2){3, 2});
+    AT(slot >= 0);
+    cvec4* data = calloc(S * S, sizeof(cvec4));
+    dvz_download_texture(
+        canvas, tiles->atlas, (uvec3){(slot % 8) * S, (slot / 8) * S, 0}, (uvec3){S, S, 1},
+        S * S * sizeof(cvec4), data);
+    uvec2 shape = {tiles->level_shape[2][0], tiles->level_shape[2][1]};
+    AT(shape[0] == 250 && shape[1] == 175);
+    int64_t x = 0, y = 0;
+    for (uint32_t j = 0; j < S; j++)
+    {
+        for (uint32_t i = 0; i < S; i++)
+        {
+            // The last tile of the level is partial, the apron repeats the image border.
+            x = CLIP((int64_t)(3 * 64 + i) - DVZ_TILE_APRON, 0, (int64_t)shape[0] - 1);
+            y = CLIP((int64_t)(2 * 64 + j) - DVZ_TILE_APRON, 0, (int64_t)shape[1] - 1);
+            AT(memcmp(data[j * S + i], tiles->levels[2][y * shape[0] + x], sizeof(cvec4)) == 0);
+        }
+    }
+    FREE(data);
+
+    // Zoom in the top left corner: full resolution.
+    view[0] = -1, view[1] = .9, view[2] = -.9, view[3] = 1;
+    _tiles_stream(tiles, view, size);
+    stats = dvz_tiles_stats(tiles);
+    AT(stats.level == 0);
+    AT(stats.drawn == 1);
+    AT(stats.fallback == 0);
+    AT(dvz_tiles_slot(tiles, 0, (uvec2){0, 0}) >= 0);
+
+    // Pan at full resolution: the least recently used tiles are evicted.
+    for (uint32_t k = 0; k < 20; k++)
+    {
+        view[0] = -1 + .09 * k, view[2] = view[0] + .2;
+        view[1] = -1 + .09 * k, view[3] = view[1] + .2;
+        _tiles_stream(tiles, view, size);
+        stats = dvz_tiles_stats(tiles);
+        AT(stats.level == 0);
+        AT(stats.fallback == 0);
+    }
+    AT(stats.resident == 64);
+    AT(stats.evictions > 0);
+    AT(dvz_tiles_slot(tiles, 0, (uvec2){0, 0}) == -1);
+    // The coarsest tile is wanted by every view, and it is never evicted.
+    AT(dvz_tiles_slot(tiles, 4, (uvec2){0, 0}) >= 0);
+    log_info(
+        "%d tile loads, %d evictions, mean latency %.3f ms", //
+        (int)stats.loads, (int)stats.evictions, 1000 * stats.latency_total / stats.uploads);
+
+    dvz_visual_destroy(&visual);
+    dvz_tiles_destroy(tiles);
+    TEST_END
+}
+
+
+
+// Procedural tiles of a virtual gigapixel image.
+static void _tiled_loader(DvzTiles* tiles, uint32_t level, uvec2 tile, cvec4* out, void* user_data)
+{
+    const uint32_t T = tiles->tile_size;
+    for (uint32_t j = 0; j < T; j++)
+        for (uint32_t i = 0; i < T; i++)
+            _tiled_pixel(
+                (tile[0] * T + i) >> (level % 8), (tile[1] * T + j) >> (level % 8),
+                out[j * T + i]);
+}
+
+static void _tiled_frame(DvzCanvas* canvas, DvzEvent ev)
+{
+    ASSERT(canvas != NULL);
+    DvzVisual* visual = (DvzVisual*)ev.user_data;
+    ASSERT(visual != NULL);
+    DvzTiles* tiles = visual->user_data;
+    ASSERT(tiles != NULL);
+
+    // Zoom in towards the image center while panning.
+    static DvzPanzoom panzoom = {0};
+    uint64_t frame = ev.u.f.idx;
+    if (frame == 0)
+        panzoom = _panzoom(canvas);
+    panzoom.zoom[0] = panzoom.zoom[1] = exp(.1 * frame);
+    panzoom.camera_pos[0] = panzoom.camera_pos[1] = .1 * sin(.05 * frame);
+
+    DvzMVP mvp = {0};
+    glm_mat4_identity(mvp.model);
+    _panzoom_update_mvp(canvas->viewport, &panzoom, &mvp);
+    DvzSource* source = dvz_source_get(visual, DVZ_SOURCE_TYPE_MVP, 0);
+    dvz_upload_buffers(canvas, source->u.br, 0, source->u.br.size, &mvp);
+
+    // Tile selection, requests, and uploads.
+    if (dvz_tiles_panzoom(tiles, &panzoom, canvas->viewport))
+    {
+        dvz_visual_update(visual, canvas->viewport, (DvzDataCoords){0}, NULL);
+        dvz_canvas_to_refill(canvas);
+    }
+}
+
+int test_visuals_image_tiled_stream(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    // 100k x 100k virtual image, larger than the maximum texture size.
+    const uint32_t n = 100000;
+    DvzTiles* tiles = dvz_tiles(canvas, (uvec2){n, n}, 256, (uvec2){16, 16}, _tiled_loader, NULL);
+    AT(tiles->level_count == 10);
+    AT(n > gpu->device_properties.limits.maxImageDimension2D);
+
+    DvzVisual visual = dvz_visual(canvas);
+    dvz_visual_builtin(&visual, DVZ_VISUAL_IMAGE, 0);
+    dvz_tiles_visual(tiles, &visual);
+    visual.user_data = tiles;
+
+    // Initial view.
+    _tiles_stream(tiles, (dvec4){-1, -1, +1, +1}, canvas->viewport.size_framebuffer);
+    _common_data(&visual);
+    dvz_event_callback(canvas, DVZ_EVENT_FRAME, 0, DVZ_EVENT_MODE_SYNC, _tiled_frame, &visual);
+
+    // Zoom to full resolution in 100 frames.
+    const uint32_t n_frames = 100;
+    DvzClock clock = {0};
+    _clock_init(&clock);
+    dvz_app_run(app, n_frames);
+    double elapsed = _clock_get(&clock);
+
+    DvzTileStats stats = dvz_tiles_stats(tiles);
+    AT(stats.level == 0);
+    AT(stats.uploads > 0);
+    log_info(
+        "%.1f FPS, %d tile uploads, tile latency %.2f ms (mean), %.2f ms (max)", //
+        n_frames / elapsed, (int)stats.uploads, 1000 * stats.latency_total / stats.uploads,
+        1000 * stats.latency_max);
+
+    dvz_visual_destroy(&visual);
+    dvz_tiles_destroy(tiles);
+    TEST_END
+}
+
+
+
+// CPU reference of the density aggregation, with the same pixel mapping as the shader.
+static void _density_cpu(
+    uint32_t n, const vec2* pos, const float* values, vec4 view, uvec2 size, uint32_t* counts,
+    float* sums)
+{
+    memset(counts, 0, size[0] * size[1] * sizeof(uint32_t));
+    memset(sums, 0, size[0] * size[1] * sizeof(float));
+    float u = 0, v = 0;
+    uint32_t idx = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        u = (pos[i][0] - view[0]) / (view[2] - view[0]);
+        v = (view[3] - pos[i][1]) / (view[3] - view[1]);
+        if (u < 0 || u >= 1 || v < 0 || v >= 1)
+            continue;
+        idx = MIN((uint32_t)(v * size[1]), size[1] - 1) * size[0] +
+              MIN((uint32_t)(u * size[0]), size[0] - 1);
+        counts[idx]++;
+        sums[idx] += values != NULL ? values[i] : 1;
+    }
+}
+
+// CPU reference of the normalization.
+static void _density_cpu_normalize(
+    uint32_t n, const uint32_t* counts, const float* sums, DvzDensityReduction reduction,
+    DvzDensityNormalization normalization, float* out)
+{
+    float* values = calloc(n, sizeof(float));
+    float vmin = INFINITY, vmax = -INFINITY;
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (counts[i] == 0)
+            continue;
+        values[i] = reduction == DVZ_DENSITY_REDUCTION_COUNT ? counts[i] : sums[i];
+        if (reduction == DVZ_DENSITY_REDUCTION_MEAN)
+            values[i] /= counts[i];
+        if (normalization != DVZ_DENSITY_NORMALIZATION_LINEAR)
+            values[i] = (values[i] > 0 ? 1 : -1) * logf(1 + fabsf(values[i]));
+        vmin = MIN(vmin, values[i]);
+        vmax = MAX(vmax, values[i]);
+        total++;
+    }
+
+    const uint32_t B = DVZ_DENSITY_HIST_BINS;
+    uint32_t* hist = calloc(B, sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        out[i] = 0;
+        if (counts[i] == 0)
+            continue;
+        out[i] = vmax > vmin ? CLIP((values[i] - vmin) / (vmax - vmin), 0, 1) : 1;
+        hist[MIN((uint32_t)(out[i] * B), B - 1)]++;
+    }
+    if (normalization == DVZ_DENSITY_NORMALIZATION_EQ_HIST)
+    {
+        float* cdf = calloc(B, sizeof(float));
+        uint32_t cumsum = 0;
+        for (uint32_t b = 0; b < B; b++)
+        {
+            cumsum += hist[b];
+            cdf[b] = cumsum / (float)total;
+        }
+        for (uint32_t i = 0; i < n; i++)
+            if (counts[i] > 0)
+                out[i] = cdf[MIN((uint32_t)(out[i] * B), B - 1)];
+        FREE(cdf);
+    }
+    FREE(hist);
+    FREE(values);
+}
+
+// Number of values differing by more than a relative tolerance.
+static uint32_t _density_mismatches(uint32_t n, const float* a, const float* b, float tol)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < n; i++)
+        count += fabsf(a[i] - b[i]) > tol * (1 + fabsf(b[i]));
+    return count;
+}
+
+// Compare the GPU grid and normalized values with the CPU reference.
+static int _density_check(
+    DvzDensity* density, uint32_t n, const vec2* pos, const float* values, vec4 view)
+{
+    DvzCanvas* canvas = density->canvas;
+    const uint32_t N = density->size[0] * density->size[1];
+    uint32_t* cells = calloc(2 * N, sizeof(uint32_t));
+    uint32_t* counts = calloc(N, sizeof(uint32_t));
+    float* sums = calloc(N, sizeof(float));
+    float* gpu = calloc(N, sizeof(float));
+    float* cpu = calloc(N, sizeof(float));
+    int res = 0;
+
+    // The downloads only wait for the compute queue, the aggregation is submitted to the render
+    // queue.
+    dvz_density_wait(density);
+    dvz_download_buffers(canvas, density->br_grid, 0, 2 * N * sizeof(uint32_t), cells);
+    _density_cpu(n, pos, values, view, density->size, counts, sums);
+    for (uint32_t i = 0; i < N; i++)
+    {
+        res |= cells[2 * i] != counts[i];
+        memcpy(&gpu[i], &cells[2 * i + 1], sizeof(float));
+        if (density->reduction == DVZ_DENSITY_REDUCTION_COUNT)
+            sums[i] = 0; // the sums are not accumulated
+    }
+    // The float sums depend on the order of the atomic additions.
+    res |= _density_mismatches(N, gpu, sums, 1e-4) > 0;
+
+    // A few pixel values may fall in a neighboring eq-hist bin on the GPU.
+    dvz_download_buffers(canvas, density->br_output, 0, N * sizeof(float), gpu);
+    _density_cpu_normalize(N, counts, sums, density->reduction, density->normalization, cpu);
+    res |= _density_mismatches(N, gpu, cpu, 1e-3) > N / 1000;
+
+    FREE(cells);
+    FREE(counts);
+    FREE(sums);
+    FREE(gpu);
+    FREE(cpu);
+    return res;
+}
+
+int test_visuals_density(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    // The grid is smaller than the viewport, the texture is used at full size.
+    const uint32_t W = 160, H = 120;
+    DvzDensity* density = dvz_density(canvas, (uvec2){W, H});
+    DvzVisual visual = dvz_visual(canvas);
+    dvz_visual_builtin(&visual, DVZ_VISUAL_IMAGE_CMAP, 0);
+    dvz_density_visual(density, &visual);
+
+    // Skewed distribution of points around the pixel centers, far from the pixel edges of
+    // the full view and of the zoomed view below, and a few points outside of the view.
+    const uint32_t n = 1000000;
+    vec2* pos = calloc(n, sizeof(vec2));
+    float* values = calloc(n, sizeof(float));
+    float x = 0, y = 0;
+    for (uint32_t k = 0; k < n; k++)
+    {
+        x = floorf(W * powf(dvz_rand_float(), 3)) + .5 + .4 * (dvz_rand_float() - .5);
+        y = floorf(H * powf(dvz_rand_float(), 2)) + .5 + .4 * (dvz_rand_float() - .5);
+        pos[k][0] = -1 + 2 * x / W + (k % 10 == 0 ? 2 : 0);
+        pos[k][1] = +1 - 2 * y / H;
+        values[k] = 2 * dvz_rand_float() - 1;
+    }
+
+    // Counts with eq-hist, by default.
+    vec4 view = {-1, -1, +1, +1};
+    dvz_density_data(density, n, pos, NULL);
+    AT(dvz_density_update(density, (dvec4){-1, -1, +1, +1}, canvas->viewport.size_framebuffer));
+    AT(density->aggregations == 1);
+    AT(density->size[0] == W && density->size[1] == H);
+    AT(_density_check(density, n, pos, NULL, view) == 0);
+
+    // The points are not aggregated again when nothing has changed.
+    AT(!dvz_density_update(density, (dvec4){-1, -1, +1, +1}, (uvec2){W, H}));
+    AT(density->aggregations == 1);
+
+    // The texture contains the normalized values.
+    float* image = calloc(W * H, sizeof(float));
+    float* output = calloc(W * H, sizeof(float));
+    dvz_download_texture(
+        canvas, density->texture, (uvec3){0, 0, 0}, (uvec3){W, H, 1}, W * H * sizeof(float),
+        image);
+    dvz_download_buffers(canvas, density->br_output, 0, W * H * sizeof(float), output);
+    AT(memcmp(image, output, W * H * sizeof(float)) == 0);
+    FREE(image);
+    FREE(output);
+
+    // Sums with a linear normalization, and means with a log normalization.
+    dvz_density_data(density, n, pos, values);
+    dvz_density_reduction(density, DVZ_DENSITY_REDUCTION_SUM);
+    dvz_density_normalization(density, DVZ_DENSITY_NORMALIZATION_LINEAR);
+    AT(!dvz_density_update(density, (dvec4){-1, -1, +1, +1}, (uvec2){W, H}));
+    AT(density->aggregations == 2);
+    AT(_density_check(density, n, pos, values, view) == 0);
+
+    dvz_density_reduction(density, DVZ_DENSITY_REDUCTION_MEAN);
+    dvz_density_normalization(density, DVZ_DENSITY_NORMALIZATION_LOG);
+    dvz_density_update(density, (dvec4){-1, -1, +1, +1}, (uvec2){W, H});
+    AT(_density_check(density, n, pos, values, view) == 0);
+
+    // Zoom: the points are aggregated again on the GPU, the image covers the new view.
+    DvzPanzoom panzoom = _panzoom(canvas);
+    panzoom.zoom[0] = panzoom.zoom[1] = 2;
+    panzoom.camera_pos[0] = -.5 + .5 / W;
+    panzoom.camera_pos[1] = +.5 - .5 / H;
+    AT(dvz_density_panzoom(density, &panzoom, canvas->viewport));
+    AT(density->aggregations == 4);
+    for (uint32_t i = 0; i < 4; i++)
+        view[i] = (float)density->view[i];
+    AT(_density_check(density, n, pos, values, view) == 0);
+    dvec3* corner = dvz_prop_item(dvz_prop_get(&visual, DVZ_PROP_POS, 0), 0);
+    AT(fabs(corner[0][0] - density->view[0]) < 1e-9);
+    AT(fabs(corner[0][1] - density->view[3]) < 1e-9);
+
+    // Another density map is not affected when this one grows past the size of the default
+    // storage buffer.
+    DvzDensity* other = dvz_density(canvas, (uvec2){W, H});
+    dvz_density_data(other, n, pos, NULL);
+    VkBuffer handle = other->br_pos.buffer->buffer;
+    const uint32_t n_big = DVZ_BUFFER_TYPE_STORAGE_SIZE / sizeof(vec2) + 1;
+    vec2* big = calloc(n_big, sizeof(vec2));
+    dvz_density_data(density, n_big, big, NULL);
+    AT(density->capacity == n_big);
+    AT(other->br_pos.buffer->buffer == handle);
+    view[0] = view[1] = -1;
+    view[2] = view[3] = +1;
+    dvz_density_update(other, (dvec4){-1, -1, +1, +1}, (uvec2){W, H});
+    AT(_density_check(other, n, pos, NULL, view) == 0);
+    FREE(big);
+    dvz_density_destroy(other);
+
+    FREE(pos);
+    FREE(values);
+    dvz_visual_destroy(&visual);
+    dvz_density_destroy(density);
+    TEST_END
+}
+
+
+
+// CPU reference of the histogram, with the same binning as the shader.
+static uint32_t
+_histogram_cpu(uint32_t n, const float* samples, vec2 range, uint32_t bin_count, uint32_t* counts)
+{
+    memset(counts, 0, bin_count * sizeof(uint32_t));
+    uint32_t total = 0;
+    float t = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (!(samples[i] >= range[0] && samples[i] <= range[1]))
+            continue;
+        t = (samples[i] - range[0]) / (range[1] - range[0]);
+        counts[MIN((uint32_t)(t * bin_count), bin_count - 1)]++;
+        total++;
+    }
+    return total;
+}
+
+// Compare the GPU counts with the CPU reference.
+static int _histogram_check(DvzHistogram* histogram, uint32_t n, const float* samples)
+{
+    const uint32_t B = histogram->bin_count;
+    uint32_t* gpu = calloc(B, sizeof(uint32_t));
+    uint32_t* cpu = calloc(B, sizeof(uint32_t));
+    int res = dvz_histogram_counts(histogram, gpu) !=
+              _histogram_cpu(n, samples, histogram->range, B, cpu);
+    res |= memcmp(gpu, cpu, B * sizeof(uint32_t)) != 0;
+    FREE(gpu);
+    FREE(cpu);
+    return res;
+}
+
+// Samples around the centers of the bins of the range (-3, 3), far from the bin edges of the
+// ranges and bin counts used in the test, with a few samples outside of the range.
+static float* _histogram_samples(uint32_t n, uint32_t bin_count)
+{
+    float* samples = calloc(n, sizeof(float));
+    const float width = 6.0f / bin_count;
+    float b = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        b = floorf(bin_count * CLIP(.5 + .15 * dvz_rand_normal(), 0, .999));
+        samples[i] = -3 + width * (b + .5 + .4 * (dvz_rand_float() - .5));
+        if (i % 100 == 0)
+            samples[i] = i % 200 == 0 ? 10 : NAN;
+    }
+    // The upper bound of the range belongs to the last bin.
+    samples[1] = 3;
+    return samples;
+}
+
+// Samples streamed at every frame, they must remain valid until the next frame.
+static float* _histogram_stream;
+
+static void _histogram_frame(DvzCanvas* canvas, DvzEvent ev)
+{
+    ASSERT(canvas != NULL);
+    DvzHistogram* histogram = (DvzHistogram*)ev.user_data;
+    ASSERT(histogram != NULL);
+    ASSERT(_histogram_stream != NULL);
+
+    dvz_histogram_append(histogram, 10000, _histogram_stream);
+    if (dvz_histogram_update(histogram))
+        dvz_canvas_to_refill(canvas);
+}
+
+int test_visuals_histogram(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    DvzHistogram* histogram = dvz_histogram(canvas, 100);
+    DvzVisual visual = dvz_visual(canvas);
+    dvz_visual_builtin(&visual, DVZ_VISUAL_HISTOGRAM, 0);
+    dvz_histogram_visual(histogram, &visual);
+    _common_data(&visual);
+
+    const uint32_t n = 1000000, m = 100000;
+    float* samples = _histogram_samples(n + m, 100);
+    dvz_histogram_range(histogram, -3, 3);
+    dvz_histogram_data(histogram, n, samples);
+    AT(dvz_histogram_update(histogram));
+    AT(histogram->dispatches == 1);
+    AT(_histogram_check(histogram, n, samples) == 0);
+
+    // The bars reach the top of the box for the largest bin.
+    const uint32_t B = histogram->bin_count;
+    uint32_t* counts = calloc(B, sizeof(uint32_t));
+    uint32_t max_count = 0;
+    dvz_histogram_counts(histogram, counts);
+    for (uint32_t i = 0; i < B; i++)
+        max_count = MAX(max_count, counts[i]);
+    DvzVertex* vertices = calloc(B * DVZ_HISTOGRAM_BAR_VERTICES, sizeof(DvzVertex));
+    dvz_download_buffers(
+        canvas, histogram->br_vertex, 0, B * DVZ_HISTOGRAM_BAR_VERTICES * sizeof(DvzVertex),
+        vertices);
+    DvzVertex* v = NULL;
+    for (uint32_t i = 0; i < B; i++)
+    {
+        // Top left vertex of the bar.
+        v = &vertices[DVZ_HISTOGRAM_BAR_VERTICES * i + 5];
+        AT(fabs(v->pos[0] - (-1 + 2.0 * i / B)) < 1e-5);
+        AT(fabs(v->pos[1] - (-1 + 2.0 * counts[i] / max_count)) < 1e-5);
+        AT(memcmp(v->color, (cvec4)DVZ_HISTOGRAM_DEFAULT_COLOR, sizeof(cvec4)) == 0);
+    }
+    FREE(vertices);
+    FREE(counts);
+
+    // Nothing to do when nothing has changed.
+    AT(!dvz_histogram_update(histogram));
+    AT(histogram->dispatches == 1);
+
+    // Only the appended samples are binned.
+    dvz_histogram_append(histogram, m, &samples[n]);
+    AT(!dvz_histogram_update(histogram));
+    AT(histogram->dispatches == 2);
+    AT(histogram->binned == n + m);
+    AT(_histogram_check(histogram, n + m, samples) == 0);
+
+    // Half of the range with the same bins.
+    dvz_histogram_range(histogram, -3, 0);
+    dvz_histogram_update(histogram);
+    AT(_histogram_check(histogram, n + m, samples) == 0);
+
+    // More bins than in shared memory: the visual must be filled again with the new vertices.
+    dvz_histogram_range(histogram, -3, 3);
+    dvz_histogram_bins(histogram, 5000);
+    AT(5000 > DVZ_HISTOGRAM_SHARED_BINS);
+    AT(dvz_histogram_update(histogram));
+    AT(_histogram_check(histogram, n + m, samples) == 0);
+
+    // Streaming: the samples appended during a frame are binned at the next update.
+    dvz_histogram_bins(histogram, 100);
+    dvz_histogram_data(histogram, 0, NULL);
+    _histogram_stream = _histogram_samples(10000, 100);
+    dvz_event_callback(
+        canvas, DVZ_EVENT_FRAME, 0, DVZ_EVENT_MODE_SYNC, _histogram_frame, histogram);
+    dvz_app_run(app, 10);
+    FREE(_histogram_stream);
+    AT(histogram->count == 100000);
+    AT(histogram->binned < histogram->count);
+    dvz_histogram_update(histogram);
+    AT(histogram->binned == histogram->count);
+    uint32_t total = 0;
+    counts = calloc(100, sizeof(uint32_t));
+    dvz_histogram_counts(histogram, counts);
+    for (uint32_t i = 0; i < 100; i++)
+        total += counts[i];
+    AT(total == 10 * (10000 - 100));
+    FREE(counts);
+
+    FREE(samples);
+    dvz_visual_destroy(&visual);
+    dvz_histogram_destroy(histogram);
+    TEST_END
+}
+
+int test_visuals_histogram_grow(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzContext* ctx = gpu->context;
+
+    // Two histograms, and regions of the default buffers as used by the other visuals.
+    DvzHistogram* histogram = dvz_histogram(canvas, 100);
+    DvzHistogram* other = dvz_histogram(canvas, 100);
+    DvzBufferRegions br_vertex = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_VERTEX, 1, 1024);
+    DvzBufferRegions br_storage = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_STORAGE, 1, 1024);
+    VkBuffer handles[] = {
+        other->br_samples.buffer->buffer, other->br_counts.buffer->buffer,
+        other->br_vertex.buffer->buffer, br_vertex.buffer->buffer, br_storage.buffer->buffer};
+
+    const uint32_t n = 100000;
+    float* samples = _histogram_samples(n, 100);
+    dvz_histogram_range(other, -3, 3);
+    dvz_histogram_data(other, n, samples);
+    dvz_histogram_update(other);
+
+    // The first histogram grows past the size of the default storage and vertex buffers. All
+    // samples are zero and fall in the middle bin.
+    const uint32_t n_big = DVZ_BUFFER_TYPE_STORAGE_SIZE / sizeof(float) + 1;
+    const uint32_t bins =
+        DVZ_BUFFER_TYPE_VERTEX_SIZE / (DVZ_HISTOGRAM_BAR_VERTICES * sizeof(DvzVertex)) + 1;
+    float* big = calloc(n_big, sizeof(float));
+    dvz_histogram_range(histogram, -1, 1);
+    dvz_histogram_data(histogram, n_big, big);
+    dvz_histogram_bins(histogram, bins);
+    dvz_histogram_update(histogram);
+    AT(histogram->br_samples.size > DVZ_BUFFER_TYPE_STORAGE_SIZE);
+    AT(histogram->br_vertex.size > DVZ_BUFFER_TYPE_VERTEX_SIZE);
+    uint32_t* counts = calloc(bins, sizeof(uint32_t));
+    AT(dvz_histogram_counts(histogram, counts) == n_big);
+    AT(counts[bins / 2] == n_big);
+
+    // The other histogram and the default buffers are not affected.
+    VkBuffer after[] = {
+        other->br_samples.buffer->buffer, other->br_counts.buffer->buffer,
+        other->br_vertex.buffer->buffer, br_vertex.buffer->buffer, br_storage.buffer->buffer};
+    AT(memcmp(handles, after, sizeof(handles)) == 0);
+    AT(_histogram_check(other, n, samples) == 0);
+
+    FREE(counts);
+    FREE(big);
+    FREE(samples);
+    dvz_histogram_destroy(histogram);
+    dvz_histogram_destroy(other);
+    TEST_END
+}
+
+
+
 /*************************************************************************************************/
 /*  Mesh visual tests                                                                            */
 /*************************************************************************************************/
@@ -851,7 +1888,7 @@ int test_visuals_volume_1(TestContext* context)
 
     // Colormap texture.
     dvz_visual_texture(
-        &visual, DVZ_SOURCE_TYPE_COLOR_TEXTURE, 0, gpu->context->color_texture.texture);
+        &visual, DVZ_SOURCE_TYPE_COLOR_TEXTURE, 0, dvz_ctx_color_texture(gpu->context));
 
     // Volume texture.
     DvzTexture* volume = _mouse_volume(canvas);
@@ -941,7 +1978,7 @@ int test_visuals_volume_slice(TestContext* context)
     // Texture.
     DvzTexture* volume = _mouse_volume(canvas);
     dvz_visual_texture(
-        &visual, DVZ_SOURCE_TYPE_COLOR_TEXTURE, 0, gpu->context->color_texture.texture);
+        &visual, DVZ_SOURCE_TYPE_COLOR_TEXTURE, 0, dvz_ctx_color_texture(gpu->context));
     dvz_visual_texture(&visual, DVZ_SOURCE_TYPE_VOLUME, 0, volume);
 
     DvzInteract interact = dvz_interact_builtin(canvas, DVZ_INTERACT_ARCBALL);
@@ -961,3 +1998,124 @@ int test_visuals_volume_slice(TestContext* context)
     SCREENSHOT("volume_slice")
     END;
 }
+
+
+
+static uint16_t _brick_voxel(int64_t x, int64_t y, int64_t z)
+{
+    return (uint16_t)((x * 7 + y * 131 + z * 1031) & 0xFFFF);
+}
+
+// Update the bricked volume until all bricks closest to the eye are in the cache.
+static void _bricks_stream(DvzBricks* bricks, vec3 eye)
+{
+    bool done = false;
+    for (uint32_t i = 0; i < 64 && !done; i++)
+    {
+        dvz_bricks_update(bricks, eye);
+        dvz_bricks_wait(bricks);
+        done = true;
+        for (uint32_t j = 0; j < bricks->wanted_count; j++)
+            done &= bricks->brick_slot[bricks->wanted[j]] >= 0;
+    }
+    // Last update to refresh the LRU order of the new bricks.
+    dvz_bricks_update(bricks, eye);
+}
+
+int test_visuals_volume_bricked(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    // Synthetic volume, with 8x8x8 bricks, 8 times larger than the cache.
+    const uint32_t n = 64;
+    const uint32_t B = 8;
+    uint16_t* volume = calloc(n * n * n, sizeof(uint16_t));
+    for (uint32_t z = 0; z < n; z++)
+        for (uint32_t y = 0; y < n; y++)
+            for (uint32_t x = 0; x < n; x++)
+                volume[(z * n + y) * n + x] = _brick_voxel(x, y, z);
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/bricks.raw", ARTIFACTS_DIR);
+    FILE* fp = fopen(path, "wb");
+    AT(fp != NULL);
+    fwrite(volume, sizeof(uint16_t), n * n * n, fp);
+    fclose(fp);
+    FREE(volume);
+
+    uvec3 shape = {n, n, n};
+    DvzBricks* bricks = dvz_bricks(canvas, path, shape, B, (uvec3){4, 4, 4});
+    AT(bricks != NULL);
+    AT(bricks->brick_count == 512);
+    AT(bricks->slot_count == 64);
+
+    // Stream the bricks closest to the first corner.
+    _bricks_stream(bricks, (vec3){0, 0, 0});
+    DvzBrickStats stats = dvz_bricks_stats(bricks);
+    AT(stats.resident == 64);
+    AT(stats.uploads == 64);
+    AT(stats.evictions == 0);
+    AT(dvz_bricks_slot(bricks, (uvec3){0, 0, 0}) >= 0);
+    AT(dvz_bricks_slot(bricks, (uvec3){3, 3, 3}) >= 0);
+    AT(dvz_bricks_slot(bricks, (uvec3){7, 7, 7}) == -1);
+
+    // Check the cached brick, with its apron, against the file.
+    const uint32_t S = bricks->slot_size;
+    uvec3 brick = {1, 0, 2};
+    int32_t slot = dvz_bricks_slot(bricks, brick);
+    AT(slot >= 0);
+    uvec3 offset = {(slot % 4) * S, ((slot / 4) % 4) * S, (slot / 16) * S};
+    uint16_t* data = calloc(S * S * S, sizeof(uint16_t));
+    dvz_download_texture(
+        canvas, bricks->cache, offset, (uvec3){S, S, S}, S * S * S * sizeof(uint16_t), data);
+    int64_t x = 0, y = 0, z = 0;
+    for (uint32_t k = 0; k < S; k++)
+    {
+        for (uint32_t j = 0; j < S; j++)
+        {
+            for (uint32_t i = 0; i < S; i++)
+            {
+                x = CLIP((int64_t)(brick[0] * B + i) - DVZ_BRICK_APRON, 0, (int64_t)n - 1);
+                y = CLIP((int64_t)(brick[1] * B + j) - DVZ_BRICK_APRON, 0, (int64_t)n - 1);
+                z = CLIP((int64_t)(brick[2] * B + k) - DVZ_BRICK_APRON, 0, (int64_t)n - 1);
+                AT(data[(k * S + j) * S + i] == _brick_voxel(x, y, z));
+            }
+        }
+    }
+    FREE(data);
+
+    // Move to the opposite corner: all bricks are evicted.
+    _bricks_stream(bricks, (vec3){1, 1, 1});
+    stats = dvz_bricks_stats(bricks);
+    AT(stats.resident == 64);
+    AT(stats.uploads == 128);
+    AT(stats.evictions == 64);
+    AT(dvz_bricks_slot(bricks, (uvec3){0, 0, 0}) == -1);
+    AT(dvz_bricks_slot(bricks, (uvec3){7, 7, 7}) >= 0);
+    AT(dvz_bricks_slot(bricks, (uvec3){4, 4, 4}) >= 0);
+
+    // The closest brick is the most recently used one.
+    AT(bricks->slot_brick[bricks->lru_head] == 511);
+
+    // The page table on the GPU matches the CPU copy.
+    cvec4* table = calloc(bricks->brick_count, sizeof(cvec4));
+    dvz_download_texture(
+        canvas, bricks->page_table, DVZ_ZERO_OFFSET, bricks->grid,
+        bricks->brick_count * sizeof(cvec4), table);
+    AT(memcmp(table, bricks->table, bricks->brick_count * sizeof(cvec4)) == 0);
+    AT(table[511][3] == 1);
+    AT(table[0][3] == 0);
+    FREE(table);
+
+    // Bind the bricked volume to a volume visual.
+    DvzVisual visual = dvz_visual(canvas);
+    dvz_visual_builtin(&visual, DVZ_VISUAL_VOLUME, DVZ_GRAPHICS_FLAGS_VOLUME_BRICKED);
+    AT((visual.graphics[0]->flags & DVZ_GRAPHICS_FLAGS_VOLUME_BRICKED) != 0);
+    dvz_bricks_visual(bricks, &visual);
+    AT(dvz_source_get(&visual, DVZ_SOURCE_TYPE_VOLUME, 1) != NULL);
+
+    dvz_visual_destroy(&visual);
+    dvz_bricks_destroy(bricks);
+    TEST_END
+}
@@ -18,6 +18,8 @@
 
 // Basic visuals.
 int test_visuals_point(TestContext* context);
+int test_visuals_point_cmap(TestContext* context);
+int test_visuals_point_cmap_bench(TestContext* context);
 int test_visuals_line(TestContext* context);
 int test_visuals_line_strip(TestContext* context);
 int test_visuals_triangle(TestContext* context);
@@ -26,17 +28,25 @@ int test_visuals_triangle_fan(TestContext* context);
 
 // 2D visuals.
 int test_visuals_marker(TestContext* context);
+int test_visuals_compact_pos(TestContext* context);
 int test_visuals_axes_2D_1(TestContext* context);
 int test_visuals_axes_2D_update(TestContext* context);
 int test_visuals_path(TestContext* context);
+int test_visuals_path_compact(TestContext* context);
 int test_visuals_polygon(TestContext* context);
 int test_visuals_image_1(TestContext* context);
 int test_visuals_image_cmap(TestContext* context);
+int test_visuals_image_tiled(TestContext* context);
+int test_visuals_image_tiled_stream(TestContext* context);
+int test_visuals_density(TestContext* context);
+int test_visuals_histogram(TestContext* context);
+int test_visuals_histogram_grow(TestContext* context);
 
 // 3D visuals.
 int test_visuals_mesh(TestContext* context);
 int test_visuals_volume_1(TestContext* context);
 int test_visuals_volume_slice(TestContext* context);
+int test_visuals_volume_bricked(TestContext* context);
 
 
 
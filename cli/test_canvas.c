@@ -7,6 +7,9 @@
 
 
 typedef struct TestParticle TestParticle;
+typedef struct TestOnDemand TestOnDemand;
+typedef struct TestCoalesce TestCoalesce;
+typedef struct TestStream TestStream;
 
 
 
@@ -19,6 +22,43 @@ struct TestParticle
 
 
 
+struct TestOnDemand
+{
+    DvzCanvas* canvas;
+    uint32_t frames;   // number of rendered frames
+    uint32_t requests; // number of frame requests made by the background thread
+};
+
+
+
+struct TestCoalesce
+{
+    uint32_t events;  // number of events received by the callback
+    uint32_t moves;   // number of mouse move events, including the coalesced ones
+    uint32_t wheels;  // number of mouse wheel events, including the coalesced ones
+    uint32_t keys;    // number of key press and release events
+    bool in_order;    // whether the key events were received in order, after the mouse events
+    vec2 pos, delta;  // last mouse position, and accumulated mouse displacement
+    vec2 dir;         // accumulated wheel direction
+    DvzClock clock;   // started before the burst of events
+    double done_time; // time when the last event was received
+    atomic(bool, done);
+};
+
+
+
+struct TestStream
+{
+    DvzTextureStream* stream;
+    uint32_t start_frame; // frame at which the stream is attached to the canvas
+    uint32_t done_frame;  // first frame at which the stream is done
+    double max_interval;  // maximum frame interval while streaming, in seconds
+    DvzClock clock;       // started when the stream is attached
+    double done_time;     // streaming duration, in seconds
+};
+
+
+
 /*************************************************************************************************/
 /*  Canvas buffer upload                                                                         */
 /*************************************************************************************************/
@@ -102,6 +142,119 @@ int test_canvas_transfer_texture(TestContext* context)
 
 
 
+/*************************************************************************************************/
+/*  Canvas texture streaming                                                                     */
+/*************************************************************************************************/
+
+static void _stream_frame(DvzCanvas* canvas, DvzEvent ev)
+{
+    TestStream* test = (TestStream*)ev.user_data;
+    ASSERT(test != NULL);
+    ASSERT(test->stream != NULL);
+
+    if (ev.u.f.idx == test->start_frame)
+    {
+        _clock_init(&test->clock);
+        dvz_stream_texture(canvas, test->stream);
+    }
+    else if (ev.u.f.idx > test->start_frame && test->done_frame == 0)
+    {
+        test->max_interval = MAX(test->max_interval, ev.u.f.interval);
+        if (test->stream->is_done)
+        {
+            test->done_frame = ev.u.f.idx;
+            test->done_time = _clock_get(&test->clock);
+        }
+    }
+}
+
+int test_canvas_texture_stream(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzContext* ctx = gpu->context;
+
+    const uint32_t n = 256;
+    VkDeviceSize size = n * n * 4;
+    uint8_t* data = calloc(size, sizeof(uint8_t));
+    for (uint32_t i = 0; i < size; i++)
+        data[i] = (uint8_t)(i % 251);
+
+    // Texture with a full mip chain.
+    DvzTexture* tex = dvz_ctx_texture(ctx, 2, (uvec3){n, n, 1}, VK_FORMAT_R8G8B8A8_UNORM);
+    dvz_texture_mips(tex, 0);
+    AT(tex->mip_count == 9);
+
+    // Chunks of 16 rows: the texture is uploaded over several frames.
+    TestStream test = {0};
+    test.start_frame = 2;
+    test.stream = dvz_texture_stream(tex, size, data, 16 * n * 4);
+    AT(test.stream->chunk_count == n / 16);
+    dvz_event_callback(canvas, DVZ_EVENT_FRAME, 0, DVZ_EVENT_MODE_SYNC, _stream_frame, &test);
+    dvz_app_run(app, 20);
+    AT(test.stream->is_done);
+    AT(test.done_frame > test.start_frame + 1);
+    AT(test.stream->uploaded == size);
+    AT(canvas->stream_count == 0);
+    dvz_texture_stream_destroy(test.stream);
+
+    // Download the base level.
+    uint8_t* data2 = calloc(size, sizeof(uint8_t));
+    dvz_download_texture(canvas, tex, DVZ_ZERO_OFFSET, (uvec3){n, n, 1}, size, data2);
+    AT(memcmp(data, data2, size) == 0);
+
+    FREE(data);
+    FREE(data2);
+    TEST_END
+}
+
+int test_canvas_texture_stream_bench(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzContext* ctx = gpu->context;
+
+    const uint32_t n = 4096;
+    VkDeviceSize size = (VkDeviceSize)n * n * 4;
+    uint8_t* data = calloc(size, sizeof(uint8_t));
+    for (VkDeviceSize i = 0; i < size; i++)
+        data[i] = (uint8_t)(i % 251);
+    uvec3 shape = {n, n, 1};
+
+    // Blocking upload, during which no frame can be rendered.
+    DvzTexture* tex = dvz_ctx_texture(ctx, 2, shape, VK_FORMAT_R8G8B8A8_UNORM);
+    dvz_texture_mips(tex, 0);
+    DvzClock clock = {0};
+    _clock_init(&clock);
+    dvz_upload_texture(canvas, tex, DVZ_ZERO_OFFSET, DVZ_ZERO_OFFSET, size, data);
+    double dt_sync = _clock_get(&clock);
+
+    // Streaming upload, a few chunks per frame.
+    TestStream test = {0};
+    test.start_frame = 5;
+    test.stream = dvz_texture_stream(tex, size, data, 0);
+    dvz_event_callback(canvas, DVZ_EVENT_FRAME, 0, DVZ_EVENT_MODE_SYNC, _stream_frame, &test);
+    dvz_app_run(app, 100);
+    AT(test.stream->is_done);
+    AT(test.done_time > 0);
+
+    log_info(
+        "%s texture with mips: blocking upload %.1f ms (%.0f MB/s), streamed in %d frames, "
+        "%.1f ms (%.0f MB/s), max frame interval %.1f ms",
+        pretty_size(size), dt_sync * 1e3, size / dt_sync / 1e6,
+        test.done_frame - test.start_frame, test.done_time * 1e3, size / test.done_time / 1e6,
+        test.max_interval * 1e3);
+    AT(test.done_frame > test.start_frame + 1);
+
+    dvz_texture_stream_destroy(test.stream);
+    FREE(data);
+    TEST_END
+}
+
+
+
 /*************************************************************************************************/
 /*  Canvas 1                                                                                     */
 /*************************************************************************************************/
@@ -1165,6 +1318,194 @@ int test_canvas_offscreen(TestContext* context)
 
 
 
+/*************************************************************************************************/
+/*  Canvas on demand                                                                             */
+/*************************************************************************************************/
+
+static void _on_demand_frame(DvzCanvas* canvas, DvzEvent ev)
+{
+    TestOnDemand* test = (TestOnDemand*)ev.user_data;
+    ASSERT(test != NULL);
+    test->frames++;
+}
+
+static void* _on_demand_thread(void* user_data)
+{
+    TestOnDemand* test = (TestOnDemand*)user_data;
+    ASSERT(test != NULL);
+
+    // A few frame requests, then an idle period, then close the canvas.
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        dvz_sleep(50);
+        dvz_canvas_request_frame(test->canvas);
+        test->requests++;
+    }
+    dvz_sleep(500);
+    dvz_canvas_to_close(test->canvas);
+    return NULL;
+}
+
+int test_canvas_on_demand(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, DVZ_CANVAS_FLAGS_ON_DEMAND);
+    AT(canvas->on_demand);
+
+    TestOnDemand test = {0};
+    test.canvas = canvas;
+    dvz_event_callback(canvas, DVZ_EVENT_FRAME, 0, DVZ_EVENT_MODE_SYNC, _on_demand_frame, &test);
+
+    // Run the main loop until the background thread closes the canvas.
+    DvzThread thread = dvz_thread(_on_demand_thread, &test);
+    DvzClock clock = {0};
+    _clock_init(&clock);
+    clock_t cpu = clock();
+    dvz_app_run(app, 0);
+    double cpu_time = (clock() - cpu) / (double)CLOCKS_PER_SEC;
+    double elapsed = _clock_get(&clock);
+    dvz_thread_join(&thread);
+
+    log_info(
+        "%d frames for %d requests in %.3f s, %d wakeups (%.1f/s), CPU usage %.1f%%",
+        test.frames, test.requests, elapsed, (int)app->wakeups, app->wakeups / elapsed,
+        100 * cpu_time / elapsed);
+
+    // The first frame, then at most one frame per request, and no frame while idle.
+    AT(test.frames >= 2);
+    AT(test.frames <= 1 + test.requests);
+    // One wakeup per request, plus the close request.
+    AT(app->wakeups <= test.requests + 2);
+    AT(cpu_time < .5 * elapsed);
+
+    TEST_END
+}
+
+
+
+/*************************************************************************************************/
+/*  Canvas event coalescing                                                                      */
+/*************************************************************************************************/
+
+#define COALESCE_BLOCKS 100
+#define COALESCE_MOVES  900
+#define COALESCE_WHEELS 98
+#define COALESCE_EPS    1e-3
+
+static void _coalesce_callback(DvzCanvas* canvas, DvzEvent ev)
+{
+    TestCoalesce* test = (TestCoalesce*)ev.user_data;
+    ASSERT(test != NULL);
+    test->events++;
+
+    // Deliberately slow callback.
+    dvz_sleep(1);
+
+    uint32_t block = test->keys / 2;
+    switch (ev.type)
+    {
+    case DVZ_EVENT_MOUSE_MOVE:
+        glm_vec2_copy(ev.u.m.pos, test->pos);
+        glm_vec2_add(test->delta, ev.u.m.delta, test->delta);
+        test->moves += ev.u.m.count;
+        break;
+
+    case DVZ_EVENT_MOUSE_WHEEL:
+        glm_vec2_add(test->dir, ev.u.w.dir, test->dir);
+        test->wheels += ev.u.w.count;
+        break;
+
+    case DVZ_EVENT_KEY_PRESS:
+    case DVZ_EVENT_KEY_RELEASE:
+        // The key events of each block must come after all mouse events of the block, with
+        // alternating press and release events.
+        test->in_order &= ev.u.k.key_code == (DvzKeyCode)(DVZ_KEY_A + block % 26);
+        test->in_order &= (ev.type == DVZ_EVENT_KEY_PRESS) == (test->keys % 2 == 0);
+        test->in_order &= test->moves == COALESCE_MOVES * (block + 1);
+        test->in_order &= test->wheels == COALESCE_WHEELS * (block + 1);
+        test->keys++;
+        if (test->keys == 2 * COALESCE_BLOCKS)
+        {
+            test->done_time = _clock_get(&test->clock);
+            bool done = true;
+            atomic_store(&test->done, done);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+int test_canvas_coalesce(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    TestCoalesce test = {0};
+    test.in_order = true;
+    atomic_init(&test.done, false);
+    _clock_init(&test.clock);
+
+    DvzEventType types[] = {
+        DVZ_EVENT_MOUSE_MOVE, DVZ_EVENT_MOUSE_WHEEL, DVZ_EVENT_KEY_PRESS, DVZ_EVENT_KEY_RELEASE};
+    for (uint32_t i = 0; i < 4; i++)
+        dvz_event_callback(canvas, types[i], 0, DVZ_EVENT_MODE_ASYNC, _coalesce_callback, &test);
+
+    // Burst of 100k events: in each block, mouse moves, then wheel ticks, then a key press and
+    // release that must never be dropped.
+    vec2 pos = {0};
+    uint32_t k = 0;
+    for (uint32_t block = 0; block < COALESCE_BLOCKS; block++)
+    {
+        for (uint32_t i = 0; i < COALESCE_MOVES; i++)
+        {
+            k++;
+            pos[0] = k % 800;
+            pos[1] = (3 * k) % 600;
+            dvz_event_mouse_move(canvas, pos, 0);
+        }
+        for (uint32_t i = 0; i < COALESCE_WHEELS; i++)
+            dvz_event_mouse_wheel(canvas, (vec2){0, 1}, 0);
+        dvz_event_key_press(canvas, (DvzKeyCode)(DVZ_KEY_A + block % 26), 0);
+        dvz_event_key_release(canvas, (DvzKeyCode)(DVZ_KEY_A + block % 26), 0);
+    }
+    double burst_time = _clock_get(&test.clock);
+
+    // Wait until the last event has been processed.
+    for (uint32_t i = 0; i < 10000 && !atomic_load(&test.done); i++)
+        dvz_sleep(1);
+    AT(atomic_load(&test.done));
+    double latency = test.done_time - burst_time;
+    log_info(
+        "%d events coalesced into %d callbacks, burst in %.3f s, latency %.3f s",
+        COALESCE_BLOCKS * (COALESCE_MOVES + COALESCE_WHEELS + 2), test.events, burst_time,
+        latency);
+
+    // No event was lost.
+    AT(test.in_order);
+    AT(test.keys == 2 * COALESCE_BLOCKS);
+    AT(test.moves == COALESCE_BLOCKS * COALESCE_MOVES);
+    AT(test.wheels == COALESCE_BLOCKS * COALESCE_WHEELS);
+    AC(test.pos[0], pos[0], COALESCE_EPS);
+    AC(test.pos[1], pos[1], COALESCE_EPS);
+    AC(test.delta[0], pos[0], COALESCE_EPS);
+    AC(test.delta[1], pos[1], COALESCE_EPS);
+    AC(test.dir[0], 0, COALESCE_EPS);
+    AC(test.dir[1], COALESCE_BLOCKS * COALESCE_WHEELS, COALESCE_EPS);
+
+    // The slow callback was called far fewer times than the number of events, and the queue was
+    // drained quickly after the burst.
+    AT(test.events <= 4 * COALESCE_BLOCKS);
+    AT(latency < 1);
+
+    TEST_END
+}
+
+
+
 /*************************************************************************************************/
 /*  Canvas GUI                                                                                   */
 /*************************************************************************************************/
@@ -12,6 +12,8 @@
 
 int test_canvas_transfer_buffer(TestContext* context);
 int test_canvas_transfer_texture(TestContext* context);
+int test_canvas_texture_stream(TestContext* context);
+int test_canvas_texture_stream_bench(TestContext* context);
 int test_canvas_1(TestContext* context);
 int test_canvas_2(TestContext* context);
 int test_canvas_3(TestContext* context);
@@ -24,6 +26,8 @@ int test_canvas_depth(TestContext* context);
 int test_canvas_append(TestContext* context);
 int test_canvas_particles(TestContext* context);
 int test_canvas_offscreen(TestContext* context);
+int test_canvas_on_demand(TestContext* context);
+int test_canvas_coalesce(TestContext* context);
 int test_canvas_gui_1(TestContext* context);
 int test_canvas_screencast(TestContext* context);
 
@@ -1,5 +1,6 @@
 #include "test_common.h"
 #include "../include/datoviz/common.h"
+#include "../include/datoviz/jobs.h"
 
 
 
@@ -232,3 +233,281 @@ int test_fifo_3(TestContext* context)
     dvz_fifo_destroy(&fifo);
     return 0;
 }
+
+
+
+// Merge small numbers by summing them into the last item.
+static bool _fifo_merge(void* last, void* item)
+{
+    uint32_t* a = (uint32_t*)last;
+    uint32_t* b = (uint32_t*)item;
+    if (*a >= 100 || *b >= 100)
+        return false;
+    *a += *b;
+    return true;
+}
+
+int test_fifo_merge(TestContext* context)
+{
+    DvzFifo fifo = dvz_fifo(8);
+    uint32_t numbers[] = {1, 2, 3, 200, 4, 5, 7, 8};
+
+    // Nothing to merge into an empty queue.
+    AT(!dvz_fifo_enqueue_merge(&fifo, &numbers[0], _fifo_merge));
+    AT(dvz_fifo_enqueue_merge(&fifo, &numbers[1], _fifo_merge));
+    AT(dvz_fifo_enqueue_merge(&fifo, &numbers[2], _fifo_merge));
+    AT(!dvz_fifo_enqueue_merge(&fifo, &numbers[3], _fifo_merge));
+    AT(!dvz_fifo_enqueue_merge(&fifo, &numbers[4], _fifo_merge));
+    AT(dvz_fifo_enqueue_merge(&fifo, &numbers[5], _fifo_merge));
+    AT(dvz_fifo_size(&fifo) == 3);
+
+    uint32_t* n = dvz_fifo_dequeue(&fifo, false);
+    AT(n == &numbers[0]);
+    AT(*n == 6);
+
+    // Merge into the last item, after the first one has been dequeued.
+    AT(dvz_fifo_enqueue_merge(&fifo, &numbers[6], _fifo_merge));
+    n = dvz_fifo_dequeue(&fifo, false);
+    AT(*n == 200);
+    n = dvz_fifo_dequeue(&fifo, false);
+    AT(n == &numbers[4]);
+    AT(*n == 16);
+
+    // A dequeued item is never merged into.
+    AT(!dvz_fifo_enqueue_merge(&fifo, &numbers[7], _fifo_merge));
+    AT(dvz_fifo_size(&fifo) == 1);
+    dvz_fifo_reset(&fifo);
+
+    // The queue grows beyond its initial capacity instead of dropping items.
+    uint32_t big[2048] = {0};
+    for (uint32_t i = 0; i < 2048; i++)
+    {
+        big[i] = 100 + i;
+        AT(!dvz_fifo_enqueue_merge(&fifo, &big[i], _fifo_merge));
+    }
+    AT(dvz_fifo_size(&fifo) == 2048);
+    for (uint32_t i = 0; i < 2048; i++)
+    {
+        n = dvz_fifo_dequeue(&fifo, false);
+        AT(*n == 100 + i);
+    }
+    dvz_fifo_destroy(&fifo);
+
+    // The queue also grows when the items wrap around the end of the buffer, with the head at
+    // the start of the buffer (shift of 1) or after it.
+    for (uint32_t shift = 1; shift <= 3; shift++)
+    {
+        fifo = dvz_fifo(8);
+        for (uint32_t i = 0; i < shift; i++)
+        {
+            dvz_fifo_enqueue(&fifo, &big[i]);
+            dvz_fifo_dequeue(&fifo, false);
+        }
+        for (uint32_t i = 0; i < 20; i++)
+            dvz_fifo_enqueue(&fifo, &big[i]);
+        AT(dvz_fifo_size(&fifo) == 20);
+        for (uint32_t i = 0; i < 20; i++)
+        {
+            n = dvz_fifo_dequeue(&fifo, false);
+            AT(n == &big[i]);
+        }
+        dvz_fifo_destroy(&fifo);
+    }
+
+    return 0;
+}
+
+
+
+/*************************************************************************************************/
+/*  Job system                                                                                   */
+/*************************************************************************************************/
+
+typedef struct TestJobs TestJobs;
+struct TestJobs
+{
+    uint32_t thread_count;
+    uint32_t* runs;    // number of runs of each job
+    uint32_t* threads; // thread that ran each job
+};
+
+static void _jobs_callback(DvzJobs* jobs, uint32_t job_idx, uint32_t thread_idx, void* user_data)
+{
+    TestJobs* test = (TestJobs*)user_data;
+    ASSERT(test != NULL);
+    test->runs[job_idx]++;
+    test->threads[job_idx] = thread_idx;
+}
+
+int test_jobs(TestContext* context)
+{
+    const uint32_t job_count = 1000;
+    TestJobs test = {0};
+    test.runs = calloc(job_count, sizeof(uint32_t));
+    test.threads = calloc(job_count, sizeof(uint32_t));
+
+    uint32_t thread_counts[] = {0, 1, 3, 8};
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        test.thread_count = thread_counts[i];
+        DvzJobs* jobs = dvz_jobs(test.thread_count);
+        memset(test.runs, 0, job_count * sizeof(uint32_t));
+
+        // Each batch runs every job exactly once.
+        for (uint32_t batch = 1; batch <= 10; batch++)
+        {
+            dvz_jobs_run(jobs, batch * job_count / 10, _jobs_callback, &test);
+            for (uint32_t j = 0; j < job_count; j++)
+                AT(test.runs[j] == batch - MIN(batch, 10 * j / job_count));
+        }
+
+        // The jobs are statically assigned to the threads.
+        for (uint32_t j = 0; j < job_count; j++)
+            AT(test.threads[j] == (test.thread_count > 0 ? j % test.thread_count : 0));
+
+        // An empty batch does not run anything.
+        dvz_jobs_run(jobs, 0, _jobs_callback, &test);
+        AT(test.runs[0] == 10);
+
+        dvz_jobs_destroy(jobs);
+    }
+
+    FREE(test.runs);
+    FREE(test.threads);
+    return 0;
+}
+
+
+
+/*************************************************************************************************/
+/*  Logging                                                                                      */
+/*************************************************************************************************/
+
+#define TEST_LOG_THREADS  4
+#define TEST_LOG_MESSAGES 1000
+
+static int _log_evaluated(int* count)
+{
+    (*count)++;
+    return *count;
+}
+
+static void* _log_thread(void* user_data)
+{
+    uint32_t idx = (uint32_t)(uint64_t)user_data;
+    for (uint32_t i = 0; i < TEST_LOG_MESSAGES; i++)
+        log_info("log thread #%d message #%d", idx, i);
+    return NULL;
+}
+
+int test_log(TestContext* context)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/log.txt", ARTIFACTS_DIR);
+    FILE* fp = fopen(path, "w");
+    AT(fp != NULL);
+    log_set_fp(fp);
+    log_set_quiet(1);
+    log_set_level(LOG_INFO);
+
+    // The arguments of filtered messages are not evaluated.
+    int count = 0;
+    log_debug("not evaluated %d", _log_evaluated(&count));
+    AT(count == 0);
+    log_info("evaluated %d", _log_evaluated(&count));
+    AT(count == 1);
+
+    // Messages from several threads.
+    DvzThread threads[TEST_LOG_THREADS] = {0};
+    for (uint64_t i = 0; i < TEST_LOG_THREADS; i++)
+        threads[i] = dvz_thread(_log_thread, (void*)i);
+    for (uint32_t i = 0; i < TEST_LOG_THREADS; i++)
+        dvz_thread_join(&threads[i]);
+    log_flush();
+    log_set_fp(NULL);
+    fclose(fp);
+
+    // All messages are written, in order within each thread.
+    fp = fopen(path, "r");
+    AT(fp != NULL);
+    char line[1024];
+    uint32_t next[TEST_LOG_THREADS] = {0};
+    uint32_t evaluated = 0, idx = 0, i = 0;
+    const char* msg = NULL;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        if (strstr(line, "evaluated 1") != NULL)
+            evaluated++;
+        msg = strstr(line, "log thread #");
+        if (msg == NULL)
+            continue;
+        AT(sscanf(msg, "log thread #%u message #%u", &idx, &i) == 2);
+        AT(idx < TEST_LOG_THREADS);
+        AT(i == next[idx]);
+        next[idx]++;
+    }
+    fclose(fp);
+    AT(evaluated == 1);
+    for (uint32_t k = 0; k < TEST_LOG_THREADS; k++)
+        AT(next[k] == TEST_LOG_MESSAGES);
+
+    log_set_quiet(0);
+    log_set_level_env();
+    return 0;
+}
+
+int test_log_bench(TestContext* context)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/log_bench.txt", ARTIFACTS_DIR);
+    FILE* fp = fopen(path, "w");
+    AT(fp != NULL);
+    log_set_fp(fp);
+    log_set_quiet(1);
+    log_set_level(LOG_INFO);
+
+    // Filtered messages.
+    const uint32_t n = 1000000;
+    DvzClock clock = {0};
+    _clock_init(&clock);
+    for (uint32_t i = 0; i < n; i++)
+        log_debug("disabled message #%d", i);
+    double dt_disabled = _clock_get(&clock) / n;
+
+    // Enabled messages, in bursts that fit in the per-thread buffer. The flushes, done by the
+    // background thread in practice, are not timed.
+    const uint32_t bursts = 1000, burst = 64;
+    double dt_async = 0;
+    for (uint32_t k = 0; k < bursts; k++)
+    {
+        _clock_init(&clock);
+        for (uint32_t i = 0; i < burst; i++)
+            log_info("enabled message #%d", i);
+        dt_async += _clock_get(&clock);
+        log_flush();
+    }
+    dt_async /= bursts * burst;
+
+    // Enabled messages written on the calling thread.
+    log_set_async(0);
+    _clock_init(&clock);
+    for (uint32_t i = 0; i < bursts * burst; i++)
+        log_info("enabled message #%d", i);
+    double dt_sync = _clock_get(&clock) / (bursts * burst);
+    log_set_async(1);
+
+    log_set_fp(NULL);
+    fclose(fp);
+    log_set_quiet(0);
+    log_set_level_env();
+
+    // NOTE: the timings depend on the machine load, they are logged but not checked.
+    log_info(
+        "log call: %.1f ns disabled, %.1f ns enabled, %.1f ns enabled without the flusher thread",
+        dt_disabled * 1e9, dt_async * 1e9, dt_sync * 1e9);
+    log_info(
+        "log call: enabled %.1fx slower than disabled, %.1fx faster than without the flusher "
+        "thread",
+        dt_async / dt_disabled, dt_sync / dt_async);
+    return 0;
+}
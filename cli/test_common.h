@@ -21,6 +21,24 @@ int test_container(TestContext* context);
 int test_fifo_1(TestContext* context);
 int test_fifo_2(TestContext* context);
 int test_fifo_3(TestContext* context);
+int test_fifo_merge(TestContext* context);
+
+
+
+/*************************************************************************************************/
+/*  Job system                                                                                   */
+/*************************************************************************************************/
+
+int test_jobs(TestContext* context);
+
+
+
+/*************************************************************************************************/
+/*  Logging                                                                                      */
+/*************************************************************************************************/
+
+int test_log(TestContext* context);
+int test_log_bench(TestContext* context);
 
 
 
@@ -76,7 +76,11 @@ static void _graphics_refill(DvzCanvas* canvas, DvzEvent ev)
         else
         {
             log_debug("draw non-indexed %d", tg->vertices.item_count);
-            dvz_cmd_draw(cmds, idx, 0, tg->vertices.item_count);
+            if (graphics->instance_vertex_count > 0)
+                dvz_cmd_draw_instanced(
+                    cmds, idx, 0, graphics->instance_vertex_count, 0, tg->vertices.item_count);
+            else
+                dvz_cmd_draw(cmds, idx, 0, tg->vertices.item_count);
         }
     }
     dvz_cmd_end_renderpass(cmds, idx);
@@ -348,7 +352,7 @@ int test_graphics_depth(TestContext* context)
     dvz_bindings_buffer(&tg.bindings, DVZ_USER_BINDING, tg.br_params);
     for (uint32_t i = 1; i <= 4; i++)
         dvz_bindings_texture(
-            &tg.bindings, DVZ_USER_BINDING + i, gpu->context->color_texture.texture);
+            &tg.bindings, DVZ_USER_BINDING + i, dvz_ctx_color_texture(gpu->context));
     dvz_bindings_update(&tg.bindings);
 
     DvzGraphicsMeshParams params = default_graphics_mesh_params(tg.eye);
@@ -676,6 +680,142 @@ int test_graphics_segment(TestContext* context)
 
 
 
+// Upload radial segments to a canvas, with regular or instanced segments.
+static void _segment_data(DvzCanvas* canvas, int flags, uint32_t n, TestGraphics* tg)
+{
+    DvzContext* ctx = canvas->gpu->context;
+    tg->canvas = canvas;
+    tg->graphics = dvz_graphics_builtin(canvas, DVZ_GRAPHICS_SEGMENT, flags);
+    tg->vertices = dvz_array_struct(0, sizeof(DvzGraphicsSegmentVertex));
+    tg->indices = dvz_array_struct(0, sizeof(DvzIndex));
+    DvzGraphicsData data = dvz_graphics_data(tg->graphics, &tg->vertices, &tg->indices, NULL);
+    dvz_graphics_alloc(&data, n);
+
+    DvzGraphicsSegmentVertex vertex = {0};
+    float t = 0, a = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        t = (float)i / (float)n;
+        a = M_2PI * t;
+        vertex.P0[0] = .2 * cos(a);
+        vertex.P0[1] = .2 * sin(a);
+        vertex.P1[0] = .9 * cos(a);
+        vertex.P1[1] = .9 * sin(a);
+        vertex.linewidth = 2 + 10 * t;
+        dvz_colormap_scale(DVZ_CMAP_RAINBOW, t, 0, 1, vertex.color);
+        vertex.cap0 = vertex.cap1 = i % DVZ_CAP_COUNT;
+        dvz_graphics_append(&data, &vertex);
+    }
+
+    VkDeviceSize size = tg->vertices.item_count * tg->vertices.item_size;
+    tg->br_vert = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_VERTEX, 1, size);
+    dvz_upload_buffers(canvas, tg->br_vert, 0, size, tg->vertices.data);
+    if (tg->indices.item_count > 0)
+    {
+        size = tg->indices.item_count * tg->indices.item_size;
+        tg->br_index = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_INDEX, 1, size);
+        dvz_upload_buffers(canvas, tg->br_index, 0, size, tg->indices.data);
+    }
+
+    _common_bindings(tg);
+    dvz_bindings_update(&tg->bindings);
+    dvz_upload_buffers(canvas, tg->br_viewport, 0, sizeof(DvzViewport), &canvas->viewport);
+    dvz_event_callback(canvas, DVZ_EVENT_REFILL, 0, DVZ_EVENT_MODE_SYNC, _graphics_refill, tg);
+}
+
+int test_graphics_segment_instanced(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+
+    // The same segments, drawn with regular and instanced segments in two canvases.
+    const uint32_t N = 64;
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzCanvas* canvas_inst = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    TestGraphics tg = {0};
+    TestGraphics tg_inst = {0};
+    _segment_data(canvas, 0, N, &tg);
+    _segment_data(canvas_inst, DVZ_GRAPHICS_FLAGS_SEGMENT_INSTANCED, N, &tg_inst);
+
+    // One vertex per segment, and no index buffer.
+    AT(tg_inst.graphics->instance_vertex_count == 4);
+    AT(tg_inst.vertices.item_count == N);
+    AT(tg.vertices.item_count == 4 * N);
+    AT(tg_inst.indices.item_count == 0);
+    AT(tg.indices.item_count == 6 * N);
+
+    dvz_app_run(app, 5);
+
+    // The images must be the same, up to rounding errors in the interpolation.
+    uint8_t* rgb = dvz_screenshot(canvas, false);
+    uint8_t* rgb_inst = dvz_screenshot(canvas_inst, false);
+    uint32_t lit = 0, max_diff = 0;
+    for (uint32_t i = 0; i < TEST_WIDTH * TEST_HEIGHT * 3; i++)
+    {
+        lit += rgb[i] > 0;
+        max_diff = MAX(max_diff, (uint32_t)abs((int)rgb[i] - (int)rgb_inst[i]));
+    }
+    log_debug("%d lit pixel components, max difference %d", lit, max_diff);
+    AT(lit > 1000);
+    AT(max_diff <= 2);
+
+    FREE(rgb);
+    FREE(rgb_inst);
+    dvz_array_destroy(&tg.vertices);
+    dvz_array_destroy(&tg.indices);
+    dvz_array_destroy(&tg_inst.vertices);
+    dvz_array_destroy(&tg_inst.indices);
+    TEST_END
+}
+
+int test_graphics_segment_bench(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    const uint32_t N = 1000000;
+    int flags[2] = {0, DVZ_GRAPHICS_FLAGS_SEGMENT_INSTANCED};
+    VkDeviceSize sizes[2] = {0};
+    DvzGraphicsSegmentVertex vertex = {0};
+    vertex.linewidth = 2;
+    vertex.color[3] = 255;
+
+    DvzClock clock = {0};
+    for (uint32_t k = 0; k < 2; k++)
+    {
+        DvzGraphics* graphics = dvz_graphics_builtin(canvas, DVZ_GRAPHICS_SEGMENT, flags[k]);
+        DvzArray vertices = dvz_array_struct(0, sizeof(DvzGraphicsSegmentVertex));
+        DvzArray indices = dvz_array_struct(0, sizeof(DvzIndex));
+        DvzGraphicsData data = dvz_graphics_data(graphics, &vertices, &indices, NULL);
+
+        _clock_init(&clock);
+        dvz_graphics_alloc(&data, N);
+        for (uint32_t i = 0; i < N; i++)
+        {
+            vertex.P0[0] = vertex.P1[1] = (float)i / N;
+            dvz_graphics_append(&data, &vertex);
+        }
+        double elapsed = _clock_get(&clock);
+
+        sizes[k] = vertices.item_count * vertices.item_size;
+        sizes[k] += indices.item_count * indices.item_size;
+        log_info(
+            "%s segments: baked %.1fM segments/s, %s of vertex and index data",
+            k == 0 ? "regular" : "instanced", N / elapsed / 1e6, pretty_size(sizes[k]));
+
+        dvz_array_destroy(&vertices);
+        dvz_array_destroy(&indices);
+    }
+
+    // The instanced segments need at least 4x less memory.
+    AT(4 * sizes[1] <= sizes[0]);
+
+    TEST_END
+}
+
+
+
 /*************************************************************************************************/
 /*  Agg path tests                                                                               */
 /*************************************************************************************************/
@@ -754,7 +894,7 @@ int test_graphics_text(TestContext* context)
     const uint32_t offset = strlen(str);
 
     // Font atlas
-    DvzFontAtlas* atlas = &gpu->context->font_atlas;
+    DvzFontAtlas* atlas = dvz_ctx_font_atlas(gpu->context);
 
     DvzGraphicsTextParams params = {0};
     params.grid_size[0] = (int32_t)atlas->rows;
@@ -819,6 +959,62 @@ int test_graphics_text(TestContext* context)
 
 
 
+int test_graphics_text_bench(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzGraphics* graphics = dvz_graphics_builtin(canvas, DVZ_GRAPHICS_TEXT, 0);
+    AT(graphics->instance_vertex_count == 4);
+
+    // Typical tick labels.
+    const uint32_t N = 100000;
+    const uint32_t n_repeats = 10;
+    char* labels = calloc(N, 16);
+    uint32_t n_chars = 0;
+    for (uint32_t i = 0; i < N; i++)
+    {
+        snprintf(&labels[16 * i], 16, "%.4e", i * .001);
+        n_chars += strlen(&labels[16 * i]);
+    }
+
+    DvzArray vertices = dvz_array_struct(0, sizeof(DvzGraphicsTextVertex));
+    DvzGraphicsData data = dvz_graphics_data(graphics, &vertices, NULL, NULL);
+    DvzGraphicsTextItem item = {0};
+    item.font_size = 12;
+
+    DvzClock clock = {0};
+    _clock_init(&clock);
+    for (uint32_t k = 0; k < n_repeats; k++)
+    {
+        data.current_idx = 0;
+        data.current_group = 0;
+        dvz_graphics_alloc(&data, n_chars);
+        for (uint32_t i = 0; i < N; i++)
+        {
+            item.string = &labels[16 * i];
+            dvz_graphics_append(&data, &item);
+        }
+    }
+    double elapsed = _clock_get(&clock);
+    log_info(
+        "baked %.1fM labels/s, %s of vertex data", n_repeats * N / elapsed / 1e6,
+        pretty_size(vertices.buffer_size));
+
+    // One vertex per glyph.
+    AT(vertices.item_count == n_chars);
+    DvzGraphicsTextVertex* vertex = dvz_array_item(&vertices, 0);
+    DvzFontAtlas* atlas = dvz_ctx_font_atlas(gpu->context);
+    AT(vertex->glyph[0] == (uint16_t)(strchr(atlas->font_str, labels[0]) - atlas->font_str));
+    AT(vertex->glyph[2] == strlen(labels));
+
+    dvz_array_destroy(&vertices);
+    FREE(labels);
+    TEST_END
+}
+
+
+
 /*************************************************************************************************/
 /*  Image tests                                                                                  */
 /*************************************************************************************************/
@@ -911,7 +1107,7 @@ int test_graphics_image_cmap(TestContext* context)
     // Bindings.
     _common_bindings(&tg);
     dvz_bindings_buffer(&tg.bindings, DVZ_USER_BINDING, tg.br_params);
-    dvz_bindings_texture(&tg.bindings, DVZ_USER_BINDING + 1, gpu->context->color_texture.texture);
+    dvz_bindings_texture(&tg.bindings, DVZ_USER_BINDING + 1, dvz_ctx_color_texture(gpu->context));
     dvz_bindings_texture(&tg.bindings, DVZ_USER_BINDING + 2, tex);
     dvz_bindings_update(&tg.bindings);
 
@@ -984,7 +1180,7 @@ int test_graphics_volume_slice(TestContext* context)
     // Bindings.
     _common_bindings(&tg);
     dvz_bindings_buffer(&tg.bindings, DVZ_USER_BINDING, tg.br_params);
-    dvz_bindings_texture(&tg.bindings, DVZ_USER_BINDING + 1, gpu->context->color_texture.texture);
+    dvz_bindings_texture(&tg.bindings, DVZ_USER_BINDING + 1, dvz_ctx_color_texture(gpu->context));
     dvz_bindings_texture(&tg.bindings, DVZ_USER_BINDING + 2, texture);
     dvz_bindings_update(&tg.bindings);
 
@@ -1057,7 +1253,7 @@ int test_graphics_volume_1(TestContext* context)
     // Bindings.
     _common_bindings(&tg);
     dvz_bindings_buffer(&tg.bindings, DVZ_USER_BINDING, tg.br_params);
-    dvz_bindings_texture(&tg.bindings, DVZ_USER_BINDING + 1, gpu->context->color_texture.texture);
+    dvz_bindings_texture(&tg.bindings, DVZ_USER_BINDING + 1, dvz_ctx_color_texture(gpu->context));
     dvz_bindings_texture(&tg.bindings, DVZ_USER_BINDING + 2, texture);
     dvz_bindings_update(&tg.bindings);
 
@@ -1182,7 +1378,7 @@ int test_graphics_mesh(TestContext* context)
     {
         DvzGraphicsMeshVertex* vertices = ((DvzGraphicsMeshVertex*)mesh.vertices.data);
         // Use the colormap texture.
-        texture = gpu->context->color_texture.texture;
+        texture = dvz_ctx_color_texture(gpu->context);
         float z = 0;
         for (uint32_t i = 0; i < mesh.vertices.item_count; i++)
         {
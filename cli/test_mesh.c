@@ -0,0 +1,421 @@
+#include "test_mesh.h"
+#include "../include/datoviz/app.h"
+#include "../include/datoviz/mesh.h"
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+// Rotate a face so that its smallest index comes first, preserving the winding.
+static void _canonical_face(const DvzIndex* face, DvzIndex* out)
+{
+    uint32_t k = 0;
+    if (face[1] < face[k])
+        k = 1;
+    if (face[2] < face[k])
+        k = 2;
+    for (uint32_t l = 0; l < 3; l++)
+        out[l] = face[(k + l) % 3];
+}
+
+
+
+static int _face_compare(const void* a, const void* b)
+{
+    const DvzIndex* fa = (const DvzIndex*)a;
+    const DvzIndex* fb = (const DvzIndex*)b;
+    for (uint32_t l = 0; l < 3; l++)
+        if (fa[l] != fb[l])
+            return fa[l] < fb[l] ? -1 : +1;
+    return 0;
+}
+
+
+
+// Return the sorted list of canonical faces of a mesh, to compare two face orderings.
+static DvzIndex* _sorted_faces(DvzMesh* mesh)
+{
+    uint32_t face_count = mesh->indices.item_count / 3;
+    DvzIndex* faces = calloc(3 * face_count, sizeof(DvzIndex));
+    for (uint32_t i = 0; i < face_count; i++)
+        _canonical_face(&((DvzIndex*)mesh->indices.data)[3 * i], &faces[3 * i]);
+    qsort(faces, face_count, 3 * sizeof(DvzIndex), _face_compare);
+    return faces;
+}
+
+
+
+static void _shuffle_faces(DvzMesh* mesh)
+{
+    uint32_t face_count = mesh->indices.item_count / 3;
+    DvzIndex* indices = (DvzIndex*)mesh->indices.data;
+    DvzIndex face[3] = {0};
+    for (uint32_t i = face_count - 1; i > 0; i--)
+    {
+        uint32_t j = (uint32_t)rand() % (i + 1);
+        memcpy(face, &indices[3 * i], sizeof(face));
+        memcpy(&indices[3 * i], &indices[3 * j], sizeof(face));
+        memcpy(&indices[3 * j], face, sizeof(face));
+    }
+}
+
+
+
+// Write a mesh as an OBJ file with positions, texture coordinates, and normals.
+static void _write_obj(DvzMesh* mesh, const char* path)
+{
+    FILE* fp = fopen(path, "w");
+    ASSERT(fp != NULL);
+    DvzGraphicsMeshVertex* vertices = (DvzGraphicsMeshVertex*)mesh->vertices.data;
+    DvzIndex* indices = (DvzIndex*)mesh->indices.data;
+    uint32_t vertex_count = mesh->vertices.item_count;
+    for (uint32_t i = 0; i < vertex_count; i++)
+    {
+        fprintf(
+            fp, "v %.6f %.6f %.6f\n", vertices[i].pos[0], vertices[i].pos[1], vertices[i].pos[2]);
+    }
+    for (uint32_t i = 0; i < vertex_count; i++)
+        fprintf(fp, "vt %.6f %.6f\n", vertices[i].uv[0], vertices[i].uv[1]);
+    for (uint32_t i = 0; i < vertex_count; i++)
+    {
+        fprintf(
+            fp, "vn %.6f %.6f %.6f\n", vertices[i].normal[0], vertices[i].normal[1],
+            vertices[i].normal[2]);
+    }
+    for (uint32_t i = 0; i < mesh->indices.item_count; i += 3)
+    {
+        fprintf(
+            fp, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", //
+            indices[i + 0] + 1, indices[i + 0] + 1, indices[i + 0] + 1, indices[i + 1] + 1,
+            indices[i + 1] + 1, indices[i + 1] + 1, indices[i + 2] + 1, indices[i + 2] + 1,
+            indices[i + 2] + 1);
+    }
+    fclose(fp);
+}
+
+
+
+// Write a mesh as a binary little-endian PLY file with positions and normals.
+static void _write_ply(DvzMesh* mesh, const char* path)
+{
+    FILE* fp = fopen(path, "wb");
+    ASSERT(fp != NULL);
+    DvzGraphicsMeshVertex* vertices = (DvzGraphicsMeshVertex*)mesh->vertices.data;
+    DvzIndex* indices = (DvzIndex*)mesh->indices.data;
+    uint32_t face_count = mesh->indices.item_count / 3;
+    fprintf(
+        fp,
+        "ply\nformat binary_little_endian 1.0\nelement vertex %d\n"
+        "property float x\nproperty float y\nproperty float z\n"
+        "property float nx\nproperty float ny\nproperty float nz\n"
+        "element face %d\nproperty list uchar uint vertex_indices\nend_header\n",
+        mesh->vertices.item_count, face_count);
+    for (uint32_t i = 0; i < mesh->vertices.item_count; i++)
+    {
+        fwrite(vertices[i].pos, sizeof(vec3), 1, fp);
+        fwrite(vertices[i].normal, sizeof(vec3), 1, fp);
+    }
+    uint8_t count = 3;
+    for (uint32_t i = 0; i < face_count; i++)
+    {
+        fwrite(&count, 1, 1, fp);
+        fwrite(&indices[3 * i], sizeof(DvzIndex), 3, fp);
+    }
+    fclose(fp);
+}
+
+
+
+// Write an indexed or non-indexed mesh as a binary STL file.
+static void _write_stl(DvzMesh* mesh, const char* path)
+{
+    FILE* fp = fopen(path, "wb");
+    ASSERT(fp != NULL);
+    DvzGraphicsMeshVertex* vertices = (DvzGraphicsMeshVertex*)mesh->vertices.data;
+    DvzIndex* indices = (DvzIndex*)mesh->indices.data;
+    uint32_t count = indices != NULL ? mesh->indices.item_count : mesh->vertices.item_count;
+    uint32_t face_count = count / 3;
+    char header[80] = "datoviz test mesh";
+    fwrite(header, sizeof(header), 1, fp);
+    fwrite(&face_count, sizeof(uint32_t), 1, fp);
+    vec3 normal = {0};
+    uint16_t attribute = 0;
+    DvzIndex idx = 0;
+    for (uint32_t i = 0; i < face_count; i++)
+    {
+        fwrite(normal, sizeof(vec3), 1, fp);
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            idx = indices != NULL ? indices[3 * i + k] : 3 * i + k;
+            fwrite(vertices[idx].pos, sizeof(vec3), 1, fp);
+        }
+        fwrite(&attribute, sizeof(uint16_t), 1, fp);
+    }
+    fclose(fp);
+}
+
+
+
+static void _write_text(const char* path, const char* text)
+{
+    FILE* fp = fopen(path, "wb");
+    ASSERT(fp != NULL);
+    fwrite(text, strlen(text), 1, fp);
+    fclose(fp);
+}
+
+
+
+/*************************************************************************************************/
+/*  Mesh tests                                                                                   */
+/*************************************************************************************************/
+
+int test_mesh_normals(TestContext* context)
+{
+    DvzMesh mesh = dvz_mesh_sphere(500, 500);
+    uint32_t vertex_count = mesh.vertices.item_count;
+    uint32_t face_count = mesh.indices.item_count / 3;
+    AT(face_count >= DVZ_MESH_PARALLEL_FACES);
+    DvzGraphicsMeshVertex* vertices = (DvzGraphicsMeshVertex*)mesh.vertices.data;
+    DvzIndex* indices = (DvzIndex*)mesh.indices.data;
+
+    for (uint32_t i = 0; i < vertex_count; i++)
+        glm_vec3_zero(vertices[i].normal);
+
+    // Reference: serial scatter of the face normals.
+    DvzClock clock = {0};
+    _clock_init(&clock);
+    vec3* expected = calloc(vertex_count, sizeof(vec3));
+    vec3 u, v, n;
+    for (uint32_t i = 0; i < face_count; i++)
+    {
+        glm_vec3_sub(vertices[indices[3 * i + 1]].pos, vertices[indices[3 * i + 0]].pos, u);
+        glm_vec3_sub(vertices[indices[3 * i + 2]].pos, vertices[indices[3 * i + 0]].pos, v);
+        glm_vec3_crossn(u, v, n);
+        for (uint32_t k = 0; k < 3; k++)
+            glm_vec3_add(expected[indices[3 * i + k]], n, expected[indices[3 * i + k]]);
+    }
+    for (uint32_t i = 0; i < vertex_count; i++)
+        glm_vec3_normalize(expected[i]);
+    double t_serial = _clock_get(&clock);
+
+    _clock_init(&clock);
+    dvz_mesh_normals(&mesh);
+    double t_mesh = _clock_get(&clock);
+    log_info(
+        "normals of %d faces: serial %.2f ms, dvz_mesh_normals() %.2f ms", face_count,
+        t_serial * 1000, t_mesh * 1000);
+
+    // The partial sums are reduced in a different order, so the results may differ slightly.
+    for (uint32_t i = 0; i < vertex_count; i++)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+            AC(vertices[i].normal[k], expected[i][k], 1e-5);
+    }
+
+    FREE(expected);
+    dvz_mesh_destroy(&mesh);
+    return 0;
+}
+
+
+
+int test_mesh_optimize(TestContext* context)
+{
+    DvzMesh mesh = dvz_mesh_sphere(300, 300);
+    uint32_t face_count = mesh.indices.item_count / 3;
+    _shuffle_faces(&mesh);
+    DvzIndex* faces = _sorted_faces(&mesh);
+
+    double acmr_shuffled = dvz_mesh_acmr(&mesh, DVZ_MESH_CACHE_SIZE);
+
+    // Vertex cache optimization.
+    DvzClock clock = {0};
+    _clock_init(&clock);
+    dvz_mesh_optimize_cache(&mesh);
+    double t_cache = _clock_get(&clock);
+    double acmr_cache = dvz_mesh_acmr(&mesh, DVZ_MESH_CACHE_SIZE);
+
+    // Overdraw optimization.
+    const float threshold = 1.05;
+    _clock_init(&clock);
+    dvz_mesh_optimize_overdraw(&mesh, threshold);
+    double t_overdraw = _clock_get(&clock);
+    double acmr_overdraw = dvz_mesh_acmr(&mesh, DVZ_MESH_CACHE_SIZE);
+
+    log_info(
+        "ACMR of %d faces: shuffled %.3f, cache %.3f (%.2f ms), overdraw %.3f (%.2f ms)",
+        face_count, acmr_shuffled, acmr_cache, t_cache * 1000, acmr_overdraw,
+        t_overdraw * 1000);
+    AT(acmr_shuffled > 2.5);
+    AT(acmr_cache < .75);
+    AT(acmr_overdraw <= acmr_cache * threshold * 1.1);
+
+    // The reordering should preserve the faces and their winding.
+    DvzIndex* reordered = _sorted_faces(&mesh);
+    AT(memcmp(faces, reordered, 3 * face_count * sizeof(DvzIndex)) == 0);
+
+    FREE(faces);
+    FREE(reordered);
+    dvz_mesh_destroy(&mesh);
+    return 0;
+}
+
+
+
+/*************************************************************************************************/
+/*  Mesh loading tests                                                                           */
+/*************************************************************************************************/
+
+int test_mesh_obj(TestContext* context)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/square.obj", ARTIFACTS_DIR);
+
+    // A quad with shared texture coordinates and normals, the same quad with negative indices,
+    // and an invalid face.
+    _write_text(
+        path, "# square\n"
+              "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+              "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+              "vn 0 0 1\n"
+              "f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+              "f -4/-4/-1 -3/-3/-1 -2/-2/-1 -1/-1/-1\n"
+              "f 1 2 x\n");
+
+    DvzMesh mesh = dvz_mesh_obj(path);
+    AT(mesh.vertices.item_count == 4);
+    AT(mesh.indices.item_count == 12);
+    DvzIndex* indices = (DvzIndex*)mesh.indices.data;
+    DvzIndex expected[] = {0, 1, 2, 0, 2, 3, 0, 1, 2, 0, 2, 3};
+    AT(memcmp(indices, expected, sizeof(expected)) == 0);
+    DvzGraphicsMeshVertex* vertices = (DvzGraphicsMeshVertex*)mesh.vertices.data;
+    AT(vertices[2].uv[0] == 1 && vertices[2].uv[1] == 1);
+    AT(vertices[2].normal[2] == 1);
+    dvz_mesh_destroy(&mesh);
+
+    return 0;
+}
+
+
+
+int test_mesh_ply(TestContext* context)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/square.ply", ARTIFACTS_DIR);
+
+    // ASCII file with a quad.
+    _write_text(
+        path, "ply\nformat ascii 1.0\ncomment square\nelement vertex 4\n"
+              "property float x\nproperty float y\nproperty float z\n"
+              "element face 1\nproperty list uchar int vertex_indices\nend_header\n"
+              "0 0 0\n1 0 0\n1 1 0\n0 1 0\n4 0 1 2 3\n");
+    DvzMesh mesh = dvz_mesh_ply(path);
+    AT(mesh.vertices.item_count == 4);
+    AT(mesh.indices.item_count == 6);
+    DvzIndex* indices = (DvzIndex*)mesh.indices.data;
+    AT(memcmp(indices, (DvzIndex[]){0, 1, 2, 0, 2, 3}, 6 * sizeof(DvzIndex)) == 0);
+    // The normals are computed from the faces.
+    AC(((DvzGraphicsMeshVertex*)mesh.vertices.data)[0].normal[2], 1, 1e-6);
+    dvz_mesh_destroy(&mesh);
+
+    // Binary file, compared to the mesh it was generated from.
+    DvzMesh sphere = dvz_mesh_sphere(20, 20);
+    _write_ply(&sphere, path);
+    mesh = dvz_mesh_ply(path);
+    AT(mesh.vertices.item_count == sphere.vertices.item_count);
+    AT(mesh.indices.item_count == sphere.indices.item_count);
+    AT(memcmp(mesh.indices.data, sphere.indices.data, sphere.indices.buffer_size) == 0);
+    dvz_mesh_destroy(&mesh);
+    dvz_mesh_destroy(&sphere);
+
+    return 0;
+}
+
+
+
+int test_mesh_stl(TestContext* context)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/cube.stl", ARTIFACTS_DIR);
+
+    // The 36 triangle corners of a cube share 8 positions.
+    DvzMesh cube = dvz_mesh_cube();
+    _write_stl(&cube, path);
+    DvzMesh mesh = dvz_mesh_stl(path);
+    AT(mesh.indices.item_count == 36);
+    AT(mesh.vertices.item_count == 8);
+    dvz_mesh_destroy(&mesh);
+    dvz_mesh_destroy(&cube);
+
+    return 0;
+}
+
+
+
+int test_mesh_load(TestContext* context)
+{
+    char path[1024], cache_path[1024];
+    const char* formats[] = {"obj", "ply", "stl"};
+    DvzClock clock = {0};
+    double t_parse = 0, t_cache = 0;
+
+    // Generated mesh with 500k faces.
+    DvzMesh sphere = dvz_mesh_sphere(501, 501);
+    uint32_t face_count = sphere.indices.item_count / 3;
+
+    for (uint32_t f = 0; f < 3; f++)
+    {
+        snprintf(path, sizeof(path), "%s/sphere.%s", ARTIFACTS_DIR, formats[f]);
+        snprintf(
+            cache_path, sizeof(cache_path), "%s/sphere.%s.dvzmesh", ARTIFACTS_DIR, formats[f]);
+        if (f == 0)
+            _write_obj(&sphere, path);
+        else if (f == 1)
+            _write_ply(&sphere, path);
+        else
+            _write_stl(&sphere, path);
+        remove(cache_path);
+
+        // Parse the file and write the cache.
+        _clock_init(&clock);
+        DvzMesh mesh = dvz_mesh_load(path, cache_path);
+        t_parse = _clock_get(&clock);
+        AT(mesh.indices.item_count == 3 * face_count);
+        AT(mesh.mapped == NULL);
+
+        // Memory-map the cache.
+        _clock_init(&clock);
+        DvzMesh cached = dvz_mesh_load(path, cache_path);
+        t_cache = _clock_get(&clock);
+        AT(cached.mapped != NULL);
+        AT(cached.vertices.item_count == mesh.vertices.item_count);
+        AT(cached.indices.item_count == mesh.indices.item_count);
+        AT(memcmp(cached.vertices.data, mesh.vertices.data, mesh.vertices.buffer_size) == 0);
+        AT(memcmp(cached.indices.data, mesh.indices.data, mesh.indices.buffer_size) == 0);
+
+        log_info(
+            "load %s with %d faces, %d vertices: parse %.1f ms, cached %.3f ms", formats[f],
+            face_count, mesh.vertices.item_count, t_parse * 1000, t_cache * 1000);
+        dvz_mesh_destroy(&cached);
+
+        // A cache with an out-of-range index is discarded, and the mesh file is parsed again.
+        FILE* fp = fopen(cache_path, "r+b");
+        AT(fp != NULL);
+        DvzIndex bad = mesh.vertices.item_count;
+        AT(fseek(fp, -(long)sizeof(DvzIndex), SEEK_END) == 0);
+        AT(fwrite(&bad, sizeof(DvzIndex), 1, fp) == 1);
+        fclose(fp);
+        cached = dvz_mesh_load(path, cache_path);
+        AT(cached.mapped == NULL);
+        AT(memcmp(cached.indices.data, mesh.indices.data, mesh.indices.buffer_size) == 0);
+
+        dvz_mesh_destroy(&cached);
+        dvz_mesh_destroy(&mesh);
+    }
+    dvz_mesh_destroy(&sphere);
+
+    return 0;
+}
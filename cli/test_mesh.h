@@ -0,0 +1,22 @@
+#ifndef DVZ_TEST_MESH_HEADER
+#define DVZ_TEST_MESH_HEADER
+
+
+#include "utils.h"
+
+
+
+/*************************************************************************************************/
+/*  Mesh tests                                                                                   */
+/*************************************************************************************************/
+
+int test_mesh_normals(TestContext* context);
+int test_mesh_optimize(TestContext* context);
+int test_mesh_obj(TestContext* context);
+int test_mesh_ply(TestContext* context);
+int test_mesh_stl(TestContext* context);
+int test_mesh_load(TestContext* context);
+
+
+
+#endif
@@ -1,6 +1,7 @@
 #include "test_scene.h"
 #include "../external/video.h"
 #include "../include/datoviz/builtin_visuals.h"
+#include "../include/datoviz/replay.h"
 #include "../include/datoviz/scene.h"
 #include "../src/ticks.h"
 #include "utils.h"
@@ -318,7 +319,7 @@ int test_scene_mesh(TestContext* context)
     dvz_visual_data_source(visual, DVZ_SOURCE_TYPE_VERTEX, 0, 0, nv, nv, vertices);
     FREE(vertices);
 
-    dvz_visual_texture(visual, DVZ_SOURCE_TYPE_IMAGE, 0, gpu->context->color_texture.texture);
+    dvz_visual_texture(visual, DVZ_SOURCE_TYPE_IMAGE, 0, dvz_ctx_color_texture(gpu->context));
 
     // dvz_event_callback(canvas, DVZ_EVENT_TIMER, 1. / 60, DVZ_EVENT_MODE_SYNC, _rotate, panel);
 
@@ -461,3 +462,612 @@ int test_scene_logistic(TestContext* context)
     dvz_scene_destroy(scene);
     TEST_END
 }
+
+
+
+/*************************************************************************************************/
+/*  Profiler tests                                                                               */
+/*************************************************************************************************/
+
+int test_scene_profiler(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzProfiler* profiler = dvz_canvas_profiler(canvas);
+    AT(profiler != NULL);
+    AT(dvz_canvas_profiler(canvas) == profiler);
+
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+
+    const uint32_t N = 1000;
+    dvec3* pos = calloc(N, sizeof(dvec3));
+    cvec4* color = calloc(N, sizeof(cvec4));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        RANDN_POS(pos[i])
+        RAND_COLOR(color[i])
+    }
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(visual, DVZ_PROP_COLOR, 0, N, color);
+
+    dvz_app_run(app, 10);
+
+    // The summary covers the last complete frame.
+    DvzFrameProfile summary = dvz_profiler_summary(profiler);
+    AT(summary.frame_idx > 0);
+    AT(summary.counts[DVZ_PROFILE_FRAME] == 1);
+    AT(summary.counts[DVZ_PROFILE_SUBMIT] == 1);
+    AT(summary.durations[DVZ_PROFILE_FRAME] >= summary.durations[DVZ_PROFILE_SUBMIT]);
+    if (profiler->gpu_render)
+        AT(summary.counts[DVZ_PROFILE_GPU_DRAW] >= 1);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/profile.json", ARTIFACTS_DIR);
+    AT(dvz_profiler_dump(profiler, path) == 0);
+
+    dvz_scene_destroy(scene);
+    FREE(pos);
+    FREE(color);
+    TEST_END
+}
+
+
+
+/*************************************************************************************************/
+/*  Refill benchmark                                                                             */
+/*************************************************************************************************/
+
+typedef struct TestRefill TestRefill;
+
+struct TestRefill
+{
+    DvzClock clock;
+    double start;   // time at the beginning of the current refill
+    double elapsed; // total refill time
+    uint32_t count; // number of refills
+};
+
+static void _refill_begin(DvzCanvas* canvas, DvzEvent ev)
+{
+    TestRefill* refill = (TestRefill*)ev.user_data;
+    ASSERT(refill != NULL);
+    refill->start = _clock_get(&refill->clock);
+}
+
+static void _refill_end(DvzCanvas* canvas, DvzEvent ev)
+{
+    TestRefill* refill = (TestRefill*)ev.user_data;
+    ASSERT(refill != NULL);
+    refill->elapsed += _clock_get(&refill->clock) - refill->start;
+    refill->count++;
+}
+
+static void _refill_points(DvzPanel* panel, uint32_t n, dvec3* pos, cvec4* color)
+{
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, DVZ_VISUAL_FLAGS_TRANSFORM_NONE);
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, n, pos);
+    dvz_visual_data(visual, DVZ_PROP_COLOR, 0, n, color);
+}
+
+// Run a few frames, return the mean duration of the scene refills in seconds.
+static double _refill_measure(DvzApp* app, TestRefill* refill)
+{
+    refill->elapsed = 0;
+    refill->count = 0;
+    dvz_app_run(app, 3);
+    return refill->count > 0 ? refill->elapsed / refill->count : 0;
+}
+
+int test_scene_refill(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    // The REFILL callbacks registered before and after the scene surround the scene refill.
+    TestRefill refill = {0};
+    _clock_init(&refill.clock);
+    dvz_event_callback(canvas, DVZ_EVENT_REFILL, 0, DVZ_EVENT_MODE_SYNC, _refill_begin, &refill);
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    dvz_event_callback(canvas, DVZ_EVENT_REFILL, 0, DVZ_EVENT_MODE_SYNC, _refill_end, &refill);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_NONE, 0);
+
+    const uint32_t N = 100;
+    dvec3* pos = calloc(N, sizeof(dvec3));
+    cvec4* color = calloc(N, sizeof(cvec4));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        RANDN_POS(pos[i])
+        RAND_COLOR(color[i])
+    }
+
+    uint32_t counts[] = {10, 100, 1000};
+    uint32_t visual_count = 0;
+    uint64_t recorded = 0;
+    double t_first = 0, t_same = 0, t_add = 0;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        // The first refill records all new visuals.
+        for (; visual_count < counts[i] - 1; visual_count++)
+            _refill_points(panel, N, pos, color);
+        t_first = _refill_measure(app, &refill);
+
+        // A refill without any change reuses all visual command buffers.
+        recorded = scene->fill_recorded;
+        dvz_canvas_to_refill(canvas);
+        t_same = _refill_measure(app, &refill);
+        AT(scene->fill_recorded == recorded);
+
+        // Adding a visual only records the command buffers of that visual.
+        recorded = scene->fill_recorded;
+        _refill_points(panel, N, pos, color);
+        visual_count++;
+        t_add = _refill_measure(app, &refill);
+        AT(scene->fill_recorded > recorded);
+        AT(scene->fill_recorded - recorded < visual_count);
+
+        log_info(
+            "%4d visuals: refill %.3f ms with new visuals, %.3f ms without change, "
+            "%.3f ms after adding one visual",
+            visual_count, 1000 * t_first, 1000 * t_same, 1000 * t_add);
+    }
+
+    dvz_scene_destroy(scene);
+    FREE(pos);
+    FREE(color);
+    TEST_END
+}
+
+
+
+int test_scene_buffer_grow(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    TestRefill refill = {0};
+    _clock_init(&refill.clock);
+    dvz_event_callback(canvas, DVZ_EVENT_REFILL, 0, DVZ_EVENT_MODE_SYNC, _refill_begin, &refill);
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    dvz_event_callback(canvas, DVZ_EVENT_REFILL, 0, DVZ_EVENT_MODE_SYNC, _refill_end, &refill);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_NONE, 0);
+
+    // A grid of points, recorded in a cached command buffer.
+    const uint32_t N = 100;
+    dvec3* pos = calloc(N, sizeof(dvec3));
+    cvec4* color = calloc(N, sizeof(cvec4));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        pos[i][0] = -.9 + 1.8 * (i % 10) / 9.0;
+        pos[i][1] = -.9 + 1.8 * (i / 10) / 9.0;
+        color[i][0] = 255;
+        color[i][3] = 255;
+    }
+    _refill_points(panel, N, pos, color);
+    _refill_measure(app, &refill);
+    DvzVisual* visual = panel->visuals[0];
+    DvzBuffer* buffer = dvz_source_get(visual, DVZ_SOURCE_TYPE_VERTEX, 0)->u.br.buffer;
+    VkBuffer handle = buffer->buffer;
+    VkDeviceSize size = buffer->size;
+    uint8_t* expected = dvz_screenshot(canvas, false);
+
+    // Another visual, outside of the viewport, grows the shared vertex buffer beyond its size.
+    // The first visual must be recorded again with the new buffer.
+    const uint32_t n = (uint32_t)(size / 8);
+    dvec3* far = calloc(n, sizeof(dvec3));
+    cvec4* far_color = calloc(n, sizeof(cvec4));
+    for (uint32_t i = 0; i < n; i++)
+        far[i][0] = 10;
+    _refill_points(panel, n, far, far_color);
+    uint64_t recorded = scene->fill_recorded;
+    _refill_measure(app, &refill);
+    AT(buffer->size > size);
+    AT(buffer->buffer != handle);
+    AT(scene->fill_recorded - recorded >= 2);
+
+    uint8_t* rgb = dvz_screenshot(canvas, false);
+    AT(memcmp(rgb, expected, TEST_WIDTH * TEST_HEIGHT * 3) == 0);
+
+    dvz_scene_destroy(scene);
+    FREE(rgb);
+    FREE(expected);
+    FREE(far);
+    FREE(far_color);
+    FREE(pos);
+    FREE(color);
+    TEST_END
+}
+
+
+
+int test_scene_threads(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    TestRefill refill = {0};
+    _clock_init(&refill.clock);
+    dvz_event_callback(canvas, DVZ_EVENT_REFILL, 0, DVZ_EVENT_MODE_SYNC, _refill_begin, &refill);
+    DvzScene* scene = dvz_scene(canvas, 6, 6);
+    dvz_event_callback(canvas, DVZ_EVENT_REFILL, 0, DVZ_EVENT_MODE_SYNC, _refill_end, &refill);
+
+    // A 6x6 grid of panels with many visuals each, with deterministic data.
+    const uint32_t N = 100;
+    const uint32_t visuals_per_panel = 50;
+    dvec3* pos = calloc(N, sizeof(dvec3));
+    cvec4* color = calloc(N, sizeof(cvec4));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        pos[i][0] = -1 + 2 * (i % 10) / 9.0;
+        pos[i][1] = -1 + 2 * (i / 10) / 9.0;
+        color[i][0] = (uint8_t)(25 * (i % 10));
+        color[i][1] = (uint8_t)(25 * (i / 10));
+        color[i][2] = 128;
+        color[i][3] = 255;
+    }
+    DvzPanel* panel = NULL;
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        for (uint32_t j = 0; j < 6; j++)
+        {
+            panel = dvz_scene_panel(scene, i, j, DVZ_CONTROLLER_NONE, 0);
+            for (uint32_t k = 0; k < visuals_per_panel; k++)
+                _refill_points(panel, N, pos, color);
+        }
+    }
+    uint32_t visual_count = 36 * visuals_per_panel;
+    _refill_measure(app, &refill);
+
+    // Record all visuals again with an increasing number of threads. The image must not depend
+    // on the number of threads.
+    uint32_t thread_counts[] = {0, 1, 2, 4, 8, 16};
+    uint64_t recorded = 0;
+    uint8_t* expected = NULL;
+    uint8_t* rgb = NULL;
+    double t = 0, t0 = 0;
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        dvz_scene_threads(scene, thread_counts[i]);
+        recorded = scene->fill_recorded;
+        t = _refill_measure(app, &refill);
+        AT(scene->fill_recorded - recorded >= visual_count);
+
+        rgb = dvz_screenshot(canvas, false);
+        if (expected == NULL)
+        {
+            expected = rgb;
+            t0 = t;
+        }
+        else
+        {
+            AT(memcmp(rgb, expected, TEST_WIDTH * TEST_HEIGHT * 3) == 0);
+            FREE(rgb);
+        }
+
+        log_info(
+            "%d visuals, %2d thread(s): refill %.3f ms, speedup %.2fx", visual_count,
+            thread_counts[i], 1000 * t, t > 0 ? t0 / t : 0);
+    }
+
+    // Without any change, the worker threads reuse all visual command buffers.
+    recorded = scene->fill_recorded;
+    dvz_canvas_to_refill(canvas);
+    _refill_measure(app, &refill);
+    AT(scene->fill_recorded == recorded);
+
+    dvz_scene_destroy(scene);
+    FREE(expected);
+    FREE(pos);
+    FREE(color);
+    TEST_END
+}
+
+
+
+// Number of runs of lit pixels on the middle row of an RGB screenshot.
+static uint32_t _middle_row_runs(uint8_t* rgb, uint32_t* centers, uint32_t max_runs)
+{
+    uint8_t* row = &rgb[3 * TEST_WIDTH * (TEST_HEIGHT / 2)];
+    uint32_t count = 0, start = 0;
+    bool lit = false, prev = false;
+    for (uint32_t x = 0; x <= TEST_WIDTH; x++)
+    {
+        lit = x < TEST_WIDTH && row[3 * x] > 100;
+        if (lit && !prev)
+            start = x;
+        if (!lit && prev)
+        {
+            if (count < max_runs)
+                centers[count] = (start + x - 1) / 2;
+            count++;
+        }
+        prev = lit;
+    }
+    return count;
+}
+
+int test_scene_double(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzScene* scene = dvz_scene(canvas, 1, 3);
+
+    // Precision: 10 points separated by 1e-10 relative to their coordinates, and a far point.
+    const double x0 = 1000.123456789;
+    const double step = x0 * 1e-10;
+    const uint32_t n = 11;
+    dvec3 pos[11] = {0};
+    for (uint32_t i = 0; i < n - 1; i++)
+        pos[i][0] = x0 + i * step;
+    pos[n - 1][0] = -x0;
+
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_NONE, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, DVZ_GRAPHICS_FLAGS_POS_DOUBLE);
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, n, pos);
+    dvz_app_run(app, 3);
+    AT(panel->has_data_origin);
+
+    // Zoom on the 10 points, at a relative zoom level of 1e-9.
+    DvzBox box = {{x0 - .5 * step, -1, -1}, {x0 + 9.5 * step, +1, +1}};
+    dvz_panel_box(panel, box);
+    dvz_app_run(app, 3);
+
+    // The 10 points must be drawn at distinct, regularly spaced positions in the left panel.
+    uint8_t* rgb = dvz_screenshot(canvas, false);
+    uint32_t centers[10] = {0};
+    uint32_t count = _middle_row_runs(rgb, centers, 10);
+    AT(count == 10);
+    double w = TEST_WIDTH / 3.0;
+    for (uint32_t i = 0; i < MIN(count, 10); i++)
+        AT(fabs(centers[i] - (i + .5) * w / 10) <= 2);
+    FREE(rgb);
+
+    // Cost of a change of the data box with 1M points, with and without emulated double
+    // precision. The first visual is only updated via the MVP uniform, whereas the second one is
+    // renormalized on the CPU and uploaded again.
+    const uint32_t N = 1000000;
+    dvec3* big = calloc(N, sizeof(dvec3));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        big[i][0] = x0 + dvz_rand_normal();
+        big[i][1] = dvz_rand_normal();
+    }
+    DvzPanel* panels[2] = {
+        dvz_scene_panel(scene, 0, 1, DVZ_CONTROLLER_NONE, 0),
+        dvz_scene_panel(scene, 0, 2, DVZ_CONTROLLER_NONE, 0)};
+    int flags[2] = {DVZ_GRAPHICS_FLAGS_POS_DOUBLE, 0};
+    for (uint32_t k = 0; k < 2; k++)
+    {
+        visual = dvz_scene_visual(panels[k], DVZ_VISUAL_POINT, flags[k]);
+        dvz_visual_data(visual, DVZ_PROP_POS, 0, N, big);
+    }
+    dvz_app_run(app, 3);
+
+    DvzClock clock = {0};
+    const uint32_t frames = 10;
+    double t[2] = {0};
+    for (uint32_t k = 0; k < 2; k++)
+    {
+        _clock_init(&clock);
+        for (uint32_t i = 0; i < frames; i++)
+        {
+            box = (DvzBox){{x0 - 1 - .1 * i, -3, -1}, {x0 + 1 + .1 * i, +3, +1}};
+            dvz_panel_box(panels[k], box);
+            dvz_app_run(app, 1);
+        }
+        t[k] = _clock_get(&clock) / frames;
+    }
+    log_info(
+        "data box change with %d points: %.3f ms/frame with double positions, "
+        "%.3f ms/frame with CPU renormalization",
+        N, 1000 * t[0], 1000 * t[1]);
+
+    dvz_scene_destroy(scene);
+    FREE(big);
+    TEST_END
+}
+
+
+
+/*************************************************************************************************/
+/*  Memory accounting                                                                            */
+/*************************************************************************************************/
+
+int test_scene_memory(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    AT(dvz_canvas_memory(canvas).host == 0);
+
+    DvzMemoryUsage arrays = dvz_memory_arrays();
+    DvzScene* scene = dvz_scene(canvas, 1, 2);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+
+    const uint32_t N = 10000;
+    dvec3* pos = calloc(N, sizeof(dvec3));
+    cvec4* color = calloc(N, sizeof(cvec4));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        RANDN_POS(pos[i])
+        RAND_COLOR(color[i])
+    }
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(visual, DVZ_PROP_COLOR, 0, N, color);
+
+    // A second panel with another visual.
+    panel = dvz_scene_panel(scene, 0, 1, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* other = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+    dvz_visual_data(other, DVZ_PROP_POS, 0, N / 2, pos);
+
+    dvz_app_run(app, 5);
+
+    // The canvas memory is the sum of the memory of its visuals.
+    DvzMemoryUsage usage = dvz_canvas_memory(canvas);
+    DvzMemoryUsage expected = {0};
+    dvz_memory_add(&expected, dvz_visual_memory(visual));
+    dvz_memory_add(&expected, dvz_visual_memory(other));
+    AT(usage.host == expected.host);
+    AT(usage.device == expected.device);
+    AT(usage.array_count == expected.array_count);
+    AT(usage.host >= N * (sizeof(dvec3) + sizeof(cvec4)) + N / 2 * sizeof(dvec3));
+    AT(usage.device > 0);
+    AT(usage.region_count >= 2);
+
+    // The canvas visuals own all the arrays created by the scene.
+    AT(dvz_memory_arrays().host - arrays.host >= usage.host);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/memory.json", ARTIFACTS_DIR);
+    AT(dvz_memory_dump(canvas, path) == 0);
+    FILE* fp = fopen(path, "r");
+    AT(fp != NULL);
+    char buf[16] = {0};
+    AT(fread(buf, 1, 10, fp) == 10);
+    AT(strncmp(buf, "{\"arrays\"", 9) == 0);
+    fclose(fp);
+
+    // Destroying the scene releases the arrays of all visuals.
+    dvz_scene_destroy(scene);
+    AT(dvz_memory_arrays().host == arrays.host);
+    AT(dvz_memory_arrays().array_count == arrays.array_count);
+
+    FREE(pos);
+    FREE(color);
+    TEST_END
+}
+
+
+
+// Replay an event file in a new offscreen scene, and return the checksums of the frames.
+static uint64_t*
+_replay_checksums(const char* path, dvec3* pos, uint32_t n, uint64_t* count, DvzPanzoom* panzoom)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_AXES_2D, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, n, pos);
+    dvz_app_run(app, 3);
+
+    DvzEventReplay* replay = dvz_event_replay(canvas, path);
+    ASSERT(replay != NULL);
+    dvz_event_replay_run(replay, DVZ_REPLAY_FLAGS_MAX_SPEED | DVZ_REPLAY_FLAGS_CHECKSUM);
+
+    *count = replay->frame_count;
+    uint64_t* checksums = calloc(replay->frame_count, sizeof(uint64_t));
+    for (uint64_t i = 0; i < replay->frame_count; i++)
+        checksums[i] = replay->frames[i].checksum;
+    *panzoom = panel->controller->interacts[0].u.p;
+
+    char json[1024];
+    snprintf(json, sizeof(json), "%s/replay.json", ARTIFACTS_DIR);
+    dvz_event_replay_dump(replay, json);
+
+    dvz_event_replay_destroy(replay);
+    dvz_scene_destroy(scene);
+    dvz_app_destroy(app);
+    return checksums;
+}
+
+int test_scene_replay(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_AXES_2D, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+
+    const uint32_t N = 1000;
+    dvec3* pos = calloc(N, sizeof(dvec3));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        RANDN_POS(pos[i])
+    }
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, N, pos);
+    dvz_app_run(app, 3);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/events.bin", ARTIFACTS_DIR);
+    AT(dvz_event_record(canvas, path) != NULL);
+
+    // Pan with a left drag, then zoom with the wheel.
+    const uint32_t n_frames = 20;
+    vec2 mouse = {TEST_WIDTH / 2, TEST_HEIGHT / 2};
+    vec2 wheel = {0, 1};
+    for (uint32_t i = 0; i < n_frames; i++)
+    {
+        if (i == 2)
+        {
+            dvz_event_mouse_move(canvas, mouse, 0);
+            dvz_event_mouse_press(canvas, DVZ_MOUSE_BUTTON_LEFT, 0);
+        }
+        else if (i > 2 && i < 11)
+        {
+            mouse[0] += 10;
+            dvz_event_mouse_move(canvas, mouse, 0);
+        }
+        else if (i == 11)
+            dvz_event_mouse_release(canvas, DVZ_MOUSE_BUTTON_LEFT, 0);
+        else if (i > 11 && i < 16)
+            dvz_event_mouse_wheel(canvas, wheel, 0);
+        dvz_app_run(app, 1);
+    }
+    AT(canvas->recorder->count > n_frames);
+    dvz_event_record_stop(canvas);
+    AT(canvas->recorder == NULL);
+    DvzPanzoom recorded = panel->controller->interacts[0].u.p;
+    AT(recorded.camera_pos[0] != 0);
+    AT(recorded.zoom[0] != 1);
+
+    // The replay reproduces the interaction, and the same frames at every replay.
+    uint64_t count = 0, other_count = 0;
+    DvzPanzoom replayed = {0};
+    uint64_t* checksums = _replay_checksums(path, pos, N, &count, &replayed);
+    AT(count == n_frames);
+    AT(fabs(replayed.camera_pos[0] - recorded.camera_pos[0]) < 1e-6);
+    AT(fabs(replayed.zoom[0] - recorded.zoom[0]) < 1e-6);
+    AT(checksums[n_frames - 1] != checksums[0]);
+
+    uint64_t* other = _replay_checksums(path, pos, N, &other_count, &replayed);
+    AT(other_count == count);
+    for (uint32_t i = 0; i < count; i++)
+        AT(other[i] == checksums[i]);
+
+    // Truncated files: an incomplete header is rejected, a header alone has no events.
+    DvzEventFileHeader header = {0};
+    FILE* fp = fopen(path, "rb");
+    AT(fp != NULL);
+    AT(fread(&header, sizeof(header), 1, fp) == 1);
+    fclose(fp);
+    snprintf(path, sizeof(path), "%s/events_truncated.bin", ARTIFACTS_DIR);
+    fp = fopen(path, "wb");
+    AT(fp != NULL);
+    fwrite(&header, sizeof(header) / 2, 1, fp);
+    fclose(fp);
+    AT(dvz_event_replay(canvas, path) == NULL);
+    fp = fopen(path, "wb");
+    AT(fp != NULL);
+    fwrite(&header, sizeof(header), 1, fp);
+    fclose(fp);
+    DvzEventReplay* replay = dvz_event_replay(canvas, path);
+    AT(replay != NULL);
+    AT(replay->record_count == 0);
+    dvz_event_replay_destroy(replay);
+
+    dvz_scene_destroy(scene);
+    FREE(checksums);
+    FREE(other);
+    FREE(pos);
+    TEST_END
+}
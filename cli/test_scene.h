@@ -19,6 +19,14 @@ int test_scene_mesh(TestContext* context);
 int test_scene_axes(TestContext* context);
 int test_scene_logistic(TestContext* context);
 
+int test_scene_profiler(TestContext* context);
+int test_scene_refill(TestContext* context);
+int test_scene_buffer_grow(TestContext* context);
+int test_scene_threads(TestContext* context);
+int test_scene_double(TestContext* context);
+int test_scene_memory(TestContext* context);
+int test_scene_replay(TestContext* context);
+
 
 
 #endif
@@ -215,3 +215,77 @@ int test_transforms_5(TestContext* context)
 
     TEST_END
 }
+
+
+
+int test_transforms_double(TestContext* context)
+{
+    const uint32_t n = 10000;
+    const double x0 = 1000.123456789;
+    const double zoom = 1e-9; // view extent relative to the coordinate magnitude
+    const double extent = x0 * zoom;
+
+    // Data coords: the view is a tiny window far from the origin.
+    DvzDataCoords coords = {0};
+    coords.transform = DVZ_TRANSFORM_CARTESIAN;
+    coords.box = (DvzBox){{x0, -1, -1}, {x0 + extent, +1, +1}};
+    dvec3 origin = {123.456789012345, 0, 0};
+
+    // Positions spanning the view.
+    DvzArray pos = dvz_array(n, DVZ_DTYPE_DVEC3);
+    dvec3* p = (dvec3*)pos.data;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        p[i][0] = x0 + extent * i / (double)(n - 1);
+        p[i][1] = 1 - 2 * i / (double)(n - 1);
+    }
+
+    // CPU part: subtract the origin, and split into (hi, lo) float pairs like in the prop cast.
+    DvzArray pos_tr = dvz_array(n, DVZ_DTYPE_DVEC3);
+    dvz_transform_pos_double(coords, origin, &pos, &pos_tr);
+    DvzArray pos_hilo = dvz_array(n, DVZ_DTYPE_VEC3_HILO);
+    AT(pos_hilo.item_size == 2 * sizeof(vec3));
+    dvz_array_column(
+        &pos_hilo, 0, sizeof(dvec3), 0, n, n, pos_tr.data, DVZ_DTYPE_DVEC3, DVZ_DTYPE_VEC3_HILO,
+        DVZ_ARRAY_COPY_SINGLE, 1);
+
+    // Uniform part.
+    DvzMVP mvp = {0};
+    dvz_transform_mvp_double(coords, origin, &mvp);
+    AT(mvp.data_scale[3] == 1);
+
+    // Emulate normalize_double() in the vertex shader with single precision floats, and compare
+    // with the NDC positions computed in double precision.
+    double err = 0, err_float = 0, ndc = 0;
+    vec3* hilo = NULL;
+    float t = 0, e = 0, d = 0, naive = 0;
+    float c = (float)(x0 + .5 * extent);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        hilo = (vec3*)dvz_array_item(&pos_hilo, i);
+        t = hilo[0][0] - mvp.data_offset_hi[0];
+        e = hilo[1][0] - mvp.data_offset_lo[0];
+        d = t + e;
+        ndc = 2 * (p[i][0] - x0) / extent - 1;
+        err = MAX(err, fabs(d * mvp.data_scale[0] - ndc));
+
+        // Single precision positions and transform.
+        naive = ((float)p[i][0] - c) * mvp.data_scale[0];
+        err_float = MAX(err_float, fabs(naive - ndc));
+
+        // The y coordinate is normalized as usual.
+        d = (hilo[0][1] - mvp.data_offset_hi[1]) + (hilo[1][1] - mvp.data_offset_lo[1]);
+        AC(d * mvp.data_scale[1], p[i][1], 1e-6);
+    }
+    log_debug("max NDC error at zoom %g: %g (single precision: %g)", zoom, err, err_float);
+
+    // Below 1/100 of a pixel with a 1000-pixel wide viewport.
+    AT(err < 1e-5);
+    // Single precision positions collapse at this zoom level.
+    AT(err_float > .1);
+
+    dvz_array_destroy(&pos);
+    dvz_array_destroy(&pos_tr);
+    dvz_array_destroy(&pos_hilo);
+    return 0;
+}
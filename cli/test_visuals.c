@@ -366,3 +366,86 @@ int test_visuals_5(TestContext* context)
     dvz_visual_destroy(&visual);
     TEST_END
 }
+
+
+
+static void _memory_data(DvzVisual* visual, uint32_t n)
+{
+    dvec3* pos = calloc(n, sizeof(dvec3));
+    cvec4* color = calloc(n, sizeof(cvec4));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        RANDN_POS(pos[i])
+        RAND_COLOR(color[i])
+    }
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, n, pos);
+    dvz_visual_data(visual, DVZ_PROP_COLOR, 0, n, color);
+    dvz_visual_update(visual, visual->canvas->viewport, (DvzDataCoords){0}, NULL);
+    FREE(pos);
+    FREE(color);
+}
+
+int test_visuals_memory(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzContext* ctx = gpu->context;
+    ASSERT(ctx != NULL);
+    DvzVisual visual = dvz_visual(canvas);
+    _marker_visual(&visual);
+
+    // The props and sources have empty arrays.
+    DvzMemoryUsage arrays = dvz_memory_arrays();
+    DvzMemoryUsage empty = dvz_visual_memory(&visual);
+    AT(empty.array_count > 0);
+    AT(arrays.array_count >= empty.array_count);
+    AT(empty.host == 0);
+    AT(empty.device == 0);
+
+    mat4 id = GLM_MAT4_IDENTITY_INIT;
+    dvz_visual_data(&visual, DVZ_PROP_MODEL, 0, 1, id);
+    dvz_visual_data(&visual, DVZ_PROP_VIEW, 0, 1, id);
+    dvz_visual_data(&visual, DVZ_PROP_PROJ, 0, 1, id);
+    float param = 10.0f;
+    dvz_visual_data(&visual, DVZ_PROP_MARKER_SIZE, 0, 1, &param);
+    dvz_visual_data_source(&visual, DVZ_SOURCE_TYPE_VIEWPORT, 0, 0, 1, 1, &canvas->viewport);
+
+    DvzProp* prop = dvz_prop_get(&visual, DVZ_PROP_POS, 0);
+    DvzSource* source = dvz_source_get(&visual, DVZ_SOURCE_TYPE_VERTEX, 0);
+    DvzMemoryUsage usage = {0}, ctx_usage = {0}, new_arrays = {0};
+    const uint32_t N = 10000;
+    for (uint32_t n = N; n <= 4 * N; n *= 2)
+    {
+        _memory_data(&visual, n);
+
+        // All the arrays created since the baseline are owned by the visual.
+        usage = dvz_visual_memory(&visual);
+        new_arrays = dvz_memory_arrays();
+        AT(new_arrays.host - arrays.host == usage.host);
+        AT(new_arrays.array_count - arrays.array_count == usage.array_count - empty.array_count);
+        AT(dvz_prop_memory(prop).host >= n * sizeof(dvec3));
+        AT(dvz_source_memory(source).host >= n * sizeof(DvzVertex));
+
+        // The vertex buffer is allocated by the library.
+        AT(dvz_source_memory(source).device >= n * sizeof(DvzVertex));
+        AT(dvz_source_memory(source).region_count == 1);
+        AT(usage.device >= n * sizeof(DvzVertex));
+
+        // The context accounts for the regions of the visual.
+        ctx_usage = dvz_context_memory(ctx);
+        AT(ctx_usage.region_count >= usage.region_count);
+        AT(ctx_usage.device >= usage.device);
+        AT(ctx_usage.device_total >= ctx_usage.device);
+    }
+    log_debug(
+        "visual memory: host %.1f KB, device %.1f KB, %d arrays, %d regions",
+        usage.host / (double)KB, usage.device / (double)KB, usage.array_count, usage.region_count);
+
+    // Destroying the visual releases all of its arrays.
+    dvz_visual_destroy(&visual);
+    new_arrays = dvz_memory_arrays();
+    AT(new_arrays.host == arrays.host);
+    AT(new_arrays.array_count == arrays.array_count - empty.array_count);
+    TEST_END
+}
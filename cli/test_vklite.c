@@ -430,6 +430,62 @@ int test_vklite_barrier(TestContext* context)
 
 
 
+int test_vklite_barrier_buffer(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    dvz_gpu_queue(gpu, 0, DVZ_QUEUE_RENDER);
+    dvz_gpu_create(gpu, 0);
+
+    // Three buffers: the data goes from the first one to the last one through the second one.
+    const VkDeviceSize size = 256;
+    DvzBuffer buffers[3];
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        buffers[i] = dvz_buffer(gpu);
+        dvz_buffer_size(&buffers[i], size);
+        dvz_buffer_usage(
+            &buffers[i], VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+        dvz_buffer_memory(
+            &buffers[i],
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        dvz_buffer_queue_access(&buffers[i], 0);
+        dvz_buffer_create(&buffers[i]);
+    }
+
+    uint8_t* data = calloc(size, 1);
+    for (uint32_t i = 0; i < size; i++)
+        data[i] = i;
+    dvz_buffer_upload(&buffers[0], 0, size, data);
+
+    // The second copy reads the second buffer after the first copy has written it.
+    DvzBarrier barrier = dvz_barrier(gpu);
+    dvz_barrier_stages(&barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    dvz_barrier_buffer(&barrier, dvz_buffer_regions(&buffers[1], 1, 0, size, 0));
+    dvz_barrier_buffer_access(&barrier, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+    DvzCommands cmds = dvz_commands(gpu, 0, 1);
+    dvz_cmd_begin(&cmds, 0);
+    dvz_cmd_copy_buffer(&cmds, 0, &buffers[0], 0, &buffers[1], 0, size);
+    dvz_cmd_barrier(&cmds, 0, &barrier);
+    dvz_cmd_copy_buffer(&cmds, 0, &buffers[1], 0, &buffers[2], 0, size);
+    dvz_cmd_end(&cmds, 0);
+    dvz_cmd_submit_sync(&cmds, 0);
+
+    uint8_t* data2 = calloc(size, 1);
+    dvz_buffer_download(&buffers[2], 0, size, data2);
+    AT(memcmp(data2, data, size) == 0);
+
+    FREE(data);
+    FREE(data2);
+    for (uint32_t i = 0; i < 3; i++)
+        dvz_buffer_destroy(&buffers[i]);
+
+    TEST_END
+}
+
+
+
 int test_vklite_submit(TestContext* context)
 {
     DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
@@ -688,3 +744,84 @@ int test_default_app(TestContext* context)
 
     TEST_END
 }
+
+
+
+int test_context_lazy(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzContext* ctx = dvz_context(gpu, NULL);
+
+    // The default resources are not created with the context.
+    DvzBuffer* buffer = dvz_container_get(&ctx->buffers, DVZ_BUFFER_TYPE_VERTEX);
+    AT(buffer != NULL);
+    AT(!dvz_obj_is_created(&buffer->obj));
+    AT(ctx->color_texture.texture == NULL);
+    AT(ctx->font_atlas.texture == NULL);
+
+    // They are created on first use.
+    DvzBufferRegions br = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_VERTEX, 1, 64);
+    AT(br.buffer == buffer);
+    AT(dvz_obj_is_created(&buffer->obj));
+    AT(dvz_ctx_color_texture(ctx) != NULL);
+    AT(dvz_ctx_color_texture(ctx) == ctx->color_texture.texture);
+
+    DvzFontAtlas* atlas = dvz_ctx_font_atlas(ctx);
+    AT(atlas->texture != NULL);
+    AT(atlas->width > 0);
+    AT(atlas->height > 0);
+
+    // The startup timeline records the initialization phases.
+    AT(app->startup.count >= 4);
+    dvz_app_startup_trace(app);
+
+    TEST_END
+}
+
+
+
+int test_context_buffers_resize(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzContext* ctx = dvz_context(gpu, NULL);
+
+    // Grow the last region of the buffer in-place, beyond the size of the buffer.
+    DvzBufferRegions br = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_VERTEX, 1, 64);
+    DvzBuffer* buffer = br.buffer;
+    VkDeviceSize size = buffer->size;
+    dvz_ctx_buffers_resize(ctx, &br, 2 * size);
+    AT(br.buffer == buffer);
+    AT(br.size == 2 * size);
+    AT(buffer->size >= br.offsets[0] + br.size);
+    AT(buffer->allocated_size == br.offsets[0] + br.size);
+
+    TEST_END
+}
+
+
+
+int test_context_buffers_align(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzContext* ctx = dvz_context(gpu, NULL);
+    VkDeviceSize alignment = gpu->device_properties.limits.minStorageBufferOffsetAlignment;
+
+    // Storage buffer regions with sizes that are not multiples of the alignment.
+    DvzBufferRegions br0 = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_STORAGE, 1, 3);
+    DvzBufferRegions br1 = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_STORAGE, 1, 5);
+    AT(br0.offsets[0] % alignment == 0);
+    AT(br1.offsets[0] % alignment == 0);
+    AT(br1.offsets[0] >= br0.offsets[0] + br0.size);
+
+    // The next region is still aligned after an in-place resize of the last one.
+    dvz_ctx_buffers_resize(ctx, &br1, 7);
+    AT(br1.buffer->allocated_size % alignment == 0);
+    DvzBufferRegions br2 = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_STORAGE, 1, 1);
+    AT(br2.offsets[0] % alignment == 0);
+    AT(br2.offsets[0] >= br1.offsets[0] + br1.size);
+
+    TEST_END
+}
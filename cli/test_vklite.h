@@ -22,6 +22,7 @@ int test_vklite_push(TestContext* context);
 int test_vklite_images(TestContext* context);
 int test_vklite_sampler(TestContext* context);
 int test_vklite_barrier(TestContext* context);
+int test_vklite_barrier_buffer(TestContext* context);
 int test_vklite_submit(TestContext* context);
 int test_vklite_blank(TestContext* context);
 int test_vklite_graphics(TestContext* context);
@@ -46,6 +47,9 @@ int test_context_transfer_async_thread(TestContext* context);
 int test_context_download(TestContext* context);
 
 int test_default_app(TestContext* context);
+int test_context_lazy(TestContext* context);
+int test_context_buffers_resize(TestContext* context);
+int test_context_buffers_align(TestContext* context);
 
 
 
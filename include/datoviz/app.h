@@ -31,6 +31,8 @@ extern "C" {
 
 typedef struct DvzApp DvzApp;
 typedef struct DvzClock DvzClock;
+typedef struct DvzTracePhase DvzTracePhase;
+typedef struct DvzTrace DvzTrace;
 
 
 
@@ -88,6 +90,68 @@ static inline void _clock_set(DvzClock* clock)
 
 
 
+/*************************************************************************************************/
+/*  Startup trace                                                                                */
+/*************************************************************************************************/
+
+#define DVZ_MAX_TRACE_PHASES 64
+
+struct DvzTracePhase
+{
+    const char* name;
+    uint64_t start;    // in microseconds, relative to the trace initialization
+    uint64_t duration; // in microseconds
+};
+
+
+
+struct DvzTrace
+{
+    DvzClock clock;
+    uint32_t count;
+    DvzTracePhase phases[DVZ_MAX_TRACE_PHASES];
+};
+
+
+
+static inline void _trace_init(DvzTrace* trace)
+{
+    ASSERT(trace != NULL);
+    trace->count = 0;
+    _clock_init(&trace->clock);
+}
+
+
+
+// Current time of the trace timeline, in microseconds.
+static inline uint64_t _trace_now(DvzTrace* trace)
+{
+    ASSERT(trace != NULL);
+    return (uint64_t)(_clock_get(&trace->clock) * 1000000.0);
+}
+
+
+
+// Record a phase that started at `start` (returned by _trace_now()) and ends now.
+static inline void _trace_phase(DvzTrace* trace, const char* name, uint64_t start)
+{
+    if (trace == NULL)
+        return;
+    uint64_t end = _trace_now(trace);
+    if (trace->count >= DVZ_MAX_TRACE_PHASES)
+    {
+        log_trace("maximum number of trace phases reached, skipping %s", name);
+        return;
+    }
+    DvzTracePhase* phase = &trace->phases[trace->count++];
+    phase->name = name;
+    phase->start = start;
+    phase->duration = end >= start ? end - start : 0;
+    log_trace("startup phase %s took %.3f ms", name, phase->duration / 1000.0);
+}
+
+
+
 /*************************************************************************************************/
 /*  Structs                                                                                      */
 /*************************************************************************************************/
@@ -104,6 +168,9 @@ struct DvzApp
     DvzClock clock;
     bool is_running;
 
+    // Timeline of the initialization phases (app, GPU, context, canvases).
+    DvzTrace startup;
+
     // Vulkan objects.
     VkInstance instance;
     VkDebugUtilsMessengerEXT debug_messenger;
@@ -115,6 +182,13 @@ struct DvzApp
 
     // Threads.
     DvzThread timer_thread;
+
+    // Waiting for events when all canvases render on demand and none of them is dirty.
+    atomic(bool, is_waiting);
+    bool wakeup;
+    pthread_mutex_t wait_lock;
+    pthread_cond_t wait_cond;
+    uint64_t wakeups; // number of times the main loop has waited for events
 };
 
 
@@ -6,6 +6,7 @@
 #ifndef DVZ_ARRAY_HEADER
 #define DVZ_ARRAY_HEADER
 
+#include "memory.h"
 #include "vklite.h"
 
 
@@ -67,6 +68,13 @@ typedef enum
     DVZ_DTYPE_MAT2, // matrices of floats
     DVZ_DTYPE_MAT3,
     DVZ_DTYPE_MAT4,
+
+    DVZ_DTYPE_HALF, // 16 bits float, stored as raw bits in a uint16_t
+    DVZ_DTYPE_HVEC2,
+    DVZ_DTYPE_HVEC3,
+    DVZ_DTYPE_HVEC4,
+
+    DVZ_DTYPE_VEC3_HILO, // pair of vec3 (hi, lo) whose sum approximates a dvec3
 } DvzDataType;
 
 
@@ -135,6 +143,15 @@ static VkDeviceSize _get_dtype_size(DvzDataType dtype)
     case DVZ_DTYPE_USVEC4:
         return 2 * 4;
 
+    case DVZ_DTYPE_HALF:
+        return 2;
+    case DVZ_DTYPE_HVEC2:
+        return 2 * 2;
+    case DVZ_DTYPE_HVEC3:
+        return 2 * 3;
+    case DVZ_DTYPE_HVEC4:
+        return 2 * 4;
+
     // 32 bits
     case DVZ_DTYPE_FLOAT:
     case DVZ_DTYPE_UINT:
@@ -175,6 +192,9 @@ static VkDeviceSize _get_dtype_size(DvzDataType dtype)
     case DVZ_DTYPE_MAT4:
         return 4 * 4 * 4;
 
+    case DVZ_DTYPE_VEC3_HILO:
+        return 2 * 4 * 3;
+
     default:
         break;
     }
@@ -227,6 +247,9 @@ static uint32_t _get_components(DvzDataType dtype)
     case DVZ_DTYPE_DVEC4:
         return 4;
 
+    case DVZ_DTYPE_VEC3_HILO:
+        return 6;
+
     default:
         return 0;
         break;
@@ -236,6 +259,122 @@ static uint32_t _get_components(DvzDataType dtype)
 
 
 
+// Dtype of the components of a given dtype (e.g. FLOAT for vec3), or NONE for matrices, half
+// floats, and custom dtypes.
+static DvzDataType _get_scalar_dtype(DvzDataType dtype)
+{
+    switch (dtype)
+    {
+    case DVZ_DTYPE_CHAR:
+    case DVZ_DTYPE_CVEC2:
+    case DVZ_DTYPE_CVEC3:
+    case DVZ_DTYPE_CVEC4:
+        return DVZ_DTYPE_CHAR;
+
+    case DVZ_DTYPE_USHORT:
+    case DVZ_DTYPE_USVEC2:
+    case DVZ_DTYPE_USVEC3:
+    case DVZ_DTYPE_USVEC4:
+        return DVZ_DTYPE_USHORT;
+
+    case DVZ_DTYPE_SHORT:
+    case DVZ_DTYPE_SVEC2:
+    case DVZ_DTYPE_SVEC3:
+    case DVZ_DTYPE_SVEC4:
+        return DVZ_DTYPE_SHORT;
+
+    case DVZ_DTYPE_UINT:
+    case DVZ_DTYPE_UVEC2:
+    case DVZ_DTYPE_UVEC3:
+    case DVZ_DTYPE_UVEC4:
+        return DVZ_DTYPE_UINT;
+
+    case DVZ_DTYPE_INT:
+    case DVZ_DTYPE_IVEC2:
+    case DVZ_DTYPE_IVEC3:
+    case DVZ_DTYPE_IVEC4:
+        return DVZ_DTYPE_INT;
+
+    case DVZ_DTYPE_FLOAT:
+    case DVZ_DTYPE_VEC2:
+    case DVZ_DTYPE_VEC3:
+    case DVZ_DTYPE_VEC4:
+        return DVZ_DTYPE_FLOAT;
+
+    case DVZ_DTYPE_DOUBLE:
+    case DVZ_DTYPE_DVEC2:
+    case DVZ_DTYPE_DVEC3:
+    case DVZ_DTYPE_DVEC4:
+        return DVZ_DTYPE_DOUBLE;
+
+    default:
+        break;
+    }
+    return DVZ_DTYPE_NONE;
+}
+
+
+
+// Read a scalar of a given dtype as a double.
+static inline double _scalar_get(DvzDataType dtype, const void* src)
+{
+    switch (dtype)
+    {
+    case DVZ_DTYPE_CHAR:
+        return *(const uint8_t*)src;
+    case DVZ_DTYPE_USHORT:
+        return *(const uint16_t*)src;
+    case DVZ_DTYPE_SHORT:
+        return *(const int16_t*)src;
+    case DVZ_DTYPE_UINT:
+        return *(const uint32_t*)src;
+    case DVZ_DTYPE_INT:
+        return *(const int32_t*)src;
+    case DVZ_DTYPE_FLOAT:
+        return *(const float*)src;
+    case DVZ_DTYPE_DOUBLE:
+        return *(const double*)src;
+    default:
+        break;
+    }
+    return 0;
+}
+
+
+
+// Write a double as a scalar of a given dtype, integer dtypes are clamped.
+static inline void _scalar_set(DvzDataType dtype, void* dst, double value)
+{
+    switch (dtype)
+    {
+    case DVZ_DTYPE_CHAR:
+        *(uint8_t*)dst = (uint8_t)CLIP(value, 0, UINT8_MAX);
+        break;
+    case DVZ_DTYPE_USHORT:
+        *(uint16_t*)dst = (uint16_t)CLIP(value, 0, UINT16_MAX);
+        break;
+    case DVZ_DTYPE_SHORT:
+        *(int16_t*)dst = (int16_t)CLIP(value, INT16_MIN, INT16_MAX);
+        break;
+    case DVZ_DTYPE_UINT:
+        *(uint32_t*)dst = (uint32_t)CLIP(value, 0, UINT32_MAX);
+        break;
+    case DVZ_DTYPE_INT:
+        *(int32_t*)dst = (int32_t)CLIP(value, INT32_MIN, INT32_MAX);
+        break;
+    case DVZ_DTYPE_FLOAT:
+        *(float*)dst = (float)value;
+        break;
+    case DVZ_DTYPE_DOUBLE:
+        *(double*)dst = value;
+        break;
+    default:
+        break;
+    }
+}
+
+
+
 /*************************************************************************************************/
 /*  Functions                                                                                    */
 /*************************************************************************************************/
@@ -254,6 +393,7 @@ static DvzArray _create_array(uint32_t item_count, DvzDataType dtype, VkDeviceSi
     arr.buffer_size = item_count * arr.item_size;
     if (item_count > 0)
         arr.data = calloc(item_count, arr.item_size);
+    dvz_memory_arrays_track(arr.data != NULL ? (int64_t)arr.buffer_size : 0, 1);
     dvz_obj_created(&arr.obj);
     return arr;
 }
@@ -287,6 +427,7 @@ static DvzArray dvz_array_copy(DvzArray* arr)
     DvzArray arr_new = *arr; // struct copy
     arr_new.data = malloc(arr->buffer_size);
     memcpy(arr_new.data, arr->data, arr->buffer_size);
+    dvz_memory_arrays_track((int64_t)arr->buffer_size, 1);
     return arr_new;
 }
 
@@ -326,6 +467,7 @@ static DvzArray dvz_array_wrap(uint32_t item_count, DvzDataType dtype, void* dat
     arr.item_count = item_count;
     arr.buffer_size = item_count * arr.item_size;
     arr.data = data;
+    dvz_memory_arrays_track((int64_t)arr.buffer_size, 0);
     return arr;
 }
 
@@ -429,6 +571,7 @@ static void dvz_array_resize(DvzArray* array, uint32_t item_count)
         // NOTE: using dvz_next_pow2() below causes a crash in scene_axes test
         array->buffer_size = item_count * array->item_size;
         // array->buffer_size = dvz_next_pow2(item_count * array->item_size);
+        dvz_memory_arrays_track((int64_t)array->buffer_size, 0);
 
         log_trace(
             "allocate array to contain %d elements (%s)", item_count,
@@ -453,6 +596,7 @@ static void dvz_array_resize(DvzArray* array, uint32_t item_count)
             "resize array from %d to %d items of size %d", old_item_count, new_item_count,
             array->item_size);
         REALLOC(array->data, new_size);
+        dvz_memory_arrays_track((int64_t)new_size - (int64_t)old_size, 0);
         // Repeat the last element when resizing.
         _repeat_last(old_size / array->item_size, array->item_size, array->data, new_item_count);
         array->buffer_size = new_size;
@@ -631,7 +775,10 @@ static void dvz_array_data(
     void* dst = array->data;
     // Allocate the array if needed.
     if (dst == NULL)
+    {
         dst = array->data = calloc(first_item + array->item_count, array->item_size);
+        dvz_memory_arrays_track((int64_t)array->buffer_size, 0);
+    }
     ASSERT(dst != NULL);
     const void* src = data;
     ASSERT(src != NULL);
@@ -654,6 +801,87 @@ static void dvz_array_data(
 }
 
 
+/**
+ * Copy strided data, with a possibly different dtype, into an array.
+ *
+ * Each item of the source data is made of as many scalars as the array components, with arbitrary
+ * strides between the items and between the components of an item. The scalars are converted to
+ * the dtype of the array components in the same pass, so that the source data does not need to be
+ * made contiguous or cast beforehand. Conversions to integer dtypes clamp the values.
+ *
+ * @param array the array
+ * @param first_item first element in the array to be overwritten
+ * @param item_count number of items to write
+ * @param data pointer to the first component of the first item
+ * @param dtype scalar dtype of the source data
+ * @param item_stride number of bytes between two consecutive items in the source data
+ * @param component_stride number of bytes between two consecutive components of an item
+ */
+static void dvz_array_data_strided(
+    DvzArray* array, uint32_t first_item, uint32_t item_count, const void* data,
+    DvzDataType dtype, int64_t item_stride, int64_t component_stride)
+{
+    ASSERT(array != NULL);
+    ASSERT(item_count > 0);
+    if (data == NULL)
+    {
+        log_debug("skipping dvz_array_data_strided() with NULL data");
+        return;
+    }
+
+    DvzDataType target = _get_scalar_dtype(array->dtype);
+    uint32_t nc = array->components;
+    if (target == DVZ_DTYPE_NONE || _get_components(dtype) != 1)
+    {
+        log_error("unsupported strided copy from dtype %d to dtype %d", dtype, array->dtype);
+        return;
+    }
+    ASSERT(nc > 0);
+    ASSERT(array->item_size == nc * _get_dtype_size(target));
+
+    // Resize if necessary.
+    if (first_item + item_count > array->item_count)
+        dvz_array_resize(array, first_item + item_count);
+    ASSERT(array->data != NULL);
+
+    int64_t size = (int64_t)_get_dtype_size(dtype);
+    int64_t target_size = (int64_t)_get_dtype_size(target);
+    int64_t src = (int64_t)data;
+    int64_t dst = (int64_t)array->data + (int64_t)(first_item * array->item_size);
+
+    // Contiguous data with the same dtype: a single copy.
+    if (dtype == target && component_stride == size && item_stride == nc * size)
+    {
+        memcpy((void*)dst, (const void*)src, item_count * array->item_size);
+        return;
+    }
+
+    // Float data for a double array, typically positions: no per-scalar dtype dispatch.
+    if (dtype == DVZ_DTYPE_FLOAT && target == DVZ_DTYPE_DOUBLE)
+    {
+        double* out = (double*)dst;
+        for (uint32_t i = 0; i < item_count; i++)
+            for (uint32_t j = 0; j < nc; j++)
+                *out++ = *(const float*)(src + i * item_stride + j * component_stride);
+        return;
+    }
+
+    const void* scalar = NULL;
+    for (uint32_t i = 0; i < item_count; i++)
+    {
+        for (uint32_t j = 0; j < nc; j++)
+        {
+            scalar = (const void*)(src + i * item_stride + j * component_stride);
+            if (dtype == target)
+                memcpy((void*)dst, scalar, (size_t)size);
+            else
+                _scalar_set(target, (void*)dst, _scalar_get(dtype, scalar));
+            dst += target_size;
+        }
+    }
+}
+
+
 /**
  * Multiply all array elements by a scaling factor.
  *
@@ -694,7 +922,94 @@ static inline void* dvz_array_item(DvzArray* array, uint32_t idx)
 
 
 
+// Convert a float to a half-precision float (IEEE 754 binary16), rounding to nearest even.
+static inline uint16_t _float_to_half(float value)
+{
+    union
+    {
+        float f;
+        uint32_t u;
+    } v = {value};
+    uint32_t sign = (v.u >> 16) & 0x8000;
+    uint32_t mag = v.u & 0x7FFFFFFF;
+
+    // NaN and infinity.
+    if (mag >= 0x7F800000)
+        return (uint16_t)(sign | 0x7C00 | (mag > 0x7F800000 ? 0x0200 : 0));
+    // Overflow: round to infinity.
+    if (mag >= 0x477FF000)
+        return (uint16_t)(sign | 0x7C00);
+    // Subnormal halfs.
+    if (mag < 0x38800000)
+    {
+        if (mag < 0x33000000)
+            return (uint16_t)sign;
+        uint32_t shift = 126 - (mag >> 23);
+        uint32_t mant = (mag & 0x007FFFFF) | 0x00800000;
+        uint32_t half = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t mid = 1u << (shift - 1);
+        if (rem > mid || (rem == mid && (half & 1)))
+            half++;
+        return (uint16_t)(sign | half);
+    }
+    // Normal halfs: rebias the exponent and round the mantissa.
+    uint32_t half = ((mag - 0x38000000) >> 13);
+    uint32_t rem = mag & 0x1FFF;
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1)))
+        half++;
+    return (uint16_t)(sign | half);
+}
+
+
+
+// Convert a half-precision float to a float.
+static inline float _half_to_float(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exp = (value >> 10) & 0x1F;
+    uint32_t mant = value & 0x03FF;
+    union
+    {
+        uint32_t u;
+        float f;
+    } v = {0};
+
+    if (exp == 0x1F)
+        v.u = sign | 0x7F800000 | (mant << 13);
+    else if (exp != 0)
+        v.u = sign | ((exp + 112) << 23) | (mant << 13);
+    else if (mant == 0)
+        v.u = sign;
+    else
+    {
+        // Subnormal half: normalize the mantissa.
+        exp = 113;
+        while ((mant & 0x0400) == 0)
+        {
+            mant <<= 1;
+            exp--;
+        }
+        v.u = sign | (exp << 23) | ((mant & 0x03FF) << 13);
+    }
+    return v.f;
+}
+
+
+
+// Quantize a double in [-1, 1] to a 16-bit signed normalized integer (values are clamped).
+static inline int16_t _double_to_snorm16(double value)
+{
+    value = CLIP(value, -1, +1);
+    return (int16_t)round(value * 32767);
+}
+
+
+
 // Cast a vector.
+// NOTE: casting to SVEC4 quantizes normalized values in [-1, 1] (for VK_FORMAT_*_SNORM vertex
+// attributes), casting to CHAR rounds and clamps values to [0, 255], casting to VEC3_HILO splits
+// each double into a float and the float rounding error.
 static inline void _cast(DvzDataType target_dtype, void* dst, DvzDataType source_dtype, void* src)
 {
     if (source_dtype == DVZ_DTYPE_DOUBLE && target_dtype == DVZ_DTYPE_FLOAT)
@@ -712,6 +1027,32 @@ static inline void _cast(DvzDataType target_dtype, void* dst, DvzDataType source
         ((vec3*)dst)[0][1] = ((dvec3*)src)[0][1];
         ((vec3*)dst)[0][2] = ((dvec3*)src)[0][2];
     }
+    else if (source_dtype == DVZ_DTYPE_DVEC3 && target_dtype == DVZ_DTYPE_SVEC4)
+    {
+        ((svec4*)dst)[0][0] = _double_to_snorm16(((dvec3*)src)[0][0]);
+        ((svec4*)dst)[0][1] = _double_to_snorm16(((dvec3*)src)[0][1]);
+        ((svec4*)dst)[0][2] = _double_to_snorm16(((dvec3*)src)[0][2]);
+        ((svec4*)dst)[0][3] = 0;
+    }
+    else if (source_dtype == DVZ_DTYPE_DVEC3 && target_dtype == DVZ_DTYPE_HVEC4)
+    {
+        ((usvec4*)dst)[0][0] = _float_to_half((float)((dvec3*)src)[0][0]);
+        ((usvec4*)dst)[0][1] = _float_to_half((float)((dvec3*)src)[0][1]);
+        ((usvec4*)dst)[0][2] = _float_to_half((float)((dvec3*)src)[0][2]);
+        ((usvec4*)dst)[0][3] = 0;
+    }
+    else if (source_dtype == DVZ_DTYPE_DVEC3 && target_dtype == DVZ_DTYPE_VEC3_HILO)
+    {
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            ((vec3*)dst)[0][i] = (float)((dvec3*)src)[0][i];
+            ((vec3*)dst)[1][i] = (float)(((dvec3*)src)[0][i] - ((vec3*)dst)[0][i]);
+        }
+    }
+    else if (source_dtype == DVZ_DTYPE_FLOAT && target_dtype == DVZ_DTYPE_CHAR)
+    {
+        ((uint8_t*)dst)[0] = (uint8_t)CLIP(round(((float*)src)[0]), 0, 255);
+    }
     else
         log_error("unknown casting dtypes %d %d", source_dtype, target_dtype);
 }
@@ -841,6 +1182,7 @@ static void dvz_array_destroy(DvzArray* array)
     if (!dvz_obj_is_created(&array->obj))
         return;
     dvz_obj_destroyed(&array->obj);
+    dvz_memory_arrays_track(array->data != NULL ? -(int64_t)array->buffer_size : 0, -1);
     FREE(array->data) //
 }
 
@@ -25,19 +25,27 @@ static const char DVZ_FONT_ATLAS_STRING[] =
 
 
 
-static size_t _font_atlas_glyph(DvzFontAtlas* atlas, const char* str, uint32_t idx)
+// Fill the lookup table mapping every byte to its glyph index in the atlas. Characters missing
+// from the atlas map to the glyph count, like strcspn() would.
+static void _font_atlas_lut(DvzFontAtlas* atlas)
 {
     ASSERT(atlas != NULL);
-    ASSERT(atlas->rows > 0);
-    ASSERT(atlas->cols > 0);
-    ASSERT(str != NULL);
-    ASSERT(strlen(str) > 0);
-    ASSERT(idx < strlen(str));
     ASSERT(atlas->font_str != NULL);
-    ASSERT(strlen(atlas->font_str) > 0);
+    size_t n = strlen(atlas->font_str);
+    ASSERT(n > 0);
+    ASSERT(n < 256);
+    memset(atlas->glyph_lut, (int)n, sizeof(atlas->glyph_lut));
+    // NOTE: iterate backwards so that the first occurrence of a character wins.
+    for (size_t i = n; i > 0; i--)
+        atlas->glyph_lut[(unsigned char)atlas->font_str[i - 1]] = (uint8_t)(i - 1);
+}
+
+
 
-    char c[2] = {str[idx], 0};
-    return strcspn(atlas->font_str, c);
+static inline uint32_t _font_atlas_glyph(DvzFontAtlas* atlas, char c)
+{
+    ASSERT(atlas != NULL);
+    return atlas->glyph_lut[(unsigned char)c];
 }
 
 
@@ -71,34 +79,50 @@ static DvzTexture* _font_texture(DvzContext* ctx, DvzFontAtlas* atlas)
 
 
 
-static DvzFontAtlas dvz_font_atlas(DvzContext* ctx)
+// Decode the font PNG file. This function does not make any GPU call and may run in a
+// background thread.
+static void* _font_atlas_load(void* user_data)
 {
+    DvzFontAtlas* atlas = (DvzFontAtlas*)user_data;
+    ASSERT(atlas != NULL);
+
     // Font texture
     char path[1024];
     snprintf(path, sizeof(path), "%s/%s", FONT_TEXTURE_DIR, "font_inconsolata.png");
-    ASSERT(path != NULL);
-
-    int width, height, depth;
 
-    DvzFontAtlas atlas = {0};
-    atlas.font_texture = stbi_load(path, &width, &height, &depth, STBI_rgb_alpha);
+    int width = 0, height = 0, depth = 0;
+    atlas->font_texture = stbi_load(path, &width, &height, &depth, STBI_rgb_alpha);
+    if (atlas->font_texture == NULL)
+    {
+        log_error("unable to load the font texture %s", path);
+        return NULL;
+    }
     ASSERT(width > 0);
     ASSERT(height > 0);
     ASSERT(depth > 0);
 
     // TODO: parameters
-    atlas.font_str = DVZ_FONT_ATLAS_STRING;
-    ASSERT(strlen(atlas.font_str) > 0);
-    atlas.cols = 16;
-    atlas.rows = 6;
+    atlas->font_str = DVZ_FONT_ATLAS_STRING;
+    _font_atlas_lut(atlas);
+    atlas->cols = 16;
+    atlas->rows = 6;
+
+    atlas->width = (uint32_t)width;
+    atlas->height = (uint32_t)height;
+    atlas->glyph_width = atlas->width / (float)atlas->cols;
+    atlas->glyph_height = atlas->height / (float)atlas->rows;
+
+    return NULL;
+}
 
-    atlas.width = (uint32_t)width;
-    atlas.height = (uint32_t)height;
-    atlas.glyph_width = atlas.width / (float)atlas.cols;
-    atlas.glyph_height = atlas.height / (float)atlas.rows;
 
-    atlas.texture = _font_texture(ctx, &atlas);
 
+static DvzFontAtlas dvz_font_atlas(DvzContext* ctx)
+{
+    DvzFontAtlas atlas = {0};
+    _font_atlas_load(&atlas);
+    if (atlas.font_texture != NULL)
+        atlas.texture = _font_texture(ctx, &atlas);
     return atlas;
 }
 
@@ -107,8 +131,9 @@ static DvzFontAtlas dvz_font_atlas(DvzContext* ctx)
 static void dvz_font_atlas_destroy(DvzFontAtlas* atlas)
 {
     ASSERT(atlas != NULL);
-    ASSERT(atlas->font_texture != NULL);
-    stbi_image_free(atlas->font_texture);
+    if (atlas->font_texture != NULL)
+        stbi_image_free(atlas->font_texture);
+    atlas->font_texture = NULL;
 }
 
 
@@ -0,0 +1,240 @@
+/*************************************************************************************************/
+/*  Bricked out-of-core volumes streamed from a memory-mapped file                               */
+/*************************************************************************************************/
+
+#ifndef DVZ_BRICKS_HEADER
+#define DVZ_BRICKS_HEADER
+
+#include "common.h"
+#include "visuals.h"
+#include "vklite.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_BRICK_APRON            1    // number of border voxels on each side of a cached brick
+#define DVZ_BRICK_UPLOAD_BUDGET    16   // default maximum number of brick uploads per update
+#define DVZ_BRICK_MAX_CACHE_SLOTS  255  // maximum number of cache slots per axis (8-bit entries)
+#define DVZ_BRICK_PRIORITY_EPSILON 1e-4 // minimum eye displacement to recompute the priorities
+
+
+
+/*************************************************************************************************/
+/*  Enums                                                                                        */
+/*************************************************************************************************/
+
+// Brick state.
+typedef enum
+{
+    DVZ_BRICK_EMPTY,    // not in the cache, not requested
+    DVZ_BRICK_QUEUED,   // requested, waiting for the loader thread
+    DVZ_BRICK_LOADING,  // being read by the loader thread
+    DVZ_BRICK_LOADED,   // read, waiting for the upload to the cache texture
+    DVZ_BRICK_RESIDENT, // in the cache texture
+} DvzBrickState;
+
+
+
+// Loader buffer state.
+typedef enum
+{
+    DVZ_BRICK_BUFFER_FREE,
+    DVZ_BRICK_BUFFER_LOADING,
+    DVZ_BRICK_BUFFER_LOADED,
+    DVZ_BRICK_BUFFER_UPLOADING,
+} DvzBrickBufferState;
+
+
+
+/*************************************************************************************************/
+/*  Typedefs                                                                                     */
+/*************************************************************************************************/
+
+typedef struct DvzBrickBuffer DvzBrickBuffer;
+typedef struct DvzBrickStats DvzBrickStats;
+typedef struct DvzBricks DvzBricks;
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+// Buffer holding a brick read by the loader thread, until it has been uploaded to the GPU.
+struct DvzBrickBuffer
+{
+    DvzBrickBufferState state;
+    uint32_t brick_idx;
+    uint16_t* data; // (brick_size + 2 * DVZ_BRICK_APRON)^3 voxels
+};
+
+
+
+struct DvzBrickStats
+{
+    uint64_t loads;     // number of bricks read by the loader thread
+    uint64_t uploads;   // number of bricks uploaded to the cache texture
+    uint64_t evictions; // number of bricks evicted from the cache texture
+    uint64_t discards;  // number of loaded bricks that were no longer needed
+    uint32_t resident;  // current number of bricks in the cache texture
+};
+
+
+
+struct DvzBricks
+{
+    DvzObject obj;
+    DvzCanvas* canvas;
+
+    // Volume layout. The volume is a raw uint16 array, with x varying fastest.
+    uvec3 shape;         // volume shape in voxels (width, height, depth)
+    uint32_t brick_size; // brick side in voxels, without the apron
+    uint32_t slot_size;  // brick side in voxels in the cache texture, with the apron
+    uvec3 grid;          // number of bricks along each axis
+    uint32_t brick_count;
+
+    // Cache layout.
+    uvec3 cache_grid; // number of cache slots along each axis
+    uint32_t slot_count;
+    uint32_t upload_budget; // maximum number of brick uploads per update
+
+    // Memory-mapped file.
+    const uint16_t* data;
+    size_t data_size;
+    FILE* file; // used when memory mapping is not available
+
+    // GPU resources.
+    DvzTexture* cache;      // 3D R16_UNORM texture with the cached bricks
+    DvzTexture* page_table; // 3D R8G8B8A8_UINT texture: slot coordinates and resident flag
+
+    // Per-brick CPU data.
+    cvec4* table;           // CPU copy of the page table
+    uint8_t* state;         // DvzBrickState
+    int32_t* brick_slot;    // cache slot, or -1
+    uint32_t* wanted_epoch; // last priority epoch where the brick was wanted
+
+    // Per-slot LRU list, the head is the most recently used slot.
+    int32_t* slot_brick; // brick in each slot, or -1
+    int32_t* lru_prev;
+    int32_t* lru_next;
+    int32_t lru_head, lru_tail;
+    uint32_t slot_used;
+
+    // Priorities: the bricks closest to the eye, sorted by increasing distance.
+    vec3 eye;
+    bool has_eye;
+    uint32_t epoch;
+    uint32_t* wanted;
+    float* wanted_dist;
+    uint32_t wanted_count;
+
+    // Loader thread, the lock protects the request queue, the brick states, and the buffers.
+    DvzThread thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    atomic(bool, is_running);
+    uint32_t* queue;
+    uint32_t queue_count, queue_pos;
+    DvzBrickBuffer* buffers;
+    uint32_t buffer_count;
+
+    DvzBrickStats stats;
+};
+
+
+
+/*************************************************************************************************/
+/*  Functions                                                                                    */
+/*************************************************************************************************/
+
+/**
+ * Create a bricked volume streamed from a raw file.
+ *
+ * The file contains a `uint16` volume with x varying fastest, then y, then z. The volume is
+ * split into cubic bricks. A fixed-size cache texture holds a subset of the bricks, and a page
+ * table texture maps each brick to its slot in the cache. A background thread reads the bricks
+ * closest to the eye from the memory-mapped file, and `dvz_bricks_update()` uploads them to the
+ * cache, evicting the least recently used bricks.
+ *
+ * @param canvas the canvas
+ * @param path path to the raw volume file
+ * @param shape the volume shape in voxels (width, height, depth)
+ * @param brick_size the brick side, in voxels
+ * @param cache_grid the number of cache slots along each axis
+ * @returns the bricked volume
+ */
+DVZ_EXPORT DvzBricks* dvz_bricks(
+    DvzCanvas* canvas, const char* path, uvec3 shape, uint32_t brick_size, uvec3 cache_grid);
+
+/**
+ * Set the maximum number of bricks uploaded at each update.
+ *
+ * @param bricks the bricked volume
+ * @param budget the maximum number of brick uploads per update
+ */
+DVZ_EXPORT void dvz_bricks_budget(DvzBricks* bricks, uint32_t budget);
+
+/**
+ * Bind a bricked volume to a volume visual created with `DVZ_GRAPHICS_FLAGS_VOLUME_BRICKED`.
+ *
+ * @param bricks the bricked volume
+ * @param visual the volume visual
+ */
+DVZ_EXPORT void dvz_bricks_visual(DvzBricks* bricks, DvzVisual* visual);
+
+/**
+ * Request the bricks closest to the eye and upload the bricks read by the loader thread.
+ *
+ * This function should be called at most once per frame, typically in a FRAME callback, as the
+ * brick uploads go through the canvas transfers.
+ *
+ * @param bricks the bricked volume
+ * @param eye the eye position, in normalized volume coordinates (between 0 and 1 in the volume)
+ */
+DVZ_EXPORT void dvz_bricks_update(DvzBricks* bricks, vec3 eye);
+
+/**
+ * Block until the loader thread has read all requested bricks.
+ *
+ * @param bricks the bricked volume
+ */
+DVZ_EXPORT void dvz_bricks_wait(DvzBricks* bricks);
+
+/**
+ * Return the cache slot of a brick.
+ *
+ * @param bricks the bricked volume
+ * @param brick the brick coordinates
+ * @returns the slot index, or -1 if the brick is not in the cache
+ */
+DVZ_EXPORT int32_t dvz_bricks_slot(DvzBricks* bricks, uvec3 brick);
+
+/**
+ * Return the streaming statistics.
+ *
+ * @param bricks the bricked volume
+ * @returns the statistics
+ */
+DVZ_EXPORT DvzBrickStats dvz_bricks_stats(DvzBricks* bricks);
+
+/**
+ * Destroy a bricked volume.
+ *
+ * @param bricks the bricked volume
+ */
+DVZ_EXPORT void dvz_bricks_destroy(DvzBricks* bricks);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -75,6 +75,8 @@ typedef enum
     DVZ_VISUAL_AXES_3D,
     DVZ_VISUAL_COLORMAP,
 
+    DVZ_VISUAL_POINT_CMAP,
+
     DVZ_VISUAL_COUNT,
 
     DVZ_VISUAL_CUSTOM,
@@ -8,6 +8,7 @@
 #include "context.h"
 #include "fifo.h"
 #include "keycode.h"
+#include "profiler.h"
 #include "transfers.h"
 #include "vklite.h"
 
@@ -22,8 +23,6 @@ extern "C" {
 /*************************************************************************************************/
 
 #define DVZ_MAX_EVENT_CALLBACKS 32
-// Maximum acceptable duration for the pending events in the event queue, in seconds
-#define DVZ_MAX_EVENT_DURATION .5
 #define DVZ_DEFAULT_BACKGROUND                                                                    \
     (VkClearColorValue)                                                                           \
     {                                                                                             \
@@ -41,6 +40,7 @@ extern "C" {
 #define DVZ_DEFAULT_COMMANDS_TRANSFER 0
 #define DVZ_DEFAULT_COMMANDS_RENDER   1
 #define DVZ_MAX_FRAMES_IN_FLIGHT      2
+#define DVZ_MAX_TEXTURE_STREAMS       16
 
 
 
@@ -54,6 +54,7 @@ typedef enum
     DVZ_CANVAS_FLAGS_NONE = 0x0000,
     DVZ_CANVAS_FLAGS_IMGUI = 0x0001,
     DVZ_CANVAS_FLAGS_FPS = 0x0003, // NOTE: 1 bit for ImGUI, 1 bit for FPS
+    DVZ_CANVAS_FLAGS_ON_DEMAND = 0x0008, // only render frames when something has changed
 
     DVZ_CANVAS_FLAGS_DPI_SCALE_050 = 0x1000,
     DVZ_CANVAS_FLAGS_DPI_SCALE_100 = 0x2000,
@@ -266,6 +267,7 @@ typedef struct DvzPendingRefill DvzPendingRefill;
 typedef struct DvzGui DvzGui;
 typedef struct DvzGuiContext DvzGuiContext;
 typedef struct DvzGuiControl DvzGuiControl;
+typedef struct DvzEventRecorder DvzEventRecorder;
 
 
 /*************************************************************************************************/
@@ -362,6 +364,8 @@ struct DvzMouseMoveEvent
 {
     vec2 pos;
     int modifiers;
+    vec2 delta;     // displacement since the previous mouse position
+    uint32_t count; // number of coalesced mouse move events
 };
 
 
@@ -370,6 +374,7 @@ struct DvzMouseWheelEvent
 {
     vec2 dir;
     int modifiers;
+    uint32_t count; // number of coalesced mouse wheel events
 };
 
 
@@ -550,6 +555,7 @@ struct DvzCanvas
     bool offscreen;
     bool overlay;
     bool resized;
+    bool on_demand; // only render when the canvas is dirty, see dvz_canvas_request_frame()
     float dpi_scaling;
     int flags;
     void* user_data;
@@ -558,6 +564,7 @@ struct DvzCanvas
     // safely communicate a status change of the canvas
     atomic(DvzObjectStatus, cur_status);
     atomic(bool, to_close);
+    atomic(bool, dirty); // whether a canvas rendering on demand needs a new frame
 
     DvzWindow* window;
 
@@ -597,13 +604,16 @@ struct DvzCanvas
     // Data transfers.
     DvzFifo transfers;
 
+    // Texture streams in progress, stepped at every frame.
+    uint32_t stream_count;
+    DvzTextureStream* streams[DVZ_MAX_TEXTURE_STREAMS];
+
     // Event callbacks, running in the background thread, may be slow, for end-users.
     uint32_t callbacks_count;
     DvzEventCallbackRegister callbacks[DVZ_MAX_EVENT_CALLBACKS];
 
     // Event queue.
     DvzFifo event_queue;
-    DvzEvent events[DVZ_MAX_FIFO_CAPACITY];
     DvzThread event_thread;
     bool enable_lock;
     atomic(DvzEventType, event_processing);
@@ -621,6 +631,11 @@ struct DvzCanvas
 
     DvzViewport viewport;
     DvzScene* scene;
+
+    DvzProfiler* profiler; // NULL unless profiling was enabled with dvz_canvas_profiler()
+    double frame_start;    // profiler time at the beginning of the current frame
+
+    DvzEventRecorder* recorder; // NULL unless the events are recorded with dvz_event_record()
 };
 
 
@@ -791,6 +806,18 @@ DVZ_EXPORT void dvz_canvas_to_refill(DvzCanvas* canvas);
  */
 DVZ_EXPORT void dvz_canvas_to_close(DvzCanvas* canvas);
 
+/**
+ * Mark a canvas as dirty so that it renders a new frame.
+ *
+ * This is only needed with canvases created with `DVZ_CANVAS_FLAGS_ON_DEMAND`, that do not
+ * render anything until something changes. Input events, TIMER events, visual data updates,
+ * transfers, and refills already request new frames. This function is thread-safe and wakes up
+ * the main loop if it is waiting for events.
+ *
+ * @param canvas the canvas
+ */
+DVZ_EXPORT void dvz_canvas_request_frame(DvzCanvas* canvas);
+
 
 
 /*************************************************************************************************/
@@ -1122,10 +1149,35 @@ DVZ_EXPORT void dvz_canvas_frame(DvzCanvas* canvas);
  */
 DVZ_EXPORT void dvz_canvas_frame_submit(DvzCanvas* canvas);
 
+/**
+ * Enable the frame profiler of a canvas.
+ *
+ * Once enabled, every frame records CPU zones (callbacks, transfers, refill, submit) and, if the
+ * GPU supports timestamp queries, GPU zones (visual draws and transfers). This also works with
+ * offscreen canvases.
+ *
+ * @param canvas the canvas
+ * @returns the canvas profiler, created on the first call
+ */
+DVZ_EXPORT DvzProfiler* dvz_canvas_profiler(DvzCanvas* canvas);
+
+/**
+ * Wake up the main loop if it is waiting for events.
+ *
+ * When all canvases render on demand and none of them is dirty, the main loop blocks until the
+ * next input event or TIMER event. This function is thread-safe and may be called by background
+ * threads to make the main loop check the canvases again, for example after enqueuing a transfer.
+ *
+ * @param app the app
+ */
+DVZ_EXPORT void dvz_app_wakeup(DvzApp* app);
+
 /**
  * Start the main event loop.
  *
- * Every loop iteration processes one frame of all open canvases.
+ * Every loop iteration processes one frame of all open canvases. Canvases created with
+ * `DVZ_CANVAS_FLAGS_ON_DEMAND` are skipped unless they are dirty, and when all canvases are
+ * skipped, the iteration waits for events instead.
  *
  * @param app the app
  * @param frame_count number of frames to process (0 for infinite loop)
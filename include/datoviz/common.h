@@ -296,6 +296,15 @@ struct DvzMVP
     mat4 view;
     mat4 proj;
     float time;
+    float _pad[3];
+
+    // Data to normalized coordinates transform of the visuals with emulated double precision
+    // positions (DVZ_GRAPHICS_FLAGS_POS_DOUBLE): ndc = (pos - offset) * scale, where the positions
+    // and the offset are relative to the panel origin and split into (hi, lo) float pairs.
+    // The transform is ignored when data_scale[3] is 0.
+    vec4 data_offset_hi;
+    vec4 data_offset_lo;
+    vec4 data_scale;
 };
 
 
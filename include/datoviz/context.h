@@ -8,6 +8,8 @@
 #include "colormaps.h"
 #include "common.h"
 #include "fifo.h"
+#include "memory.h"
+#include "profiler.h"
 #include "transfers.h"
 #include "vklite.h"
 
@@ -33,6 +35,9 @@ extern "C" {
 #define DVZ_ZERO_OFFSET                                                                           \
     (uvec3) { 0, 0, 0 }
 
+#define DVZ_TEXTURE_STREAM_SLOTS      4
+#define DVZ_TEXTURE_STREAM_CHUNK_SIZE (4 * 1024 * 1024)
+
 
 
 /*************************************************************************************************/
@@ -81,6 +86,7 @@ struct DvzFontAtlas
     uint8_t* font_texture;
     float glyph_width, glyph_height;
     const char* font_str;
+    uint8_t glyph_lut[256]; // glyph index of every character in font_str
     DvzTexture* texture;
 };
 
@@ -107,13 +113,84 @@ struct DvzContext
     DvzContainer textures;
     DvzContainer computes;
 
-    // Font atlas.
+    // Font atlas, decoded in a background thread and uploaded on first use.
     DvzFontAtlas font_atlas;
+    DvzThread font_thread;
+
+    // Colormap texture, uploaded on first use.
     DvzColorTexture color_texture;
+
+    // Profiler of the canvas whose transfers are being processed, if any (not owned).
+    DvzProfiler* profiler;
+
+    // Number of buffer region sets allocated with dvz_ctx_buffers(), see dvz_context_memory().
+    uint32_t region_count;
+};
+
+
+
+struct DvzTextureStream
+{
+    DvzObject obj;
+    DvzTexture* texture;
+
+    // The data is not copied and must remain valid until the stream is done.
+    const uint8_t* data;
+    VkDeviceSize size;
+
+    // The chunks are bands of rows (1D and 2D textures) or of slices (3D textures), which are
+    // contiguous in the source data.
+    VkDeviceSize row_size;
+    uint32_t rows_per_chunk;
+    uint32_t chunk_count;
+    uint32_t chunk_next; // next chunk to submit
+    uint32_t chunk_done; // number of uploaded chunks
+    bool mips;           // whether to generate the mip levels after the last chunk
+    VkFilter mip_filter;
+
+    // Ring of staging slots, each with a command buffer and a fence.
+    DvzBuffer staging;
+    DvzCommands cmds;
+    DvzFences fences;
+    int32_t slot_chunks[DVZ_TEXTURE_STREAM_SLOTS]; // chunk being uploaded in each slot, or -1
+
+    VkDeviceSize uploaded; // number of bytes uploaded so far
+    atomic(bool, is_done);
 };
 
 
 
+/*************************************************************************************************/
+/*  Default resources                                                                            */
+/*************************************************************************************************/
+
+/**
+ * Return one of the default buffers of the context, creating it on first use.
+ *
+ * @param context the context
+ * @param buffer_type the buffer type
+ * @returns the buffer
+ */
+DVZ_EXPORT DvzBuffer* dvz_ctx_default_buffer(DvzContext* context, DvzBufferType buffer_type);
+
+/**
+ * Return the font atlas, waiting for the font texture to be decoded and uploaded if needed.
+ *
+ * @param context the context
+ * @returns the font atlas
+ */
+DVZ_EXPORT DvzFontAtlas* dvz_ctx_font_atlas(DvzContext* context);
+
+/**
+ * Return the colormap texture, uploading it on first use.
+ *
+ * @param context the context
+ * @returns the colormap texture
+ */
+DVZ_EXPORT DvzTexture* dvz_ctx_color_texture(DvzContext* context);
+
+
+
 /*************************************************************************************************/
 /*  Utils                                                                                        */
 /*************************************************************************************************/
@@ -121,7 +198,7 @@ struct DvzContext
 // Get the staging buffer, and make sure it can contain `size` bytes.
 static DvzBuffer* staging_buffer(DvzContext* context, VkDeviceSize size)
 {
-    DvzBuffer* staging = (DvzBuffer*)dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STAGING);
+    DvzBuffer* staging = dvz_ctx_default_buffer(context, DVZ_BUFFER_TYPE_STAGING);
     ASSERT(staging != NULL);
     ASSERT(staging->buffer != VK_NULL_HANDLE);
 
@@ -145,6 +222,24 @@ static DvzBuffer* staging_buffer(DvzContext* context, VkDeviceSize size)
 
 
 
+// Begin a GPU transfer zone in the transfer command buffer, if the context is being profiled.
+static uint32_t _transfer_zone_begin(DvzContext* context, DvzCommands* cmds, const char* name)
+{
+    ASSERT(context != NULL);
+    dvz_profiler_gpu_reset(context->profiler, cmds, 0, DVZ_PROFILER_TRANSFER_BLOCK);
+    return dvz_profiler_gpu_begin(context->profiler, cmds, 0, DVZ_PROFILER_TRANSFER_BLOCK, name);
+}
+
+
+
+static void _transfer_zone_end(DvzContext* context, DvzCommands* cmds, uint32_t zone)
+{
+    ASSERT(context != NULL);
+    dvz_profiler_gpu_end(context->profiler, cmds, 0, DVZ_PROFILER_TRANSFER_BLOCK, zone);
+}
+
+
+
 static void _copy_buffer_from_staging(
     DvzContext* context, DvzBufferRegions br, VkDeviceSize offset, VkDeviceSize size)
 {
@@ -160,12 +255,14 @@ static void _copy_buffer_from_staging(
     DvzCommands* cmds = &context->transfer_cmd;
     dvz_cmd_reset(cmds, 0);
     dvz_cmd_begin(cmds, 0);
+    uint32_t zone = _transfer_zone_begin(context, cmds, "copy_buffer_from_staging");
 
     VkBufferCopy region = {0};
     region.size = size;
     region.srcOffset = 0;
     region.dstOffset = br.offsets[0] + offset;
     vkCmdCopyBuffer(cmds->cmds[0], staging->buffer, br.buffer->buffer, br.count, &region);
+    _transfer_zone_end(context, cmds, zone);
     dvz_cmd_end(cmds, 0);
 
     // Wait for the render queue to be idle.
@@ -178,12 +275,14 @@ static void _copy_buffer_from_staging(
     DvzSubmit submit = dvz_submit(gpu);
     dvz_submit_commands(&submit, cmds);
     log_debug("copy %s from staging buffer", pretty_size(size));
+    dvz_profiler_gpu_submit(context->profiler, DVZ_PROFILER_TRANSFER_BLOCK);
     dvz_submit_send(&submit, 0, NULL, 0);
 
     // Wait for the transfer queue to be idle.
     // TODO: less brutal synchronization with semaphores. Here we wait for the
     // transfer to be complete before we send new rendering commands.
     dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+    dvz_profiler_gpu_collect(context->profiler, DVZ_PROFILER_TRANSFER_BLOCK);
 }
 
 
@@ -203,6 +302,7 @@ static void _copy_buffer_to_staging(
     DvzCommands* cmds = &context->transfer_cmd;
     dvz_cmd_reset(cmds, 0);
     dvz_cmd_begin(cmds, 0);
+    uint32_t zone = _transfer_zone_begin(context, cmds, "copy_buffer_to_staging");
 
     // Determine the offset in the source buffer.
     // Should be consecutive offsets.
@@ -218,6 +318,7 @@ static void _copy_buffer_to_staging(
     // Copy to staging buffer
     ASSERT(br.buffer != 0);
     dvz_cmd_copy_buffer(cmds, 0, br.buffer, vk_offset, staging, 0, size * n_regions);
+    _transfer_zone_end(context, cmds, zone);
     dvz_cmd_end(cmds, 0);
 
     // Wait for the compute queue to be idle, as we assume the buffer to be copied from may
@@ -229,12 +330,14 @@ static void _copy_buffer_to_staging(
     DvzSubmit submit = dvz_submit(gpu);
     dvz_submit_commands(&submit, cmds);
     log_debug("copy %s to staging buffer", pretty_size(size));
+    dvz_profiler_gpu_submit(context->profiler, DVZ_PROFILER_TRANSFER_BLOCK);
     dvz_submit_send(&submit, 0, NULL, 0);
 
     // Wait for the transfer queue to be idle.
     // TODO: less brutal synchronization with semaphores. Here we wait for the
     // transfer to be complete before we send new rendering commands.
     dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+    dvz_profiler_gpu_collect(context->profiler, DVZ_PROFILER_TRANSFER_BLOCK);
 }
 
 
@@ -254,6 +357,7 @@ static void _copy_texture_from_staging(
     DvzCommands* cmds = &context->transfer_cmd;
     dvz_cmd_reset(cmds, 0);
     dvz_cmd_begin(cmds, 0);
+    uint32_t zone = _transfer_zone_begin(context, cmds, "copy_texture_from_staging");
 
     // Image transition.
     DvzBarrier barrier = dvz_barrier(gpu);
@@ -275,6 +379,7 @@ static void _copy_texture_from_staging(
     dvz_barrier_images_access(&barrier, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT);
     dvz_cmd_barrier(cmds, 0, &barrier);
 
+    _transfer_zone_end(context, cmds, zone);
     dvz_cmd_end(cmds, 0);
 
     // Wait for the render queue to be idle.
@@ -283,12 +388,14 @@ static void _copy_texture_from_staging(
     // Submit the commands to the transfer queue.
     DvzSubmit submit = dvz_submit(gpu);
     dvz_submit_commands(&submit, cmds);
+    dvz_profiler_gpu_submit(context->profiler, DVZ_PROFILER_TRANSFER_BLOCK);
     dvz_submit_send(&submit, 0, NULL, 0);
 
     // Wait for the transfer queue to be idle.
     // TODO: less brutal synchronization with semaphores. Here we wait for the
     // transfer to be complete before we send new rendering commands.
     dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+    dvz_profiler_gpu_collect(context->profiler, DVZ_PROFILER_TRANSFER_BLOCK);
 }
 
 
@@ -308,6 +415,7 @@ static void _copy_texture_to_staging(
     DvzCommands* cmds = &context->transfer_cmd;
     dvz_cmd_reset(cmds, 0);
     dvz_cmd_begin(cmds, 0);
+    uint32_t zone = _transfer_zone_begin(context, cmds, "copy_texture_to_staging");
 
     // Image transition.
     DvzBarrier barrier = dvz_barrier(gpu);
@@ -329,6 +437,7 @@ static void _copy_texture_to_staging(
     dvz_barrier_images_access(&barrier, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_MEMORY_READ_BIT);
     dvz_cmd_barrier(cmds, 0, &barrier);
 
+    _transfer_zone_end(context, cmds, zone);
     dvz_cmd_end(cmds, 0);
 
     // Wait for the render queue to be idle.
@@ -337,12 +446,14 @@ static void _copy_texture_to_staging(
     // Submit the commands to the transfer queue.
     DvzSubmit submit = dvz_submit(gpu);
     dvz_submit_commands(&submit, cmds);
+    dvz_profiler_gpu_submit(context->profiler, DVZ_PROFILER_TRANSFER_BLOCK);
     dvz_submit_send(&submit, 0, NULL, 0);
 
     // Wait for the transfer queue to be idle.
     // TODO: less brutal synchronization with semaphores. Here we wait for the
     // transfer to be complete before we send new rendering commands.
     dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+    dvz_profiler_gpu_collect(context->profiler, DVZ_PROFILER_TRANSFER_BLOCK);
 }
 
 
@@ -366,6 +477,17 @@ DVZ_EXPORT DvzContext* dvz_context(DvzGpu* gpu, DvzWindow* window);
  */
 DVZ_EXPORT void dvz_context_reset(DvzContext* context);
 
+/**
+ * Return the GPU memory used by a context.
+ *
+ * The device memory is the sum of the allocated buffer regions and of the texture images, the
+ * total device memory also includes the free space at the end of the buffers.
+ *
+ * @param context the context
+ * @returns the memory usage
+ */
+DVZ_EXPORT DvzMemoryUsage dvz_context_memory(DvzContext* context);
+
 
 
 /*************************************************************************************************/
@@ -403,7 +525,8 @@ dvz_ctx_buffers_resize(DvzContext* context, DvzBufferRegions* br, VkDeviceSize n
  * Create a new compute pipeline.
  *
  * @param context the context
- * @param shader_path path to the `.spirv` file containing the compute shader
+ * @param shader_path (optional) path to the `.spirv` file containing the compute shader, or NULL
+ *      when the shader is set with `dvz_compute_code()` or `dvz_compute_spirv()`
  */
 DVZ_EXPORT DvzCompute* dvz_ctx_compute(DvzContext* context, const char* shader_path);
 
@@ -502,6 +625,36 @@ DVZ_EXPORT void dvz_texture_download(
 DVZ_EXPORT void dvz_texture_copy(
     DvzTexture* src, uvec3 src_offset, DvzTexture* dst, uvec3 dst_offset, uvec3 shape);
 
+/**
+ * Allocate the mip levels of a texture.
+ *
+ * !!! warning
+ *     This function will delete the texture data. It must be called before the texture is bound
+ *     to a visual or to any descriptor set.
+ *
+ * The mip levels are then generated on the GPU after every upload, and the sampler may sample
+ * them with a linear min filter.
+ *
+ * @param texture the texture
+ * @param mip_count the number of mip levels, 0 for the full mip chain
+ */
+DVZ_EXPORT void dvz_texture_mips(DvzTexture* texture, uint32_t mip_count);
+
+/**
+ * Generate the mip levels of a texture from its base level, with a chain of blits on the GPU.
+ *
+ * @param texture the texture
+ */
+DVZ_EXPORT void dvz_texture_generate_mips(DvzTexture* texture);
+
+/**
+ * Return the GPU memory used by a texture image, including its mip levels.
+ *
+ * @param texture the texture
+ * @returns the size of the image memory, in bytes
+ */
+DVZ_EXPORT VkDeviceSize dvz_texture_memory(DvzTexture* texture);
+
 /**
  * Destroy a texture.
  *
@@ -511,6 +664,54 @@ DVZ_EXPORT void dvz_texture_destroy(DvzTexture* texture);
 
 
 
+/*************************************************************************************************/
+/*  Texture streaming                                                                            */
+/*************************************************************************************************/
+
+/**
+ * Create a stream uploading a whole texture in chunks, without blocking the CPU.
+ *
+ * The chunks are copied to a ring of staging slots and submitted to the render queue, so that
+ * they are ordered with the rendering commands without any queue wait. A fence per slot tells
+ * when the slot can be reused. If the texture has mip levels, they are generated on the GPU
+ * after the last chunk.
+ *
+ * @param texture the texture
+ * @param size the size of the data, in bytes
+ * @param data the data, which must remain valid until the stream is done
+ * @param chunk_size the approximate size of each chunk, in bytes, 0 for the default size
+ * @returns the stream
+ */
+DVZ_EXPORT DvzTextureStream* dvz_texture_stream(
+    DvzTexture* texture, VkDeviceSize size, const void* data, VkDeviceSize chunk_size);
+
+/**
+ * Submit as many chunks as there are free staging slots.
+ *
+ * This function does not wait for the GPU. It is called at every frame by the canvases the
+ * stream is attached to, see `dvz_stream_texture()`.
+ *
+ * @param stream the stream
+ * @returns whether all chunks have been uploaded
+ */
+DVZ_EXPORT bool dvz_texture_stream_step(DvzTextureStream* stream);
+
+/**
+ * Wait until all chunks have been uploaded.
+ *
+ * @param stream the stream
+ */
+DVZ_EXPORT void dvz_texture_stream_wait(DvzTextureStream* stream);
+
+/**
+ * Destroy a stream, waiting for the pending chunks.
+ *
+ * @param stream the stream
+ */
+DVZ_EXPORT void dvz_texture_stream_destroy(DvzTextureStream* stream);
+
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,17 +11,22 @@
 extern "C" {
 #endif
 
+#include "bricks.h"
 #include "canvas.h"
 #include "colormaps.h"
 #include "context.h"
 #include "controls.h"
 #include "demo.h"
+#include "density.h"
 #include "graphics.h"
 #include "gui.h"
+#include "histogram.h"
 #include "interact.h"
 #include "mesh.h"
 #include "panel.h"
+#include "replay.h"
 #include "scene.h"
+#include "tiles.h"
 #include "transfers.h"
 #include "visuals.h"
 #include "vklite.h"
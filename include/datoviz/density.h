@@ -0,0 +1,247 @@
+/*************************************************************************************************/
+/*  Density maps of large point clouds aggregated on the GPU                                     */
+/*************************************************************************************************/
+
+#ifndef DVZ_DENSITY_HEADER
+#define DVZ_DENSITY_HEADER
+
+#include "common.h"
+#include "interact.h"
+#include "visuals.h"
+#include "vklite.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_DENSITY_GROUP_SIZE   256                // workgroup size of the compute shader
+#define DVZ_DENSITY_HIST_BINS    4096               // number of bins of the eq-hist histogram
+#define DVZ_DENSITY_UPLOAD_CHUNK (64 * 1024 * 1024) // maximum size of a point upload, in bytes
+
+
+
+/*************************************************************************************************/
+/*  Enums                                                                                        */
+/*************************************************************************************************/
+
+// Reduction of the points falling in each pixel.
+typedef enum
+{
+    DVZ_DENSITY_REDUCTION_COUNT, // number of points
+    DVZ_DENSITY_REDUCTION_SUM,   // sum of the point values
+    DVZ_DENSITY_REDUCTION_MEAN,  // mean of the point values
+} DvzDensityReduction;
+
+
+
+// Normalization of the reduced pixel values between 0 and 1, before the colormap.
+typedef enum
+{
+    DVZ_DENSITY_NORMALIZATION_LINEAR,  // linear between the extreme values
+    DVZ_DENSITY_NORMALIZATION_LOG,     // linear after a log(1 + x) scaling
+    DVZ_DENSITY_NORMALIZATION_EQ_HIST, // histogram equalization
+} DvzDensityNormalization;
+
+
+
+// Compute shader stage, each one is a dispatch of the same shader.
+typedef enum
+{
+    DVZ_DENSITY_STAGE_CLEAR,     // clear the grid and the statistics
+    DVZ_DENSITY_STAGE_AGGREGATE, // bin the points into the grid, one invocation per point
+    DVZ_DENSITY_STAGE_REDUCE,    // extreme pixel values
+    DVZ_DENSITY_STAGE_HISTOGRAM, // histogram of the pixel values, for eq-hist only
+    DVZ_DENSITY_STAGE_CDF,       // cumulative histogram, for eq-hist only
+    DVZ_DENSITY_STAGE_NORMALIZE, // normalized pixel values
+} DvzDensityStage;
+
+
+
+/*************************************************************************************************/
+/*  Typedefs                                                                                     */
+/*************************************************************************************************/
+
+typedef struct DvzDensityParams DvzDensityParams;
+typedef struct DvzDensity DvzDensity;
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+// Push constants of the compute shader.
+struct DvzDensityParams
+{
+    vec4 view;             // visible rectangle in normalized coordinates (xmin, ymin, xmax, ymax)
+    uvec2 size;            // grid size, in pixels
+    uint32_t count;        // number of points
+    int32_t reduction;     // DvzDensityReduction
+    int32_t normalization; // DvzDensityNormalization
+    uint32_t stage;        // DvzDensityStage
+    uint32_t has_values;   // whether the points have values, otherwise they all have a value of 1
+};
+
+
+
+struct DvzDensity
+{
+    DvzObject obj;
+    DvzCanvas* canvas;
+    DvzVisual* visual;
+
+    DvzDensityReduction reduction;
+    DvzDensityNormalization normalization;
+
+    // Dedicated storage buffers, one per region below. The default buffers of the context may be
+    // reallocated when other objects allocate or grow regions, which would leave the bindings of
+    // this density map with a destroyed buffer.
+    DvzBuffer buffers[5];
+
+    // Points, in normalized coordinates, and their optional values.
+    uint32_t count;
+    uint32_t capacity;       // number of points that fit in the position buffer
+    uint32_t value_capacity; // number of points that fit in the value buffer
+    bool has_values;
+    DvzBufferRegions br_pos;    // vec2 per point
+    DvzBufferRegions br_values; // float per point
+
+    // Grid.
+    uvec2 shape;                // maximum grid size, and texture size
+    DvzBufferRegions br_grid;   // point count and float sum per pixel
+    DvzBufferRegions br_stats;  // extreme values, histogram, and cumulative histogram
+    DvzBufferRegions br_output; // normalized float value per pixel
+    DvzTexture* texture;        // R32 float texture with the normalized values
+
+    // Compute pipeline, and the command buffer submitted at every aggregation.
+    DvzCompute* compute;
+    DvzBindings bindings;
+    DvzCommands cmds;
+    DvzFences fences;
+
+    // Aggregation state.
+    dvec4 view;
+    uvec2 size; // current grid size
+    bool has_view;
+    uint32_t dirty;        // number of aggregations to run regardless of the view
+    uint64_t aggregations; // number of aggregations submitted so far
+};
+
+
+
+/*************************************************************************************************/
+/*  Functions                                                                                    */
+/*************************************************************************************************/
+
+/**
+ * Create a density map.
+ *
+ * A density map bins a large number of points into a grid with one cell per screen pixel, and
+ * reduces the points falling in each pixel to a single value (count, sum, or mean). The pixel
+ * values are then normalized and displayed with a colormap by an image visual. Everything runs
+ * in a compute shader: the points are only uploaded once, and the grid is aggregated again on
+ * the GPU whenever the view changes.
+ *
+ * @param canvas the canvas
+ * @param shape the maximum grid size in pixels (width, height), typically the framebuffer size
+ * @returns the density map
+ */
+DVZ_EXPORT DvzDensity* dvz_density(DvzCanvas* canvas, uvec2 shape);
+
+/**
+ * Set the points of a density map.
+ *
+ * The points are uploaded in chunks. When the app is running, the uploads go through the canvas
+ * transfers, and the data must remain valid until the next frame.
+ *
+ * @param density the density map
+ * @param count the number of points
+ * @param pos the point positions, in normalized coordinates
+ * @param values the point values, or NULL for a value of 1 for every point
+ */
+DVZ_EXPORT void
+dvz_density_data(DvzDensity* density, uint32_t count, const vec2* pos, const float* values);
+
+/**
+ * Set the reduction of the points falling in each pixel.
+ *
+ * @param density the density map
+ * @param reduction the reduction
+ */
+DVZ_EXPORT void dvz_density_reduction(DvzDensity* density, DvzDensityReduction reduction);
+
+/**
+ * Set the normalization of the pixel values.
+ *
+ * @param density the density map
+ * @param normalization the normalization
+ */
+DVZ_EXPORT void
+dvz_density_normalization(DvzDensity* density, DvzDensityNormalization normalization);
+
+/**
+ * Bind a density map to an image visual with a colormap.
+ *
+ * Each update sets the visual position and texture coordinate props so that the image covers
+ * the view, with one texel per screen pixel. Empty pixels have the first color of the colormap.
+ *
+ * @param density the density map
+ * @param visual the image visual, of type `DVZ_VISUAL_IMAGE_CMAP`
+ */
+DVZ_EXPORT void dvz_density_visual(DvzDensity* density, DvzVisual* visual);
+
+/**
+ * Aggregate the points in a view, if the view or the data has changed.
+ *
+ * The compute commands are submitted to the render queue without waiting, so that the frames
+ * sample the updated texture. This function should be called at most once per frame, typically
+ * in a FRAME callback.
+ *
+ * @param density the density map
+ * @param view the visible rectangle in normalized coordinates (xmin, ymin, xmax, ymax)
+ * @param size the viewport size, in framebuffer pixels
+ * @returns whether the visual data has changed
+ */
+DVZ_EXPORT bool dvz_density_update(DvzDensity* density, dvec4 view, uvec2 size);
+
+/**
+ * Update a density map with the view of a panzoom.
+ *
+ * @param density the density map
+ * @param panzoom the panzoom
+ * @param viewport the viewport
+ * @returns whether the visual data has changed
+ */
+DVZ_EXPORT bool
+dvz_density_panzoom(DvzDensity* density, DvzPanzoom* panzoom, DvzViewport viewport);
+
+/**
+ * Wait until the last aggregation has completed on the GPU.
+ *
+ * The aggregation is submitted to the render queue, whereas the buffer and texture downloads only
+ * wait for the compute queue. This function must be called before reading back the grid.
+ *
+ * @param density the density map
+ */
+DVZ_EXPORT void dvz_density_wait(DvzDensity* density);
+
+/**
+ * Destroy a density map.
+ *
+ * @param density the density map
+ */
+DVZ_EXPORT void dvz_density_destroy(DvzDensity* density);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -27,6 +27,9 @@ extern "C" {
 
 typedef struct DvzFifo DvzFifo;
 
+// Merge an item into the last item of a queue, return whether the item was merged.
+typedef bool (*DvzFifoMergeCallback)(void* last, void* item);
+
 
 
 /*************************************************************************************************/
@@ -56,7 +59,7 @@ struct DvzFifo
 /**
  * Create a FIFO queue.
  *
- * @param capacity the maximum size
+ * @param capacity the initial capacity, the queue grows when it is full
  * @returns a FIFO queue
  */
 DVZ_EXPORT DvzFifo dvz_fifo(int32_t capacity);
@@ -69,6 +72,20 @@ DVZ_EXPORT DvzFifo dvz_fifo(int32_t capacity);
  */
 DVZ_EXPORT void dvz_fifo_enqueue(DvzFifo* fifo, void* item);
 
+/**
+ * Enqueue an object in a queue, or merge it into the most recently enqueued object.
+ *
+ * If the queue is not empty, the merge callback is called, while the queue is locked, with the
+ * most recently enqueued object that has not been dequeued yet and the new object. If the
+ * callback returns true, the new object is not enqueued and the caller keeps its ownership.
+ *
+ * @param fifo the FIFO queue
+ * @param item the pointer to the object to enqueue
+ * @param merge the callback merging the object into the last object of the queue
+ * @returns whether the object was merged
+ */
+DVZ_EXPORT bool dvz_fifo_enqueue_merge(DvzFifo* fifo, void* item, DvzFifoMergeCallback merge);
+
 /**
  * Dequeue an object from a queue.
  *
@@ -62,6 +62,11 @@ layout (std140, binding = 0) uniform MVP {
     mat4 view;
     mat4 proj;
     float time;
+
+    // Data transform of the emulated double precision positions, see normalize_double().
+    vec4 data_offset_hi;
+    vec4 data_offset_lo;
+    vec4 data_scale;
 } mvp;
 
 struct VkViewport {
@@ -89,6 +94,20 @@ layout (std140, binding = 1) uniform Viewport {
 /*  Viewport and transform functions                                                             */
 /*************************************************************************************************/
 
+// Normalize a position stored as a (hi, lo) float pair relative to the panel origin.
+// The large common part of the data and of the view center cancels out in the subtractions, which
+// are exact, so that the result keeps double precision relative to the view extent.
+vec3 normalize_double(vec3 pos_hi, vec3 pos_lo) {
+    if (mvp.data_scale.w == 0)
+        return pos_hi + pos_lo;
+    precise vec3 t = pos_hi - mvp.data_offset_hi.xyz;
+    precise vec3 e = pos_lo - mvp.data_offset_lo.xyz;
+    precise vec3 d = t + e;
+    return d * mvp.data_scale.xyz;
+}
+
+
+
 vec4 to_vulkan(vec4 tr) {
     // HACK: we transform from OpenGL conventional coordinate system to Vulkan
     // This allows us to use MVP matrices in OpenGL conventions.
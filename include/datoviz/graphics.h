@@ -31,9 +31,18 @@
 typedef enum
 {
     DVZ_GRAPHICS_FLAGS_DEPTH_TEST_DISABLE = 0x0000,
+    DVZ_GRAPHICS_FLAGS_VOLUME_BRICKED = 0x0001, // volume sampled through a page table, see below
+    DVZ_GRAPHICS_FLAGS_POS_SNORM16 = 0x0040, // 16-bit normalized positions, see below
+    DVZ_GRAPHICS_FLAGS_POS_HALF = 0x0080,    // half-float positions
     DVZ_GRAPHICS_FLAGS_DEPTH_TEST_ENABLE = 0x0100,
+    DVZ_GRAPHICS_FLAGS_PATH_COMPACT = 0x0200,      // path positions stored once, see below
+    DVZ_GRAPHICS_FLAGS_POS_DOUBLE = 0x0400,        // emulated double precision positions
+    DVZ_GRAPHICS_FLAGS_SEGMENT_INSTANCED = 0x0800, // one vertex per segment, see below
 } DvzGraphicsFlags;
 
+#define DVZ_GRAPHICS_FLAGS_POS_COMPACT                                                            \
+    (DVZ_GRAPHICS_FLAGS_POS_SNORM16 | DVZ_GRAPHICS_FLAGS_POS_HALF)
+
 
 
 // Marker type.
@@ -101,15 +110,21 @@ typedef enum
 /*************************************************************************************************/
 
 typedef struct DvzVertex DvzVertex;
+typedef struct DvzVertexCompact DvzVertexCompact;
+typedef struct DvzVertexDouble DvzVertexDouble;
 
 typedef struct DvzGraphicsPointParams DvzGraphicsPointParams;
+typedef struct DvzGraphicsPointCmapVertex DvzGraphicsPointCmapVertex;
+typedef struct DvzGraphicsPointCmapParams DvzGraphicsPointCmapParams;
 
 typedef struct DvzGraphicsMarkerVertex DvzGraphicsMarkerVertex;
+typedef struct DvzGraphicsMarkerCompactVertex DvzGraphicsMarkerCompactVertex;
 typedef struct DvzGraphicsMarkerParams DvzGraphicsMarkerParams;
 
 typedef struct DvzGraphicsSegmentVertex DvzGraphicsSegmentVertex;
 
 typedef struct DvzGraphicsPathVertex DvzGraphicsPathVertex;
+typedef struct DvzGraphicsPathCompactVertex DvzGraphicsPathCompactVertex;
 typedef struct DvzGraphicsPathParams DvzGraphicsPathParams;
 // typedef struct DvzGraphicsPathItem DvzGraphicsPathItem;
 
@@ -125,6 +140,7 @@ typedef struct DvzGraphicsVolumeSliceParams DvzGraphicsVolumeSliceParams;
 typedef struct DvzGraphicsVolumeItem DvzGraphicsVolumeItem;
 typedef struct DvzGraphicsVolumeVertex DvzGraphicsVolumeVertex;
 typedef struct DvzGraphicsVolumeParams DvzGraphicsVolumeParams;
+typedef struct DvzGraphicsVolumeBrickedParams DvzGraphicsVolumeBrickedParams;
 
 typedef struct DvzGraphicsMeshVertex DvzGraphicsMeshVertex;
 typedef struct DvzGraphicsMeshParams DvzGraphicsMeshParams;
@@ -147,6 +163,28 @@ struct DvzVertex
     cvec4 color; /* color */
 };
 
+// With DVZ_GRAPHICS_FLAGS_POS_SNORM16 or DVZ_GRAPHICS_FLAGS_POS_HALF, the positions are stored on
+// 16 bits per component (the fourth component is padding, as 3-component 16-bit vertex formats
+// are not always supported). SNORM16 positions are quantized in [-1, 1], which is the range of
+// the positions normalized with respect to the panel data box: values outside are clamped. Half
+// positions are not clamped but have a relative precision of about 5e-4.
+struct DvzVertexCompact
+{
+    svec4 pos;   /* position, SNORM16 or half float */
+    cvec4 color; /* color */
+};
+
+// With DVZ_GRAPHICS_FLAGS_POS_DOUBLE, the positions are stored relative to the panel origin as
+// pairs of floats whose sum is the double precision value. They are normalized in the vertex
+// shader with the data transform of the MVP uniform, so that changing the panel data box does not
+// require transforming and uploading the positions again.
+struct DvzVertexDouble
+{
+    vec3 pos_hi; /* position relative to the panel origin, rounded to a float */
+    vec3 pos_lo; /* rounding error of pos_hi */
+    cvec4 color; /* color */
+};
+
 
 
 struct DvzGraphicsData
@@ -171,6 +209,21 @@ struct DvzGraphicsPointParams
     float point_size; /* point size, in pixels */
 };
 
+// Point with a scalar value, colormapped in the vertex shader. Changing the value range or the
+// colormap only updates the params uniform buffer, not the vertex buffer.
+struct DvzGraphicsPointCmapVertex
+{
+    vec3 pos;    /* position */
+    float value; /* scalar value */
+};
+
+struct DvzGraphicsPointCmapParams
+{
+    vec2 vrange;      /* value range */
+    int cmap;         /* colormap number */
+    float point_size; /* point size, in pixels */
+};
+
 
 
 /*************************************************************************************************/
@@ -188,6 +241,17 @@ struct DvzGraphicsMarkerVertex
     uint8_t transform; /* transform enum */
 };
 
+// Compact marker vertex, used with DVZ_GRAPHICS_FLAGS_POS_SNORM16 or DVZ_GRAPHICS_FLAGS_POS_HALF.
+struct DvzGraphicsMarkerCompactVertex
+{
+    svec4 pos;         /* position, SNORM16 or half float */
+    cvec4 color;       /* color */
+    uint8_t size;      /* marker size, in pixels, between 0 and 255 */
+    uint8_t marker;    /* marker type enum */
+    uint8_t angle;     /* angle, between 0 (0) included and 256 (M_2PI) excluded */
+    uint8_t transform; /* transform enum */
+};
+
 struct DvzGraphicsMarkerParams
 {
     vec4 edge_color;  /* edge color RGBA */
@@ -212,6 +276,10 @@ struct DvzGraphicsSegmentVertex
     uint8_t transform; /* transform enum */
 };
 
+// With DVZ_GRAPHICS_FLAGS_SEGMENT_INSTANCED, every segment is stored once in the vertex buffer,
+// without index buffer. The graphics pipeline is instanced, with one instance per segment drawn
+// as a 4-vertex triangle strip whose corners are generated in the vertex shader.
+
 
 
 /*************************************************************************************************/
@@ -227,6 +295,16 @@ struct DvzGraphicsPathVertex
     cvec4 color; /* point color */
 };
 
+// With DVZ_GRAPHICS_FLAGS_PATH_COMPACT, every path point is stored once. The vertex buffer
+// contains, for each path, a leading padding point, the path points, and two trailing padding
+// points (the padding points have a transparent color). The graphics pipeline is instanced, with
+// one instance per point: the previous and next points are read through shifted vertex bindings.
+struct DvzGraphicsPathCompactVertex
+{
+    vec3 pos;    /* position */
+    cvec4 color; /* point color */
+};
+
 struct DvzGraphicsPathParams
 {
     float linewidth;    /* line width in pixels */
@@ -368,6 +446,17 @@ struct DvzGraphicsVolumeParams
     int32_t cmap;  /* colormap */
 };
 
+// With DVZ_GRAPHICS_FLAGS_VOLUME_BRICKED, the volume texture is a cache of fixed-size bricks,
+// each surrounded by an apron of border voxels, and a second texture maps every brick of the
+// volume to its slot in the cache. Bricks that are not in the cache are transparent.
+struct DvzGraphicsVolumeBrickedParams
+{
+    vec4 box_size; /* size of the box containing the volume, in NDC */
+    vec4 shape;    /* volume shape in voxels (xyz), brick size in voxels (w) */
+    vec4 cache;    /* number of cache slots along each axis (xyz), apron size in voxels (w) */
+    int32_t cmap;  /* colormap */
+};
+
 
 
 /*************************************************************************************************/
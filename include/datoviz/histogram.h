@@ -0,0 +1,245 @@
+/*************************************************************************************************/
+/*  Histograms of sample streams binned on the GPU                                               */
+/*************************************************************************************************/
+
+#ifndef DVZ_HISTOGRAM_HEADER
+#define DVZ_HISTOGRAM_HEADER
+
+#include "common.h"
+#include "visuals.h"
+#include "vklite.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_HISTOGRAM_GROUP_SIZE    256                // workgroup size of the compute shader
+#define DVZ_HISTOGRAM_SHARED_BINS   4096               // maximum number of bins in shared memory
+#define DVZ_HISTOGRAM_ITEMS         16                 // minimum number of samples per invocation
+#define DVZ_HISTOGRAM_BAR_VERTICES  6                  // two triangles per bar
+#define DVZ_HISTOGRAM_UPLOAD_CHUNK  (64 * 1024 * 1024) // maximum size of a sample upload, in bytes
+#define DVZ_HISTOGRAM_DEFAULT_COLOR {31, 119, 180, 255}
+
+
+
+/*************************************************************************************************/
+/*  Enums                                                                                        */
+/*************************************************************************************************/
+
+// Compute shader stage, each one is a dispatch of the same shader.
+typedef enum
+{
+    DVZ_HISTOGRAM_STAGE_CLEAR,  // clear the counts, or only the maximum count when appending
+    DVZ_HISTOGRAM_STAGE_BIN,    // bin the samples, one invocation per sample
+    DVZ_HISTOGRAM_STAGE_REDUCE, // maximum and total counts
+    DVZ_HISTOGRAM_STAGE_BARS,   // bar vertices, one invocation per bin
+} DvzHistogramStage;
+
+
+
+/*************************************************************************************************/
+/*  Typedefs                                                                                     */
+/*************************************************************************************************/
+
+typedef struct DvzHistogramParams DvzHistogramParams;
+typedef struct DvzHistogram DvzHistogram;
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+// Push constants of the compute shader.
+struct DvzHistogramParams
+{
+    vec4 box;           // rectangle of the bars in normalized coordinates (x0, y0, x1, y1)
+    vec2 range;         // range of the bins, the samples outside of the range are ignored
+    uint32_t bin_count; // number of bins
+    uint32_t first;     // first sample to bin, the counts are kept when it is not zero
+    uint32_t count;     // number of samples
+    uint32_t stage;     // DvzHistogramStage
+    uint32_t max_count; // count at the top of the box, or 0 for the maximum count
+    cvec4 color;        // bar color
+};
+
+
+
+struct DvzHistogram
+{
+    DvzObject obj;
+    DvzCanvas* canvas;
+    DvzVisual* visual;
+
+    // Dedicated buffers for the samples, the counts, and the bar vertices. The default buffers of
+    // the context may be reallocated when other objects allocate or grow regions, which would
+    // leave the bindings of this histogram, or of the other objects, with a destroyed buffer.
+    DvzBuffer buffers[3];
+
+    // Samples.
+    uint32_t count;              // number of samples
+    uint32_t capacity;           // number of samples that fit in the sample buffer
+    uint32_t binned;             // number of samples included in the counts
+    bool replaced;               // whether the samples have been replaced during this frame
+    DvzBufferRegions br_samples; // float per sample
+
+    // Bins and bars.
+    uint32_t bin_count;
+    vec2 range;
+    uint32_t max_count;
+    vec4 box;
+    cvec4 color;
+    DvzBufferRegions br_counts; // maximum count, total count, then the count of each bin
+    DvzBufferRegions br_vertex; // DvzVertex vertices of the bars, drawn by the visual
+
+    // Compute pipeline, and the command buffer submitted at every update.
+    DvzCompute* compute;
+    DvzBindings bindings;
+    DvzCommands cmds;
+    DvzFences fences;
+
+    // Update state. When the app is running, the uploads are processed after the FRAME
+    // callbacks, so the samples set during a frame are only binned at the next update.
+    uint32_t gpu_count;  // number of samples on the GPU at the next update
+    bool gpu_replaced;   // whether the samples on the GPU at the next update are new ones
+    bool rebin;          // whether all samples must be binned again
+    bool rebar;          // whether the bars must be computed again
+    bool refill;         // whether the visual command buffers must be recorded again
+    uint64_t dispatches; // number of submitted updates so far
+};
+
+
+
+/*************************************************************************************************/
+/*  Functions                                                                                    */
+/*************************************************************************************************/
+
+/**
+ * Create a histogram.
+ *
+ * The samples are uploaded to a storage buffer, binned with atomics in a compute shader, and the
+ * bars are written by the same shader to a vertex buffer drawn by a histogram visual. The samples
+ * never come back to the CPU, and changing the range or the number of bins only bins the samples
+ * again on the GPU.
+ *
+ * @param canvas the canvas
+ * @param bin_count the number of bins
+ * @returns the histogram
+ */
+DVZ_EXPORT DvzHistogram* dvz_histogram(DvzCanvas* canvas, uint32_t bin_count);
+
+/**
+ * Set the samples of a histogram.
+ *
+ * When the app is running, the uploads go through the canvas transfers, and the data must remain
+ * valid until the next frame.
+ *
+ * @param histogram the histogram
+ * @param count the number of samples
+ * @param samples the samples
+ */
+DVZ_EXPORT void dvz_histogram_data(DvzHistogram* histogram, uint32_t count, const float* samples);
+
+/**
+ * Append samples to a histogram.
+ *
+ * Only the new samples are binned at the next update, unless the bins have changed.
+ *
+ * @param histogram the histogram
+ * @param count the number of new samples
+ * @param samples the new samples
+ */
+DVZ_EXPORT void
+dvz_histogram_append(DvzHistogram* histogram, uint32_t count, const float* samples);
+
+/**
+ * Set the range of the bins.
+ *
+ * The bins split the range in equal parts. The last bin includes its upper bound, and the samples
+ * outside of the range are ignored.
+ *
+ * @param histogram the histogram
+ * @param vmin the lower bound of the first bin
+ * @param vmax the upper bound of the last bin
+ */
+DVZ_EXPORT void dvz_histogram_range(DvzHistogram* histogram, float vmin, float vmax);
+
+/**
+ * Set the number of bins.
+ *
+ * The visual command buffers must then be recorded again, see `dvz_histogram_update()`.
+ *
+ * @param histogram the histogram
+ * @param bin_count the number of bins
+ */
+DVZ_EXPORT void dvz_histogram_bins(DvzHistogram* histogram, uint32_t bin_count);
+
+/**
+ * Set the count corresponding to the top of the bars rectangle.
+ *
+ * @param histogram the histogram
+ * @param max_count the count, or 0 to scale the bars to the maximum count (default)
+ */
+DVZ_EXPORT void dvz_histogram_max_count(DvzHistogram* histogram, uint32_t max_count);
+
+/**
+ * Set the rectangle and the color of the bars.
+ *
+ * @param histogram the histogram
+ * @param box the rectangle in normalized coordinates (x0, y0, x1, y1), the bars start at y0
+ * @param color the bar color
+ */
+DVZ_EXPORT void dvz_histogram_style(DvzHistogram* histogram, vec4 box, cvec4 color);
+
+/**
+ * Bind a histogram to a histogram visual.
+ *
+ * @param histogram the histogram
+ * @param visual the visual, of type `DVZ_VISUAL_HISTOGRAM`
+ */
+DVZ_EXPORT void dvz_histogram_visual(DvzHistogram* histogram, DvzVisual* visual);
+
+/**
+ * Bin the new samples and compute the bars, if anything has changed.
+ *
+ * The compute commands are submitted to the render queue without waiting, so that the frames
+ * draw the updated bars. This function should be called at most once per frame, typically in a
+ * FRAME callback.
+ *
+ * @param histogram the histogram
+ * @returns whether the visual command buffers must be recorded again
+ */
+DVZ_EXPORT bool dvz_histogram_update(DvzHistogram* histogram);
+
+/**
+ * Download the bin counts.
+ *
+ * The download waits for the last update, and is synchronous: this function must not be called
+ * while the app is running, for example from a FRAME callback.
+ *
+ * @param histogram the histogram
+ * @param[out] counts an array of `bin_count` counts
+ * @returns the number of binned samples within the range
+ */
+DVZ_EXPORT uint32_t dvz_histogram_counts(DvzHistogram* histogram, uint32_t* counts);
+
+/**
+ * Destroy a histogram.
+ *
+ * @param histogram the histogram
+ */
+DVZ_EXPORT void dvz_histogram_destroy(DvzHistogram* histogram);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,111 @@
+/*************************************************************************************************/
+/*  Standalone pool of worker threads running batches of jobs                                    */
+/*************************************************************************************************/
+
+#ifndef DVZ_JOBS_HEADER
+#define DVZ_JOBS_HEADER
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_JOBS_MAX_THREADS 64
+
+
+
+/*************************************************************************************************/
+/*  Type definitions                                                                             */
+/*************************************************************************************************/
+
+typedef struct DvzJobs DvzJobs;
+typedef struct DvzJobsWorker DvzJobsWorker;
+
+// Run one job of a batch, on the worker thread with the given index.
+typedef void (*DvzJobCallback)(
+    DvzJobs* jobs, uint32_t job_idx, uint32_t thread_idx, void* user_data);
+
+
+
+/*************************************************************************************************/
+/*  Job system                                                                                   */
+/*************************************************************************************************/
+
+struct DvzJobsWorker
+{
+    DvzJobs* jobs;
+    uint32_t idx;
+    DvzThread thread;
+};
+
+
+
+struct DvzJobs
+{
+    uint32_t thread_count;
+    DvzJobsWorker workers[DVZ_JOBS_MAX_THREADS];
+
+    // The lock protects the current batch and the number of running workers.
+    pthread_mutex_t lock;
+    pthread_cond_t cond_start;
+    pthread_cond_t cond_done;
+
+    // Current batch.
+    uint64_t batch;
+    uint32_t job_count;
+    DvzJobCallback callback;
+    void* user_data;
+    uint32_t running;
+    bool is_stopping;
+};
+
+
+
+/*************************************************************************************************/
+/*  Functions                                                                                    */
+/*************************************************************************************************/
+
+/**
+ * Create a pool of worker threads.
+ *
+ * The jobs of a batch are statically assigned to the workers: job `i` always runs on the worker
+ * `i % thread_count`. Per-thread resources, like command pools, can then be indexed by the
+ * thread index passed to the job callback.
+ *
+ * @param thread_count the number of worker threads, 0 to run the jobs on the calling thread
+ * @returns a pointer to the job system
+ */
+DVZ_EXPORT DvzJobs* dvz_jobs(uint32_t thread_count);
+
+/**
+ * Run a batch of jobs and wait until all of them have completed.
+ *
+ * @param jobs the job system
+ * @param job_count the number of jobs in the batch
+ * @param callback the callback called once for each job
+ * @param user_data pointer passed to the callback
+ */
+DVZ_EXPORT void
+dvz_jobs_run(DvzJobs* jobs, uint32_t job_count, DvzJobCallback callback, void* user_data);
+
+/**
+ * Stop the worker threads and destroy a job system.
+ *
+ * @param jobs the job system
+ */
+DVZ_EXPORT void dvz_jobs_destroy(DvzJobs* jobs);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,6 +15,8 @@ extern "C" {
 #include <stdarg.h>
 #include <stdio.h>
 
+#include "macros.h"
+
 #define LOG_VERSION "0.1.0"
 
 
@@ -38,12 +40,27 @@ enum
 #define DVZ_DEFAULT_LOG_LEVEL LOG_INFO
 #endif
 
-#define log_trace(...) log_log(LOG_TRACE, __FILENAME__, __LINE__, __VA_ARGS__)
-#define log_debug(...) log_log(LOG_DEBUG, __FILENAME__, __LINE__, __VA_ARGS__)
-#define log_info(...)  log_log(LOG_INFO, __FILENAME__, __LINE__, __VA_ARGS__)
-#define log_warn(...)  log_log(LOG_WARN, __FILENAME__, __LINE__, __VA_ARGS__)
-#define log_error(...) log_log(LOG_ERROR, __FILENAME__, __LINE__, __VA_ARGS__)
-#define log_fatal(...) log_log(LOG_FATAL, __FILENAME__, __LINE__, __VA_ARGS__)
+// Messages below this level are compiled away, and their arguments are never evaluated.
+#ifndef DVZ_LOG_MIN_LEVEL
+#define DVZ_LOG_MIN_LEVEL LOG_TRACE
+#endif
+
+// Runtime log level, see log_set_level(). It is checked before the arguments are evaluated.
+DVZ_EXPORT extern int log_level_runtime;
+
+#define log_at(level, ...)                                                                        \
+    do                                                                                            \
+    {                                                                                             \
+        if ((level) >= DVZ_LOG_MIN_LEVEL && (level) >= log_level_runtime)                         \
+            log_log((level), __FILENAME__, __LINE__, __VA_ARGS__);                                \
+    } while (0)
+
+#define log_trace(...) log_at(LOG_TRACE, __VA_ARGS__)
+#define log_debug(...) log_at(LOG_DEBUG, __VA_ARGS__)
+#define log_info(...)  log_at(LOG_INFO, __VA_ARGS__)
+#define log_warn(...)  log_at(LOG_WARN, __VA_ARGS__)
+#define log_error(...) log_at(LOG_ERROR, __VA_ARGS__)
+#define log_fatal(...) log_at(LOG_FATAL, __VA_ARGS__)
 
 void log_set_udata(void* udata);
 void log_set_lock(log_LockFn fn);
@@ -51,6 +68,11 @@ void log_set_fp(FILE* fp);
 void log_set_level(int level);
 void log_set_quiet(int enable);
 
+// By default, the messages are formatted on the calling thread into a per-thread lock-free
+// buffer, and written by a background thread. Errors are written immediately.
+void log_set_async(int enable);
+void log_flush(void);
+
 void log_log(int level, const char* file, int line, const char* fmt, ...);
 
 void log_set_level_env(void);
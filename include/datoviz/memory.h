@@ -0,0 +1,78 @@
+/*************************************************************************************************/
+/*  Memory accounting of the CPU arrays, GPU buffer regions, and textures                        */
+/*************************************************************************************************/
+
+#ifndef DVZ_MEMORY_HEADER
+#define DVZ_MEMORY_HEADER
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Type definitions                                                                             */
+/*************************************************************************************************/
+
+typedef struct DvzMemoryUsage DvzMemoryUsage;
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+// Memory used by an object and the objects it owns.
+struct DvzMemoryUsage
+{
+    uint64_t host;          // CPU memory of the arrays, in bytes
+    uint64_t device;        // GPU memory of the buffer regions and textures, in bytes
+    uint64_t device_total;  // GPU memory of the underlying buffers, including their free space
+    uint32_t array_count;   // number of arrays
+    uint32_t region_count;  // number of buffer region sets
+    uint32_t texture_count; // number of textures
+};
+
+
+
+/*************************************************************************************************/
+/*  Functions                                                                                    */
+/*************************************************************************************************/
+
+/**
+ * Account for an array allocation or deallocation.
+ *
+ * This function is called by the array functions, see `array.h`.
+ *
+ * @param size the number of allocated bytes, negative when the memory is freed
+ * @param count the number of created arrays, negative when arrays are destroyed
+ */
+DVZ_EXPORT void dvz_memory_arrays_track(int64_t size, int32_t count);
+
+/**
+ * Return the memory used by all live arrays of the process.
+ *
+ * Comparing this value before and after creating and destroying objects detects leaks.
+ *
+ * @returns the memory usage, with only the host memory and the number of arrays
+ */
+DVZ_EXPORT DvzMemoryUsage dvz_memory_arrays(void);
+
+/**
+ * Add a memory usage to another.
+ *
+ * @param[out] total the memory usage to update
+ * @param usage the memory usage to add
+ */
+DVZ_EXPORT void dvz_memory_add(DvzMemoryUsage* total, DvzMemoryUsage usage);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
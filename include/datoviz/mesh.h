@@ -14,6 +14,18 @@ extern "C" {
 
 
 
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_MESH_CACHE_SIZE     32      // vertex cache size modeled by the cache optimizer
+#define DVZ_MESH_FIFO_SIZE      16      // FIFO cache size simulated by the overdraw optimizer
+#define DVZ_MESH_PARALLEL_FACES 65536   // minimum number of faces to compute normals in parallel
+#define DVZ_MESH_PARALLEL_BYTES 1048576 // minimum file size to parse OBJ files in parallel
+#define DVZ_MESH_MAX_THREADS    16      // maximum number of threads to compute normals or parse
+
+
+
 /*************************************************************************************************/
 /*  Enums                                                                                     */
 /*************************************************************************************************/
@@ -51,6 +63,10 @@ struct DvzMesh
     DvzArray vertices;
     DvzArray indices;
     mat4 transform;
+
+    // Memory-mapped cache file backing the vertex and index arrays, see dvz_mesh_load().
+    void* mapped;
+    size_t mapped_size;
 };
 
 
@@ -109,7 +125,8 @@ DVZ_EXPORT void dvz_mesh_transform(DvzMesh* mesh);
 /**
  * Compute the normals of a mesh from the vertices and faces, with cross-products.
  *
- * Useful when a mesh has no normal data, just vertex positions and face indices.
+ * Useful when a mesh has no normal data, just vertex positions and face indices. Meshes with at
+ * least `DVZ_MESH_PARALLEL_FACES` faces are processed with one thread per CPU core.
  *
  * @param mesh the mesh
  */
@@ -117,6 +134,46 @@ DVZ_EXPORT void dvz_mesh_normals(DvzMesh* mesh);
 
 
 
+/*************************************************************************************************/
+/*  Mesh optimization                                                                            */
+/*************************************************************************************************/
+
+/**
+ * Reorder the faces of a mesh to improve the GPU post-transform vertex cache efficiency.
+ *
+ * This function implements Tom Forsyth's linear-speed vertex cache optimization. The vertices
+ * are left untouched.
+ *
+ * @param mesh the mesh
+ */
+DVZ_EXPORT void dvz_mesh_optimize_cache(DvzMesh* mesh);
+
+/**
+ * Reorder the faces of a mesh to reduce overdraw, while preserving the cache efficiency.
+ *
+ * The faces are split into clusters that can be reordered without degrading the cache
+ * efficiency by more than the threshold, and the clusters facing outwards are drawn first. This
+ * function should be called after `dvz_mesh_optimize_cache()`.
+ *
+ * @param mesh the mesh
+ * @param threshold maximum relative ACMR degradation, typically 1.05
+ */
+DVZ_EXPORT void dvz_mesh_optimize_overdraw(DvzMesh* mesh, float threshold);
+
+/**
+ * Compute the average cache miss ratio (ACMR) of a mesh with a simulated FIFO vertex cache.
+ *
+ * The ACMR is the number of vertex shader invocations per face, between 0.5 (best case on large
+ * regular meshes) and 3 (no vertex reuse).
+ *
+ * @param mesh the mesh
+ * @param cache_size the simulated cache size
+ * @returns the average cache miss ratio
+ */
+DVZ_EXPORT double dvz_mesh_acmr(DvzMesh* mesh, uint32_t cache_size);
+
+
+
 /*************************************************************************************************/
 /*  Common shapes                                                                                */
 /*************************************************************************************************/
@@ -218,14 +275,58 @@ DVZ_EXPORT void dvz_mesh_normalize(DvzMesh* mesh);
  */
 DVZ_EXPORT void dvz_mesh_destroy(DvzMesh* mesh);
 
+
+
+
+/*************************************************************************************************/
+/*  Mesh loading                                                                                 */
+/*************************************************************************************************/
+
 /**
  * Load an OBJ mesh.
  *
+ * Large files are parsed in parallel. Polygonal faces are triangulated, and the face corners
+ * sharing the same position, texture coordinates, and normal are merged into a single vertex.
+ * The normals are computed if the file does not contain any.
+ *
  * @param file_path the path to the .obj file
  * @returns the mesh
  */
 DVZ_EXPORT DvzMesh dvz_mesh_obj(const char* file_path);
 
+/**
+ * Load a PLY mesh (ASCII or binary).
+ *
+ * @param file_path the path to the .ply file
+ * @returns the mesh
+ */
+DVZ_EXPORT DvzMesh dvz_mesh_ply(const char* file_path);
+
+/**
+ * Load an STL mesh (ASCII or binary).
+ *
+ * The triangle corners sharing the same position are merged into a single vertex, and the
+ * normals are computed from the faces.
+ *
+ * @param file_path the path to the .stl file
+ * @returns the mesh
+ */
+DVZ_EXPORT DvzMesh dvz_mesh_stl(const char* file_path);
+
+/**
+ * Load an OBJ, PLY, or STL mesh, depending on the file extension, with an optional binary cache.
+ *
+ * When the cache file exists and matches the size and modification time of the mesh file, the
+ * cache file is memory-mapped instead of parsing the mesh file. Otherwise, the mesh file is
+ * parsed and the cache file is written. The vertex and index arrays of a memory-mapped mesh
+ * must not be resized.
+ *
+ * @param file_path the path to the mesh file
+ * @param cache_path the path to the cache file, or NULL to disable the cache
+ * @returns the mesh
+ */
+DVZ_EXPORT DvzMesh dvz_mesh_load(const char* file_path, const char* cache_path);
+
 
 #ifdef __cplusplus
 }
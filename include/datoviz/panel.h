@@ -80,6 +80,8 @@ struct DvzPanel
     DvzPanelMode mode;
     DvzPanelSizeUnit size_unit; // the unit x, y, width, height are in
     DvzDataCoords data_coords;  // data CPU transformation
+    dvec3 data_origin;          // origin of the emulated double precision positions
+    bool has_data_origin;       // whether the origin has been set, with the first such positions
 
     // User-specified:
     uint32_t row, col;
@@ -0,0 +1,273 @@
+/*************************************************************************************************/
+/*  Frame profiler with CPU zones, GPU timestamp queries, and Chrome trace export                */
+/*************************************************************************************************/
+
+#ifndef DVZ_PROFILER_HEADER
+#define DVZ_PROFILER_HEADER
+
+#include "common.h"
+#include "vklite.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_PROFILER_RING_SIZE   4096 // number of zones in each per-thread ring
+#define DVZ_PROFILER_MAX_THREADS 8    // maximum number of threads recording zones
+#define DVZ_PROFILER_MAX_QUERIES 256  // maximum number of GPU timestamp queries per block
+
+// The GPU timestamp queries are organized in blocks: one block per swapchain image (render
+// command buffers), and an extra block for the transfer command buffer.
+#define DVZ_PROFILER_MAX_BLOCKS     (DVZ_MAX_SWAPCHAIN_IMAGES + 1)
+#define DVZ_PROFILER_TRANSFER_BLOCK DVZ_MAX_SWAPCHAIN_IMAGES
+
+
+
+/*************************************************************************************************/
+/*  Enums                                                                                        */
+/*************************************************************************************************/
+
+// Profiler zone types.
+typedef enum
+{
+    DVZ_PROFILE_FRAME,           // whole frame, from dvz_canvas_frame() to the end of the submit
+    DVZ_PROFILE_INTERACT,        // INTERACT callbacks
+    DVZ_PROFILE_FRAME_CALLBACKS, // FRAME callbacks
+    DVZ_PROFILE_TIMER,           // TIMER callbacks
+    DVZ_PROFILE_TRANSFERS,       // dvz_process_transfers()
+    DVZ_PROFILE_REFILL,          // command buffer refill
+    DVZ_PROFILE_SUBMIT,          // dvz_canvas_frame_submit()
+    DVZ_PROFILE_EVENT,           // asynchronous event callbacks, in the event thread
+    DVZ_PROFILE_GPU_DRAW,        // GPU time of a visual draw
+    DVZ_PROFILE_GPU_TRANSFER,    // GPU time of a transfer command buffer
+    DVZ_PROFILE_CUSTOM,          // user zone
+    DVZ_PROFILE_COUNT,
+} DvzProfileZoneType;
+
+
+
+/*************************************************************************************************/
+/*  Typedefs                                                                                     */
+/*************************************************************************************************/
+
+typedef struct DvzProfileZone DvzProfileZone;
+typedef struct DvzProfilerRing DvzProfilerRing;
+typedef struct DvzFrameProfile DvzFrameProfile;
+typedef struct DvzProfiler DvzProfiler;
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+struct DvzProfileZone
+{
+    DvzProfileZoneType type;
+    const char* name; // static string
+    uint64_t frame_idx;
+    double start;    // in microseconds, relative to the profiler creation
+    double duration; // in microseconds
+    uint32_t id;     // for example, the index of the draw within the command buffer
+};
+
+
+
+// Single-producer single-consumer ring: only the owner thread writes zones, only the reader
+// (dvz_profiler_dump()) consumes them.
+struct DvzProfilerRing
+{
+    pthread_t thread;
+    atomic(bool, registered);
+    atomic(uint64_t, head);    // number of zones written by the owner thread
+    atomic(uint64_t, tail);    // number of zones consumed by the reader
+    atomic(uint64_t, dropped); // number of zones dropped because the ring was full
+    DvzProfileZone zones[DVZ_PROFILER_RING_SIZE];
+};
+
+
+
+// Summary of a frame, all durations are in microseconds.
+// NOTE: the GPU durations are those of the most recent GPU results available at the time of the
+// frame, typically a frame that was submitted a few frames before.
+struct DvzFrameProfile
+{
+    uint64_t frame_idx;
+    double durations[DVZ_PROFILE_COUNT]; // total duration of each zone type
+    uint32_t counts[DVZ_PROFILE_COUNT];  // number of zones of each type
+};
+
+
+
+struct DvzProfiler
+{
+    DvzObject obj;
+    DvzGpu* gpu;
+    DvzClock clock;
+    pthread_t main_thread; // thread running the frames, the only one updating the summary
+
+    // Per-thread rings.
+    atomic(uint32_t, ring_count);
+    DvzProfilerRing rings[DVZ_PROFILER_MAX_THREADS];
+
+    // Frame summaries.
+    uint64_t frame_idx;
+    DvzFrameProfile current;
+    DvzFrameProfile last;
+
+    // GPU timestamp queries.
+    VkQueryPool query_pool;
+    double timestamp_period; // in nanoseconds per tick
+    uint64_t timestamp_mask;
+    bool gpu_render, gpu_transfer; // whether the render/transfer queues support timestamps
+    uint32_t query_count[DVZ_PROFILER_MAX_BLOCKS];
+    const char* query_names[DVZ_PROFILER_MAX_BLOCKS][DVZ_PROFILER_MAX_QUERIES / 2];
+    DvzProfileZoneType query_types[DVZ_PROFILER_MAX_BLOCKS];
+    double query_submit[DVZ_PROFILER_MAX_BLOCKS]; // CPU time of the last submission
+    bool query_pending[DVZ_PROFILER_MAX_BLOCKS];
+};
+
+
+
+/*************************************************************************************************/
+/*  Profiler                                                                                     */
+/*************************************************************************************************/
+
+/**
+ * Create a profiler.
+ *
+ * The GPU timestamp queries are only enabled if the queues support them.
+ *
+ * @param gpu the GPU
+ * @returns a pointer to the profiler
+ */
+DVZ_EXPORT DvzProfiler* dvz_profiler(DvzGpu* gpu);
+
+/**
+ * Current time of the profiler timeline.
+ *
+ * @param profiler the profiler (may be NULL, in which case the function returns 0)
+ * @returns the time in microseconds since the profiler creation
+ */
+DVZ_EXPORT double dvz_profiler_begin(DvzProfiler* profiler);
+
+/**
+ * Record a CPU zone that started at `start` and ends now, in the ring of the calling thread.
+ *
+ * @param profiler the profiler (may be NULL, in which case the function does nothing)
+ * @param type the zone type
+ * @param name the zone name, must be a static string, or NULL to use the zone type name
+ * @param start the start time returned by `dvz_profiler_begin()`
+ */
+DVZ_EXPORT void dvz_profiler_end(
+    DvzProfiler* profiler, DvzProfileZoneType type, const char* name, double start);
+
+/**
+ * Mark the end of a frame and update the frame summary.
+ *
+ * @param profiler the profiler
+ * @param frame_idx the index of the frame that just ended
+ */
+DVZ_EXPORT void dvz_profiler_frame(DvzProfiler* profiler, uint64_t frame_idx);
+
+/**
+ * Return the summary of the last complete frame.
+ *
+ * @param profiler the profiler
+ * @returns the frame summary
+ */
+DVZ_EXPORT DvzFrameProfile dvz_profiler_summary(DvzProfiler* profiler);
+
+/**
+ * Write all recorded zones to a Chrome `trace_event` JSON file, and empty the rings.
+ *
+ * The file can be opened with `chrome://tracing` or Perfetto.
+ *
+ * @param profiler the profiler
+ * @param path the path to the JSON file
+ * @returns 0 if the file was successfully written
+ */
+DVZ_EXPORT int dvz_profiler_dump(DvzProfiler* profiler, const char* path);
+
+/**
+ * Destroy a profiler.
+ *
+ * @param profiler the profiler
+ */
+DVZ_EXPORT void dvz_profiler_destroy(DvzProfiler* profiler);
+
+
+
+/*************************************************************************************************/
+/*  GPU timestamp queries                                                                        */
+/*************************************************************************************************/
+
+/**
+ * Reset the GPU queries of a block, at the beginning of a command buffer recording.
+ *
+ * Must be recorded outside of a render pass.
+ *
+ * @param profiler the profiler (may be NULL)
+ * @param cmds the command buffers
+ * @param idx the command buffer index
+ * @param block the query block (swapchain image index, or `DVZ_PROFILER_TRANSFER_BLOCK`)
+ */
+DVZ_EXPORT void dvz_profiler_gpu_reset(
+    DvzProfiler* profiler, DvzCommands* cmds, uint32_t idx, uint32_t block);
+
+/**
+ * Record a GPU timestamp at the beginning of a GPU zone.
+ *
+ * @param profiler the profiler (may be NULL)
+ * @param cmds the command buffers
+ * @param idx the command buffer index
+ * @param block the query block
+ * @param name the zone name, must be a static string
+ * @returns the zone index within the block, to pass to `dvz_profiler_gpu_end()`
+ */
+DVZ_EXPORT uint32_t dvz_profiler_gpu_begin(
+    DvzProfiler* profiler, DvzCommands* cmds, uint32_t idx, uint32_t block, const char* name);
+
+/**
+ * Record a GPU timestamp at the end of a GPU zone.
+ *
+ * @param profiler the profiler (may be NULL)
+ * @param cmds the command buffers
+ * @param idx the command buffer index
+ * @param block the query block
+ * @param zone the zone index returned by `dvz_profiler_gpu_begin()`
+ */
+DVZ_EXPORT void dvz_profiler_gpu_end(
+    DvzProfiler* profiler, DvzCommands* cmds, uint32_t idx, uint32_t block, uint32_t zone);
+
+/**
+ * Mark the submission of the command buffer holding the queries of a block.
+ *
+ * @param profiler the profiler (may be NULL)
+ * @param block the query block
+ */
+DVZ_EXPORT void dvz_profiler_gpu_submit(DvzProfiler* profiler, uint32_t block);
+
+/**
+ * Collect the GPU timestamps of a block, if they are available, and record the GPU zones.
+ *
+ * This function does not block.
+ *
+ * @param profiler the profiler (may be NULL)
+ * @param block the query block
+ */
+DVZ_EXPORT void dvz_profiler_gpu_collect(DvzProfiler* profiler, uint32_t block);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,202 @@
+/*************************************************************************************************/
+/*  Recording and replay of the input events of a canvas                                         */
+/*************************************************************************************************/
+
+#ifndef DVZ_REPLAY_HEADER
+#define DVZ_REPLAY_HEADER
+
+#include "canvas.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_EVENT_FILE_MAGIC   "DVZE"
+#define DVZ_EVENT_FILE_VERSION 1
+
+
+
+/*************************************************************************************************/
+/*  Enums                                                                                        */
+/*************************************************************************************************/
+
+// Replay flags.
+typedef enum
+{
+    DVZ_REPLAY_FLAGS_NONE = 0x0000,
+    DVZ_REPLAY_FLAGS_MAX_SPEED = 0x0001, // do not wait between frames
+    DVZ_REPLAY_FLAGS_CHECKSUM = 0x0002,  // hash every rendered frame
+} DvzReplayFlags;
+
+
+
+/*************************************************************************************************/
+/*  Typedefs                                                                                     */
+/*************************************************************************************************/
+
+typedef struct DvzEventFileHeader DvzEventFileHeader;
+typedef struct DvzEventRecord DvzEventRecord;
+typedef struct DvzReplayFrame DvzReplayFrame;
+typedef struct DvzEventReplay DvzEventReplay;
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+// The event files contain this header followed by the records, in the native byte order.
+struct DvzEventFileHeader
+{
+    char magic[4];    // DVZ_EVENT_FILE_MAGIC
+    uint32_t version; // DVZ_EVENT_FILE_VERSION
+    uint32_t width;   // screen size of the recorded canvas
+    uint32_t height;
+};
+
+
+
+// Only the raw input events and the frames are recorded. The other mouse events (click, double
+// click, drag) are derived from them by the mouse state machine, and are raised again on replay.
+struct DvzEventRecord
+{
+    double time;       // in seconds since the beginning of the recording
+    int32_t type;      // DvzEventType
+    int32_t modifiers; // key modifiers
+    int32_t code;      // mouse button or key code
+    float pos[2];      // mouse position, or wheel direction
+    uint32_t _padding;
+};
+
+
+
+// All durations are in seconds.
+struct DvzReplayFrame
+{
+    double time;       // time of the frame in the recording
+    double events;     // injection of the input events preceding the frame, with sync callbacks
+    double duration;   // frame, from the INTERACT callbacks to the submission
+    uint64_t checksum; // hash of the rendered image, 0 without DVZ_REPLAY_FLAGS_CHECKSUM
+};
+
+
+
+struct DvzEventRecorder
+{
+    DvzObject obj;
+    FILE* fp;
+    DvzClock clock;
+    uint64_t count; // number of records written
+};
+
+
+
+struct DvzEventReplay
+{
+    DvzObject obj;
+    DvzCanvas* canvas;
+    DvzEventFileHeader header;
+
+    uint64_t record_count;
+    DvzEventRecord* records;
+
+    // Results of the last call to dvz_event_replay_run().
+    uint64_t frame_count;
+    DvzReplayFrame* frames;
+};
+
+
+
+/*************************************************************************************************/
+/*  Recording                                                                                    */
+/*************************************************************************************************/
+
+/**
+ * Start recording the input events of a canvas to a binary file.
+ *
+ * Every frame is recorded as well, so that the replay reproduces how the input events were
+ * batched between the frames.
+ *
+ * @param canvas the canvas
+ * @param path the path to the event file
+ * @returns a pointer to the recorder, or NULL if the file could not be opened
+ */
+DVZ_EXPORT DvzEventRecorder* dvz_event_record(DvzCanvas* canvas, const char* path);
+
+/**
+ * Write an event to an event file, if it is a frame or a raw input event.
+ *
+ * This function is called by the canvas event producer while the canvas is being recorded.
+ *
+ * @param recorder the recorder
+ * @param ev the event
+ */
+DVZ_EXPORT void dvz_event_record_write(DvzEventRecorder* recorder, DvzEvent ev);
+
+/**
+ * Stop recording the events of a canvas and close the event file.
+ *
+ * @param canvas the canvas
+ */
+DVZ_EXPORT void dvz_event_record_stop(DvzCanvas* canvas);
+
+
+
+/*************************************************************************************************/
+/*  Replay                                                                                       */
+/*************************************************************************************************/
+
+/**
+ * Load an event file to replay it in a canvas.
+ *
+ * The canvas may be offscreen. It should have the same size as the recorded canvas, since the
+ * mouse positions are replayed as is.
+ *
+ * @param canvas the canvas
+ * @param path the path to the event file
+ * @returns a pointer to the replay, or NULL if the file is not a valid event file
+ */
+DVZ_EXPORT DvzEventReplay* dvz_event_replay(DvzCanvas* canvas, const char* path);
+
+/**
+ * Inject the recorded events into the canvas, and run one frame for every recorded frame.
+ *
+ * The app must not be running: this function runs the frames itself with `dvz_app_run()`. The
+ * click and double click delays are measured with the recorded times, so that the same mouse
+ * events are raised at any replay speed.
+ *
+ * @param replay the replay
+ * @param flags the replay flags
+ * @returns 0 if the replay could run
+ */
+DVZ_EXPORT int dvz_event_replay_run(DvzEventReplay* replay, int flags);
+
+/**
+ * Write the per-frame timings and checksums of the last replay to a JSON file.
+ *
+ * @param replay the replay
+ * @param path the path to the JSON file
+ * @returns 0 if the file was successfully written
+ */
+DVZ_EXPORT int dvz_event_replay_dump(DvzEventReplay* replay, const char* path);
+
+/**
+ * Destroy a replay.
+ *
+ * @param replay the replay
+ */
+DVZ_EXPORT void dvz_event_replay_destroy(DvzEventReplay* replay);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
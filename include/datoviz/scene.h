@@ -7,6 +7,7 @@
 
 #include "builtin_visuals.h"
 #include "interact.h"
+#include "jobs.h"
 #include "panel.h"
 #include "ticks_types.h"
 #include "transforms.h"
@@ -161,6 +162,16 @@ struct DvzScene
 
     // FIFO queue with the pending scene updates.
     DvzFifo update_fifo;
+
+    // Protects the visual data, which the FRAME callback bakes, against other threads.
+    pthread_mutex_t data_lock;
+
+    // Number of visual command buffers recorded by the refills, the others were reused.
+    uint64_t fill_recorded;
+
+    // Worker threads recording the panels in parallel, with one command pool per thread.
+    DvzJobs* jobs;
+    VkCommandPool cmd_pools[DVZ_JOBS_MAX_THREADS];
 };
 
 
@@ -182,6 +193,43 @@ struct DvzScene
  */
 DVZ_EXPORT DvzScene* dvz_scene(DvzCanvas* canvas, uint32_t n_rows, uint32_t n_cols);
 
+/**
+ * Set the number of threads recording the panel command buffers.
+ *
+ * Each visual is recorded in its own secondary command buffer. With worker threads, the panels
+ * are distributed among the threads, each thread having its own command pool, and the main
+ * thread only records the primary command buffers executing them and submits them. The fill
+ * callbacks of the visuals are then called from the worker threads. All visuals are recorded
+ * again at the next refill.
+ *
+ * @param scene the scene
+ * @param thread_count the number of worker threads, 0 to record everything on the main thread
+ */
+DVZ_EXPORT void dvz_scene_threads(DvzScene* scene, uint32_t thread_count);
+
+
+
+/**
+ * Lock the visual data of a scene.
+ *
+ * The scene bakes and uploads the visual data in its FRAME callback, on the thread running the
+ * event loop. Another thread calling `dvz_visual_data()` while the event loop runs must hold this
+ * lock around the call. The lock is not recursive, and must not be taken from a callback running
+ * while the scene processes its updates.
+ *
+ * @param scene the scene
+ */
+DVZ_EXPORT void dvz_scene_lock(DvzScene* scene);
+
+
+
+/**
+ * Unlock the visual data of a scene.
+ *
+ * @param scene the scene
+ */
+DVZ_EXPORT void dvz_scene_unlock(DvzScene* scene);
+
 
 
 /**
@@ -290,6 +338,19 @@ dvz_scene_panel(DvzScene* scene, uint32_t row, uint32_t col, DvzControllerType t
  */
 DVZ_EXPORT DvzVisual* dvz_scene_visual(DvzPanel* panel, DvzVisualType type, int flags);
 
+/**
+ * Set the data box of a panel.
+ *
+ * The POS props of the visuals are normalized with respect to this box. This is typically called
+ * after the visuals have been displayed, as the box is otherwise extended to the data of the
+ * visuals. The visuals created with `DVZ_GRAPHICS_FLAGS_POS_DOUBLE` are not renormalized on the
+ * CPU: only the panel MVP uniform is updated.
+ *
+ * @param panel the panel
+ * @param box the data box
+ */
+DVZ_EXPORT void dvz_panel_box(DvzPanel* panel, DvzBox box);
+
 /**
  * Create a blank graphics (used when creating custom graphics and visuals).
  *
@@ -366,6 +427,34 @@ DVZ_EXPORT void dvz_arcball_rotate(DvzPanel* panel, float angle, vec3 axis);
 
 
 
+/*************************************************************************************************/
+/*  Memory accounting                                                                            */
+/*************************************************************************************************/
+
+/**
+ * Return the memory used by the visuals of a canvas.
+ *
+ * The GPU memory of the context, shared by all canvases, is returned by dvz_context_memory().
+ *
+ * @param canvas the canvas
+ * @returns the memory usage
+ */
+DVZ_EXPORT DvzMemoryUsage dvz_canvas_memory(DvzCanvas* canvas);
+
+/**
+ * Write the memory usage of a canvas to a JSON file.
+ *
+ * The file contains the memory used by all arrays of the process, by the GPU context, and by
+ * each panel, visual, prop, and source of the canvas.
+ *
+ * @param canvas the canvas
+ * @param path the path to the JSON file
+ * @returns 0 if the file was successfully written
+ */
+DVZ_EXPORT int dvz_memory_dump(DvzCanvas* canvas, const char* path);
+
+
+
 static void _default_controller_callback(DvzController* controller, DvzEvent ev)
 {
     DvzScene* scene = controller->panel->scene;
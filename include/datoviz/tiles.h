@@ -0,0 +1,295 @@
+/*************************************************************************************************/
+/*  Tiled multi-resolution images streamed into a texture atlas                                  */
+/*************************************************************************************************/
+
+#ifndef DVZ_TILES_HEADER
+#define DVZ_TILES_HEADER
+
+#include "common.h"
+#include "interact.h"
+#include "visuals.h"
+#include "vklite.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_TILE_APRON         1  // number of border pixels on each side of a tile in the atlas
+#define DVZ_TILE_UPLOAD_BUDGET 16 // default maximum number of tile uploads per update
+#define DVZ_TILE_MAX_LEVELS    24 // maximum number of pyramid levels
+
+
+
+/*************************************************************************************************/
+/*  Enums                                                                                        */
+/*************************************************************************************************/
+
+// Tile state.
+typedef enum
+{
+    DVZ_TILE_EMPTY,    // not in the atlas, not requested
+    DVZ_TILE_QUEUED,   // requested, waiting for the loader thread
+    DVZ_TILE_LOADING,  // being loaded by the loader thread
+    DVZ_TILE_LOADED,   // loaded, waiting for the upload to the atlas texture
+    DVZ_TILE_RESIDENT, // in the atlas texture
+} DvzTileState;
+
+
+
+// Loader buffer state.
+typedef enum
+{
+    DVZ_TILE_BUFFER_FREE,
+    DVZ_TILE_BUFFER_LOADING,
+    DVZ_TILE_BUFFER_LOADED,
+    DVZ_TILE_BUFFER_UPLOADING,
+} DvzTileBufferState;
+
+
+
+/*************************************************************************************************/
+/*  Typedefs                                                                                     */
+/*************************************************************************************************/
+
+typedef struct DvzTileBuffer DvzTileBuffer;
+typedef struct DvzTileStats DvzTileStats;
+typedef struct DvzTiles DvzTiles;
+
+// Load a tile_size x tile_size RGBA tile of a given pyramid level, called by the loader thread.
+// Level 0 is the full-resolution image, and each level halves the resolution of the previous
+// one. Only the pixels within the image need to be set in tiles at the right and bottom edges.
+typedef void (*DvzTileLoader)(
+    DvzTiles* tiles, uint32_t level, uvec2 tile, cvec4* out, void* user_data);
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+// Buffer holding a tile loaded by the loader thread, until it has been uploaded to the GPU.
+struct DvzTileBuffer
+{
+    DvzTileBufferState state;
+    uint32_t tile_idx;
+    cvec4* tile; // tile_size^2 pixels, filled by the loader callback
+    cvec4* data; // (tile_size + 2 * DVZ_TILE_APRON)^2 pixels, uploaded to the atlas
+};
+
+
+
+struct DvzTileStats
+{
+    uint64_t loads;       // number of tiles loaded by the loader thread
+    uint64_t uploads;     // number of tiles uploaded to the atlas texture
+    uint64_t evictions;   // number of tiles evicted from the atlas texture
+    uint64_t discards;    // number of loaded tiles that were no longer needed
+    uint32_t resident;    // current number of tiles in the atlas texture
+    uint32_t level;       // pyramid level selected at the last update
+    uint32_t drawn;       // number of tiles drawn at the last update
+    uint32_t fallback;    // number of tiles drawn from a coarser level at the last update
+    double latency_total; // total time between the request and the upload of the tiles, in s
+    double latency_max;   // maximum time between the request and the upload of a tile, in s
+};
+
+
+
+struct DvzTiles
+{
+    DvzObject obj;
+    DvzCanvas* canvas;
+    DvzVisual* visual;
+
+    // Pyramid layout.
+    uvec2 shape;        // full-resolution image shape in pixels (width, height)
+    uint32_t tile_size; // tile side in pixels, without the apron
+    uint32_t slot_size; // tile side in pixels in the atlas, with the apron
+    uint32_t level_count;
+    uvec2 level_shape[DVZ_TILE_MAX_LEVELS];   // image shape at each level
+    uvec2 level_grid[DVZ_TILE_MAX_LEVELS];    // number of tiles along each axis at each level
+    uint32_t level_offset[DVZ_TILE_MAX_LEVELS]; // index of the first tile of each level
+    uint32_t tile_count;
+
+    // Tile loader.
+    DvzTileLoader loader;
+    void* user_data;
+    cvec4* levels[DVZ_TILE_MAX_LEVELS]; // in-memory pyramid, used by dvz_tiles_image()
+
+    // Atlas layout.
+    uvec2 atlas_grid; // number of atlas slots along each axis
+    uint32_t slot_count;
+    uint32_t upload_budget; // maximum number of tile uploads per update
+    DvzTexture* atlas;      // 2D RGBA texture with the resident tiles
+
+    // Per-tile data.
+    uint8_t* state;         // DvzTileState
+    int32_t* tile_slot;     // atlas slot, or -1
+    uint32_t* wanted_epoch; // last update where the tile was wanted
+    double* requested;      // time of the last request, for the latency statistics
+
+    // Per-slot LRU list, the head is the most recently used slot.
+    int32_t* slot_tile; // tile in each slot, or -1
+    int32_t* lru_prev;
+    int32_t* lru_next;
+    int32_t lru_head, lru_tail;
+    uint32_t slot_used;
+
+    // Tile selection: the tiles covering the view, coarsest level first.
+    dvec4 view;
+    uvec2 view_size;
+    bool has_view, is_visible;
+    uint32_t level; // selected level
+    uvec4 range;    // tiles covering the view at the selected level (i0, j0, i1, j1)
+    uint32_t epoch;
+    uint32_t* wanted;
+    uint64_t* wanted_keys;
+    uint32_t wanted_count;
+
+    // Tile quads passed to the image visual.
+    uint32_t quad_count;
+    dvec3* quad_pos[4];
+    vec2* quad_uv[4];
+
+    // Loader thread, the lock protects the request queue, the tile states, and the buffers.
+    DvzClock clock;
+    DvzThread thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    atomic(bool, is_running);
+    uint32_t* queue;
+    uint32_t queue_count, queue_pos;
+    DvzTileBuffer* buffers;
+    uint32_t buffer_count;
+
+    DvzTileStats stats;
+};
+
+
+
+/*************************************************************************************************/
+/*  Functions                                                                                    */
+/*************************************************************************************************/
+
+/**
+ * Create a tiled image pyramid with tiles provided by a callback.
+ *
+ * The callback is called on a background thread, for example to read the tiles from files on
+ * disk. A fixed-size atlas texture holds a subset of the tiles. At every update, the tiles
+ * covering the view are selected at the pyramid level matching the zoom level, and the missing
+ * ones are requested. Until they are loaded, the corresponding part of the image is drawn with
+ * the tiles of a coarser level.
+ *
+ * @param canvas the canvas
+ * @param shape the full-resolution image shape in pixels (width, height)
+ * @param tile_size the tile side, in pixels
+ * @param atlas_grid the number of atlas slots along each axis
+ * @param loader the tile loader callback
+ * @param user_data pointer passed to the tile loader
+ * @returns the tiled image
+ */
+DVZ_EXPORT DvzTiles* dvz_tiles(
+    DvzCanvas* canvas, uvec2 shape, uint32_t tile_size, uvec2 atlas_grid, DvzTileLoader loader,
+    void* user_data);
+
+/**
+ * Create a tiled image pyramid from an in-memory RGBA image.
+ *
+ * The coarser levels are computed on the CPU by averaging 2x2 blocks of pixels.
+ *
+ * @param canvas the canvas
+ * @param shape the image shape in pixels (width, height)
+ * @param tile_size the tile side, in pixels
+ * @param atlas_grid the number of atlas slots along each axis
+ * @param image the image pixels, copied
+ * @returns the tiled image
+ */
+DVZ_EXPORT DvzTiles* dvz_tiles_image(
+    DvzCanvas* canvas, uvec2 shape, uint32_t tile_size, uvec2 atlas_grid, const cvec4* image);
+
+/**
+ * Set the maximum number of tiles uploaded at each update.
+ *
+ * @param tiles the tiled image
+ * @param budget the maximum number of tile uploads per update
+ */
+DVZ_EXPORT void dvz_tiles_budget(DvzTiles* tiles, uint32_t budget);
+
+/**
+ * Bind a tiled image to an image visual.
+ *
+ * The image occupies the square between -1 and +1 in normalized coordinates. Each update sets
+ * the visual position and texture coordinate props with one image per drawn tile.
+ *
+ * @param tiles the tiled image
+ * @param visual the image visual
+ */
+DVZ_EXPORT void dvz_tiles_visual(DvzTiles* tiles, DvzVisual* visual);
+
+/**
+ * Select the tiles covering a view, request the missing ones, and upload the loaded ones.
+ *
+ * This function should be called at most once per frame, typically in a FRAME callback, as the
+ * tile uploads go through the canvas transfers.
+ *
+ * @param tiles the tiled image
+ * @param view the visible rectangle in normalized coordinates (xmin, ymin, xmax, ymax)
+ * @param size the viewport size, in framebuffer pixels
+ * @returns whether the visual data has changed
+ */
+DVZ_EXPORT bool dvz_tiles_update(DvzTiles* tiles, dvec4 view, uvec2 size);
+
+/**
+ * Update a tiled image with the view of a panzoom.
+ *
+ * @param tiles the tiled image
+ * @param panzoom the panzoom
+ * @param viewport the viewport
+ * @returns whether the visual data has changed
+ */
+DVZ_EXPORT bool dvz_tiles_panzoom(DvzTiles* tiles, DvzPanzoom* panzoom, DvzViewport viewport);
+
+/**
+ * Block until the loader thread has loaded all requested tiles.
+ *
+ * @param tiles the tiled image
+ */
+DVZ_EXPORT void dvz_tiles_wait(DvzTiles* tiles);
+
+/**
+ * Return the atlas slot of a tile.
+ *
+ * @param tiles the tiled image
+ * @param level the pyramid level
+ * @param tile the tile coordinates within the level
+ * @returns the slot index, or -1 if the tile is not in the atlas
+ */
+DVZ_EXPORT int32_t dvz_tiles_slot(DvzTiles* tiles, uint32_t level, uvec2 tile);
+
+/**
+ * Return the streaming statistics.
+ *
+ * @param tiles the tiled image
+ * @returns the statistics
+ */
+DVZ_EXPORT DvzTileStats dvz_tiles_stats(DvzTiles* tiles);
+
+/**
+ * Destroy a tiled image.
+ *
+ * @param tiles the tiled image
+ */
+DVZ_EXPORT void dvz_tiles_destroy(DvzTiles* tiles);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
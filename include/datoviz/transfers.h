@@ -24,6 +24,7 @@ typedef enum
     DVZ_TRANSFER_TEXTURE_UPLOAD,
     DVZ_TRANSFER_TEXTURE_DOWNLOAD,
     DVZ_TRANSFER_TEXTURE_COPY,
+    DVZ_TRANSFER_TEXTURE_STREAM,
 } DvzDataTransferType;
 
 
@@ -87,6 +88,7 @@ union DvzTransferUnion
     DvzTransferTexture tex;
     DvzTransferBufferCopy buf_copy;
     DvzTransferTextureCopy tex_copy;
+    DvzTextureStream* stream;
 };
 
 
@@ -188,6 +190,17 @@ DVZ_EXPORT void dvz_copy_texture(
     DvzCanvas* canvas, DvzTexture* src, uvec3 src_offset, DvzTexture* dst, uvec3 dst_offset,
     uvec3 shape, VkDeviceSize size);
 
+/**
+ * Attach a texture stream to a canvas, which uploads some of its chunks at every frame.
+ *
+ * The stream is detached from the canvas once all chunks have been uploaded, and it may then be
+ * destroyed. When the event loop is not running, the whole texture is uploaded immediately.
+ *
+ * @param canvas the canvas
+ * @param stream the texture stream, see `dvz_texture_stream()`
+ */
+DVZ_EXPORT void dvz_stream_texture(DvzCanvas* canvas, DvzTextureStream* stream);
+
 /**
  * Process the pending transfers.
  *
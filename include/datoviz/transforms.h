@@ -204,6 +204,31 @@ MAKE_TRANSPOSE(vec3)
 DVZ_EXPORT void
 dvz_transform_pos(DvzDataCoords coords, DvzArray* pos_in, DvzArray* pos_out, bool inverse);
 
+/**
+ * Apply the non-linear part of the CPU transformation on position data with emulated double
+ * precision.
+ *
+ * The positions are only transformed by the non-cartesian transformation, if any, and the origin
+ * is subtracted. The linear rescaling to normalized coordinates is done in the vertex shader,
+ * see `dvz_transform_mvp_double()`.
+ *
+ * @param coords the data coordinate system and bounds
+ * @param origin the origin subtracted from the transformed positions
+ * @param pos_in input array of dvec3 values
+ * @param[out] pos_out output array of dvec3 values
+ */
+DVZ_EXPORT void dvz_transform_pos_double(
+    DvzDataCoords coords, dvec3 origin, DvzArray* pos_in, DvzArray* pos_out);
+
+/**
+ * Set the data transform of the positions with emulated double precision in an MVP structure.
+ *
+ * @param coords the data coordinate system and bounds
+ * @param origin the origin subtracted from the transformed positions
+ * @param[out] mvp the MVP structure
+ */
+DVZ_EXPORT void dvz_transform_mvp_double(DvzDataCoords coords, dvec3 origin, DvzMVP* mvp);
+
 /**
  * Convert a 3D position from a coordinate system to another.
  *
@@ -75,6 +75,7 @@ typedef enum
     DVZ_PROP_INDEX,
     DVZ_PROP_SCALE,
     DVZ_PROP_TRANSFORM,
+    DVZ_PROP_VALUE,
 } DvzPropType;
 
 
@@ -160,6 +161,7 @@ typedef union DvzSourceUnion DvzSourceUnion;
 typedef struct DvzSource DvzSource;
 
 typedef struct DvzVisualFillEvent DvzVisualFillEvent;
+typedef struct DvzVisualFillKey DvzVisualFillKey;
 typedef struct DvzVisualDataEvent DvzVisualDataEvent;
 
 typedef uint32_t DvzIndex;
@@ -257,6 +259,24 @@ struct DvzProp
 
 
 
+// State of a visual when its cached command buffer was recorded. The command buffer is recorded
+// again when the state changes.
+struct DvzVisualFillKey
+{
+    uint32_t version; // 0 if the command buffer has never been recorded
+    VkViewport viewport;
+    uint32_t vertex_count[DVZ_MAX_GRAPHICS_PER_VISUAL];
+    uint32_t index_count[DVZ_MAX_GRAPHICS_PER_VISUAL];
+
+    // The shared vertex and index buffers are recreated when they grow.
+    VkBuffer vertex_buffer[DVZ_MAX_GRAPHICS_PER_VISUAL];
+    VkDeviceSize vertex_offset[DVZ_MAX_GRAPHICS_PER_VISUAL];
+    VkBuffer index_buffer[DVZ_MAX_GRAPHICS_PER_VISUAL];
+    VkDeviceSize index_offset[DVZ_MAX_GRAPHICS_PER_VISUAL];
+};
+
+
+
 /*************************************************************************************************/
 /*  Visual struct                                                                                */
 /*************************************************************************************************/
@@ -308,6 +328,11 @@ struct DvzVisual
     // GPU data
     DvzContainer bindings;
     DvzContainer bindings_comp;
+
+    // Cached secondary command buffers with the draw commands, one per swapchain image.
+    DvzCommands cmds_fill;
+    uint32_t fill_version; // incremented when the graphics or the bindings change
+    DvzVisualFillKey fill_keys[DVZ_MAX_SWAPCHAIN_IMAGES];
 };
 
 
@@ -512,6 +537,27 @@ DVZ_EXPORT void dvz_visual_data_partial(
     DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, //
     uint32_t first_item, uint32_t item_count, uint32_t data_item_count, const void* data);
 
+/**
+ * Set the data for a given visual prop from a strided array of scalars of any dtype.
+ *
+ * The data is converted to the prop dtype and copied to the prop array in a single pass. This
+ * avoids a contiguous copy and a cast copy of the data beforehand, for example with a column of a
+ * larger array, or with float positions for a dvec3 prop. This is used by the Python bindings to
+ * ingest NumPy arrays without copying them.
+ *
+ * @param visual the visual
+ * @param prop_type the prop type
+ * @param prop_idx the prop index
+ * @param count the number of elements to upload
+ * @param data pointer to the first component of the first element
+ * @param dtype the scalar dtype of the data (CHAR, USHORT, SHORT, UINT, INT, FLOAT, or DOUBLE)
+ * @param item_stride the number of bytes between two consecutive elements
+ * @param component_stride the number of bytes between two consecutive components of an element
+ */
+DVZ_EXPORT void dvz_visual_data_strided(
+    DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count, const void* data,
+    DvzDataType dtype, int64_t item_stride, int64_t component_stride);
+
 /**
  * Append elements to the prop.
  *
@@ -599,6 +645,29 @@ DVZ_EXPORT void dvz_visual_fill_event(
     DvzVisual* visual, VkClearColorValue clear_color, DvzCommands* cmds, uint32_t cmd_idx,
     DvzViewport viewport, void* user_data);
 
+/**
+ * Record the visual draw commands in a cached secondary command buffer.
+ *
+ * The secondary command buffer is only recorded again if the visual graphics, bindings, vertex or
+ * index counts, or viewport have changed since it was last recorded for the same command buffer
+ * index. Visuals with a custom fill callback are always recorded again.
+ *
+ * The secondary command buffers are allocated again from the given command pool if they were
+ * allocated from another one. Visuals recorded in parallel must use different command pools, and
+ * the custom fill callbacks are then called from several threads.
+ *
+ * @param visual the visual
+ * @param clear_color the clear color
+ * @param cmds the primary command buffers that will execute the secondary command buffer
+ * @param cmd_idx the index of the command buffer to update
+ * @param viewport the viewport
+ * @param pool the command pool, or `VK_NULL_HANDLE` for the GPU command pool
+ * @returns whether the secondary command buffer was recorded
+ */
+DVZ_EXPORT bool dvz_visual_fill_cached(
+    DvzVisual* visual, VkClearColorValue clear_color, DvzCommands* cmds, uint32_t cmd_idx,
+    DvzViewport viewport, VkCommandPool pool);
+
 /**
  * Begin recording a command buffer and begin the render pass.
  *
@@ -716,4 +785,35 @@ DVZ_EXPORT void dvz_visual_update(
 
 
 
+/*************************************************************************************************/
+/*  Memory accounting                                                                            */
+/*************************************************************************************************/
+
+/**
+ * Return the CPU memory used by the arrays of a prop.
+ *
+ * @param prop the prop
+ * @returns the memory usage
+ */
+DVZ_EXPORT DvzMemoryUsage dvz_prop_memory(DvzProp* prop);
+
+/**
+ * Return the CPU memory used by the array of a source, and the GPU memory of its buffer regions
+ * or texture when they are handled by the library.
+ *
+ * @param source the source
+ * @returns the memory usage
+ */
+DVZ_EXPORT DvzMemoryUsage dvz_source_memory(DvzSource* source);
+
+/**
+ * Return the memory used by a visual, its props and its sources.
+ *
+ * @param visual the visual
+ * @returns the memory usage
+ */
+DVZ_EXPORT DvzMemoryUsage dvz_visual_memory(DvzVisual* visual);
+
+
+
 #endif
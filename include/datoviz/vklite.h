@@ -101,6 +101,7 @@ typedef struct DvzSubmit DvzSubmit;
 typedef struct DvzCanvas DvzCanvas;
 typedef struct DvzContext DvzContext;
 typedef struct DvzTexture DvzTexture;
+typedef struct DvzTextureStream DvzTextureStream;
 typedef struct DvzGraphicsData DvzGraphicsData;
 
 // Callback definitions
@@ -179,6 +180,8 @@ typedef enum
     DVZ_GRAPHICS_FAKE_SPHERE,
     DVZ_GRAPHICS_VOLUME,
 
+    DVZ_GRAPHICS_POINT_CMAP,
+
     DVZ_GRAPHICS_COUNT,
     DVZ_GRAPHICS_CUSTOM,
 } DvzGraphicsType;
@@ -390,6 +393,8 @@ struct DvzCommands
 
     uint32_t queue_idx;
     uint32_t count;
+    bool secondary;     // whether the command buffers are executed from primary command buffers
+    VkCommandPool pool; // command pool the command buffers were allocated from
     VkCommandBuffer cmds[DVZ_MAX_COMMAND_BUFFERS_PER_SET];
 };
 
@@ -445,6 +450,7 @@ struct DvzImages
     VkImageType image_type;
     VkImageViewType view_type;
     uint32_t width, height, depth;
+    uint32_t mip_levels;
     VkFormat format;
     VkImageLayout layout;
     VkImageTiling tiling;
@@ -467,6 +473,7 @@ struct DvzSampler
     VkFilter min_filter;
     VkFilter mag_filter;
     VkSamplerAddressMode address_modes[3];
+    float max_lod;
     VkSampler sampler;
 };
 
@@ -531,6 +538,7 @@ struct DvzVertexBinding
 {
     uint32_t binding;
     VkDeviceSize stride;
+    uint32_t shift; // number of items by which the binding is shifted in the shared vertex buffer
 };
 
 
@@ -576,6 +584,9 @@ struct DvzGraphics
     VkShaderStageFlagBits shader_stages[DVZ_MAX_SHADERS_PER_GRAPHICS];
     VkShaderModule shader_modules[DVZ_MAX_SHADERS_PER_GRAPHICS];
 
+    // Number of vertices per instance, or 0 if the graphics pipeline is not instanced.
+    uint32_t instance_vertex_count;
+
     DvzGraphicsCallback callback;
 };
 
@@ -754,6 +765,8 @@ struct DvzTexture
 
     DvzImages* image;
     DvzSampler* sampler;
+    uint32_t mip_count; // number of mip levels, see dvz_texture_mips()
+    bool is_bound;      // whether the texture was bound to descriptor sets
 };
 
 
@@ -782,6 +795,16 @@ DVZ_EXPORT DvzApp* dvz_app(DvzBackend backend);
  */
 DVZ_EXPORT int dvz_app_destroy(DvzApp* app);
 
+/**
+ * Log the timeline of the initialization phases of the application.
+ *
+ * Every phase (Vulkan instance, GPU creation, context resources, canvas creation...) is reported
+ * with its start time and duration, in microseconds, relative to the creation of the app.
+ *
+ * @param app the application
+ */
+DVZ_EXPORT void dvz_app_startup_trace(DvzApp* app);
+
 
 
 /*************************************************************************************************/
@@ -1031,6 +1054,42 @@ DVZ_EXPORT void dvz_swapchain_destroy(DvzSwapchain* swapchain);
  */
 DVZ_EXPORT DvzCommands dvz_commands(DvzGpu* gpu, uint32_t queue, uint32_t count);
 
+/**
+ * Create a set of secondary command buffers.
+ *
+ * Secondary command buffers are recorded within a render pass and executed from primary command
+ * buffers with `dvz_cmd_execute()`.
+ *
+ * A command pool and the command buffers allocated from it must only be used by one thread at a
+ * time. Command buffers recorded in parallel must be allocated from different command pools,
+ * created with `dvz_command_pool()`.
+ *
+ * @param gpu the GPU
+ * @param queue the queue index within the GPU
+ * @param pool the command pool, or `VK_NULL_HANDLE` for the GPU command pool of the queue family
+ * @param count the number of command buffers to create
+ * @returns the set of command buffers
+ */
+DVZ_EXPORT DvzCommands
+dvz_commands_secondary(DvzGpu* gpu, uint32_t queue, VkCommandPool pool, uint32_t count);
+
+/**
+ * Create a command pool for a queue, to allocate command buffers recorded on another thread.
+ *
+ * @param gpu the GPU
+ * @param queue the queue index within the GPU
+ * @returns the command pool
+ */
+DVZ_EXPORT VkCommandPool dvz_command_pool(DvzGpu* gpu, uint32_t queue);
+
+/**
+ * Destroy a command pool and all command buffers allocated from it.
+ *
+ * @param gpu the GPU
+ * @param pool the command pool
+ */
+DVZ_EXPORT void dvz_command_pool_destroy(DvzGpu* gpu, VkCommandPool pool);
+
 /**
  * Start recording a command buffer.
  *
@@ -1039,6 +1098,16 @@ DVZ_EXPORT DvzCommands dvz_commands(DvzGpu* gpu, uint32_t queue, uint32_t count)
  */
 DVZ_EXPORT void dvz_cmd_begin(DvzCommands* cmds, uint32_t idx);
 
+/**
+ * Start recording a secondary command buffer that continues the first subpass of a render pass.
+ *
+ * @param cmds the set of secondary command buffers
+ * @param idx the index of the command buffer to begin recording on
+ * @param renderpass the render pass in which the command buffer will be executed
+ */
+DVZ_EXPORT void
+dvz_cmd_begin_secondary(DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass);
+
 /**
  * Stop recording a command buffer.
  *
@@ -1319,6 +1388,14 @@ DVZ_EXPORT void dvz_images_aspect(DvzImages* images, VkImageAspectFlags aspect);
  */
 DVZ_EXPORT void dvz_images_queue_access(DvzImages* images, uint32_t queue_idx);
 
+/**
+ * Set the number of mip levels of the images.
+ *
+ * @param images the images
+ * @param mip_levels the number of mip levels, 0 for the full mip chain down to 1x1x1
+ */
+DVZ_EXPORT void dvz_images_mip_levels(DvzImages* images, uint32_t mip_levels);
+
 /**
  * Create the images after they have been set up.
  *
@@ -1409,6 +1486,14 @@ DVZ_EXPORT void dvz_sampler_mag_filter(DvzSampler* sampler, VkFilter filter);
 DVZ_EXPORT void dvz_sampler_address_mode(
     DvzSampler* sampler, DvzTextureAxis axis, VkSamplerAddressMode address_mode);
 
+/**
+ * Set the maximum level of detail that can be sampled, for mipmapped textures.
+ *
+ * @param sampler the sampler
+ * @param max_lod the maximum level of detail, 0 to only sample the base level
+ */
+DVZ_EXPORT void dvz_sampler_max_lod(DvzSampler* sampler, float max_lod);
+
 /**
  * Create the sampler after it has been set up.
  *
@@ -1547,6 +1632,15 @@ DVZ_EXPORT void dvz_compute_create(DvzCompute* compute);
  */
 DVZ_EXPORT void dvz_compute_code(DvzCompute* compute, const char* code);
 
+/**
+ * Set the SPIRV code of a compute pipeline.
+ *
+ * @param compute the compute pipeline
+ * @param size the size of the SPIRV buffer, in bytes
+ * @param buffer the binary buffer with the SPIRV code
+ */
+DVZ_EXPORT void dvz_compute_spirv(DvzCompute* compute, VkDeviceSize size, const uint32_t* buffer);
+
 /**
  * Declare a slot for the compute pipeline.
  *
@@ -1655,6 +1749,35 @@ dvz_graphics_shader(DvzGraphics* graphics, VkShaderStageFlagBits stage, const ch
 DVZ_EXPORT void
 dvz_graphics_vertex_binding(DvzGraphics* graphics, uint32_t binding, VkDeviceSize stride);
 
+/**
+ * Set a vertex binding reading the vertex buffer shifted by a number of items.
+ *
+ * All vertex bindings of the graphics pipeline read the same vertex buffer. With an instanced
+ * graphics pipeline, instance `i` reads item `i + shift` in that binding, so that the vertex
+ * shader can access neighboring items (for example, the previous and next points of a path)
+ * while every item is stored only once. The number of drawn instances is the number of items
+ * minus the largest shift.
+ *
+ * @param graphics the graphics pipeline
+ * @param binding the binding index
+ * @param stride the stride in the vertex buffer, in bytes
+ * @param shift the number of items by which the binding is shifted
+ */
+DVZ_EXPORT void dvz_graphics_vertex_binding_shift(
+    DvzGraphics* graphics, uint32_t binding, VkDeviceSize stride, uint32_t shift);
+
+/**
+ * Make the graphics pipeline instanced.
+ *
+ * The vertex bindings advance per instance rather than per vertex: the vertex buffer contains one
+ * item per instance, and each instance is drawn with `vertex_count` vertices that the vertex
+ * shader generates from `gl_VertexIndex`.
+ *
+ * @param graphics the graphics pipeline
+ * @param vertex_count the number of vertices of each instance
+ */
+DVZ_EXPORT void dvz_graphics_instanced(DvzGraphics* graphics, uint32_t vertex_count);
+
 /**
  * Add a vertex attribute.
  *
@@ -2148,6 +2271,30 @@ DVZ_EXPORT void dvz_submit_reset(DvzSubmit* submit);
 DVZ_EXPORT void dvz_cmd_begin_renderpass(
     DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers);
 
+/**
+ * Begin a render pass whose contents are recorded in secondary command buffers.
+ *
+ * Only `dvz_cmd_execute()` may be recorded until the end of the render pass.
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record
+ * @param renderpass the render pass
+ * @param framebuffers the framebuffers
+ */
+DVZ_EXPORT void dvz_cmd_begin_renderpass_secondary(
+    DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers);
+
+/**
+ * Execute secondary command buffers.
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record, and of the secondary command buffers
+ * @param secondary_count the number of sets of secondary command buffers
+ * @param secondaries the sets of secondary command buffers
+ */
+DVZ_EXPORT void dvz_cmd_execute(
+    DvzCommands* cmds, uint32_t idx, uint32_t secondary_count, DvzCommands** secondaries);
+
 /**
  * End a render pass.
  *
@@ -2186,6 +2333,21 @@ DVZ_EXPORT void dvz_cmd_barrier(DvzCommands* cmds, uint32_t idx, DvzBarrier* bar
 DVZ_EXPORT void dvz_cmd_copy_buffer_to_image(
     DvzCommands* cmds, uint32_t idx, DvzBuffer* buffer, DvzImages* images);
 
+/**
+ * Copy part of a GPU buffer to a region of the base mip level of a GPU image.
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record
+ * @param buffer the buffer
+ * @param buf_offset the offset within the buffer, in bytes
+ * @param images the image
+ * @param offset the offset of the region within the image
+ * @param shape the shape of the region
+ */
+DVZ_EXPORT void dvz_cmd_copy_buffer_to_image_region(
+    DvzCommands* cmds, uint32_t idx, DvzBuffer* buffer, VkDeviceSize buf_offset,
+    DvzImages* images, uvec3 offset, uvec3 shape);
+
 /**
  * Copy a GPU image to a GPU buffer.
  *
@@ -2208,6 +2370,20 @@ DVZ_EXPORT void dvz_cmd_copy_image_to_buffer(
 DVZ_EXPORT void
 dvz_cmd_copy_image(DvzCommands* cmds, uint32_t idx, DvzImages* src_img, DvzImages* dst_img);
 
+/**
+ * Generate the mip levels of an image from its base level, with a chain of blits.
+ *
+ * All mip levels must be in the `VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL` layout. They are
+ * transitioned to the images layout once generated.
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record
+ * @param images the image
+ * @param filter the blit filter, `VK_FILTER_LINEAR` requires a format supporting linear filtering
+ */
+DVZ_EXPORT void
+dvz_cmd_blit_mips(DvzCommands* cmds, uint32_t idx, DvzImages* images, VkFilter filter);
+
 /**
  * Set the viewport.
  *
@@ -2241,6 +2417,20 @@ DVZ_EXPORT void dvz_cmd_bind_graphics(
 DVZ_EXPORT void dvz_cmd_bind_vertex_buffer(
     DvzCommands* cmds, uint32_t idx, DvzBufferRegions br, VkDeviceSize offset);
 
+/**
+ * Bind a vertex buffer to all vertex bindings of a graphics pipeline, taking their shifts into
+ * account.
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record
+ * @param graphics the graphics pipeline
+ * @param br the buffer regions
+ * @param offset the offset within the buffer regions, in bytes
+ */
+DVZ_EXPORT void dvz_cmd_bind_vertex_buffers(
+    DvzCommands* cmds, uint32_t idx, DvzGraphics* graphics, DvzBufferRegions br,
+    VkDeviceSize offset);
+
 /**
  * Bind an index buffer.
  *
@@ -2263,6 +2453,20 @@ DVZ_EXPORT void dvz_cmd_bind_index_buffer(
 DVZ_EXPORT void
 dvz_cmd_draw(DvzCommands* cmds, uint32_t idx, uint32_t first_vertex, uint32_t vertex_count);
 
+/**
+ * Direct instanced draw.
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record
+ * @param first_vertex index of the first vertex
+ * @param vertex_count number of vertices to draw in each instance
+ * @param first_instance index of the first instance
+ * @param instance_count number of instances to draw
+ */
+DVZ_EXPORT void dvz_cmd_draw_instanced(
+    DvzCommands* cmds, uint32_t idx, uint32_t first_vertex, uint32_t vertex_count,
+    uint32_t first_instance, uint32_t instance_count);
+
 /**
  * Direct indexed draw.
  *
@@ -78,6 +78,11 @@ then
     VK_INSTANCE_LAYERS=$dump ./build/datoviz test $2
 fi
 
+if [ $1 == "bench" ]
+then
+    ./build/datoviz bench ${@:2}
+fi
+
 if [ $1 == "demo" ]
 then
     ./build/datoviz demo $2
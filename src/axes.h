@@ -51,7 +51,7 @@ static DvzAxesContext _axes_context(DvzController* controller, DvzAxisCoord coor
     // TODO: improve determination of glyph size
     float font_size = controller->u.axes_2D.font_size;
     ASSERT(font_size > 0);
-    DvzFontAtlas* atlas = &canvas->gpu->context->font_atlas;
+    DvzFontAtlas* atlas = dvz_ctx_font_atlas(canvas->gpu->context);
     ASSERT(atlas->glyph_width > 0);
     ASSERT(atlas->glyph_height > 0);
     ctx.size_glyph = coord == DVZ_AXES_COORD_X
@@ -408,7 +408,7 @@ static void _axes_visual(DvzController* controller, DvzAxisCoord coord)
         (coord == 0 ? DVZ_INTERACT_FIXED_AXIS_Y : DVZ_INTERACT_FIXED_AXIS_X) >> 12;
 
     // Text params.
-    DvzFontAtlas* atlas = &ctx->font_atlas;
+    DvzFontAtlas* atlas = dvz_ctx_font_atlas(ctx);
     ASSERT(strlen(atlas->font_str) > 0);
     dvz_visual_texture(visual, DVZ_SOURCE_TYPE_FONT_ATLAS, 0, atlas->texture);
 
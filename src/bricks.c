@@ -0,0 +1,755 @@
+#include "../include/datoviz/bricks.h"
+#include "../include/datoviz/canvas.h"
+#include "../include/datoviz/context.h"
+#include "../include/datoviz/transfers.h"
+
+#if !OS_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+static inline void _brick_coords(uvec3 grid, uint32_t idx, uvec3 out)
+{
+    out[0] = idx % grid[0];
+    out[1] = (idx / grid[0]) % grid[1];
+    out[2] = idx / (grid[0] * grid[1]);
+}
+
+
+
+static inline uint32_t _brick_index(uvec3 grid, uvec3 coords)
+{
+    return (coords[2] * grid[1] + coords[1]) * grid[0] + coords[0];
+}
+
+
+
+static inline VkDeviceSize _slot_bytes(DvzBricks* bricks)
+{
+    VkDeviceSize s = bricks->slot_size;
+    return s * s * s * sizeof(uint16_t);
+}
+
+
+
+/*************************************************************************************************/
+/*  File                                                                                         */
+/*************************************************************************************************/
+
+static bool _bricks_open(DvzBricks* bricks, const char* path)
+{
+    ASSERT(bricks != NULL);
+    ASSERT(path != NULL);
+
+#if OS_WIN32
+    // NOTE: no memory mapping on Windows yet, the loader thread reads the rows with fread().
+    bricks->file = fopen(path, "rb");
+    if (bricks->file == NULL)
+        return false;
+    _fseeki64(bricks->file, 0, SEEK_END);
+    bricks->data_size = (size_t)_ftelli64(bricks->file);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st = {0};
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+    bricks->data_size = (size_t)st.st_size;
+    void* data = mmap(NULL, bricks->data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping remains valid after the file descriptor is closed.
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    // The bricks are read in an arbitrary order, disable the kernel read-ahead.
+    madvise(data, bricks->data_size, MADV_RANDOM);
+    bricks->data = (const uint16_t*)data;
+#endif
+    return true;
+}
+
+
+
+static void _bricks_close(DvzBricks* bricks)
+{
+    ASSERT(bricks != NULL);
+#if OS_WIN32
+    if (bricks->file != NULL)
+        fclose(bricks->file);
+    bricks->file = NULL;
+#else
+    if (bricks->data != NULL)
+        munmap((void*)bricks->data, bricks->data_size);
+    bricks->data = NULL;
+#endif
+}
+
+
+
+// Read a contiguous range of voxels from the file.
+static void _bricks_read_row(DvzBricks* bricks, uint64_t offset, uint32_t count, uint16_t* out)
+{
+    ASSERT(bricks != NULL);
+    ASSERT((offset + count) * sizeof(uint16_t) <= bricks->data_size);
+    if (bricks->data != NULL)
+    {
+        memcpy(out, &bricks->data[offset], count * sizeof(uint16_t));
+    }
+    else
+    {
+        ASSERT(bricks->file != NULL);
+#if OS_WIN32
+        _fseeki64(bricks->file, (int64_t)(offset * sizeof(uint16_t)), SEEK_SET);
+#else
+        fseeko(bricks->file, (off_t)(offset * sizeof(uint16_t)), SEEK_SET);
+#endif
+        if (fread(out, sizeof(uint16_t), count, bricks->file) != count)
+            log_error("unable to read %d voxels from the volume file", count);
+    }
+}
+
+
+
+// Read a brick with its apron. The voxels outside the volume are clamped to the volume border.
+static void _bricks_read(DvzBricks* bricks, uint32_t brick_idx, uint16_t* out)
+{
+    ASSERT(bricks != NULL);
+    ASSERT(out != NULL);
+
+    const int64_t B = bricks->brick_size;
+    const int64_t S = bricks->slot_size;
+    const int64_t W = bricks->shape[0];
+    const int64_t H = bricks->shape[1];
+    const int64_t D = bricks->shape[2];
+
+    uvec3 coords = {0};
+    _brick_coords(bricks->grid, brick_idx, coords);
+    int64_t x0 = coords[0] * B - DVZ_BRICK_APRON;
+    int64_t y0 = coords[1] * B - DVZ_BRICK_APRON;
+    int64_t z0 = coords[2] * B - DVZ_BRICK_APRON;
+
+    // Range of the brick row inside the volume.
+    int64_t i0 = CLIP(-x0, 0, S);
+    int64_t i1 = CLIP(W - x0, i0, S);
+    ASSERT(i0 < i1);
+
+    int64_t y = 0, z = 0;
+    uint16_t* row = NULL;
+    for (int64_t k = 0; k < S; k++)
+    {
+        z = CLIP(z0 + k, 0, D - 1);
+        for (int64_t j = 0; j < S; j++)
+        {
+            y = CLIP(y0 + j, 0, H - 1);
+            row = &out[(k * S + j) * S];
+            _bricks_read_row(
+                bricks, (uint64_t)((z * H + y) * W + x0 + i0), (uint32_t)(i1 - i0), &row[i0]);
+            for (int64_t i = 0; i < i0; i++)
+                row[i] = row[i0];
+            for (int64_t i = i1; i < S; i++)
+                row[i] = row[i1 - 1];
+        }
+    }
+}
+
+
+
+/*************************************************************************************************/
+/*  Loader thread                                                                                */
+/*************************************************************************************************/
+
+// Take the next requested brick and a free buffer. Must be called with the lock.
+static DvzBrickBuffer* _bricks_next(DvzBricks* bricks)
+{
+    ASSERT(bricks != NULL);
+
+    DvzBrickBuffer* buffer = NULL;
+    for (uint32_t i = 0; i < bricks->buffer_count; i++)
+    {
+        if (bricks->buffers[i].state == DVZ_BRICK_BUFFER_FREE)
+        {
+            buffer = &bricks->buffers[i];
+            break;
+        }
+    }
+    if (buffer == NULL)
+        return NULL;
+
+    // The queue is sorted by priority.
+    uint32_t brick_idx = 0;
+    while (bricks->queue_pos < bricks->queue_count)
+    {
+        brick_idx = bricks->queue[bricks->queue_pos++];
+        if (bricks->state[brick_idx] != DVZ_BRICK_QUEUED)
+            continue;
+        bricks->state[brick_idx] = DVZ_BRICK_LOADING;
+        buffer->state = DVZ_BRICK_BUFFER_LOADING;
+        buffer->brick_idx = brick_idx;
+        return buffer;
+    }
+    return NULL;
+}
+
+
+
+static void* _bricks_loader(void* user_data)
+{
+    DvzBricks* bricks = (DvzBricks*)user_data;
+    ASSERT(bricks != NULL);
+
+    DvzBrickBuffer* buffer = NULL;
+    while (true)
+    {
+        pthread_mutex_lock(&bricks->lock);
+        while (atomic_load(&bricks->is_running) && (buffer = _bricks_next(bricks)) == NULL)
+            pthread_cond_wait(&bricks->cond, &bricks->lock);
+        pthread_mutex_unlock(&bricks->lock);
+        if (!atomic_load(&bricks->is_running))
+            break;
+        ASSERT(buffer != NULL);
+
+        // Read the brick outside of the lock.
+        _bricks_read(bricks, buffer->brick_idx, buffer->data);
+
+        pthread_mutex_lock(&bricks->lock);
+        buffer->state = DVZ_BRICK_BUFFER_LOADED;
+        bricks->state[buffer->brick_idx] = DVZ_BRICK_LOADED;
+        bricks->stats.loads++;
+        pthread_cond_broadcast(&bricks->cond);
+        pthread_mutex_unlock(&bricks->lock);
+
+        // Canvases rendering on demand need a frame to upload the brick.
+        dvz_canvas_request_frame(bricks->canvas);
+    }
+    return NULL;
+}
+
+
+
+/*************************************************************************************************/
+/*  Priorities                                                                                   */
+/*************************************************************************************************/
+
+static void _heap_sift_down(uint32_t* items, float* keys, uint32_t n, uint32_t i)
+{
+    uint32_t l = 0, r = 0, m = 0, tmp = 0;
+    float tmpk = 0;
+    while (true)
+    {
+        l = 2 * i + 1;
+        r = l + 1;
+        m = i;
+        if (l < n && keys[l] > keys[m])
+            m = l;
+        if (r < n && keys[r] > keys[m])
+            m = r;
+        if (m == i)
+            return;
+        tmp = items[i], items[i] = items[m], items[m] = tmp;
+        tmpk = keys[i], keys[i] = keys[m], keys[m] = tmpk;
+        i = m;
+    }
+}
+
+
+
+// Select the bricks closest to the eye, at most one per cache slot, and request those that are
+// not in the cache yet, by increasing distance.
+static void _bricks_prioritize(DvzBricks* bricks, vec3 eye)
+{
+    ASSERT(bricks != NULL);
+
+    const uint32_t K = MIN(bricks->slot_count, bricks->brick_count);
+    const float B = bricks->brick_size;
+    vec3 p = {0};
+    for (uint32_t i = 0; i < 3; i++)
+        p[i] = eye[i] * bricks->shape[i];
+
+    // Max-heap of the K closest bricks, keyed by the squared distance between the eye and the
+    // brick center, in voxels.
+    uint32_t* items = bricks->wanted;
+    float* keys = bricks->wanted_dist;
+    uint32_t n = 0;
+    uvec3 c = {0};
+    float d = 0, dx = 0, dy = 0, dz = 0;
+    for (c[2] = 0; c[2] < bricks->grid[2]; c[2]++)
+    {
+        dz = (c[2] + .5f) * B - p[2];
+        for (c[1] = 0; c[1] < bricks->grid[1]; c[1]++)
+        {
+            dy = (c[1] + .5f) * B - p[1];
+            for (c[0] = 0; c[0] < bricks->grid[0]; c[0]++)
+            {
+                dx = (c[0] + .5f) * B - p[0];
+                d = dx * dx + dy * dy + dz * dz;
+                if (n < K)
+                {
+                    // Fill the heap, and heapify once it is full.
+                    items[n] = _brick_index(bricks->grid, c);
+                    keys[n++] = d;
+                    if (n == K)
+                        for (int64_t i = (int64_t)K / 2 - 1; i >= 0; i--)
+                            _heap_sift_down(items, keys, K, (uint32_t)i);
+                }
+                else if (d < keys[0])
+                {
+                    items[0] = _brick_index(bricks->grid, c);
+                    keys[0] = d;
+                    _heap_sift_down(items, keys, K, 0);
+                }
+            }
+        }
+    }
+    ASSERT(n == K);
+
+    // Heap sort: increasing distance.
+    uint32_t tmp = 0;
+    float tmpk = 0;
+    for (uint32_t i = K - 1; i > 0; i--)
+    {
+        tmp = items[0], items[0] = items[i], items[i] = tmp;
+        tmpk = keys[0], keys[0] = keys[i], keys[i] = tmpk;
+        _heap_sift_down(items, keys, i, 0);
+    }
+    bricks->wanted_count = K;
+    bricks->epoch++;
+    for (uint32_t i = 0; i < K; i++)
+        bricks->wanted_epoch[items[i]] = bricks->epoch;
+
+    // Replace the request queue.
+    pthread_mutex_lock(&bricks->lock);
+    uint32_t brick_idx = 0;
+    for (uint32_t i = bricks->queue_pos; i < bricks->queue_count; i++)
+    {
+        brick_idx = bricks->queue[i];
+        if (bricks->state[brick_idx] == DVZ_BRICK_QUEUED)
+            bricks->state[brick_idx] = DVZ_BRICK_EMPTY;
+    }
+    bricks->queue_pos = 0;
+    bricks->queue_count = 0;
+    for (uint32_t i = 0; i < K; i++)
+    {
+        brick_idx = items[i];
+        if (bricks->state[brick_idx] != DVZ_BRICK_EMPTY)
+            continue;
+        bricks->state[brick_idx] = DVZ_BRICK_QUEUED;
+        bricks->queue[bricks->queue_count++] = brick_idx;
+    }
+    pthread_cond_broadcast(&bricks->cond);
+    pthread_mutex_unlock(&bricks->lock);
+
+    _vec3_copy(eye, bricks->eye);
+    bricks->has_eye = true;
+}
+
+
+
+/*************************************************************************************************/
+/*  LRU cache                                                                                    */
+/*************************************************************************************************/
+
+static void _lru_remove(DvzBricks* bricks, int32_t slot)
+{
+    int32_t prev = bricks->lru_prev[slot];
+    int32_t next = bricks->lru_next[slot];
+    if (prev >= 0)
+        bricks->lru_next[prev] = next;
+    else
+        bricks->lru_head = next;
+    if (next >= 0)
+        bricks->lru_prev[next] = prev;
+    else
+        bricks->lru_tail = prev;
+    bricks->lru_prev[slot] = -1;
+    bricks->lru_next[slot] = -1;
+}
+
+
+
+static void _lru_push_head(DvzBricks* bricks, int32_t slot)
+{
+    bricks->lru_prev[slot] = -1;
+    bricks->lru_next[slot] = bricks->lru_head;
+    if (bricks->lru_head >= 0)
+        bricks->lru_prev[bricks->lru_head] = slot;
+    bricks->lru_head = slot;
+    if (bricks->lru_tail < 0)
+        bricks->lru_tail = slot;
+}
+
+
+
+static void _lru_touch(DvzBricks* bricks, int32_t slot)
+{
+    if (bricks->lru_head == slot)
+        return;
+    _lru_remove(bricks, slot);
+    _lru_push_head(bricks, slot);
+}
+
+
+
+// Mark the resident bricks that are still wanted as recently used, the closest brick last so
+// that it ends up at the head of the LRU list.
+static void _bricks_touch(DvzBricks* bricks)
+{
+    uint32_t brick_idx = 0;
+    for (int64_t i = (int64_t)bricks->wanted_count - 1; i >= 0; i--)
+    {
+        brick_idx = bricks->wanted[i];
+        if (bricks->brick_slot[brick_idx] >= 0)
+            _lru_touch(bricks, bricks->brick_slot[brick_idx]);
+    }
+}
+
+
+
+static void _upload_table_entry(DvzBricks* bricks, uint32_t brick_idx)
+{
+    uvec3 coords = {0};
+    _brick_coords(bricks->grid, brick_idx, coords);
+    dvz_upload_texture(
+        bricks->canvas, bricks->page_table, coords, (uvec3){1, 1, 1}, sizeof(cvec4),
+        bricks->table[brick_idx]);
+}
+
+
+
+// Return a free cache slot, evicting the least recently used brick if the cache is full.
+static int32_t _bricks_slot_alloc(DvzBricks* bricks)
+{
+    if (bricks->slot_used < bricks->slot_count)
+        return (int32_t)bricks->slot_used++;
+
+    int32_t slot = bricks->lru_tail;
+    ASSERT(slot >= 0);
+    _lru_remove(bricks, slot);
+
+    int32_t evicted = bricks->slot_brick[slot];
+    ASSERT(evicted >= 0);
+    bricks->state[evicted] = DVZ_BRICK_EMPTY;
+    bricks->brick_slot[evicted] = -1;
+    bricks->slot_brick[slot] = -1;
+    memset(bricks->table[evicted], 0, sizeof(cvec4));
+    _upload_table_entry(bricks, (uint32_t)evicted);
+    bricks->stats.evictions++;
+    return slot;
+}
+
+
+
+static void _bricks_upload(DvzBricks* bricks, DvzBrickBuffer* buffer)
+{
+    uint32_t brick_idx = buffer->brick_idx;
+    int32_t slot = _bricks_slot_alloc(bricks);
+
+    uvec3 coords = {0};
+    _brick_coords(bricks->cache_grid, (uint32_t)slot, coords);
+
+    // Upload the brick to its cache slot.
+    const uint32_t S = bricks->slot_size;
+    dvz_upload_texture(
+        bricks->canvas, bricks->cache, (uvec3){coords[0] * S, coords[1] * S, coords[2] * S},
+        (uvec3){S, S, S}, _slot_bytes(bricks), buffer->data);
+
+    // Update the page table.
+    bricks->table[brick_idx][0] = (uint8_t)coords[0];
+    bricks->table[brick_idx][1] = (uint8_t)coords[1];
+    bricks->table[brick_idx][2] = (uint8_t)coords[2];
+    bricks->table[brick_idx][3] = 1;
+    _upload_table_entry(bricks, brick_idx);
+
+    bricks->state[brick_idx] = DVZ_BRICK_RESIDENT;
+    bricks->brick_slot[brick_idx] = slot;
+    bricks->slot_brick[slot] = (int32_t)brick_idx;
+    _lru_push_head(bricks, slot);
+    bricks->stats.uploads++;
+}
+
+
+
+/*************************************************************************************************/
+/*  Bricked volume                                                                               */
+/*************************************************************************************************/
+
+DvzBricks* dvz_bricks(
+    DvzCanvas* canvas, const char* path, uvec3 shape, uint32_t brick_size, uvec3 cache_grid)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(canvas->gpu != NULL);
+    ASSERT(path != NULL);
+    ASSERT(brick_size > 0);
+    ASSERT(shape[0] > 0 && shape[1] > 0 && shape[2] > 0);
+
+    DvzBricks* bricks = calloc(1, sizeof(DvzBricks));
+    bricks->canvas = canvas;
+
+    // Volume layout.
+    memcpy(bricks->shape, shape, sizeof(uvec3));
+    bricks->brick_size = brick_size;
+    bricks->slot_size = brick_size + 2 * DVZ_BRICK_APRON;
+    for (uint32_t i = 0; i < 3; i++)
+        bricks->grid[i] = (shape[i] + brick_size - 1) / brick_size;
+    bricks->brick_count = bricks->grid[0] * bricks->grid[1] * bricks->grid[2];
+
+    // Cache layout.
+    for (uint32_t i = 0; i < 3; i++)
+        bricks->cache_grid[i] = CLIP(cache_grid[i], 1, DVZ_BRICK_MAX_CACHE_SLOTS);
+    bricks->slot_count = bricks->cache_grid[0] * bricks->cache_grid[1] * bricks->cache_grid[2];
+    bricks->upload_budget = DVZ_BRICK_UPLOAD_BUDGET;
+
+    // Memory-map the volume file.
+    if (!_bricks_open(bricks, path))
+    {
+        log_error("unable to open the volume file %s", path);
+        FREE(bricks);
+        return NULL;
+    }
+    uint64_t voxels = (uint64_t)shape[0] * shape[1] * shape[2];
+    if (bricks->data_size < voxels * sizeof(uint16_t))
+    {
+        log_error(
+            "volume file %s is too small for a %dx%dx%d volume", path, shape[0], shape[1],
+            shape[2]);
+        _bricks_close(bricks);
+        FREE(bricks);
+        return NULL;
+    }
+    log_debug(
+        "bricked volume %dx%dx%d, %d bricks of %d voxels, cache with %d slots", //
+        shape[0], shape[1], shape[2], bricks->brick_count, brick_size, bricks->slot_count);
+
+    // Cache texture, with linear interpolation within each brick thanks to the apron.
+    DvzContext* ctx = canvas->gpu->context;
+    const uint32_t S = bricks->slot_size;
+    uvec3 cache_size = {
+        bricks->cache_grid[0] * S, bricks->cache_grid[1] * S, bricks->cache_grid[2] * S};
+    bricks->cache = dvz_ctx_texture(ctx, 3, cache_size, VK_FORMAT_R16_UNORM);
+    dvz_texture_filter(bricks->cache, DVZ_FILTER_MIN, VK_FILTER_LINEAR);
+    dvz_texture_filter(bricks->cache, DVZ_FILTER_MAG, VK_FILTER_LINEAR);
+
+    // Page table texture, initially empty.
+    bricks->page_table = dvz_ctx_texture(ctx, 3, bricks->grid, VK_FORMAT_R8G8B8A8_UINT);
+    bricks->table = calloc(bricks->brick_count, sizeof(cvec4));
+    dvz_upload_texture(
+        canvas, bricks->page_table, DVZ_ZERO_OFFSET, bricks->grid,
+        bricks->brick_count * sizeof(cvec4), bricks->table);
+
+    // Per-brick data.
+    bricks->state = calloc(bricks->brick_count, sizeof(uint8_t));
+    bricks->brick_slot = malloc(bricks->brick_count * sizeof(int32_t));
+    memset(bricks->brick_slot, 0xFF, bricks->brick_count * sizeof(int32_t)); // -1
+    bricks->wanted_epoch = calloc(bricks->brick_count, sizeof(uint32_t));
+
+    // Per-slot data.
+    bricks->slot_brick = malloc(bricks->slot_count * sizeof(int32_t));
+    bricks->lru_prev = malloc(bricks->slot_count * sizeof(int32_t));
+    bricks->lru_next = malloc(bricks->slot_count * sizeof(int32_t));
+    memset(bricks->slot_brick, 0xFF, bricks->slot_count * sizeof(int32_t));
+    memset(bricks->lru_prev, 0xFF, bricks->slot_count * sizeof(int32_t));
+    memset(bricks->lru_next, 0xFF, bricks->slot_count * sizeof(int32_t));
+    bricks->lru_head = -1;
+    bricks->lru_tail = -1;
+
+    // Priorities and request queue.
+    uint32_t K = MIN(bricks->slot_count, bricks->brick_count);
+    bricks->wanted = calloc(K, sizeof(uint32_t));
+    bricks->wanted_dist = calloc(K, sizeof(float));
+    bricks->queue = calloc(K, sizeof(uint32_t));
+
+    // Loader buffers: the uploads of an update go through the canvas transfers, so that the
+    // buffers can only be reused at the next update.
+    bricks->buffer_count = 2 * DVZ_BRICK_UPLOAD_BUDGET;
+    bricks->buffers = calloc(bricks->buffer_count, sizeof(DvzBrickBuffer));
+    for (uint32_t i = 0; i < bricks->buffer_count; i++)
+        bricks->buffers[i].data = malloc(_slot_bytes(bricks));
+
+    // Loader thread.
+    pthread_mutex_init(&bricks->lock, NULL);
+    pthread_cond_init(&bricks->cond, NULL);
+    atomic_init(&bricks->is_running, true);
+    dvz_obj_created(&bricks->obj);
+    bricks->thread = dvz_thread(_bricks_loader, bricks);
+
+    return bricks;
+}
+
+
+
+void dvz_bricks_budget(DvzBricks* bricks, uint32_t budget)
+{
+    ASSERT(bricks != NULL);
+    // NOTE: a brick upload may require two other transfers to update the page table, and the
+    // number of uploads is bounded by the number of loader buffers.
+    bricks->upload_budget = CLIP(budget, 1, bricks->buffer_count);
+}
+
+
+
+void dvz_bricks_visual(DvzBricks* bricks, DvzVisual* visual)
+{
+    ASSERT(bricks != NULL);
+    ASSERT(visual != NULL);
+    ASSERT(visual->graphics_count > 0);
+    if ((visual->graphics[0]->flags & DVZ_GRAPHICS_FLAGS_VOLUME_BRICKED) == 0)
+    {
+        log_error("the volume visual must be created with DVZ_GRAPHICS_FLAGS_VOLUME_BRICKED");
+        return;
+    }
+
+    dvz_visual_texture(visual, DVZ_SOURCE_TYPE_VOLUME, 0, bricks->cache);
+    dvz_visual_texture(visual, DVZ_SOURCE_TYPE_VOLUME, 1, bricks->page_table);
+
+    vec4 shape = {
+        bricks->shape[0], bricks->shape[1], bricks->shape[2], bricks->brick_size};
+    vec4 cache_grid = {bricks->cache_grid[0], bricks->cache_grid[1], bricks->cache_grid[2], 0};
+    dvz_visual_data(visual, DVZ_PROP_LENGTH, 1, 1, shape);
+    dvz_visual_data(visual, DVZ_PROP_LENGTH, 2, 1, cache_grid);
+}
+
+
+
+void dvz_bricks_update(DvzBricks* bricks, vec3 eye)
+{
+    ASSERT(bricks != NULL);
+
+    // The transfers only keep a pointer to the data of the buffers: the buffers are released once
+    // all pending transfers have been processed, usually at the end of the last frame.
+    DvzFifo* transfers = &bricks->canvas->transfers;
+    bool uploaded = dvz_fifo_size(transfers) == 0 && !transfers->is_processing;
+
+    pthread_mutex_lock(&bricks->lock);
+    for (uint32_t i = 0; i < bricks->buffer_count && uploaded; i++)
+        if (bricks->buffers[i].state == DVZ_BRICK_BUFFER_UPLOADING)
+            bricks->buffers[i].state = DVZ_BRICK_BUFFER_FREE;
+    pthread_cond_broadcast(&bricks->cond);
+    pthread_mutex_unlock(&bricks->lock);
+
+    // Recompute the priorities when the eye moves.
+    if (!bricks->has_eye || glm_vec3_distance(eye, bricks->eye) > DVZ_BRICK_PRIORITY_EPSILON)
+        _bricks_prioritize(bricks, eye);
+    _bricks_touch(bricks);
+
+    // Upload the loaded bricks, within the budget.
+    pthread_mutex_lock(&bricks->lock);
+    DvzBrickBuffer* buffer = NULL;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < bricks->buffer_count && n < bricks->upload_budget; i++)
+    {
+        buffer = &bricks->buffers[i];
+        if (buffer->state != DVZ_BRICK_BUFFER_LOADED)
+            continue;
+        // Discard the bricks that were requested before the last priority update and that are
+        // no longer needed.
+        if (bricks->wanted_epoch[buffer->brick_idx] != bricks->epoch)
+        {
+            bricks->state[buffer->brick_idx] = DVZ_BRICK_EMPTY;
+            buffer->state = DVZ_BRICK_BUFFER_FREE;
+            bricks->stats.discards++;
+            continue;
+        }
+        _bricks_upload(bricks, buffer);
+        buffer->state = DVZ_BRICK_BUFFER_UPLOADING;
+        n++;
+    }
+    bricks->stats.resident = bricks->slot_used;
+    pthread_cond_broadcast(&bricks->cond);
+    pthread_mutex_unlock(&bricks->lock);
+}
+
+
+
+void dvz_bricks_wait(DvzBricks* bricks)
+{
+    ASSERT(bricks != NULL);
+
+    pthread_mutex_lock(&bricks->lock);
+    bool busy = true;
+    bool has_free = false;
+    while (busy)
+    {
+        busy = false;
+        has_free = false;
+        for (uint32_t i = 0; i < bricks->buffer_count; i++)
+        {
+            busy |= bricks->buffers[i].state == DVZ_BRICK_BUFFER_LOADING;
+            has_free |= bricks->buffers[i].state == DVZ_BRICK_BUFFER_FREE;
+        }
+        // The loader thread is idle when the queue is empty, or when all buffers are waiting
+        // for the next update.
+        busy |= has_free && bricks->queue_pos < bricks->queue_count;
+        if (busy)
+            pthread_cond_wait(&bricks->cond, &bricks->lock);
+    }
+    pthread_mutex_unlock(&bricks->lock);
+}
+
+
+
+int32_t dvz_bricks_slot(DvzBricks* bricks, uvec3 brick)
+{
+    ASSERT(bricks != NULL);
+    for (uint32_t i = 0; i < 3; i++)
+        if (brick[i] >= bricks->grid[i])
+            return -1;
+    return bricks->brick_slot[_brick_index(bricks->grid, brick)];
+}
+
+
+
+DvzBrickStats dvz_bricks_stats(DvzBricks* bricks)
+{
+    ASSERT(bricks != NULL);
+    pthread_mutex_lock(&bricks->lock);
+    DvzBrickStats stats = bricks->stats;
+    pthread_mutex_unlock(&bricks->lock);
+    return stats;
+}
+
+
+
+void dvz_bricks_destroy(DvzBricks* bricks)
+{
+    if (bricks == NULL || !dvz_obj_is_created(&bricks->obj))
+        return;
+
+    // Stop the loader thread.
+    pthread_mutex_lock(&bricks->lock);
+    atomic_store(&bricks->is_running, false);
+    pthread_cond_broadcast(&bricks->cond);
+    pthread_mutex_unlock(&bricks->lock);
+    dvz_thread_join(&bricks->thread);
+    pthread_cond_destroy(&bricks->cond);
+    pthread_mutex_destroy(&bricks->lock);
+
+    _bricks_close(bricks);
+    dvz_texture_destroy(bricks->cache);
+    dvz_texture_destroy(bricks->page_table);
+
+    for (uint32_t i = 0; i < bricks->buffer_count; i++)
+        FREE(bricks->buffers[i].data);
+    FREE(bricks->buffers);
+    FREE(bricks->queue);
+    FREE(bricks->wanted);
+    FREE(bricks->wanted_dist);
+    FREE(bricks->slot_brick);
+    FREE(bricks->lru_prev);
+    FREE(bricks->lru_next);
+    FREE(bricks->wanted_epoch);
+    FREE(bricks->brick_slot);
+    FREE(bricks->state);
+    FREE(bricks->table);
+
+    dvz_obj_destroyed(&bricks->obj);
+    FREE(bricks);
+}
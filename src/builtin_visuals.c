@@ -12,6 +12,46 @@
 /*************************************************************************************************/
 /*************************************************************************************************/
 
+/*************************************************************************************************/
+/*  Compact and double positions                                                                 */
+/*************************************************************************************************/
+
+// Dtype of the positions in the vertex buffer, depending on the compact position flags. With
+// DVZ_GRAPHICS_FLAGS_POS_SNORM16, the positions normalized with respect to the panel data box are
+// quantized on 16 bits in the prop cast, and dequantized by the vertex fetch unit. With
+// DVZ_GRAPHICS_FLAGS_POS_DOUBLE, the positions relative to the panel origin are split into
+// (hi, lo) float pairs, and normalized in the vertex shader.
+static DvzDataType _pos_dtype(int flags)
+{
+    if ((flags & DVZ_GRAPHICS_FLAGS_POS_DOUBLE) != 0)
+        return DVZ_DTYPE_VEC3_HILO;
+    if ((flags & DVZ_GRAPHICS_FLAGS_POS_SNORM16) != 0)
+        return DVZ_DTYPE_SVEC4;
+    if ((flags & DVZ_GRAPHICS_FLAGS_POS_HALF) != 0)
+        return DVZ_DTYPE_HVEC4;
+    return DVZ_DTYPE_VEC3;
+}
+
+static bool _pos_compact(int flags) { return (flags & DVZ_GRAPHICS_FLAGS_POS_COMPACT) != 0; }
+
+// Size of the DvzVertex, DvzVertexCompact, or DvzVertexDouble vertices.
+static VkDeviceSize _pos_vertex_size(int flags)
+{
+    if ((flags & DVZ_GRAPHICS_FLAGS_POS_DOUBLE) != 0)
+        return sizeof(DvzVertexDouble);
+    return _pos_compact(flags) ? sizeof(DvzVertexCompact) : sizeof(DvzVertex);
+}
+
+// Offset of the color in the DvzVertex, DvzVertexCompact, or DvzVertexDouble vertices.
+static VkDeviceSize _pos_color_offset(int flags)
+{
+    if ((flags & DVZ_GRAPHICS_FLAGS_POS_DOUBLE) != 0)
+        return offsetof(DvzVertexDouble, color);
+    return _pos_compact(flags) ? offsetof(DvzVertexCompact, color) : offsetof(DvzVertex, color);
+}
+
+
+
 /*************************************************************************************************/
 /*  Point                                                                                        */
 /*************************************************************************************************/
@@ -28,7 +68,8 @@ static void _visual_point(DvzVisual* visual)
 
     // Sources
     dvz_visual_source(
-        visual, DVZ_SOURCE_TYPE_VERTEX, 0, DVZ_PIPELINE_GRAPHICS, 0, 0, sizeof(DvzVertex), 0);
+        visual, DVZ_SOURCE_TYPE_VERTEX, 0, DVZ_PIPELINE_GRAPHICS, 0, 0,
+        _pos_vertex_size(visual->flags), 0);
     _common_sources(visual);
     dvz_visual_source(
         visual, DVZ_SOURCE_TYPE_PARAM, 0, DVZ_PIPELINE_GRAPHICS, 0, DVZ_USER_BINDING,
@@ -36,14 +77,13 @@ static void _visual_point(DvzVisual* visual)
 
     // Props:
 
-    // Vertex pos.
+    // Vertex pos (first field of DvzVertex, DvzVertexCompact, and DvzVertexDouble).
     prop = dvz_visual_prop(visual, DVZ_PROP_POS, 0, DVZ_DTYPE_DVEC3, DVZ_SOURCE_TYPE_VERTEX, 0);
-    dvz_visual_prop_cast(
-        prop, 0, offsetof(DvzVertex, pos), DVZ_DTYPE_VEC3, DVZ_ARRAY_COPY_SINGLE, 1);
+    dvz_visual_prop_cast(prop, 0, 0, _pos_dtype(visual->flags), DVZ_ARRAY_COPY_SINGLE, 1);
 
     // Vertex color.
     prop = dvz_visual_prop(visual, DVZ_PROP_COLOR, 0, DVZ_DTYPE_CVEC4, DVZ_SOURCE_TYPE_VERTEX, 0);
-    dvz_visual_prop_copy(prop, 1, offsetof(DvzVertex, color), DVZ_ARRAY_COPY_SINGLE, 1);
+    dvz_visual_prop_copy(prop, 1, _pos_color_offset(visual->flags), DVZ_ARRAY_COPY_SINGLE, 1);
     cvec4 color = {200, 200, 200, 255};
     dvz_visual_prop_default(prop, &color);
 
@@ -62,6 +102,72 @@ static void _visual_point(DvzVisual* visual)
 
 
 
+static void _visual_point_cmap(DvzVisual* visual)
+{
+    ASSERT(visual != NULL);
+    DvzCanvas* canvas = visual->canvas;
+    ASSERT(canvas != NULL);
+    DvzProp* prop = NULL;
+
+    // Graphics.
+    int flags = visual->flags & DVZ_GRAPHICS_FLAGS_DEPTH_TEST_ENABLE;
+    dvz_visual_graphics(visual, dvz_graphics_builtin(canvas, DVZ_GRAPHICS_POINT_CMAP, flags));
+
+    // Sources
+    dvz_visual_source(
+        visual, DVZ_SOURCE_TYPE_VERTEX, 0, DVZ_PIPELINE_GRAPHICS, 0, 0,
+        sizeof(DvzGraphicsPointCmapVertex), 0);
+    _common_sources(visual);
+    dvz_visual_source(
+        visual, DVZ_SOURCE_TYPE_PARAM, 0, DVZ_PIPELINE_GRAPHICS, 0, DVZ_USER_BINDING,
+        sizeof(DvzGraphicsPointCmapParams), 0);
+    dvz_visual_source(
+        visual, DVZ_SOURCE_TYPE_COLOR_TEXTURE, 0, DVZ_PIPELINE_GRAPHICS, 0, DVZ_USER_BINDING + 1,
+        sizeof(uint8_t), 0);
+
+    // Props:
+
+    // Vertex pos.
+    prop = dvz_visual_prop(visual, DVZ_PROP_POS, 0, DVZ_DTYPE_DVEC3, DVZ_SOURCE_TYPE_VERTEX, 0);
+    dvz_visual_prop_cast(
+        prop, 0, offsetof(DvzGraphicsPointCmapVertex, pos), DVZ_DTYPE_VEC3,
+        DVZ_ARRAY_COPY_SINGLE, 1);
+
+    // Vertex value.
+    prop = dvz_visual_prop(visual, DVZ_PROP_VALUE, 0, DVZ_DTYPE_FLOAT, DVZ_SOURCE_TYPE_VERTEX, 0);
+    dvz_visual_prop_copy(
+        prop, 1, offsetof(DvzGraphicsPointCmapVertex, value), DVZ_ARRAY_COPY_SINGLE, 1);
+
+    // Common props.
+    _common_props(visual);
+
+    // Params.
+
+    // Range.
+    prop = dvz_visual_prop(visual, DVZ_PROP_RANGE, 0, DVZ_DTYPE_VEC2, DVZ_SOURCE_TYPE_PARAM, 0);
+    dvz_visual_prop_copy(
+        prop, 0, offsetof(DvzGraphicsPointCmapParams, vrange), DVZ_ARRAY_COPY_SINGLE, 1);
+    dvz_visual_prop_default(prop, (vec2){0, 1});
+
+    // Colormap value.
+    prop = dvz_visual_prop(visual, DVZ_PROP_COLORMAP, 0, DVZ_DTYPE_INT, DVZ_SOURCE_TYPE_PARAM, 0);
+    dvz_visual_prop_copy(
+        prop, 1, offsetof(DvzGraphicsPointCmapParams, cmap), DVZ_ARRAY_COPY_SINGLE, 1);
+    DvzColormap cmap = DVZ_CMAP_VIRIDIS;
+    dvz_visual_prop_default(prop, &cmap);
+
+    // Marker size.
+    prop = dvz_visual_prop(
+        visual, DVZ_PROP_MARKER_SIZE, 0, DVZ_DTYPE_FLOAT, DVZ_SOURCE_TYPE_PARAM, 0);
+    dvz_visual_prop_copy(
+        prop, 2, offsetof(DvzGraphicsPointCmapParams, point_size), DVZ_ARRAY_COPY_SINGLE, 1);
+    dvz_visual_prop_dpi(prop, canvas->dpi_scaling);
+    float size = 5;
+    dvz_visual_prop_default(prop, &size);
+}
+
+
+
 /*************************************************************************************************/
 /*  Line                                                                                         */
 /*************************************************************************************************/
@@ -73,31 +179,33 @@ static void _visual_line(DvzVisual* visual)
     ASSERT(canvas != NULL);
     DvzProp* prop = NULL;
 
+    int flags = visual->flags & (DVZ_GRAPHICS_FLAGS_POS_COMPACT | DVZ_GRAPHICS_FLAGS_POS_DOUBLE);
+    VkDeviceSize item_size = _pos_vertex_size(flags);
+
     // Graphics.
-    dvz_visual_graphics(visual, dvz_graphics_builtin(canvas, DVZ_GRAPHICS_LINE, 0));
+    dvz_visual_graphics(visual, dvz_graphics_builtin(canvas, DVZ_GRAPHICS_LINE, flags));
 
     // Sources
     dvz_visual_source(
-        visual, DVZ_SOURCE_TYPE_VERTEX, 0, DVZ_PIPELINE_GRAPHICS, 0, 0, sizeof(DvzVertex), 0);
+        visual, DVZ_SOURCE_TYPE_VERTEX, 0, DVZ_PIPELINE_GRAPHICS, 0, 0, item_size, 0);
     _common_sources(visual);
 
     // Props:
 
+    // NOTE: the position is the first field of DvzVertex, DvzVertexCompact, and DvzVertexDouble.
+
     // Vertex pos, segment start.
     prop = dvz_visual_prop(visual, DVZ_PROP_POS, 0, DVZ_DTYPE_DVEC3, DVZ_SOURCE_TYPE_VERTEX, 0);
-    dvz_visual_prop_cast(
-        prop, 0, offsetof(DvzVertex, pos), DVZ_DTYPE_VEC3, DVZ_ARRAY_COPY_SINGLE, 2);
+    dvz_visual_prop_cast(prop, 0, 0, _pos_dtype(flags), DVZ_ARRAY_COPY_SINGLE, 2);
 
     // Vertex pos, segment end.
     prop = dvz_visual_prop(visual, DVZ_PROP_POS, 1, DVZ_DTYPE_DVEC3, DVZ_SOURCE_TYPE_VERTEX, 0);
-    dvz_visual_prop_cast(
-        prop, 0, sizeof(DvzVertex) + offsetof(DvzVertex, pos), DVZ_DTYPE_VEC3,
-        DVZ_ARRAY_COPY_SINGLE, 2);
+    dvz_visual_prop_cast(prop, 0, item_size, _pos_dtype(flags), DVZ_ARRAY_COPY_SINGLE, 2);
 
 
     // Vertex color.
     prop = dvz_visual_prop(visual, DVZ_PROP_COLOR, 0, DVZ_DTYPE_CVEC4, DVZ_SOURCE_TYPE_VERTEX, 0);
-    dvz_visual_prop_copy(prop, 1, offsetof(DvzVertex, color), DVZ_ARRAY_COPY_REPEAT, 2);
+    dvz_visual_prop_copy(prop, 1, _pos_color_offset(flags), DVZ_ARRAY_COPY_REPEAT, 2);
 
     // Common props.
     _common_props(visual);
@@ -204,24 +312,26 @@ static void _visual_line_strip(DvzVisual* visual)
     ASSERT(canvas != NULL);
     DvzProp* prop = NULL;
 
+    int flags = visual->flags & DVZ_GRAPHICS_FLAGS_POS_DOUBLE;
+
     // Graphics.
-    dvz_visual_graphics(visual, dvz_graphics_builtin(canvas, DVZ_GRAPHICS_LINE_STRIP, 0));
+    dvz_visual_graphics(visual, dvz_graphics_builtin(canvas, DVZ_GRAPHICS_LINE_STRIP, flags));
 
     // Sources
     dvz_visual_source(
-        visual, DVZ_SOURCE_TYPE_VERTEX, 0, DVZ_PIPELINE_GRAPHICS, 0, 0, sizeof(DvzVertex), 0);
+        visual, DVZ_SOURCE_TYPE_VERTEX, 0, DVZ_PIPELINE_GRAPHICS, 0, 0, _pos_vertex_size(flags),
+        0);
     _common_sources(visual);
 
     // Props:
 
     // Vertex pos.
     prop = dvz_visual_prop(visual, DVZ_PROP_POS, 0, DVZ_DTYPE_DVEC3, DVZ_SOURCE_TYPE_VERTEX, 0);
-    dvz_visual_prop_cast(
-        prop, 0, offsetof(DvzVertex, pos), DVZ_DTYPE_VEC3, DVZ_ARRAY_COPY_SINGLE, 1);
+    dvz_visual_prop_cast(prop, 0, 0, _pos_dtype(flags), DVZ_ARRAY_COPY_SINGLE, 1);
 
     // Vertex color.
     prop = dvz_visual_prop(visual, DVZ_PROP_COLOR, 0, DVZ_DTYPE_CVEC4, DVZ_SOURCE_TYPE_VERTEX, 0);
-    dvz_visual_prop_copy(prop, 1, offsetof(DvzVertex, color), DVZ_ARRAY_COPY_SINGLE, 1);
+    dvz_visual_prop_copy(prop, 1, _pos_color_offset(flags), DVZ_ARRAY_COPY_SINGLE, 1);
 
     // Line strip length.
     prop = dvz_visual_prop(visual, DVZ_PROP_LENGTH, 0, DVZ_DTYPE_UINT, DVZ_SOURCE_TYPE_NONE, 0);
@@ -360,12 +470,17 @@ static void _visual_triangle_fan(DvzVisual* visual)
 /*  Marker                                                                                       */
 /*************************************************************************************************/
 
+// Offset of a field in the regular or compact marker vertex.
+#define MARKER_OFFSET(f)                                                                          \
+    (compact ? offsetof(DvzGraphicsMarkerCompactVertex, f) : offsetof(DvzGraphicsMarkerVertex, f))
+
 static void _visual_marker(DvzVisual* visual)
 {
     ASSERT(visual != NULL);
     DvzCanvas* canvas = visual->canvas;
     ASSERT(canvas != NULL);
     DvzProp* prop = NULL;
+    bool compact = _pos_compact(visual->flags);
 
     // Graphics.
     dvz_visual_graphics(visual, dvz_graphics_builtin(canvas, DVZ_GRAPHICS_MARKER, visual->flags));
@@ -374,7 +489,7 @@ static void _visual_marker(DvzVisual* visual)
     // Sources
     dvz_visual_source(
         visual, DVZ_SOURCE_TYPE_VERTEX, 0, DVZ_PIPELINE_GRAPHICS, 0, 0,
-        sizeof(DvzGraphicsMarkerVertex), 0);
+        compact ? sizeof(DvzGraphicsMarkerCompactVertex) : sizeof(DvzGraphicsMarkerVertex), 0);
     _common_sources(visual);
     dvz_visual_source(
         visual, DVZ_SOURCE_TYPE_PARAM, 0, DVZ_PIPELINE_GRAPHICS, 0, DVZ_USER_BINDING,
@@ -385,20 +500,21 @@ static void _visual_marker(DvzVisual* visual)
     // Marker pos.
     prop = dvz_visual_prop(visual, DVZ_PROP_POS, 0, DVZ_DTYPE_DVEC3, DVZ_SOURCE_TYPE_VERTEX, 0);
     dvz_visual_prop_cast(
-        prop, 0, offsetof(DvzGraphicsMarkerVertex, pos), DVZ_DTYPE_VEC3, DVZ_ARRAY_COPY_SINGLE, 1);
+        prop, 0, MARKER_OFFSET(pos), _pos_dtype(visual->flags), DVZ_ARRAY_COPY_SINGLE, 1);
 
     // Marker color.
     prop = dvz_visual_prop(visual, DVZ_PROP_COLOR, 0, DVZ_DTYPE_CVEC4, DVZ_SOURCE_TYPE_VERTEX, 0);
-    dvz_visual_prop_copy(
-        prop, 1, offsetof(DvzGraphicsMarkerVertex, color), DVZ_ARRAY_COPY_SINGLE, 1);
+    dvz_visual_prop_copy(prop, 1, MARKER_OFFSET(color), DVZ_ARRAY_COPY_SINGLE, 1);
     cvec4 color = {200, 200, 200, 255};
     dvz_visual_prop_default(prop, &color);
 
     // Marker size.
     prop = dvz_visual_prop(
         visual, DVZ_PROP_MARKER_SIZE, 0, DVZ_DTYPE_FLOAT, DVZ_SOURCE_TYPE_VERTEX, 0);
-    dvz_visual_prop_copy(
-        prop, 1, offsetof(DvzGraphicsMarkerVertex, size), DVZ_ARRAY_COPY_SINGLE, 1);
+    // NOTE: compact marker sizes are rounded and clamped to [0, 255] pixels in the prop cast.
+    dvz_visual_prop_cast(
+        prop, 1, MARKER_OFFSET(size), compact ? DVZ_DTYPE_CHAR : DVZ_DTYPE_FLOAT,
+        DVZ_ARRAY_COPY_SINGLE, 1);
     dvz_visual_prop_dpi(prop, canvas->dpi_scaling);
     float size = 20;
     dvz_visual_prop_default(prop, &size);
@@ -406,23 +522,20 @@ static void _visual_marker(DvzVisual* visual)
     // Marker type.
     prop = dvz_visual_prop(
         visual, DVZ_PROP_MARKER_TYPE, 0, DVZ_DTYPE_CHAR, DVZ_SOURCE_TYPE_VERTEX, 0);
-    dvz_visual_prop_copy(
-        prop, 1, offsetof(DvzGraphicsMarkerVertex, marker), DVZ_ARRAY_COPY_SINGLE, 1);
+    dvz_visual_prop_copy(prop, 1, MARKER_OFFSET(marker), DVZ_ARRAY_COPY_SINGLE, 1);
     DvzMarkerType marker = DVZ_MARKER_DISC;
     dvz_visual_prop_default(prop, &marker);
 
     // Marker angle.
     prop = dvz_visual_prop(visual, DVZ_PROP_ANGLE, 0, DVZ_DTYPE_CHAR, DVZ_SOURCE_TYPE_VERTEX, 0);
-    dvz_visual_prop_copy(
-        prop, 1, offsetof(DvzGraphicsMarkerVertex, angle), DVZ_ARRAY_COPY_SINGLE, 1);
+    dvz_visual_prop_copy(prop, 1, MARKER_OFFSET(angle), DVZ_ARRAY_COPY_SINGLE, 1);
     float angle = 0;
     dvz_visual_prop_default(prop, &angle);
 
     // Marker transform.
     prop =
         dvz_visual_prop(visual, DVZ_PROP_TRANSFORM, 0, DVZ_DTYPE_CHAR, DVZ_SOURCE_TYPE_VERTEX, 0);
-    dvz_visual_prop_copy(
-        prop, 1, offsetof(DvzGraphicsMarkerVertex, transform), DVZ_ARRAY_COPY_SINGLE, 1);
+    dvz_visual_prop_copy(prop, 1, MARKER_OFFSET(transform), DVZ_ARRAY_COPY_SINGLE, 1);
 
     // Common props.
     _common_props(visual);
@@ -601,6 +714,67 @@ static void _visual_polygon(DvzVisual* visual)
 /*  Path                                                                                         */
 /*************************************************************************************************/
 
+static inline void
+_path_compact_point(DvzGraphicsPathCompactVertex* vertex, const dvec3* point, const cvec4 color)
+{
+    _vec3_cast(point, &vertex->pos);
+    if (color != NULL)
+        memcpy(vertex->color, color, sizeof(cvec4));
+    else
+        memset(vertex->color, 0, sizeof(cvec4));
+}
+
+// Compact path: every point is stored once, plus 3 transparent padding points per path.
+static void _path_bake_compact(
+    DvzArray* arr_vertex, DvzArray* arr_pos, DvzArray* arr_color, DvzArray* arr_length,
+    DvzArray* arr_topology)
+{
+    ASSERT(arr_vertex != NULL);
+    ASSERT(arr_vertex->item_size == sizeof(DvzGraphicsPathCompactVertex));
+
+    uint32_t n_points = arr_pos->item_count;
+    uint32_t n_paths = MAX(1, arr_length->item_count);
+    dvz_array_resize(arr_vertex, n_points + 3 * n_paths);
+
+    DvzGraphicsPathCompactVertex* vertex = (DvzGraphicsPathCompactVertex*)arr_vertex->data;
+    const dvec3* points = (const dvec3*)arr_pos->data;
+    const cvec4* colors = (const cvec4*)arr_color->data;
+    uint32_t n_colors = arr_color->item_count;
+    ASSERT(n_colors > 0);
+
+    uint32_t* path_length = NULL;
+    int32_t* is_closed = NULL;
+    uint32_t path_size = 0;
+    bool closed = false;
+    uint32_t idx = 0; // index of the first point in the current path
+    for (uint32_t i = 0; i < n_paths; i++)
+    {
+        path_length = dvz_array_item(arr_length, i);
+        path_size = path_length != NULL ? *path_length : n_points;
+        ASSERT(path_size > 0);
+        ASSERT(idx + path_size <= n_points);
+        is_closed = dvz_array_item(arr_topology, i);
+        closed = is_closed != NULL ? *is_closed : false;
+        ASSERT(!closed || path_size >= 2);
+
+        // Leading padding point: the point before the first point, which is the last point of a
+        // closed path.
+        _path_compact_point(vertex++, &points[idx + (closed ? path_size - 1 : 0)], NULL);
+
+        // Path points.
+        for (uint32_t j = 0; j < path_size; j++)
+            _path_compact_point(vertex++, &points[idx + j], colors[MIN(idx + j, n_colors - 1)]);
+
+        // Trailing padding points: the 2 points after the last point.
+        _path_compact_point(vertex++, &points[idx + (closed ? 0 : path_size - 1)], NULL);
+        _path_compact_point(
+            vertex++, &points[idx + (closed ? MIN(1, path_size - 1) : path_size - 1)], NULL);
+
+        idx += path_size;
+    }
+    ASSERT(idx == n_points);
+}
+
 static void _path_bake(DvzVisual* visual, DvzVisualDataEvent ev)
 {
     ASSERT(visual != NULL);
@@ -643,6 +817,12 @@ static void _path_bake(DvzVisual* visual, DvzVisualDataEvent ev)
     ASSERT(n_points > 0);
     ASSERT(n_paths > 0);
 
+    if ((visual->flags & DVZ_GRAPHICS_FLAGS_PATH_COMPACT) != 0)
+    {
+        _path_bake_compact(arr_vertex, arr_pos, arr_color, arr_length, arr_topology);
+        return;
+    }
+
     dvec3* point = NULL;
     cvec4* color = NULL;
     uint32_t* path_length = NULL;
@@ -760,12 +940,13 @@ static void _visual_path(DvzVisual* visual)
     DvzProp* prop = NULL;
 
     // Graphics.
-    dvz_visual_graphics(visual, dvz_graphics_builtin(canvas, DVZ_GRAPHICS_PATH, 0));
+    int flags = visual->flags & DVZ_GRAPHICS_FLAGS_PATH_COMPACT;
+    dvz_visual_graphics(visual, dvz_graphics_builtin(canvas, DVZ_GRAPHICS_PATH, flags));
 
     // Sources
     dvz_visual_source(
         visual, DVZ_SOURCE_TYPE_VERTEX, 0, DVZ_PIPELINE_GRAPHICS, 0, 0,
-        sizeof(DvzGraphicsPathVertex), 0);
+        flags != 0 ? sizeof(DvzGraphicsPathCompactVertex) : sizeof(DvzGraphicsPathVertex), 0);
 
     _common_sources(visual);
 
@@ -1011,6 +1192,57 @@ static void _visual_image_cmap(DvzVisual* visual)
 
 
 
+/*************************************************************************************************/
+/*  Histogram                                                                                    */
+/*************************************************************************************************/
+
+// The bar vertices are written on the GPU by a histogram, see histogram.h, so the number of
+// vertices is given by the size of the bound vertex buffer region.
+static void _visual_histogram_fill(DvzVisual* visual, DvzVisualFillEvent ev)
+{
+    ASSERT(visual != NULL);
+    DvzSource* source = dvz_source_get(visual, DVZ_SOURCE_TYPE_VERTEX, 0);
+    ASSERT(source != NULL);
+    if (source->origin != DVZ_SOURCE_ORIGIN_USER || source->u.br.buffer == NULL)
+    {
+        log_warn("skip the histogram visual as it is not bound to a histogram");
+        return;
+    }
+
+    DvzGraphics* graphics = visual->graphics[0];
+    DvzBindings* bindings = dvz_container_get(&visual->bindings, 0);
+    ASSERT(dvz_obj_is_created(&bindings->obj));
+    uint32_t vertex_count = (uint32_t)(source->u.br.size / sizeof(DvzVertex));
+    log_debug("draw %d histogram vertices", vertex_count);
+
+    dvz_cmd_bind_vertex_buffers(ev.cmds, ev.cmd_idx, graphics, source->u.br, 0);
+    dvz_cmd_bind_graphics(ev.cmds, ev.cmd_idx, graphics, bindings, 0);
+    dvz_cmd_draw(ev.cmds, ev.cmd_idx, 0, vertex_count);
+}
+
+static void _visual_histogram(DvzVisual* visual)
+{
+    ASSERT(visual != NULL);
+    DvzCanvas* canvas = visual->canvas;
+    ASSERT(canvas != NULL);
+
+    // Graphics.
+    dvz_visual_graphics(visual, dvz_graphics_builtin(canvas, DVZ_GRAPHICS_TRIANGLE, 0));
+
+    // Sources: the vertex buffer is bound by dvz_histogram_visual().
+    dvz_visual_source(
+        visual, DVZ_SOURCE_TYPE_VERTEX, 0, DVZ_PIPELINE_GRAPHICS, 0, 0, sizeof(DvzVertex), 0);
+    _common_sources(visual);
+
+    // Common props.
+    _common_props(visual);
+
+    // Fill callback.
+    dvz_visual_fill_callback(visual, _visual_histogram_fill);
+}
+
+
+
 /*************************************************************************************************/
 /*  Axes 2D                                                                                      */
 /*************************************************************************************************/
@@ -1663,8 +1895,14 @@ static void _visual_volume(DvzVisual* visual)
     ASSERT(canvas != NULL);
     DvzProp* prop = NULL;
 
+    // Bricked volumes are sampled through a page table, see bricks.h.
+    bool bricked = (visual->flags & DVZ_GRAPHICS_FLAGS_VOLUME_BRICKED) != 0;
+    int flags = bricked ? DVZ_GRAPHICS_FLAGS_VOLUME_BRICKED : 0;
+    VkDeviceSize params_size =
+        bricked ? sizeof(DvzGraphicsVolumeBrickedParams) : sizeof(DvzGraphicsVolumeParams);
+
     // Graphics.
-    dvz_visual_graphics(visual, dvz_graphics_builtin(canvas, DVZ_GRAPHICS_VOLUME, 0));
+    dvz_visual_graphics(visual, dvz_graphics_builtin(canvas, DVZ_GRAPHICS_VOLUME, flags));
 
     // Sources
     dvz_visual_source(                                               // vertex buffer
@@ -1675,7 +1913,7 @@ static void _visual_volume(DvzVisual* visual)
 
     dvz_visual_source(                                              // params
         visual, DVZ_SOURCE_TYPE_PARAM, 0, DVZ_PIPELINE_GRAPHICS, 0, //
-        DVZ_USER_BINDING, sizeof(DvzGraphicsVolumeParams), 0);      //
+        DVZ_USER_BINDING, params_size, 0);                          //
 
     dvz_visual_source(                                                      // colormap texture
         visual, DVZ_SOURCE_TYPE_COLOR_TEXTURE, 0, DVZ_PIPELINE_GRAPHICS, 0, //
@@ -1687,6 +1925,11 @@ static void _visual_volume(DvzVisual* visual)
         visual, DVZ_SOURCE_TYPE_VOLUME, 0, DVZ_PIPELINE_GRAPHICS, 0, //
         DVZ_USER_BINDING + 2, sizeof(uint16_t), 0);                  //
 
+    if (bricked)
+        dvz_visual_source(                                               // page table
+            visual, DVZ_SOURCE_TYPE_VOLUME, 1, DVZ_PIPELINE_GRAPHICS, 0, //
+            DVZ_USER_BINDING + 3, sizeof(cvec4), 0);                     //
+
     // Props:
 
     // Point positions.
@@ -1722,11 +1965,32 @@ static void _visual_volume(DvzVisual* visual)
 
     // Colormap value.
     prop = dvz_visual_prop(visual, DVZ_PROP_COLORMAP, 0, DVZ_DTYPE_INT, DVZ_SOURCE_TYPE_PARAM, 0);
-    dvz_visual_prop_copy(
-        prop, 2, offsetof(DvzGraphicsVolumeParams, cmap), DVZ_ARRAY_COPY_SINGLE, 1);
+    if (!bricked)
+        dvz_visual_prop_copy(
+            prop, 2, offsetof(DvzGraphicsVolumeParams, cmap), DVZ_ARRAY_COPY_SINGLE, 1);
+    else
+        dvz_visual_prop_copy(
+            prop, 4, offsetof(DvzGraphicsVolumeBrickedParams, cmap), DVZ_ARRAY_COPY_SINGLE, 1);
     DvzColormap cmap = DVZ_CMAP_BINARY;
     dvz_visual_prop_default(prop, &cmap);
 
+    if (bricked)
+    {
+        // Volume shape and brick size, set by dvz_bricks_visual().
+        prop = dvz_visual_prop(
+            visual, DVZ_PROP_LENGTH, 1, DVZ_DTYPE_VEC4, DVZ_SOURCE_TYPE_PARAM, 0);
+        dvz_visual_prop_copy(
+            prop, 2, offsetof(DvzGraphicsVolumeBrickedParams, shape), DVZ_ARRAY_COPY_SINGLE, 1);
+        dvz_visual_prop_default(prop, (vec4){1, 1, 1, 1});
+
+        // Cache grid and apron.
+        prop = dvz_visual_prop(
+            visual, DVZ_PROP_LENGTH, 2, DVZ_DTYPE_VEC4, DVZ_SOURCE_TYPE_PARAM, 0);
+        dvz_visual_prop_copy(
+            prop, 3, offsetof(DvzGraphicsVolumeBrickedParams, cache), DVZ_ARRAY_COPY_SINGLE, 1);
+        dvz_visual_prop_default(prop, (vec4){1, 1, 1, 0});
+    }
+
 
     // // Colormap texture prop.
     // dvz_visual_prop(
@@ -1923,6 +2187,10 @@ void dvz_visual_builtin(DvzVisual* visual, DvzVisualType type, int flags)
         _visual_point(visual);
         break;
 
+    case DVZ_VISUAL_POINT_CMAP:
+        _visual_point_cmap(visual);
+        break;
+
     case DVZ_VISUAL_LINE:
         _visual_line(visual);
         break;
@@ -1965,6 +2233,10 @@ void dvz_visual_builtin(DvzVisual* visual, DvzVisualType type, int flags)
         _visual_image_cmap(visual);
         break;
 
+    case DVZ_VISUAL_HISTOGRAM:
+        _visual_histogram(visual);
+        break;
+
     case DVZ_VISUAL_AXES_2D:
         _visual_axes_2D(visual);
         break;
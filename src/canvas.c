@@ -3,6 +3,7 @@
 #include "../include/datoviz/context.h"
 #include "../include/datoviz/controls.h"
 #include "../include/datoviz/gui.h"
+#include "../include/datoviz/replay.h"
 #include "../include/datoviz/vklite.h"
 #include "../src/canvas_utils.h"
 #include "../src/vklite_utils.h"
@@ -200,6 +201,20 @@ static void _glfw_move_callback(GLFWwindow* window, double xpos, double ypos)
     dvz_event_mouse_move(canvas, (vec2){xpos, ypos}, canvas->mouse.modifiers);
 }
 
+static void _glfw_refresh_callback(GLFWwindow* window)
+{
+    DvzCanvas* canvas = (DvzCanvas*)glfwGetWindowUserPointer(window);
+    ASSERT(canvas != NULL);
+
+    // The window contents were damaged, for example after a resize or when it was uncovered.
+    dvz_canvas_request_frame(canvas);
+}
+
+static void _glfw_framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+    _glfw_refresh_callback(window);
+}
+
 static void _glfw_frame_callback(DvzCanvas* canvas, DvzEvent ev)
 {
     ASSERT(canvas != NULL);
@@ -265,6 +280,10 @@ static void backend_event_callbacks(DvzCanvas* canvas)
         // Register the mouse move callback.
         // glfwSetCursorPosCallback(w, _glfw_move_callback);
 
+        // Register the damage callbacks, used by the canvases rendering on demand.
+        glfwSetWindowRefreshCallback(w, _glfw_refresh_callback);
+        glfwSetFramebufferSizeCallback(w, _glfw_framebuffer_size_callback);
+
         // Register a function called at every frame, after event polling and state update
         dvz_event_callback(
             canvas, DVZ_EVENT_INTERACT, 0, DVZ_EVENT_MODE_SYNC, _glfw_frame_callback, NULL);
@@ -542,6 +561,7 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
             dvz_container(DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzCanvas), DVZ_OBJECT_TYPE_CANVAS);
     }
 
+    uint64_t t_canvas = _trace_now(&app->startup);
     DvzCanvas* canvas = dvz_container_alloc(&app->canvases);
     canvas->app = app;
     canvas->gpu = gpu;
@@ -554,6 +574,7 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
 
     canvas->overlay = overlay;
     canvas->flags = flags;
+    canvas->on_demand = (flags & DVZ_CANVAS_FLAGS_ON_DEMAND) > 0;
     bool show_fps = ((canvas->flags >> 1) & DVZ_CANVAS_FLAGS_FPS) != 0;
 
     // Initialize the canvas local clock.
@@ -562,6 +583,7 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
     // Initialize the atomic variables used to communicate state changes from a background thread
     // to the main thread (REFILL or CLOSE events).
     atomic_init(&canvas->to_close, false);
+    atomic_init(&canvas->dirty, true);
     atomic_init(&canvas->refills.status, DVZ_REFILL_NONE);
 
     // Allocate memory for canvas objects.
@@ -574,7 +596,9 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
     DvzWindow* window = NULL;
     if (!offscreen)
     {
+        uint64_t t = _trace_now(&app->startup);
         window = dvz_window(app, width, height);
+        _trace_phase(&app->startup, "window", t);
         ASSERT(window->app == app);
         ASSERT(window->app != NULL);
         canvas->window = window;
@@ -724,8 +748,10 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
     {
         canvas->fps = 60;
         // Compute FPS every 250 ms, even if FPS is not shown (so that the value remains accessible
-        // in callbacks if needed).
-        dvz_event_callback(canvas, DVZ_EVENT_TIMER, .25, DVZ_EVENT_MODE_SYNC, _fps, NULL);
+        // in callbacks if needed). This TIMER would wake up canvases rendering on demand, so it is
+        // only registered for them if FPS is shown.
+        if (!canvas->on_demand || show_fps)
+            dvz_event_callback(canvas, DVZ_EVENT_TIMER, .25, DVZ_EVENT_MODE_SYNC, _fps, NULL);
 
         if (show_fps)
             dvz_event_callback(
@@ -733,6 +759,7 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
     }
 
     ASSERT(canvas->swapchain.images != NULL);
+    _trace_phase(&app->startup, "canvas", t_canvas);
     log_debug(
         "created canvas of size %dx%d", //
         canvas->swapchain.images->width, canvas->swapchain.images->height);
@@ -1011,6 +1038,7 @@ void dvz_canvas_to_refill(DvzCanvas* canvas)
     ASSERT(canvas != NULL);
     DvzRefillStatus status = DVZ_REFILL_REQUESTED;
     atomic_store(&canvas->refills.status, status);
+    dvz_app_wakeup(canvas->app);
 }
 
 
@@ -1020,6 +1048,17 @@ void dvz_canvas_to_close(DvzCanvas* canvas)
     ASSERT(canvas != NULL);
     bool value = true;
     atomic_store(&canvas->to_close, value);
+    dvz_app_wakeup(canvas->app);
+}
+
+
+
+void dvz_canvas_request_frame(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    bool value = true;
+    atomic_store(&canvas->dirty, value);
+    dvz_app_wakeup(canvas->app);
 }
 
 
@@ -1331,9 +1370,11 @@ void dvz_event_mouse_move(DvzCanvas* canvas, vec2 pos, int modifiers)
     event.u.m.pos[0] = pos[0];
     event.u.m.pos[1] = pos[1];
     event.u.m.modifiers = modifiers;
+    event.u.m.count = 1;
 
     // Update the mouse state.
     dvz_mouse_event(&canvas->mouse, canvas, event);
+    glm_vec2_sub(canvas->mouse.cur_pos, canvas->mouse.last_pos, event.u.m.delta);
 
     _event_produce(canvas, event);
 }
@@ -1351,6 +1392,7 @@ void dvz_event_mouse_wheel(DvzCanvas* canvas, vec2 dir, int modifiers)
     event.u.w.dir[0] = dir[0];
     event.u.w.dir[1] = dir[1];
     event.u.w.modifiers = modifiers;
+    event.u.w.count = 1;
 
     // Update the mouse state.
     dvz_mouse_event(&canvas->mouse, canvas, event);
@@ -1955,6 +1997,131 @@ void dvz_canvas_stop(DvzCanvas* canvas)
 
 
 
+/*************************************************************************************************/
+/*  On-demand rendering                                                                          */
+/*************************************************************************************************/
+
+// Whether a canvas rendering on demand needs a new frame. Also update the timeout, in seconds,
+// with the delay until its next TIMER event (a negative timeout means no timeout).
+static bool _canvas_damaged(DvzCanvas* canvas, double* timeout)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(timeout != NULL);
+
+    // Explicit requests, pending refills and transfers, and close requests.
+    if (canvas->frame_idx == 0 || atomic_load(&canvas->dirty) || atomic_load(&canvas->to_close) ||
+        atomic_load(&canvas->refills.status) != DVZ_REFILL_NONE ||
+        dvz_fifo_size(&canvas->transfers) > 0 || canvas->stream_count > 0)
+        return true;
+
+    // Window events without a callback: close requests and mouse moves, the latter being detected
+    // in the INTERACT callback at every frame.
+    if (canvas->window != NULL)
+    {
+        if (backend_window_should_close(canvas->app->backend, canvas->window->backend_window))
+            return true;
+        if (canvas->app->backend == DVZ_BACKEND_GLFW)
+        {
+            double xpos, ypos;
+            glfwGetCursorPos(canvas->window->backend_window, &xpos, &ypos);
+            if (canvas->mouse.cur_pos[0] != (float)xpos || canvas->mouse.cur_pos[1] != (float)ypos)
+                return true;
+        }
+    }
+
+    // TIMER events: the canvas is damaged as soon as one of them is due.
+    double now = _clock_get(&canvas->clock);
+    double delay = 0;
+    DvzEventCallbackRegister* r = NULL;
+    for (uint32_t i = 0; i < canvas->callbacks_count; i++)
+    {
+        r = &canvas->callbacks[i];
+        if (r->type != DVZ_EVENT_TIMER)
+            continue;
+        delay = (r->idx + 1) * r->param - now;
+        if (delay <= 0)
+            return true;
+        *timeout = *timeout < 0 ? delay : MIN(*timeout, delay);
+    }
+    return false;
+}
+
+
+
+// Whether at least one canvas needs a new frame, and the maximum time to wait otherwise.
+static bool _app_damaged(DvzApp* app, double* timeout)
+{
+    ASSERT(app != NULL);
+    ASSERT(timeout != NULL);
+    *timeout = -1;
+
+    DvzContainerIterator iterator = dvz_container_iterator(&app->canvases);
+    DvzCanvas* canvas = NULL;
+    while (iterator.item != NULL)
+    {
+        canvas = (DvzCanvas*)iterator.item;
+        if (canvas->obj.status >= DVZ_OBJECT_STATUS_CREATED &&
+            (!canvas->on_demand || _canvas_damaged(canvas, timeout)))
+            return true;
+        dvz_container_iter(&iterator);
+    }
+    return false;
+}
+
+
+
+// Block until an input event, a TIMER event, or a call to dvz_app_wakeup().
+static void _app_wait(DvzApp* app)
+{
+    ASSERT(app != NULL);
+    double timeout = -1;
+
+    // Announce the wait before checking the canvases one last time, so that a canvas marked as
+    // dirty by another thread in the meantime either is seen here, or wakes up the wait.
+    pthread_mutex_lock(&app->wait_lock);
+    app->wakeup = false;
+    pthread_mutex_unlock(&app->wait_lock);
+    bool value = true;
+    atomic_store(&app->is_waiting, value);
+
+    if (!_app_damaged(app, &timeout))
+    {
+        log_trace("all canvases are idle, waiting for events (timeout %.3f s)", timeout);
+        if (app->backend == DVZ_BACKEND_GLFW)
+        {
+            backend_wait_events(app->backend, timeout);
+        }
+        else
+        {
+            struct timespec deadline = {0};
+            if (timeout >= 0)
+            {
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                uint64_t ns = (uint64_t)deadline.tv_nsec + (uint64_t)(timeout * 1e9);
+                deadline.tv_sec += (time_t)(ns / 1000000000);
+                deadline.tv_nsec = (long)(ns % 1000000000);
+            }
+
+            pthread_mutex_lock(&app->wait_lock);
+            int res = 0;
+            while (!app->wakeup && res == 0)
+            {
+                if (timeout < 0)
+                    res = pthread_cond_wait(&app->wait_cond, &app->wait_lock);
+                else
+                    res = pthread_cond_timedwait(&app->wait_cond, &app->wait_lock, &deadline);
+            }
+            pthread_mutex_unlock(&app->wait_lock);
+        }
+        app->wakeups++;
+    }
+
+    value = false;
+    atomic_store(&app->is_waiting, value);
+}
+
+
+
 /*************************************************************************************************/
 /*  Event loop                                                                                   */
 /*************************************************************************************************/
@@ -1971,27 +2138,40 @@ void dvz_canvas_frame(DvzCanvas* canvas)
     _clock_set(&canvas->app->clock); // global clock
     _clock_set(&canvas->clock);      // canvas-local clock
 
+    DvzProfiler* profiler = canvas->profiler;
+    canvas->frame_start = dvz_profiler_begin(profiler);
+    double t = canvas->frame_start;
+
     // Call INTERACT callbacks (for backends only), which may enqueue some events.
     _event_interact(canvas);
+    dvz_profiler_end(profiler, DVZ_PROFILE_INTERACT, NULL, t);
 
     // Call FRAME callbacks.
+    t = dvz_profiler_begin(profiler);
     _event_frame(canvas);
+    dvz_profiler_end(profiler, DVZ_PROFILE_FRAME_CALLBACKS, NULL, t);
 
     // Give a chance to update event structures in the main loop, for example reset wheel.
     _backend_next_frame(canvas);
 
     // Call TIMER callbacks, in the main thread.
+    t = dvz_profiler_begin(profiler);
     _event_timer(canvas);
+    dvz_profiler_end(profiler, DVZ_PROFILE_TIMER, NULL, t);
 
     // Refill all command buffers at the first iteration.
     if (canvas->frame_idx == 0)
         dvz_canvas_to_refill(canvas);
 
     // Pending transfers.
+    t = dvz_profiler_begin(profiler);
     dvz_process_transfers(canvas);
+    dvz_profiler_end(profiler, DVZ_PROFILE_TRANSFERS, NULL, t);
 
     // Refill if needed, only 1 swapchain command buffer per frame to avoid waiting on the device.
+    t = dvz_profiler_begin(profiler);
     _refill_frame(canvas);
+    dvz_profiler_end(profiler, DVZ_PROFILE_REFILL, NULL, t);
 }
 
 
@@ -2005,6 +2185,12 @@ void dvz_canvas_frame_submit(DvzCanvas* canvas)
     DvzSubmit* s = &canvas->submit;
     uint32_t f = canvas->cur_frame;
     uint32_t img_idx = canvas->swapchain.img_idx;
+    DvzProfiler* profiler = canvas->profiler;
+    double t = dvz_profiler_begin(profiler);
+
+    // Collect the GPU timestamps of the previous submission of this swapchain image, the
+    // corresponding fence has been waited upon before acquiring the image.
+    dvz_profiler_gpu_collect(profiler, img_idx);
 
     // Keep track of the fence associated to the current swapchain image.
     dvz_fences_copy(
@@ -2053,6 +2239,7 @@ void dvz_canvas_frame_submit(DvzCanvas* canvas)
         _event_presend(canvas);
 
         // Send the Submit instance.
+        dvz_profiler_gpu_submit(profiler, img_idx);
         dvz_submit_send(s, img_idx, &canvas->fences_render_finished, f);
 
         // Call POST_SEND callbacks
@@ -2068,6 +2255,49 @@ void dvz_canvas_frame_submit(DvzCanvas* canvas)
             canvas->present_semaphores, CLIP(f, 0, canvas->present_semaphores->count - 1));
 
     canvas->cur_frame = (f + 1) % canvas->fences_render_finished.count;
+
+    dvz_profiler_end(profiler, DVZ_PROFILE_SUBMIT, NULL, t);
+    dvz_profiler_end(profiler, DVZ_PROFILE_FRAME, NULL, canvas->frame_start);
+    dvz_profiler_frame(profiler, canvas->frame_idx);
+}
+
+
+
+DvzProfiler* dvz_canvas_profiler(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(canvas->gpu != NULL);
+    if (canvas->profiler == NULL)
+    {
+        log_debug("enable the canvas profiler");
+        canvas->profiler = dvz_profiler(canvas->gpu);
+        // The command buffers need to be refilled to record the GPU timestamp queries.
+        dvz_canvas_to_refill(canvas);
+    }
+    return canvas->profiler;
+}
+
+
+
+void dvz_app_wakeup(DvzApp* app)
+{
+    ASSERT(app != NULL);
+
+    // Only the main loop waiting in _app_wait() needs to be woken up.
+    if (!atomic_load(&app->is_waiting))
+        return;
+
+    if (app->backend == DVZ_BACKEND_GLFW)
+    {
+        backend_post_empty_event(app->backend);
+    }
+    else
+    {
+        pthread_mutex_lock(&app->wait_lock);
+        app->wakeup = true;
+        pthread_cond_signal(&app->wait_cond);
+        pthread_mutex_unlock(&app->wait_lock);
+    }
 }
 
 
@@ -2087,9 +2317,12 @@ void dvz_app_run(DvzApp* app, uint64_t frame_count)
 
     // Main loop.
     uint32_t n_canvas_active = 0;
+    uint32_t n_frames = 0;
+    double timeout = -1; // unused here, see _app_wait()
     for (uint64_t iter = 0; iter < frame_count; iter++)
     {
         n_canvas_active = 0;
+        n_frames = 0;
 
         // Loop over the canvases.
         iterator = dvz_container_iterator(&app->canvases);
@@ -2120,6 +2353,40 @@ void dvz_app_run(DvzApp* app, uint64_t frame_count)
             if (canvas->window != NULL)
                 dvz_window_poll_events(canvas->window);
 
+            // Destroy the canvas if needed.
+            if (atomic_load(&canvas->to_close))
+                canvas->obj.status = DVZ_OBJECT_STATUS_NEED_DESTROY;
+            if (canvas->window != NULL)
+            {
+                if (backend_window_should_close(app->backend, canvas->window->backend_window))
+                    canvas->window->obj.status = DVZ_OBJECT_STATUS_NEED_DESTROY;
+                if (canvas->window->obj.status == DVZ_OBJECT_STATUS_NEED_DESTROY)
+                    canvas->obj.status = DVZ_OBJECT_STATUS_NEED_DESTROY;
+            }
+            if (canvas->obj.status == DVZ_OBJECT_STATUS_NEED_DESTROY)
+            {
+                log_trace("destroying canvas");
+
+                // Stop the transfer queue.
+                dvz_event_stop(canvas);
+
+                // Wait for all GPUs to be idle.
+                dvz_app_wait(app);
+
+                // Destroy the canvas.
+                dvz_canvas_destroy(canvas);
+                dvz_container_iter(&iterator);
+                continue;
+            }
+
+            // Skip the canvases rendering on demand when nothing has changed since the last frame.
+            if (canvas->on_demand && !_canvas_damaged(canvas, &timeout))
+            {
+                n_canvas_active++;
+                dvz_container_iter(&iterator);
+                continue;
+            }
+
             // NOTE: swapchain image acquisition happens here
 
             // Wait for fence.
@@ -2164,29 +2431,10 @@ void dvz_app_run(DvzApp* app, uint64_t frame_count)
                 continue;
             }
 
-            // Destroy the canvas if needed.
-            if (canvas->window != NULL)
-            {
-                if (backend_window_should_close(app->backend, canvas->window->backend_window))
-                    canvas->window->obj.status = DVZ_OBJECT_STATUS_NEED_DESTROY;
-                if (canvas->window->obj.status == DVZ_OBJECT_STATUS_NEED_DESTROY)
-                    canvas->obj.status = DVZ_OBJECT_STATUS_NEED_DESTROY;
-            }
-            if (canvas->obj.status == DVZ_OBJECT_STATUS_NEED_DESTROY)
-            {
-                log_trace("destroying canvas");
-
-                // Stop the transfer queue.
-                dvz_event_stop(canvas);
-
-                // Wait for all GPUs to be idle.
-                dvz_app_wait(app);
-
-                // Destroy the canvas.
-                dvz_canvas_destroy(canvas);
-                dvz_container_iter(&iterator);
-                continue;
-            }
+            // Requests made from now on, including by the callbacks of this frame, lead to another
+            // frame.
+            bool value = false;
+            atomic_store(&canvas->dirty, value);
 
             // Frame logic.
             dvz_canvas_frame(canvas);
@@ -2197,6 +2445,7 @@ void dvz_app_run(DvzApp* app, uint64_t frame_count)
             dvz_canvas_frame_submit(canvas);
             canvas->frame_idx++;
             n_canvas_active++;
+            n_frames++;
 
 
             dvz_container_iter(&iterator);
@@ -2232,6 +2481,10 @@ void dvz_app_run(DvzApp* app, uint64_t frame_count)
             log_trace("no more active canvas, closing the app");
             break;
         }
+
+        // If all canvases render on demand and none of them has changed, wait for events.
+        if (n_frames == 0 && iter + 1 < frame_count)
+            _app_wait(app);
     }
     log_trace("end main loop");
 
@@ -2320,6 +2573,13 @@ void dvz_canvas_destroy(DvzCanvas* canvas)
     log_trace("canvas destroy fences");
     dvz_fences_destroy(&canvas->fences_render_finished);
 
+    // Destroy the profiler.
+    dvz_profiler_destroy(canvas->profiler);
+    canvas->profiler = NULL;
+
+    // Close the event file.
+    dvz_event_record_stop(canvas);
+
     if (canvas->overlay)
         dvz_imgui_destroy(canvas);
     CONTAINER_DESTROY_ITEMS(DvzGui, canvas->guis, dvz_gui_destroy)
@@ -2,6 +2,7 @@
 #define DVZ_CANVAS_UTILS_HEADER
 
 #include "../include/datoviz/canvas.h"
+#include "../include/datoviz/replay.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,7 +14,44 @@ extern "C" {
 /*  Event system                                                                                 */
 /*************************************************************************************************/
 
-// Enqueue an event.
+// Merge an event into the last pending event of the queue: consecutive mouse moves are merged
+// into the latest position with an accumulated displacement, and wheel directions are summed.
+// The other events are never merged.
+static bool _event_merge(void* p_last, void* p_event)
+{
+    DvzEvent* last = (DvzEvent*)p_last;
+    DvzEvent* ev = (DvzEvent*)p_event;
+    ASSERT(last != NULL);
+    ASSERT(ev != NULL);
+    if (last->type != ev->type)
+        return false;
+
+    switch (ev->type)
+    {
+    case DVZ_EVENT_MOUSE_MOVE:
+        if (last->u.m.modifiers != ev->u.m.modifiers)
+            return false;
+        glm_vec2_copy(ev->u.m.pos, last->u.m.pos);
+        glm_vec2_add(last->u.m.delta, ev->u.m.delta, last->u.m.delta);
+        last->u.m.count += ev->u.m.count;
+        return true;
+
+    case DVZ_EVENT_MOUSE_WHEEL:
+        if (last->u.w.modifiers != ev->u.w.modifiers)
+            return false;
+        glm_vec2_add(last->u.w.dir, ev->u.w.dir, last->u.w.dir);
+        last->u.w.count += ev->u.w.count;
+        return true;
+
+    default:
+        break;
+    }
+    return false;
+}
+
+
+
+// Enqueue an event, or coalesce it with the last pending event.
 static void _event_enqueue(DvzCanvas* canvas, DvzEvent event)
 {
     ASSERT(canvas != NULL);
@@ -21,7 +59,8 @@ static void _event_enqueue(DvzCanvas* canvas, DvzEvent event)
     ASSERT(fifo != NULL);
     DvzEvent* ev = (DvzEvent*)calloc(1, sizeof(DvzEvent));
     *ev = event;
-    dvz_fifo_enqueue(fifo, ev);
+    if (dvz_fifo_enqueue_merge(fifo, ev, _event_merge))
+        FREE(ev);
 }
 
 
@@ -73,6 +112,14 @@ static bool _has_event_callbacks(DvzCanvas* canvas, DvzEventType type)
 
 
 
+// Whether an event comes from the user: mouse, keyboard, resize, and GUI events.
+static bool _is_input_event(DvzEventType type)
+{
+    return type == DVZ_EVENT_GUI || (type >= DVZ_EVENT_MOUSE_PRESS && type <= DVZ_EVENT_RESIZE);
+}
+
+
+
 // Consume an event, return the number of callbacks called.
 static int _event_consume(DvzCanvas* canvas, DvzEvent ev, DvzEventMode mode)
 {
@@ -120,6 +167,13 @@ static int _event_produce(DvzCanvas* canvas, DvzEvent ev)
 {
     ASSERT(canvas != NULL);
 
+    if (canvas->recorder != NULL)
+        dvz_event_record_write(canvas->recorder, ev);
+
+    // Input and GUI events may change what the canvas shows.
+    if (canvas->on_demand && _is_input_event(ev.type))
+        dvz_canvas_request_frame(canvas);
+
     // Call the sync callbacks directly.
     int n_callbacks = _event_consume(canvas, ev, DVZ_EVENT_MODE_SYNC);
 
@@ -140,12 +194,10 @@ static void* _event_thread(void* p_canvas)
     log_debug("starting event thread");
 
     DvzEvent ev;
-    double avg_event_time = 0; // average event callback time across all event types
-    double elapsed = 0;        // average time of the event callbacks in the current iteration
-    int n_callbacks = 0;       // number of event callbacks in the current event loop iteration
-    int counter = 0;           // number of iterations in the event loop
-    int events_to_keep = 0;    // maximum number of pending events to keep in the queue
+    double t = 0; // profiler time at the beginning of the event callbacks
 
+    // NOTE: no event is ever discarded. When the callbacks are slower than the event producers,
+    // the mouse move and wheel events are coalesced in the queue by _event_enqueue().
     while (true)
     {
         // log_trace("event thread awaits for events...");
@@ -158,39 +210,13 @@ static void* _event_thread(void* p_canvas)
             break;
         }
 
-        // Logic to discard some events if the queue is getting overloaded because of long-running
-        // callbacks.
-
-        // TODO: there are ways to improve the mechanism dropping events from the queue when the
-        // queue is getting overloaded. Doing it on a per-type basis, better estimating the avg
-        // time taken by each callback, etc.
-
         // log_trace("event dequeued type %d, processing it...", ev.type);
         // process the dequeued task
-        elapsed = _clock_get(&canvas->clock);
-        n_callbacks = _event_consume(canvas, ev, DVZ_EVENT_MODE_ASYNC);
-        elapsed = _clock_get(&canvas->clock) - elapsed;
-        // NOTE: avoid division by zero.
-        if (n_callbacks > 0)
-            elapsed /= n_callbacks; // average duration of the events
-
-        // Update the average event time.
-        avg_event_time = ((avg_event_time * counter) + elapsed) / (counter + 1);
-        if (avg_event_time > 0)
-        {
-            events_to_keep =
-                CLIP(DVZ_MAX_EVENT_DURATION / avg_event_time, 1, DVZ_MAX_FIFO_CAPACITY);
-            if (events_to_keep == DVZ_MAX_FIFO_CAPACITY)
-                events_to_keep = 0;
-        }
-
-        // Handle event queue overloading: if events are enqueued faster than
-        // they are consumed, we should discard the older events so that the
-        // queue doesn't keep filling up.
-        dvz_fifo_discard(&canvas->event_queue, events_to_keep);
+        t = dvz_profiler_begin(canvas->profiler);
+        _event_consume(canvas, ev, DVZ_EVENT_MODE_ASYNC);
+        dvz_profiler_end(canvas->profiler, DVZ_PROFILE_EVENT, NULL, t);
 
         canvas->event_processing = DVZ_EVENT_NONE;
-        counter++;
     }
     log_debug("end event thread");
 
@@ -20,11 +20,36 @@ static void _context_default_queues(DvzGpu* gpu, DvzWindow* window)
 
 
 
+// Return the startup timeline of the app, if any.
+static DvzTrace* _context_trace(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    ASSERT(context->gpu != NULL);
+    return context->gpu->app != NULL ? &context->gpu->app->startup : NULL;
+}
+
+
+
+static void _context_default_buffer(
+    DvzContext* context, DvzBufferType type, VkDeviceSize size, VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags memory)
+{
+    DvzBuffer* buffer = dvz_container_get(&context->buffers, type);
+    ASSERT(buffer != NULL);
+    dvz_buffer_type(buffer, type);
+    dvz_buffer_size(buffer, size);
+    dvz_buffer_usage(buffer, usage);
+    dvz_buffer_memory(buffer, memory);
+}
+
+
+
 static void _context_default_buffers(DvzContext* context)
 {
     ASSERT(context != NULL);
     ASSERT(context->gpu != NULL);
-    // Create a predetermined set of buffers.
+    // Specify a predetermined set of buffers. The GPU buffers are only created on first use, see
+    // dvz_ctx_default_buffer().
     DvzBuffer* buffer = NULL;
     for (uint32_t i = 0; i < DVZ_BUFFER_TYPE_COUNT; i++)
     {
@@ -40,88 +65,69 @@ static void _context_default_buffers(DvzContext* context)
 
     VkBufferUsageFlagBits transferable =
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    VkMemoryPropertyFlags mappable =
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
     // Staging buffer
-    {
-        buffer = dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STAGING);
-        ASSERT(buffer != NULL);
-        dvz_buffer_type(buffer, DVZ_BUFFER_TYPE_STAGING);
-        dvz_buffer_size(buffer, DVZ_BUFFER_TYPE_STAGING_SIZE);
-        dvz_buffer_usage(buffer, transferable);
-        dvz_buffer_memory(
-            buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        dvz_buffer_create(buffer);
-        ASSERT(dvz_obj_is_created(&buffer->obj));
-
-        // Permanently map the buffer.
-        buffer->mmap = dvz_buffer_map(buffer, 0, VK_WHOLE_SIZE);
-    }
+    _context_default_buffer(
+        context, DVZ_BUFFER_TYPE_STAGING, DVZ_BUFFER_TYPE_STAGING_SIZE, transferable, mappable);
 
     // Vertex buffer
-    {
-        buffer = dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_VERTEX);
-        ASSERT(buffer != NULL);
-        dvz_buffer_type(buffer, DVZ_BUFFER_TYPE_VERTEX);
-        dvz_buffer_size(buffer, DVZ_BUFFER_TYPE_VERTEX_SIZE);
-        dvz_buffer_usage(
-            buffer,
-            transferable | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-        dvz_buffer_memory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        dvz_buffer_create(buffer);
-        ASSERT(dvz_obj_is_created(&buffer->obj));
-    }
+    _context_default_buffer(
+        context, DVZ_BUFFER_TYPE_VERTEX, DVZ_BUFFER_TYPE_VERTEX_SIZE,
+        transferable | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
     // Index buffer
-    {
-        buffer = dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_INDEX);
-        ASSERT(buffer != NULL);
-        dvz_buffer_type(buffer, DVZ_BUFFER_TYPE_INDEX);
-        dvz_buffer_size(buffer, DVZ_BUFFER_TYPE_INDEX_SIZE);
-        dvz_buffer_usage(buffer, transferable | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-        dvz_buffer_memory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        dvz_buffer_create(buffer);
-        ASSERT(dvz_obj_is_created(&buffer->obj));
-    }
+    _context_default_buffer(
+        context, DVZ_BUFFER_TYPE_INDEX, DVZ_BUFFER_TYPE_INDEX_SIZE,
+        transferable | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
     // Storage buffer
-    {
-        buffer = dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STORAGE);
-        ASSERT(buffer != NULL);
-        dvz_buffer_type(buffer, DVZ_BUFFER_TYPE_STORAGE);
-        dvz_buffer_size(buffer, DVZ_BUFFER_TYPE_STORAGE_SIZE);
-        dvz_buffer_usage(buffer, transferable | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-        dvz_buffer_memory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        dvz_buffer_create(buffer);
-        ASSERT(dvz_obj_is_created(&buffer->obj));
-    }
+    _context_default_buffer(
+        context, DVZ_BUFFER_TYPE_STORAGE, DVZ_BUFFER_TYPE_STORAGE_SIZE,
+        transferable | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
     // Uniform buffer
-    {
-        buffer = dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_UNIFORM);
-        ASSERT(buffer != NULL);
-        dvz_buffer_type(buffer, DVZ_BUFFER_TYPE_UNIFORM);
-        dvz_buffer_size(buffer, DVZ_BUFFER_TYPE_UNIFORM_SIZE);
-        dvz_buffer_usage(buffer, transferable | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-        dvz_buffer_memory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        dvz_buffer_create(buffer);
-        ASSERT(dvz_obj_is_created(&buffer->obj));
-    }
+    _context_default_buffer(
+        context, DVZ_BUFFER_TYPE_UNIFORM, DVZ_BUFFER_TYPE_UNIFORM_SIZE,
+        transferable | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
     // Mappable uniform buffer
+    _context_default_buffer(
+        context, DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE, DVZ_BUFFER_TYPE_UNIFORM_SIZE,
+        transferable | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, mappable);
+}
+
+
+
+static void _context_buffer_destroy(DvzBuffer* buffer)
+{
+    ASSERT(buffer != NULL);
+    if (dvz_obj_is_created(&buffer->obj))
+        dvz_buffer_destroy(buffer);
+    else
+        // Default buffers that were never used have no GPU object, but they must still be
+        // released from the container.
+        dvz_obj_destroyed(&buffer->obj);
+}
+
+
+
+// The actual size of the images depends on the format and tiling, as reported by the driver.
+static VkDeviceSize _images_memory(DvzImages* images)
+{
+    ASSERT(images != NULL);
+    if (!dvz_obj_is_created(&images->obj))
+        return 0;
+    VkDeviceSize size = 0;
+    VkMemoryRequirements req = {0};
+    for (uint32_t i = 0; i < images->count; i++)
     {
-        buffer = dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE);
-        ASSERT(buffer != NULL);
-        dvz_buffer_type(buffer, DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE);
-        dvz_buffer_size(buffer, DVZ_BUFFER_TYPE_UNIFORM_SIZE);
-        dvz_buffer_usage(buffer, transferable | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-        dvz_buffer_memory(
-            buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        dvz_buffer_create(buffer);
-        ASSERT(dvz_obj_is_created(&buffer->obj));
-
-        // Permanently map the buffer.
-        buffer->mmap = dvz_buffer_map(buffer, 0, VK_WHOLE_SIZE);
+        vkGetImageMemoryRequirements(images->gpu->device, images->images[i], &req);
+        size += req.size;
     }
+    return size;
 }
 
 
@@ -131,7 +137,7 @@ static void _destroy_resources(DvzContext* context)
     ASSERT(context != NULL);
 
     log_trace("context destroy buffers");
-    CONTAINER_DESTROY_ITEMS(DvzBuffer, context->buffers, dvz_buffer_destroy)
+    CONTAINER_DESTROY_ITEMS(DvzBuffer, context->buffers, _context_buffer_destroy)
 
     log_trace("context destroy sets of images");
     CONTAINER_DESTROY_ITEMS(DvzImages, context->images, dvz_images_destroy)
@@ -169,10 +175,15 @@ DvzContext* dvz_context(DvzGpu* gpu, DvzWindow* window)
     context->computes =
         dvz_container(DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzCompute), DVZ_OBJECT_TYPE_COMPUTE);
 
+    // Start decoding the font texture in the background while the GPU is being created.
+    context->font_thread = dvz_thread(_font_atlas_load, &context->font_atlas);
+
     // Specify the default queues.
     _context_default_queues(gpu, window);
 
     // Create the GPU after the default queues have been set.
+    DvzTrace* trace = _context_trace(context);
+    uint64_t t = trace != NULL ? _trace_now(trace) : 0;
     if (!dvz_obj_is_created(&gpu->obj))
     {
         VkSurfaceKHR surface = VK_NULL_HANDLE;
@@ -180,8 +191,9 @@ DvzContext* dvz_context(DvzGpu* gpu, DvzWindow* window)
             surface = window->surface;
         dvz_gpu_create(gpu, surface);
     }
+    _trace_phase(trace, "gpu_create", t);
 
-    // Create the default buffers.
+    // Specify the default buffers, they will be created on first use.
     _context_default_buffers(context);
 
     context->transfer_cmd = dvz_commands(gpu, DVZ_DEFAULT_QUEUE_TRANSFER, 1);
@@ -189,22 +201,8 @@ DvzContext* dvz_context(DvzGpu* gpu, DvzWindow* window)
     gpu->context = context;
     dvz_obj_created(&context->obj);
 
-    // Create the font atlas and assign it to the context.
-    context->font_atlas = dvz_font_atlas(context);
-
-    // Color texture.
-    context->color_texture.arr = _load_colormaps();
-    context->color_texture.texture =
-        dvz_ctx_texture(context, 2, (uvec3){256, 256, 1}, VK_FORMAT_R8G8B8A8_UNORM);
-    dvz_texture_address_mode(
-        context->color_texture.texture, DVZ_TEXTURE_AXIS_U,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER);
-    dvz_texture_address_mode(
-        context->color_texture.texture, DVZ_TEXTURE_AXIS_V,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER);
-    dvz_texture_upload(
-        context->color_texture.texture, DVZ_ZERO_OFFSET, DVZ_ZERO_OFFSET, 256 * 256 * 4,
-        context->color_texture.arr);
+    // NOTE: the font atlas and the color texture are created on first use, see
+    // dvz_ctx_font_atlas() and dvz_ctx_color_texture().
 
     return context;
 }
@@ -217,6 +215,55 @@ void dvz_context_reset(DvzContext* context)
     log_trace("reset the context");
     _destroy_resources(context);
     _context_default_buffers(context);
+    context->region_count = 0;
+
+    // The textures have been destroyed, they will be recreated on next use.
+    context->font_atlas.texture = NULL;
+    context->color_texture.texture = NULL;
+}
+
+
+
+DvzMemoryUsage dvz_context_memory(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzMemoryUsage usage = {0};
+    usage.region_count = context->region_count;
+
+    // Buffers: the regions are bump-allocated and never freed.
+    DvzContainerIterator iterator = dvz_container_iterator(&context->buffers);
+    DvzBuffer* buffer = NULL;
+    while (iterator.item != NULL)
+    {
+        buffer = (DvzBuffer*)iterator.item;
+        if (dvz_obj_is_created(&buffer->obj))
+        {
+            usage.device += buffer->allocated_size;
+            usage.device_total += buffer->size;
+        }
+        dvz_container_iter(&iterator);
+    }
+
+    // Images.
+    VkDeviceSize size = 0;
+    iterator = dvz_container_iterator(&context->images);
+    while (iterator.item != NULL)
+    {
+        size = _images_memory((DvzImages*)iterator.item);
+        usage.device += size;
+        usage.device_total += size;
+        dvz_container_iter(&iterator);
+    }
+
+    iterator = dvz_container_iterator(&context->textures);
+    while (iterator.item != NULL)
+    {
+        if (dvz_obj_is_created(&((DvzTexture*)iterator.item)->obj))
+            usage.texture_count++;
+        dvz_container_iter(&iterator);
+    }
+
+    return usage;
 }
 
 
@@ -233,6 +280,8 @@ void dvz_context_destroy(DvzContext* context)
     ASSERT(context->gpu != NULL);
 
     // Destroy the font atlas.
+    if (dvz_obj_is_created(&context->font_thread.obj))
+        dvz_thread_join(&context->font_thread);
     dvz_font_atlas_destroy(&context->font_atlas);
 
     // Destroy the buffers, images, samplers, textures, computes.
@@ -248,6 +297,98 @@ void dvz_context_destroy(DvzContext* context)
 
 
 
+/*************************************************************************************************/
+/*  Default resources                                                                            */
+/*************************************************************************************************/
+
+DvzBuffer* dvz_ctx_default_buffer(DvzContext* context, DvzBufferType buffer_type)
+{
+    ASSERT(context != NULL);
+    ASSERT(buffer_type < DVZ_BUFFER_TYPE_COUNT);
+
+    DvzBuffer* buffer = dvz_container_get(&context->buffers, buffer_type);
+    ASSERT(buffer != NULL);
+    ASSERT(buffer->type == buffer_type);
+    if (dvz_obj_is_created(&buffer->obj))
+        return buffer;
+
+    log_debug(
+        "create default buffer %d with size %s on first use", buffer_type,
+        pretty_size(buffer->size));
+    DvzTrace* trace = _context_trace(context);
+    uint64_t t = trace != NULL ? _trace_now(trace) : 0;
+
+    dvz_buffer_create(buffer);
+    ASSERT(dvz_obj_is_created(&buffer->obj));
+
+    // Permanently map the host-visible buffers.
+    if ((buffer->memory & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0)
+        buffer->mmap = dvz_buffer_map(buffer, 0, VK_WHOLE_SIZE);
+
+    _trace_phase(trace, "default_buffer", t);
+    return buffer;
+}
+
+
+
+DvzFontAtlas* dvz_ctx_font_atlas(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzFontAtlas* atlas = &context->font_atlas;
+    if (atlas->texture != NULL)
+        return atlas;
+
+    DvzTrace* trace = _context_trace(context);
+    uint64_t t = trace != NULL ? _trace_now(trace) : 0;
+
+    // Wait until the font texture has been decoded by the background thread.
+    if (dvz_obj_is_created(&context->font_thread.obj))
+    {
+        dvz_thread_join(&context->font_thread);
+        _trace_phase(trace, "font_atlas_decode_wait", t);
+        t = trace != NULL ? _trace_now(trace) : 0;
+    }
+    // The thread may have failed, or the decoded data may have been freed.
+    if (atlas->font_texture == NULL)
+        _font_atlas_load(atlas);
+    if (atlas->font_texture == NULL)
+        return atlas;
+
+    atlas->texture = _font_texture(context, atlas);
+    _trace_phase(trace, "font_atlas_upload", t);
+    return atlas;
+}
+
+
+
+DvzTexture* dvz_ctx_color_texture(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    if (context->color_texture.texture != NULL)
+        return context->color_texture.texture;
+
+    DvzTrace* trace = _context_trace(context);
+    uint64_t t = trace != NULL ? _trace_now(trace) : 0;
+
+    context->color_texture.arr = _load_colormaps();
+    context->color_texture.texture =
+        dvz_ctx_texture(context, 2, (uvec3){256, 256, 1}, VK_FORMAT_R8G8B8A8_UNORM);
+    dvz_texture_address_mode(
+        context->color_texture.texture, DVZ_TEXTURE_AXIS_U,
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER);
+    dvz_texture_address_mode(
+        context->color_texture.texture, DVZ_TEXTURE_AXIS_V,
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER);
+    dvz_texture_upload(
+        context->color_texture.texture, DVZ_ZERO_OFFSET, DVZ_ZERO_OFFSET, 256 * 256 * 4,
+        context->color_texture.arr);
+
+    _trace_phase(trace, "color_texture_upload", t);
+    return context->color_texture.texture;
+}
+
+
+
 /*************************************************************************************************/
 /*  Buffer allocation                                                                            */
 /*************************************************************************************************/
@@ -261,16 +402,8 @@ DvzBufferRegions dvz_ctx_buffers(
     ASSERT(size > 0);
     ASSERT(buffer_type < DVZ_BUFFER_TYPE_COUNT);
 
-    // Choose the first buffer with the requested type.
-    DvzContainerIterator iter = dvz_container_iterator(&context->buffers);
-    DvzBuffer* buffer = NULL;
-    while (iter.item != NULL)
-    {
-        buffer = iter.item;
-        if (dvz_obj_is_created(&buffer->obj) && buffer->type == buffer_type)
-            break;
-        dvz_container_iter(&iter);
-    }
+    // Take the default buffer with the requested type, creating it if needed.
+    DvzBuffer* buffer = dvz_ctx_default_buffer(context, buffer_type);
     if (buffer == NULL)
     {
         log_error("could not find buffer with requested type %d", buffer_type);
@@ -282,11 +415,15 @@ DvzBufferRegions dvz_ctx_buffers(
 
     VkDeviceSize alignment = 0;
     VkDeviceSize offset = buffer->allocated_size;
-    bool needs_align =
-        buffer_type == DVZ_BUFFER_TYPE_UNIFORM || buffer_type == DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE;
+    bool needs_align = buffer_type == DVZ_BUFFER_TYPE_UNIFORM ||
+                       buffer_type == DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE ||
+                       buffer_type == DVZ_BUFFER_TYPE_STORAGE;
     if (needs_align)
     {
-        alignment = context->gpu->device_properties.limits.minUniformBufferOffsetAlignment;
+        // Storage buffer regions may be bound at their offset, like uniform buffer regions.
+        alignment = buffer_type == DVZ_BUFFER_TYPE_STORAGE
+                        ? context->gpu->device_properties.limits.minStorageBufferOffsetAlignment
+                        : context->gpu->device_properties.limits.minUniformBufferOffsetAlignment;
         ASSERT(offset % alignment == 0); // offset should be already aligned
     }
 
@@ -324,6 +461,7 @@ DvzBufferRegions dvz_ctx_buffers(
         buffer_count, buffer_type, pretty_size(size), pretty_size(alsize));
     ASSERT(offset + alsize * buffer_count <= regions.buffer->size);
     buffer->allocated_size += alsize * buffer_count;
+    context->region_count++;
 
     ASSERT(regions.offsets[buffer_count - 1] + alsize == buffer->allocated_size);
     return regions;
@@ -354,12 +492,14 @@ void dvz_ctx_buffers_resize(DvzContext* context, DvzBufferRegions* br, VkDeviceS
         br->size = new_size;
         if (br->alignment > 0)
             br->aligned_size = aligned_size(new_size, br->alignment);
+        // Keep the end of the allocated space aligned for the next regions.
+        new_size = br->aligned_size > 0 ? br->aligned_size : new_size;
         br->buffer->allocated_size = br->offsets[0] + new_size;
 
         // Need to reallocate a new underlying buffer.
-        if (br->offsets[0] + old_size > br->buffer->size)
+        if (br->offsets[0] + new_size > br->buffer->size)
         {
-            VkDeviceSize bs = dvz_next_pow2(br->offsets[0] + old_size);
+            VkDeviceSize bs = dvz_next_pow2(br->offsets[0] + new_size);
             log_info("reallocating buffer #%d to %s", br->buffer->type, pretty_size(bs));
             dvz_buffer_resize(br->buffer, bs, &context->transfer_cmd);
         }
@@ -382,7 +522,6 @@ void dvz_ctx_buffers_resize(DvzContext* context, DvzBufferRegions* br, VkDeviceS
 DvzCompute* dvz_ctx_compute(DvzContext* context, const char* shader_path)
 {
     ASSERT(context != NULL);
-    ASSERT(shader_path != NULL);
 
     DvzCompute* compute = dvz_container_alloc(&context->computes);
     *compute = dvz_compute(context->gpu, shader_path);
@@ -418,6 +557,54 @@ static VkImageType image_type_from_dims(uint32_t dims)
 
 
 
+// Transition all mip levels of a newly-created image to its layout.
+static void _texture_transition(DvzContext* context, DvzImages* image)
+{
+    ASSERT(context != NULL);
+    ASSERT(image != NULL);
+
+    DvzGpu* gpu = context->gpu;
+    DvzCommands* cmds = &context->transfer_cmd;
+
+    dvz_cmd_reset(cmds, 0);
+    dvz_cmd_begin(cmds, 0);
+
+    DvzBarrier barrier = dvz_barrier(gpu);
+    dvz_barrier_stages(&barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    dvz_barrier_images(&barrier, image);
+    dvz_barrier_images_layout(&barrier, VK_IMAGE_LAYOUT_UNDEFINED, image->layout);
+    dvz_barrier_images_access(&barrier, 0, VK_ACCESS_TRANSFER_READ_BIT);
+    dvz_cmd_barrier(cmds, 0, &barrier);
+
+    dvz_cmd_end(cmds, 0);
+    dvz_cmd_submit_sync(cmds, 0);
+}
+
+
+
+// Return the filter to use to generate the mip levels, or false if the format does not support
+// blits.
+static bool _mip_filter(DvzGpu* gpu, VkFormat format, VkFilter* filter)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(filter != NULL);
+
+    VkFormatProperties props = {0};
+    vkGetPhysicalDeviceFormatProperties(gpu->physical_device, format, &props);
+    VkFormatFeatureFlags features = props.optimalTilingFeatures;
+    if ((features & VK_FORMAT_FEATURE_BLIT_SRC_BIT) == 0 ||
+        (features & VK_FORMAT_FEATURE_BLIT_DST_BIT) == 0)
+        return false;
+
+    // Integer formats cannot be filtered linearly.
+    *filter = (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0
+                  ? VK_FILTER_LINEAR
+                  : VK_FILTER_NEAREST;
+    return true;
+}
+
+
+
 DvzTexture* dvz_ctx_texture(DvzContext* context, uint32_t dims, uvec3 size, VkFormat format)
 {
     ASSERT(context != NULL);
@@ -435,6 +622,7 @@ DvzTexture* dvz_ctx_texture(DvzContext* context, uint32_t dims, uvec3 size, VkFo
 
     texture->image = image;
     texture->sampler = sampler;
+    texture->mip_count = 1;
 
     // Create the image.
     dvz_images_format(image, format);
@@ -462,24 +650,7 @@ DvzTexture* dvz_ctx_texture(DvzContext* context, uint32_t dims, uvec3 size, VkFo
     dvz_obj_created(&texture->obj);
 
     // Immediately transition the image to its layout.
-    {
-        DvzGpu* gpu = context->gpu;
-        DvzCommands* cmds = &context->transfer_cmd;
-
-        dvz_cmd_reset(cmds, 0);
-        dvz_cmd_begin(cmds, 0);
-
-        DvzBarrier barrier = dvz_barrier(gpu);
-        dvz_barrier_stages(
-            &barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
-        dvz_barrier_images(&barrier, image);
-        dvz_barrier_images_layout(&barrier, VK_IMAGE_LAYOUT_UNDEFINED, image->layout);
-        dvz_barrier_images_access(&barrier, 0, VK_ACCESS_TRANSFER_READ_BIT);
-        dvz_cmd_barrier(cmds, 0, &barrier);
-
-        dvz_cmd_end(cmds, 0);
-        dvz_cmd_submit_sync(cmds, 0);
-    }
+    _texture_transition(context, image);
 
     return texture;
 }
@@ -550,6 +721,10 @@ void dvz_texture_upload(
 
     // Copy from the staging buffer to the texture.
     _copy_texture_from_staging(context, texture, offset, shape, size);
+
+    // Regenerate the mip levels from the new data.
+    if (texture->mip_count > 1)
+        dvz_texture_generate_mips(texture);
 }
 
 
@@ -670,6 +845,77 @@ void dvz_texture_copy(
 
 
 
+void dvz_texture_mips(DvzTexture* texture, uint32_t mip_count)
+{
+    ASSERT(texture != NULL);
+    ASSERT(texture->image != NULL);
+    ASSERT(texture->sampler != NULL);
+    // The image view and the sampler are recreated below, existing descriptor sets would keep the
+    // destroyed handles.
+    ASSERT(!texture->is_bound);
+    DvzImages* image = texture->image;
+
+    // Recreate the image with its mip levels.
+    dvz_images_mip_levels(image, mip_count);
+    dvz_images_resize(image, image->width, image->height, image->depth);
+    _texture_transition(texture->context, image);
+    texture->mip_count = image->mip_levels;
+    log_debug("texture has %d mip level(s)", texture->mip_count);
+
+    dvz_sampler_max_lod(texture->sampler, (float)(texture->mip_count - 1));
+    dvz_sampler_destroy(texture->sampler);
+    dvz_sampler_create(texture->sampler);
+}
+
+
+
+void dvz_texture_generate_mips(DvzTexture* texture)
+{
+    ASSERT(texture != NULL);
+    DvzContext* context = texture->context;
+    ASSERT(context != NULL);
+    DvzGpu* gpu = context->gpu;
+    DvzImages* image = texture->image;
+    ASSERT(image != NULL);
+    if (texture->mip_count <= 1)
+        return;
+
+    VkFilter filter = VK_FILTER_LINEAR;
+    if (!_mip_filter(gpu, image->format, &filter))
+    {
+        log_warn("format %d does not support blits, skipping mip generation", image->format);
+        return;
+    }
+
+    // NOTE: blits require a graphics queue, the transfer queue may not support them.
+    DvzCommands cmds = dvz_commands(gpu, DVZ_DEFAULT_QUEUE_RENDER, 1);
+    dvz_cmd_begin(&cmds, 0);
+
+    DvzBarrier barrier = dvz_barrier(gpu);
+    dvz_barrier_stages(&barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    dvz_barrier_images(&barrier, image);
+    dvz_barrier_images_layout(&barrier, image->layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    dvz_barrier_images_access(&barrier, VK_ACCESS_MEMORY_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    dvz_cmd_barrier(&cmds, 0, &barrier);
+    dvz_cmd_blit_mips(&cmds, 0, image, filter);
+
+    dvz_cmd_end(&cmds, 0);
+    dvz_cmd_submit_sync(&cmds, 0);
+    dvz_cmd_free(&cmds);
+}
+
+
+
+VkDeviceSize dvz_texture_memory(DvzTexture* texture)
+{
+    ASSERT(texture != NULL);
+    if (texture->image == NULL)
+        return 0;
+    return _images_memory(texture->image);
+}
+
+
+
 void dvz_texture_destroy(DvzTexture* texture)
 {
     ASSERT(texture != NULL);
@@ -680,3 +926,202 @@ void dvz_texture_destroy(DvzTexture* texture)
     texture->sampler = NULL;
     dvz_obj_destroyed(&texture->obj);
 }
+
+
+
+/*************************************************************************************************/
+/*  Texture streaming                                                                            */
+/*************************************************************************************************/
+
+// Number of rows (1D and 2D textures) or slices (3D textures) of a streamed texture.
+static uint32_t _stream_row_count(DvzImages* image)
+{
+    ASSERT(image != NULL);
+    return image->image_type == VK_IMAGE_TYPE_3D ? image->depth : image->height;
+}
+
+
+
+// Copy a chunk to a staging slot, and record and submit its upload to the texture.
+static void _stream_submit(DvzTextureStream* stream, uint32_t slot, uint32_t chunk)
+{
+    ASSERT(stream != NULL);
+    ASSERT(slot < DVZ_TEXTURE_STREAM_SLOTS);
+    ASSERT(chunk < stream->chunk_count);
+
+    DvzImages* image = stream->texture->image;
+    ASSERT(image != NULL);
+    DvzGpu* gpu = image->gpu;
+    bool is_3D = image->image_type == VK_IMAGE_TYPE_3D;
+
+    uint32_t first = chunk * stream->rows_per_chunk;
+    uint32_t rows = MIN(stream->rows_per_chunk, _stream_row_count(image) - first);
+    VkDeviceSize slot_offset = slot * stream->rows_per_chunk * stream->row_size;
+    dvz_buffer_upload(
+        &stream->staging, slot_offset, rows * stream->row_size,
+        stream->data + first * stream->row_size);
+
+    uvec3 offset = {0, is_3D ? 0 : first, is_3D ? first : 0};
+    uvec3 shape = {image->width, is_3D ? image->height : rows, is_3D ? rows : 1};
+
+    DvzCommands* cmds = &stream->cmds;
+    dvz_cmd_reset(cmds, slot);
+    dvz_cmd_begin(cmds, slot);
+
+    // NOTE: the chunks are submitted to the render queue rather than to the transfer queue, so
+    // that the barriers order them with the frames sampling the texture, and the mips can be
+    // blitted after the last chunk, without any queue wait.
+    DvzBarrier barrier = dvz_barrier(gpu);
+    dvz_barrier_stages(
+        &barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    dvz_barrier_images(&barrier, image);
+    dvz_barrier_images_layout(&barrier, image->layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    dvz_barrier_images_access(&barrier, VK_ACCESS_MEMORY_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    dvz_cmd_barrier(cmds, slot, &barrier);
+
+    dvz_cmd_copy_buffer_to_image_region(
+        cmds, slot, &stream->staging, slot_offset, image, offset, shape);
+
+    if (stream->mips && chunk == stream->chunk_count - 1)
+    {
+        // The previous chunks were submitted before to the same queue.
+        dvz_cmd_blit_mips(cmds, slot, image, stream->mip_filter);
+    }
+    else
+    {
+        dvz_barrier_stages(
+            &barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        dvz_barrier_images_layout(&barrier, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, image->layout);
+        dvz_barrier_images_access(
+            &barrier, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT);
+        dvz_cmd_barrier(cmds, slot, &barrier);
+    }
+
+    dvz_cmd_end(cmds, slot);
+
+    // The slot fence is signaled when the chunk has been uploaded.
+    DvzSubmit submit = dvz_submit(gpu);
+    dvz_submit_commands(&submit, cmds);
+    dvz_submit_send(&submit, slot, &stream->fences, slot);
+    stream->slot_chunks[slot] = (int32_t)chunk;
+}
+
+
+
+DvzTextureStream* dvz_texture_stream(
+    DvzTexture* texture, VkDeviceSize size, const void* data, VkDeviceSize chunk_size)
+{
+    ASSERT(texture != NULL);
+    ASSERT(texture->context != NULL);
+    ASSERT(data != NULL);
+    DvzGpu* gpu = texture->context->gpu;
+    DvzImages* image = texture->image;
+    ASSERT(image != NULL);
+
+    uint32_t row_count = _stream_row_count(image);
+    ASSERT(row_count > 0);
+    ASSERT(size > 0 && size % row_count == 0);
+    if (chunk_size == 0)
+        chunk_size = DVZ_TEXTURE_STREAM_CHUNK_SIZE;
+
+    DvzTextureStream* stream = calloc(1, sizeof(DvzTextureStream));
+    stream->texture = texture;
+    stream->data = (const uint8_t*)data;
+    stream->size = size;
+    stream->row_size = size / row_count;
+    stream->rows_per_chunk = (uint32_t)MIN(row_count, MAX(1, chunk_size / stream->row_size));
+    stream->chunk_count = (row_count + stream->rows_per_chunk - 1) / stream->rows_per_chunk;
+    stream->mips = texture->mip_count > 1 && _mip_filter(gpu, image->format, &stream->mip_filter);
+    log_debug(
+        "streaming texture in %d chunk(s) of %s", stream->chunk_count,
+        pretty_size(stream->rows_per_chunk * stream->row_size));
+
+    // Persistently-mapped staging buffer with one slot per chunk in flight.
+    stream->staging = dvz_buffer(gpu);
+    dvz_buffer_type(&stream->staging, DVZ_BUFFER_TYPE_STAGING);
+    dvz_buffer_size(
+        &stream->staging, DVZ_TEXTURE_STREAM_SLOTS * stream->rows_per_chunk * stream->row_size);
+    dvz_buffer_usage(&stream->staging, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    dvz_buffer_memory(
+        &stream->staging,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    dvz_buffer_queue_access(&stream->staging, DVZ_DEFAULT_QUEUE_RENDER);
+    dvz_buffer_create(&stream->staging);
+    stream->staging.mmap = dvz_buffer_map(&stream->staging, 0, VK_WHOLE_SIZE);
+
+    stream->cmds = dvz_commands(gpu, DVZ_DEFAULT_QUEUE_RENDER, DVZ_TEXTURE_STREAM_SLOTS);
+    stream->fences = dvz_fences(gpu, DVZ_TEXTURE_STREAM_SLOTS, true);
+    for (uint32_t i = 0; i < DVZ_TEXTURE_STREAM_SLOTS; i++)
+        stream->slot_chunks[i] = -1;
+
+    dvz_obj_created(&stream->obj);
+    return stream;
+}
+
+
+
+bool dvz_texture_stream_step(DvzTextureStream* stream)
+{
+    ASSERT(stream != NULL);
+    if (stream->is_done)
+        return true;
+
+    for (uint32_t slot = 0; slot < DVZ_TEXTURE_STREAM_SLOTS; slot++)
+    {
+        // Retire the chunk uploaded in this slot, if any.
+        if (stream->slot_chunks[slot] >= 0)
+        {
+            if (!dvz_fences_ready(&stream->fences, slot))
+                continue;
+            uint32_t first = (uint32_t)stream->slot_chunks[slot] * stream->rows_per_chunk;
+            uint32_t rows =
+                MIN(stream->rows_per_chunk, _stream_row_count(stream->texture->image) - first);
+            stream->uploaded += rows * stream->row_size;
+            stream->chunk_done++;
+            stream->slot_chunks[slot] = -1;
+        }
+
+        // Submit the next chunk in the free slot.
+        if (stream->chunk_next < stream->chunk_count)
+            _stream_submit(stream, slot, stream->chunk_next++);
+    }
+
+    ASSERT(stream->chunk_done <= stream->chunk_count);
+    if (stream->chunk_done == stream->chunk_count)
+    {
+        log_debug("texture stream done, %s uploaded", pretty_size(stream->uploaded));
+        stream->is_done = true;
+    }
+    return stream->is_done;
+}
+
+
+
+void dvz_texture_stream_wait(DvzTextureStream* stream)
+{
+    ASSERT(stream != NULL);
+    while (!dvz_texture_stream_step(stream))
+    {
+        for (uint32_t slot = 0; slot < DVZ_TEXTURE_STREAM_SLOTS; slot++)
+            if (stream->slot_chunks[slot] >= 0)
+                dvz_fences_wait(&stream->fences, slot);
+    }
+}
+
+
+
+void dvz_texture_stream_destroy(DvzTextureStream* stream)
+{
+    ASSERT(stream != NULL);
+
+    // Wait for the chunks in flight before releasing their staging slots.
+    for (uint32_t slot = 0; slot < DVZ_TEXTURE_STREAM_SLOTS; slot++)
+        if (stream->slot_chunks[slot] >= 0)
+            dvz_fences_wait(&stream->fences, slot);
+
+    dvz_fences_destroy(&stream->fences);
+    dvz_cmd_free(&stream->cmds);
+    dvz_buffer_destroy(&stream->staging);
+    dvz_obj_destroyed(&stream->obj);
+    FREE(stream);
+}
@@ -0,0 +1,431 @@
+#include "../include/datoviz/density.h"
+#include "../include/datoviz/canvas.h"
+#include "../include/datoviz/context.h"
+#include "../include/datoviz/transfers.h"
+#include <inttypes.h>
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+// The shader loops over the items with a stride, so that the number of workgroups can be capped
+// to the device limit.
+static uint32_t _group_count(DvzGpu* gpu, uint64_t item_count)
+{
+    ASSERT(gpu != NULL);
+    uint64_t n = (item_count + DVZ_DENSITY_GROUP_SIZE - 1) / DVZ_DENSITY_GROUP_SIZE;
+    return (uint32_t)CLIP(n, 1, gpu->device_properties.limits.maxComputeWorkGroupCount[0]);
+}
+
+
+
+// Create a dedicated storage buffer, and return its single region.
+static DvzBufferRegions _density_buffer(DvzGpu* gpu, DvzBuffer* buffer, VkDeviceSize size)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(buffer != NULL);
+    ASSERT(size > 0);
+    *buffer = dvz_buffer(gpu);
+    dvz_buffer_type(buffer, DVZ_BUFFER_TYPE_STORAGE);
+    dvz_buffer_size(buffer, size);
+    dvz_buffer_usage(
+        buffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    dvz_buffer_memory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    dvz_buffer_queue_access(buffer, DVZ_DEFAULT_QUEUE_TRANSFER);
+    dvz_buffer_queue_access(buffer, DVZ_DEFAULT_QUEUE_COMPUTE);
+    dvz_buffer_queue_access(buffer, DVZ_DEFAULT_QUEUE_RENDER);
+    dvz_buffer_create(buffer);
+    return dvz_buffer_regions(buffer, 1, 0, size, 0);
+}
+
+
+
+static void _density_bindings(DvzDensity* density)
+{
+    ASSERT(density != NULL);
+    dvz_bindings_buffer(&density->bindings, 0, density->br_pos);
+    dvz_bindings_buffer(&density->bindings, 1, density->br_values);
+    dvz_bindings_buffer(&density->bindings, 2, density->br_grid);
+    dvz_bindings_buffer(&density->bindings, 3, density->br_stats);
+    dvz_bindings_buffer(&density->bindings, 4, density->br_output);
+    dvz_bindings_update(&density->bindings);
+}
+
+
+
+// Grow a point buffer, and return whether it has grown. The bindings must then be updated, as
+// the buffer is reallocated. The data is not kept, all points are uploaded again.
+static bool _density_grow(
+    DvzDensity* density, DvzBufferRegions* br, uint32_t* capacity, uint32_t count,
+    VkDeviceSize item_size)
+{
+    ASSERT(density != NULL);
+    ASSERT(br != NULL);
+    ASSERT(capacity != NULL);
+    if (count <= *capacity)
+        return false;
+
+    // The last aggregation may still read the region.
+    dvz_fences_wait(&density->fences, 0);
+    dvz_buffer_resize(br->buffer, count * item_size, NULL);
+    *br = dvz_buffer_regions(br->buffer, 1, 0, count * item_size, 0);
+    *capacity = count;
+    return true;
+}
+
+
+
+/*************************************************************************************************/
+/*  Aggregation                                                                                  */
+/*************************************************************************************************/
+
+static void _density_dispatch(
+    DvzDensity* density, DvzDensityParams* params, DvzDensityStage stage, uint64_t item_count)
+{
+    ASSERT(density != NULL);
+    ASSERT(params != NULL);
+    DvzCompute* compute = density->compute;
+
+    params->stage = (uint32_t)stage;
+    dvz_cmd_push(
+        &density->cmds, 0, &compute->slots, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+        sizeof(DvzDensityParams), params);
+    dvz_cmd_compute(
+        &density->cmds, 0, compute,
+        (uvec3){_group_count(density->canvas->gpu, item_count), 1, 1});
+}
+
+
+
+// Make the grid and statistics written by a stage visible to the next one.
+static void _density_barrier(DvzDensity* density)
+{
+    ASSERT(density != NULL);
+    VkAccessFlags access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    DvzBarrier barrier = dvz_barrier(density->canvas->gpu);
+    dvz_barrier_stages(
+        &barrier, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    dvz_barrier_buffer(&barrier, density->br_grid);
+    dvz_barrier_buffer_access(&barrier, VK_ACCESS_SHADER_WRITE_BIT, access);
+    dvz_barrier_buffer(&barrier, density->br_stats);
+    dvz_barrier_buffer_access(&barrier, VK_ACCESS_SHADER_WRITE_BIT, access);
+    dvz_cmd_barrier(&density->cmds, 0, &barrier);
+}
+
+
+
+static void _density_aggregate(DvzDensity* density)
+{
+    ASSERT(density != NULL);
+    DvzGpu* gpu = density->canvas->gpu;
+    DvzImages* image = density->texture->image;
+    ASSERT(image != NULL);
+    DvzCommands* cmds = &density->cmds;
+    const uint32_t width = density->size[0], height = density->size[1];
+    const uint64_t pixel_count = (uint64_t)width * height;
+
+    DvzDensityParams params = {0};
+    for (uint32_t i = 0; i < 4; i++)
+        params.view[i] = (float)density->view[i];
+    params.size[0] = width;
+    params.size[1] = height;
+    params.count = density->count;
+    params.reduction = (int32_t)density->reduction;
+    params.normalization = (int32_t)density->normalization;
+    params.has_values = density->has_values;
+
+    // The last aggregation must be done before its command buffer is recorded again.
+    dvz_fences_wait(&density->fences, 0);
+    dvz_cmd_reset(cmds, 0);
+    dvz_cmd_begin(cmds, 0);
+
+    _density_dispatch(
+        density, &params, DVZ_DENSITY_STAGE_CLEAR, MAX(pixel_count, DVZ_DENSITY_HIST_BINS));
+    _density_barrier(density);
+    _density_dispatch(density, &params, DVZ_DENSITY_STAGE_AGGREGATE, density->count);
+    _density_barrier(density);
+    _density_dispatch(density, &params, DVZ_DENSITY_STAGE_REDUCE, pixel_count);
+    _density_barrier(density);
+    if (density->normalization == DVZ_DENSITY_NORMALIZATION_EQ_HIST)
+    {
+        _density_dispatch(density, &params, DVZ_DENSITY_STAGE_HISTOGRAM, pixel_count);
+        _density_barrier(density);
+        // A single workgroup computes the cumulative histogram.
+        _density_dispatch(density, &params, DVZ_DENSITY_STAGE_CDF, DVZ_DENSITY_GROUP_SIZE);
+        _density_barrier(density);
+    }
+    _density_dispatch(density, &params, DVZ_DENSITY_STAGE_NORMALIZE, pixel_count);
+
+    // Copy the normalized values to the texture, once the previous frames have sampled it.
+    DvzBarrier barrier = dvz_barrier(gpu);
+    dvz_barrier_stages(
+        &barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    dvz_barrier_buffer(&barrier, density->br_output);
+    dvz_barrier_buffer_access(&barrier, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    dvz_barrier_images(&barrier, image);
+    dvz_barrier_images_layout(&barrier, image->layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    dvz_barrier_images_access(&barrier, VK_ACCESS_MEMORY_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    dvz_cmd_barrier(cmds, 0, &barrier);
+
+    dvz_cmd_copy_buffer_to_image_region(
+        cmds, 0, density->br_output.buffer, density->br_output.offsets[0], image,
+        (uvec3){0, 0, 0}, (uvec3){width, height, 1});
+
+    barrier = dvz_barrier(gpu);
+    dvz_barrier_stages(
+        &barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    dvz_barrier_images(&barrier, image);
+    dvz_barrier_images_layout(&barrier, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, image->layout);
+    dvz_barrier_images_access(&barrier, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT);
+    dvz_cmd_barrier(cmds, 0, &barrier);
+
+    dvz_cmd_end(cmds, 0);
+
+    // NOTE: the commands are submitted to the render queue without waiting, so that the frames
+    // submitted afterwards sample the updated texture, as with the texture streams.
+    DvzSubmit submit = dvz_submit(gpu);
+    dvz_submit_commands(&submit, cmds);
+    dvz_submit_send(&submit, 0, &density->fences, 0);
+    density->aggregations++;
+}
+
+
+
+// Set the image corners to the view, with one texel per grid pixel.
+static void _density_quad(DvzDensity* density)
+{
+    ASSERT(density != NULL);
+    if (density->visual == NULL)
+        return;
+
+    double x0 = density->view[0], y0 = density->view[1];
+    double x1 = density->view[2], y1 = density->view[3];
+    // Top left, top right, bottom right, bottom left.
+    dvec3 pos[4] = {{x0, y1, 0}, {x1, y1, 0}, {x1, y0, 0}, {x0, y0, 0}};
+    // The grid occupies the top left part of the texture when the viewport is smaller.
+    float u = density->size[0] / (float)density->shape[0];
+    float v = density->size[1] / (float)density->shape[1];
+    vec2 uv[4] = {{0, 0}, {u, 0}, {u, v}, {0, v}};
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        dvz_visual_data(density->visual, DVZ_PROP_POS, i, 1, pos[i]);
+        dvz_visual_data(density->visual, DVZ_PROP_TEXCOORDS, i, 1, uv[i]);
+    }
+}
+
+
+
+/*************************************************************************************************/
+/*  Density map                                                                                  */
+/*************************************************************************************************/
+
+DvzDensity* dvz_density(DvzCanvas* canvas, uvec2 shape)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(canvas->gpu != NULL);
+    ASSERT(shape[0] > 0 && shape[1] > 0);
+    DvzGpu* gpu = canvas->gpu;
+    DvzContext* context = gpu->context;
+    ASSERT(context != NULL);
+
+    DvzDensity* density = calloc(1, sizeof(DvzDensity));
+    density->canvas = canvas;
+    density->reduction = DVZ_DENSITY_REDUCTION_COUNT;
+    density->normalization = DVZ_DENSITY_NORMALIZATION_EQ_HIST;
+
+    uint32_t max_size = gpu->device_properties.limits.maxImageDimension2D;
+    density->shape[0] = MIN(shape[0], max_size);
+    density->shape[1] = MIN(shape[1], max_size);
+    const uint64_t pixel_count = (uint64_t)density->shape[0] * density->shape[1];
+
+    // Texture with the normalized values, sampled without interpolation.
+    density->texture = dvz_ctx_texture(
+        context, 2, (uvec3){density->shape[0], density->shape[1], 1}, VK_FORMAT_R32_SFLOAT);
+
+    // Storage buffers. The point buffers grow with the data.
+    DvzBuffer* buffers = density->buffers;
+    density->br_grid = _density_buffer(gpu, &buffers[0], pixel_count * 2 * sizeof(uint32_t));
+    density->br_stats = _density_buffer(
+        gpu, &buffers[1],
+        4 * sizeof(uint32_t) + DVZ_DENSITY_HIST_BINS * (sizeof(uint32_t) + sizeof(float)));
+    density->br_output = _density_buffer(gpu, &buffers[2], pixel_count * sizeof(float));
+    density->br_pos = _density_buffer(gpu, &buffers[3], sizeof(vec2));
+    density->br_values = _density_buffer(gpu, &buffers[4], sizeof(float));
+    density->capacity = 1;
+    density->value_capacity = 1;
+
+    // Compute pipeline, with the shader embedded in the library.
+    unsigned long size = 0;
+    const unsigned char* spirv = dvz_resource_shader("density_comp", &size);
+    ASSERT(size > 0);
+    ASSERT(spirv != NULL);
+    density->compute = dvz_ctx_compute(context, NULL);
+    dvz_compute_spirv(density->compute, size, (const uint32_t*)spirv);
+    for (uint32_t i = 0; i < 5; i++)
+        dvz_compute_slot(density->compute, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    dvz_compute_push(density->compute, 0, sizeof(DvzDensityParams), VK_SHADER_STAGE_COMPUTE_BIT);
+    density->bindings = dvz_bindings(&density->compute->slots, 1);
+    _density_bindings(density);
+    dvz_compute_bindings(density->compute, &density->bindings);
+    dvz_compute_create(density->compute);
+
+    density->cmds = dvz_commands(gpu, DVZ_DEFAULT_QUEUE_RENDER, 1);
+    density->fences = dvz_fences(gpu, 1, true);
+
+    log_debug("density map %dx%d", density->shape[0], density->shape[1]);
+    dvz_obj_created(&density->obj);
+    return density;
+}
+
+
+
+void dvz_density_data(DvzDensity* density, uint32_t count, const vec2* pos, const float* values)
+{
+    ASSERT(density != NULL);
+    ASSERT(pos != NULL || count == 0);
+    DvzCanvas* canvas = density->canvas;
+    ASSERT(canvas != NULL);
+
+    uint64_t max_count =
+        canvas->gpu->device_properties.limits.maxStorageBufferRange / sizeof(vec2);
+    if (count > max_count)
+    {
+        log_error(
+            "%d points exceed the maximum storage buffer size, keeping the first %" PRIu64,
+            count, max_count);
+        count = (uint32_t)max_count;
+    }
+
+    // NOTE: the bindings are only updated after a fence wait, when they are not in use.
+    bool grown = _density_grow(density, &density->br_pos, &density->capacity, count, sizeof(vec2));
+    if (values != NULL)
+        grown |= _density_grow(
+            density, &density->br_values, &density->value_capacity, count, sizeof(float));
+    if (grown)
+        _density_bindings(density);
+
+    density->count = count;
+    density->has_values = values != NULL;
+
+    // Chunked uploads, so that the staging buffer does not grow with the data.
+    VkDeviceSize size = count * sizeof(vec2);
+    VkDeviceSize chunk = 0;
+    for (VkDeviceSize offset = 0; offset < size; offset += chunk)
+    {
+        chunk = MIN(DVZ_DENSITY_UPLOAD_CHUNK, size - offset);
+        dvz_upload_buffers(canvas, density->br_pos, offset, chunk, (uint8_t*)pos + offset);
+    }
+    size = values != NULL ? count * sizeof(float) : 0;
+    for (VkDeviceSize offset = 0; offset < size; offset += chunk)
+    {
+        chunk = MIN(DVZ_DENSITY_UPLOAD_CHUNK, size - offset);
+        dvz_upload_buffers(canvas, density->br_values, offset, chunk, (uint8_t*)values + offset);
+    }
+
+    // When the app is running, the uploads are processed after the FRAME callbacks, so after an
+    // update in the same frame. The points are then aggregated again at the next update.
+    density->dirty = canvas->app->is_running ? 2 : 1;
+}
+
+
+
+void dvz_density_reduction(DvzDensity* density, DvzDensityReduction reduction)
+{
+    ASSERT(density != NULL);
+    density->reduction = reduction;
+    density->dirty = MAX(density->dirty, 1);
+}
+
+
+
+void dvz_density_normalization(DvzDensity* density, DvzDensityNormalization normalization)
+{
+    ASSERT(density != NULL);
+    density->normalization = normalization;
+    density->dirty = MAX(density->dirty, 1);
+}
+
+
+
+void dvz_density_visual(DvzDensity* density, DvzVisual* visual)
+{
+    ASSERT(density != NULL);
+    ASSERT(visual != NULL);
+    density->visual = visual;
+    dvz_visual_texture(visual, DVZ_SOURCE_TYPE_IMAGE, 0, density->texture);
+    if (density->has_view)
+        _density_quad(density);
+}
+
+
+
+bool dvz_density_update(DvzDensity* density, dvec4 view, uvec2 size)
+{
+    ASSERT(density != NULL);
+    ASSERT(view[2] > view[0] && view[3] > view[1]);
+
+    // One grid pixel per viewport pixel, within the texture size.
+    uvec2 grid = {CLIP(size[0], 1, density->shape[0]), CLIP(size[1], 1, density->shape[1])};
+    bool changed = !density->has_view || memcmp(view, density->view, sizeof(dvec4)) != 0 ||
+                   memcmp(grid, density->size, sizeof(uvec2)) != 0;
+    if (!changed && density->dirty == 0)
+        return false;
+
+    if (changed)
+    {
+        memcpy(density->view, view, sizeof(dvec4));
+        memcpy(density->size, grid, sizeof(uvec2));
+        density->has_view = true;
+        _density_quad(density);
+    }
+    if (density->dirty > 0)
+        density->dirty--;
+    _density_aggregate(density);
+    return changed && density->visual != NULL;
+}
+
+
+
+bool dvz_density_panzoom(DvzDensity* density, DvzPanzoom* panzoom, DvzViewport viewport)
+{
+    ASSERT(density != NULL);
+    ASSERT(panzoom != NULL);
+    ASSERT(panzoom->zoom[0] > 0 && panzoom->zoom[1] > 0);
+
+    // Visible rectangle of the orthographic projection of the panzoom.
+    double cx = panzoom->camera_pos[0], cy = panzoom->camera_pos[1];
+    double hx = 1.0 / panzoom->zoom[0], hy = 1.0 / panzoom->zoom[1];
+    return dvz_density_update(
+        density, (dvec4){cx - hx, cy - hy, cx + hx, cy + hy}, viewport.size_framebuffer);
+}
+
+
+
+void dvz_density_wait(DvzDensity* density)
+{
+    ASSERT(density != NULL);
+    dvz_fences_wait(&density->fences, 0);
+}
+
+
+
+void dvz_density_destroy(DvzDensity* density)
+{
+    if (density == NULL || !dvz_obj_is_created(&density->obj))
+        return;
+
+    // The compute pipeline belongs to the context.
+    dvz_fences_wait(&density->fences, 0);
+    dvz_fences_destroy(&density->fences);
+    dvz_cmd_free(&density->cmds);
+    dvz_bindings_destroy(&density->bindings);
+    for (uint32_t i = 0; i < 5; i++)
+        dvz_buffer_destroy(&density->buffers[i]);
+    dvz_texture_destroy(density->texture);
+
+    dvz_obj_destroyed(&density->obj);
+    FREE(density);
+}
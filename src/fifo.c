@@ -45,11 +45,6 @@ void dvz_fifo_enqueue(DvzFifo* fifo, void* item)
         ASSERT(fifo->items != NULL);
         ASSERT(size == fifo->capacity - 1);
 
-        // NOTE: we hard-code the maximum size of FIFO queues for now as the canvas has an array of
-        // fixed size for the event objects stored in the FIFO queue.
-        // TODO: fix this by making the canvas event array enlargeable.
-        ASSERT(fifo->capacity <= DVZ_MAX_FIFO_CAPACITY);
-
         fifo->capacity *= 2;
         log_debug("FIFO queue is full, enlarging it to %d", fifo->capacity);
         REALLOC(fifo->items, (uint32_t)fifo->capacity * sizeof(void*));
@@ -59,8 +54,10 @@ void dvz_fifo_enqueue(DvzFifo* fifo, void* item)
     {
         // Here, the queue buffer has been resized, but the new space should be used instead of the
         // part of the buffer before the tail.
+        // NOTE: the head may be 0, when the items end at the end of the buffer, in which case
+        // there is nothing to move.
 
-        ASSERT(fifo->head > 0);
+        ASSERT(fifo->head >= 0);
         ASSERT(old_cap < fifo->capacity);
         memcpy(&fifo->items[old_cap], &fifo->items[0], (uint32_t)fifo->head * sizeof(void*));
 
@@ -85,6 +82,30 @@ void dvz_fifo_enqueue(DvzFifo* fifo, void* item)
 
 
 
+bool dvz_fifo_enqueue_merge(DvzFifo* fifo, void* item, DvzFifoMergeCallback merge)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(merge != NULL);
+    pthread_mutex_lock(&fifo->lock);
+
+    // Try to merge the item into the most recently enqueued item, if it is still in the queue.
+    bool merged = false;
+    if (fifo->head != fifo->tail)
+    {
+        int32_t last = fifo->head - 1;
+        if (last < 0)
+            last += fifo->capacity;
+        merged = merge(fifo->items[last], item);
+    }
+    pthread_mutex_unlock(&fifo->lock);
+
+    if (!merged)
+        dvz_fifo_enqueue(fifo, item);
+    return merged;
+}
+
+
+
 void* dvz_fifo_dequeue(DvzFifo* fifo, bool wait)
 {
     ASSERT(fifo != NULL);
@@ -0,0 +1,13 @@
+#version 450
+#include "common.glsl"
+
+layout (location = 0) in vec3 pos_hi;
+layout (location = 1) in vec3 pos_lo;
+layout (location = 2) in vec4 color;
+
+layout (location = 0) out vec4 out_color;
+
+void main() {
+    gl_Position = transform(normalize_double(pos_hi, pos_lo));
+    out_color = color;
+}
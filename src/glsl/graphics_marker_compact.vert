@@ -0,0 +1,27 @@
+#version 450
+#include "constants.glsl"
+#include "common.glsl"
+
+// NOTE: same as graphics_marker.vert, with the marker size stored as an 8-bit unsigned integer.
+// The position is converted to a float vec3 by the vertex fetch unit (SNORM16 or half float).
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec4 color;
+layout (location = 2) in uint size;
+layout (location = 3) in uint marker;
+layout (location = 4) in float angle;
+layout (location = 5) in uint transform_mode;
+
+layout (location = 0) out vec4 out_color;
+layout (location = 1) out float out_size;
+layout (location = 2) out float out_marker;
+layout (location = 3) out float out_angle;
+
+void main() {
+    gl_Position = transform(pos, transform_mode);
+    gl_PointSize = float(size);
+
+    out_color = color;
+    out_size = float(size);
+    out_marker = marker;
+    out_angle = angle * M_2PI;
+}
@@ -0,0 +1,31 @@
+#version 450
+#include "common.glsl"
+
+layout (std140, binding = USER_BINDING) uniform Params {
+    vec2 vrange;
+    int cmap;
+    float point_size;
+} params;
+
+layout (binding = (USER_BINDING + 1)) uniform sampler2D tex_cmap; // colormap texture
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in float value;
+
+layout (location = 0) out vec4 out_color;
+
+void main() {
+    gl_Position = transform(pos);
+    gl_PointSize = params.point_size;
+
+    // Same quantization as dvz_colormap_scale() on the CPU: the value is clipped to the range,
+    // and mapped to one of the 256 texels of the colormap row.
+    // NOTE: the cmap index is used as the texture row, so the 32-color palettes (packed 8 per
+    // row, see dvz_colormap()) are not supported.
+    float v0 = params.vrange.x;
+    float v1 = params.vrange.y;
+    float x = v1 > v0 ? (clamp(value, v0, v1) - v0) / (v1 - v0) : 0;
+    int col = int(min(floor(x * 256.0), 255.0));
+    out_color = texelFetch(tex_cmap, ivec2(col, params.cmap), 0);
+    out_color.a = 1;
+}
@@ -22,7 +22,11 @@ void main (void)
     out_color = color;
     out_linewidth = linewidth;
 
-    int index = gl_VertexIndex % 4;
+    // Quad corner: 0 and 1 at the start, 2 and 3 at the end of the segment. The vertices
+    // 0, 1, 2, 3 are the corners 1, 0, 2, 3, so that the indexed quads (triangles 1-0-2 and
+    // 1-2-3) and the instanced triangle strips (one instance per segment) draw the same triangles.
+    const int corners[4] = int[4](1, 0, 2, 3);
+    int index = corners[gl_VertexIndex % 4];
 
     vec4 P0_ = transform(P0, shift.xy, transform_mode);
     vec4 P1_ = transform(P1, shift.zw, transform_mode);
@@ -36,7 +36,8 @@ void main() {
     float w = 2 * glyph_size.x;
     float h = 2 * glyph_size.y;
 
-    // Which vertex within the triangle strip forming the rectangle.
+    // Which vertex within the triangle strip forming the rectangle: the graphics is instanced,
+    // with one instance per glyph and 4 vertices per instance.
     int i = gl_VertexIndex % 4;
 
     // Rectangle vertex displacement (one glyph = one rectangle = 6 vertices)
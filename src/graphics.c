@@ -67,6 +67,66 @@ static void _common_slots(DvzGraphics* graphics)
     // dvz_graphics_slot(graphics, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER); // color texture
 }
 
+// Callback of the instanced graphics storing one vertex per item.
+static void
+_graphics_instance_callback(DvzGraphicsData* data, uint32_t item_count, const void* item)
+{
+    ASSERT(data != NULL);
+    ASSERT(data->vertices != NULL);
+
+    ASSERT(item_count > 0);
+    dvz_array_resize(data->vertices, item_count);
+
+    if (item == NULL)
+        return;
+    ASSERT(data->current_idx < item_count);
+    dvz_array_data(data->vertices, data->current_idx, 1, 1, item);
+    data->current_idx++;
+}
+
+// Vertex format of the positions, depending on the compact position graphics flags.
+static VkFormat _pos_format(int flags)
+{
+    if ((flags & DVZ_GRAPHICS_FLAGS_POS_SNORM16) != 0)
+        return VK_FORMAT_R16G16B16A16_SNORM;
+    if ((flags & DVZ_GRAPHICS_FLAGS_POS_HALF) != 0)
+        return VK_FORMAT_R16G16B16A16_SFLOAT;
+    return VK_FORMAT_R32G32B32_SFLOAT;
+}
+
+// Vertex attributes of the basic graphics, with either regular, compact, or double positions.
+// NOTE: the vertex fetch unit converts SNORM16 and half-float positions to a float vec3, so that
+// the same vertex shaders are used with both vertex layouts. Double positions use dedicated
+// vertex shaders, see _basic_vert().
+static void _basic_attrs(DvzGraphics* graphics)
+{
+    if ((graphics->flags & DVZ_GRAPHICS_FLAGS_POS_DOUBLE) != 0)
+    {
+        ATTR_BEGIN(DvzVertexDouble)
+        ATTR_POS(DvzVertexDouble, pos_hi)
+        ATTR_POS(DvzVertexDouble, pos_lo)
+        ATTR_COL(DvzVertexDouble, color)
+    }
+    else if ((graphics->flags & DVZ_GRAPHICS_FLAGS_POS_COMPACT) != 0)
+    {
+        ATTR_BEGIN(DvzVertexCompact)
+        ATTR(DvzVertexCompact, _pos_format(graphics->flags), pos)
+        ATTR_COL(DvzVertexCompact, color)
+    }
+    else
+    {
+        ATTR_BEGIN(DvzVertex)
+        ATTR_POS(DvzVertex, pos)
+        ATTR_COL(DvzVertex, color)
+    }
+}
+
+// Vertex shader of the basic graphics, depending on the double position graphics flag.
+static const char* _basic_vert(int flags, const char* name, const char* name_double)
+{
+    return (flags & DVZ_GRAPHICS_FLAGS_POS_DOUBLE) != 0 ? name_double : name;
+}
+
 
 
 /*************************************************************************************************/
@@ -75,7 +135,9 @@ static void _common_slots(DvzGraphics* graphics)
 
 static void _graphics_point(DvzCanvas* canvas, DvzGraphics* graphics)
 {
-    SHADER(VERTEX, "graphics_point_vert")
+    const char* vert =
+        _basic_vert(graphics->flags, "graphics_point_vert", "graphics_point_double_vert");
+    SHADER(VERTEX, vert)
     SHADER(FRAGMENT, "graphics_point_frag")
     PRIMITIVE(POINT_LIST)
 
@@ -83,9 +145,7 @@ static void _graphics_point(DvzCanvas* canvas, DvzGraphics* graphics)
     if ((graphics->flags & DVZ_GRAPHICS_FLAGS_DEPTH_TEST_ENABLE) != 0)
         dvz_graphics_depth_test(graphics, DVZ_DEPTH_TEST_ENABLE);
 
-    ATTR_BEGIN(DvzVertex)
-    ATTR_POS(DvzVertex, pos)
-    ATTR_COL(DvzVertex, color)
+    _basic_attrs(graphics);
 
     _common_slots(graphics);
     dvz_graphics_slot(graphics, DVZ_USER_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
@@ -93,9 +153,36 @@ static void _graphics_point(DvzCanvas* canvas, DvzGraphics* graphics)
     CREATE
 }
 
+static void _graphics_point_cmap(DvzCanvas* canvas, DvzGraphics* graphics)
+{
+    SHADER(VERTEX, "graphics_point_cmap_vert")
+    SHADER(FRAGMENT, "graphics_point_frag")
+    PRIMITIVE(POINT_LIST)
+
+    // Depth test flag.
+    if ((graphics->flags & DVZ_GRAPHICS_FLAGS_DEPTH_TEST_ENABLE) != 0)
+        dvz_graphics_depth_test(graphics, DVZ_DEPTH_TEST_ENABLE);
+
+    ATTR_BEGIN(DvzGraphicsPointCmapVertex)
+    ATTR_POS(DvzGraphicsPointCmapVertex, pos)
+    ATTR(DvzGraphicsPointCmapVertex, VK_FORMAT_R32_SFLOAT, value)
+
+    _common_slots(graphics);
+
+    // Params buffer.
+    dvz_graphics_slot(graphics, DVZ_USER_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+
+    // Colormap texture.
+    dvz_graphics_slot(graphics, DVZ_USER_BINDING + 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+
+    CREATE
+}
+
 static void _graphics_basic(DvzCanvas* canvas, DvzGraphics* graphics, VkPrimitiveTopology topology)
 {
-    SHADER(VERTEX, "graphics_basic_vert")
+    const char* vert =
+        _basic_vert(graphics->flags, "graphics_basic_vert", "graphics_basic_double_vert");
+    SHADER(VERTEX, vert)
     SHADER(FRAGMENT, "graphics_basic_frag")
 
     dvz_graphics_renderpass(graphics, &canvas->renderpass, 0);
@@ -106,9 +193,7 @@ static void _graphics_basic(DvzCanvas* canvas, DvzGraphics* graphics, VkPrimitiv
     if ((graphics->flags & DVZ_GRAPHICS_FLAGS_DEPTH_TEST_ENABLE) != 0)
         dvz_graphics_depth_test(graphics, DVZ_DEPTH_TEST_ENABLE);
 
-    ATTR_BEGIN(DvzVertex)
-    ATTR_POS(DvzVertex, pos)
-    ATTR_COL(DvzVertex, color)
+    _basic_attrs(graphics);
 
     _common_slots(graphics);
 
@@ -121,23 +206,44 @@ static void _graphics_basic(DvzCanvas* canvas, DvzGraphics* graphics, VkPrimitiv
 /*  Agg marker graphics                                                                          */
 /*************************************************************************************************/
 
-static void _graphics_marker(DvzCanvas* canvas, DvzGraphics* graphics)
+static void _graphics_marker_compact(DvzGraphics* graphics)
 {
-    SHADER(VERTEX, "graphics_marker_vert")
+    // NOTE: the marker size is an 8-bit unsigned integer, converted to a float in this shader.
+    SHADER(VERTEX, "graphics_marker_compact_vert")
     SHADER(FRAGMENT, "graphics_marker_frag")
+
+    ATTR_BEGIN(DvzGraphicsMarkerCompactVertex)
+    ATTR(DvzGraphicsMarkerCompactVertex, _pos_format(graphics->flags), pos)
+    ATTR_COL(DvzGraphicsMarkerCompactVertex, color)
+    ATTR(DvzGraphicsMarkerCompactVertex, VK_FORMAT_R8_UINT, size)
+    ATTR(DvzGraphicsMarkerCompactVertex, VK_FORMAT_R8_UINT, marker)
+    ATTR(DvzGraphicsMarkerCompactVertex, VK_FORMAT_R8_UNORM, angle)
+    ATTR(DvzGraphicsMarkerCompactVertex, VK_FORMAT_R8_UINT, transform)
+}
+
+static void _graphics_marker(DvzCanvas* canvas, DvzGraphics* graphics)
+{
     PRIMITIVE(POINT_LIST)
 
     // Depth test flag.
     if ((graphics->flags & DVZ_GRAPHICS_FLAGS_DEPTH_TEST_ENABLE) != 0)
         dvz_graphics_depth_test(graphics, DVZ_DEPTH_TEST_ENABLE);
 
-    ATTR_BEGIN(DvzGraphicsMarkerVertex)
-    ATTR_POS(DvzGraphicsMarkerVertex, pos)
-    ATTR_COL(DvzGraphicsMarkerVertex, color)
-    ATTR(DvzGraphicsMarkerVertex, VK_FORMAT_R32_SFLOAT, size)
-    ATTR(DvzGraphicsMarkerVertex, VK_FORMAT_R8_UINT, marker)
-    ATTR(DvzGraphicsMarkerVertex, VK_FORMAT_R8_UNORM, angle)
-    ATTR(DvzGraphicsMarkerVertex, VK_FORMAT_R8_UINT, transform)
+    if ((graphics->flags & DVZ_GRAPHICS_FLAGS_POS_COMPACT) != 0)
+        _graphics_marker_compact(graphics);
+    else
+    {
+        SHADER(VERTEX, "graphics_marker_vert")
+        SHADER(FRAGMENT, "graphics_marker_frag")
+
+        ATTR_BEGIN(DvzGraphicsMarkerVertex)
+        ATTR_POS(DvzGraphicsMarkerVertex, pos)
+        ATTR_COL(DvzGraphicsMarkerVertex, color)
+        ATTR(DvzGraphicsMarkerVertex, VK_FORMAT_R32_SFLOAT, size)
+        ATTR(DvzGraphicsMarkerVertex, VK_FORMAT_R8_UINT, marker)
+        ATTR(DvzGraphicsMarkerVertex, VK_FORMAT_R8_UNORM, angle)
+        ATTR(DvzGraphicsMarkerVertex, VK_FORMAT_R8_UINT, transform)
+    }
 
     _common_slots(graphics);
     dvz_graphics_slot(graphics, DVZ_USER_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
@@ -170,13 +276,14 @@ _graphics_segment_callback(DvzGraphicsData* data, uint32_t item_count, const voi
     // Fill the vertices array by simply repeating them 4 times.
     dvz_array_data(data->vertices, 4 * data->current_idx, 4, 1, item);
 
-    // Fill the indices array.
+    // Fill the indices array. The vertex shader maps the vertices 0, 1, 2, 3 to the quad corners
+    // 1, 0, 2, 3, so that the triangles are the same as with the instanced triangle strips.
     DvzIndex* indices = (DvzIndex*)data->indices->data;
     uint32_t i = data->current_idx;
-    indices[6 * i + 0] = 4 * i + 0;
-    indices[6 * i + 1] = 4 * i + 1;
+    indices[6 * i + 0] = 4 * i + 1;
+    indices[6 * i + 1] = 4 * i + 0;
     indices[6 * i + 2] = 4 * i + 2;
-    indices[6 * i + 3] = 4 * i + 0;
+    indices[6 * i + 3] = 4 * i + 1;
     indices[6 * i + 4] = 4 * i + 2;
     indices[6 * i + 5] = 4 * i + 3;
 
@@ -187,7 +294,18 @@ static void _graphics_segment(DvzCanvas* canvas, DvzGraphics* graphics)
 {
     SHADER(VERTEX, "graphics_segment_vert")
     SHADER(FRAGMENT, "graphics_segment_frag")
-    PRIMITIVE(TRIANGLE_LIST)
+
+    // Instanced segments: one instance per segment, drawn as a 4-vertex triangle strip.
+    bool instanced = (graphics->flags & DVZ_GRAPHICS_FLAGS_SEGMENT_INSTANCED) != 0;
+    if (instanced)
+    {
+        PRIMITIVE(TRIANGLE_STRIP)
+        dvz_graphics_instanced(graphics, 4);
+    }
+    else
+    {
+        PRIMITIVE(TRIANGLE_LIST)
+    }
     // PRIMITIVE(POINT_LIST) // DEBUG
 
     ATTR_BEGIN(DvzGraphicsSegmentVertex)
@@ -201,7 +319,8 @@ static void _graphics_segment(DvzCanvas* canvas, DvzGraphics* graphics)
     ATTR(DvzGraphicsSegmentVertex, VK_FORMAT_R8_UINT, transform)
 
     _common_slots(graphics);
-    dvz_graphics_callback(graphics, _graphics_segment_callback);
+    dvz_graphics_callback(
+        graphics, instanced ? _graphics_instance_callback : _graphics_segment_callback);
 
     CREATE
 }
@@ -241,18 +360,39 @@ static void _graphics_path(DvzCanvas* canvas, DvzGraphics* graphics)
     PRIMITIVE(TRIANGLE_STRIP)
     // PRIMITIVE(POINT_LIST)
 
-    ATTR_BEGIN(DvzGraphicsPathVertex)
-    ATTR_POS(DvzGraphicsPathVertex, p0)
-    ATTR_POS(DvzGraphicsPathVertex, p1)
-    ATTR_POS(DvzGraphicsPathVertex, p2)
-    ATTR_POS(DvzGraphicsPathVertex, p3)
-    ATTR_COL(DvzGraphicsPathVertex, color)
+    if ((graphics->flags & DVZ_GRAPHICS_FLAGS_PATH_COMPACT) != 0)
+    {
+        // One instance per point, the bindings 0, 1, 2, 3 read the previous, current, next, and
+        // next next points in the same vertex buffer.
+        dvz_graphics_instanced(graphics, 4);
+        VkDeviceSize stride = sizeof(DvzGraphicsPathCompactVertex);
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            dvz_graphics_vertex_binding_shift(graphics, i, stride, i);
+            dvz_graphics_vertex_attr(
+                graphics, i, i, VK_FORMAT_R32G32B32_SFLOAT,
+                offsetof(DvzGraphicsPathCompactVertex, pos));
+        }
+        dvz_graphics_vertex_attr(
+            graphics, 1, 4, VK_FORMAT_R8G8B8A8_UNORM,
+            offsetof(DvzGraphicsPathCompactVertex, color));
+        // Compact path: the items are the padded path points, 1 vertex per point.
+        dvz_graphics_callback(graphics, _graphics_instance_callback);
+    }
+    else
+    {
+        ATTR_BEGIN(DvzGraphicsPathVertex)
+        ATTR_POS(DvzGraphicsPathVertex, p0)
+        ATTR_POS(DvzGraphicsPathVertex, p1)
+        ATTR_POS(DvzGraphicsPathVertex, p2)
+        ATTR_POS(DvzGraphicsPathVertex, p3)
+        ATTR_COL(DvzGraphicsPathVertex, color)
+        dvz_graphics_callback(graphics, _graphics_path_callback);
+    }
 
     _common_slots(graphics);
     dvz_graphics_slot(graphics, DVZ_USER_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
 
-    dvz_graphics_callback(graphics, _graphics_path_callback);
-
     CREATE
 }
 
@@ -264,14 +404,15 @@ static void _graphics_path(DvzCanvas* canvas, DvzGraphics* graphics)
 
 static void _graphics_text_callback(DvzGraphicsData* data, uint32_t item_count, const void* item)
 {
-    // NOTE: item_count is the total number of glyphs
+    // NOTE: item_count is the total number of glyphs. The text graphics is instanced: there is
+    // one vertex per glyph, the 4 corners of the glyph quad are generated in the vertex shader.
 
     ASSERT(data != NULL);
     ASSERT(data->vertices != NULL);
 
     ASSERT(item_count > 0);
-    dvz_array_resize(data->vertices, 4 * item_count);
-    DvzFontAtlas* atlas = &data->graphics->gpu->context->font_atlas;
+    dvz_array_resize(data->vertices, item_count);
+    DvzFontAtlas* atlas = dvz_ctx_font_atlas(data->graphics->gpu->context);
     ASSERT(atlas != NULL);
 
     if (item == NULL)
@@ -281,32 +422,31 @@ static void _graphics_text_callback(DvzGraphicsData* data, uint32_t item_count,
 
     // const char* str = item;
     const DvzGraphicsTextItem* str_item = item;
-    uint32_t n = strlen(str_item->string);
-    DvzGraphicsTextVertex vertex = {0};
-    vertex = str_item->vertex;
+    const char* str = str_item->string;
+    uint32_t n = strlen(str);
     ASSERT(n > 0);
     ASSERT(data->current_idx + n <= item_count);
-    for (uint32_t i = 0; i < n; i++)
-    {
-        size_t g = _font_atlas_glyph(atlas, str_item->string, i);
 
-        // Glyph size.
-        _font_atlas_glyph_size(atlas, str_item->font_size, vertex.glyph_size);
+    // The fields common to all glyphs of the string are set once.
+    DvzGraphicsTextVertex vertex = str_item->vertex;
+    _font_atlas_glyph_size(atlas, str_item->font_size, vertex.glyph_size);
+    vertex.glyph[2] = n;                   // str len
+    vertex.glyph[3] = data->current_group; // str idx
 
+    DvzGraphicsTextVertex* out = dvz_array_item(data->vertices, data->current_idx);
+    for (uint32_t i = 0; i < n; i++)
+    {
         // Glyph.
-        vertex.glyph[0] = g;                   // char
-        vertex.glyph[1] = i;                   // char idx
-        vertex.glyph[2] = n;                   // str len
-        vertex.glyph[3] = data->current_group; // str idx
+        vertex.glyph[0] = _font_atlas_glyph(atlas, str[i]); // char
+        vertex.glyph[1] = i;                                // char idx
 
         // Glyph colors.
         if (str_item->glyph_colors != NULL)
             memcpy(vertex.color, str_item->glyph_colors[i], sizeof(cvec4));
 
-        // Fill the vertices array by simply repeating them 4 times.
-        dvz_array_data(data->vertices, 4 * data->current_idx, 4, 1, &vertex);
-        data->current_idx++; // glyph index
+        out[i] = vertex;
     }
+    data->current_idx += n; // glyph index
     data->current_group++; // glyph index
 }
 
@@ -315,6 +455,8 @@ static void _graphics_text(DvzCanvas* canvas, DvzGraphics* graphics)
     SHADER(VERTEX, "graphics_text_vert")
     SHADER(FRAGMENT, "graphics_text_frag")
     PRIMITIVE(TRIANGLE_STRIP)
+    // One instance per glyph, drawn as a 4-vertex quad.
+    dvz_graphics_instanced(graphics, 4);
 
     ATTR_BEGIN(DvzGraphicsTextVertex)
     ATTR_POS(DvzGraphicsTextVertex, pos)
@@ -580,8 +722,12 @@ static void _graphics_volume_callback(DvzGraphicsData* data, uint32_t item_count
 
 static void _graphics_volume(DvzCanvas* canvas, DvzGraphics* graphics)
 {
+    bool bricked = (graphics->flags & DVZ_GRAPHICS_FLAGS_VOLUME_BRICKED) != 0;
     SHADER(VERTEX, "graphics_volume_vert")
-    SHADER(FRAGMENT, "graphics_volume_frag")
+    if (bricked)
+        SHADER(FRAGMENT, "graphics_volume_bricked_frag")
+    else
+        SHADER(FRAGMENT, "graphics_volume_frag")
     PRIMITIVE(TRIANGLE_LIST)
     dvz_graphics_depth_test(graphics, DVZ_DEPTH_TEST_ENABLE);
 
@@ -593,6 +739,10 @@ static void _graphics_volume(DvzCanvas* canvas, DvzGraphics* graphics)
     dvz_graphics_slot(graphics, DVZ_USER_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
     dvz_graphics_slot(graphics, DVZ_USER_BINDING + 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
     dvz_graphics_slot(graphics, DVZ_USER_BINDING + 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    // Page table of the bricked volume.
+    if (bricked)
+        dvz_graphics_slot(
+            graphics, DVZ_USER_BINDING + 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 
     CREATE
 
@@ -765,6 +915,10 @@ DvzGraphics* dvz_graphics_builtin(DvzCanvas* canvas, DvzGraphicsType type, int f
         _graphics_point(canvas, graphics);
         break;
 
+    case DVZ_GRAPHICS_POINT_CMAP:
+        _graphics_point_cmap(canvas, graphics);
+        break;
+
     case DVZ_GRAPHICS_LINE:
         _graphics_basic(canvas, graphics, VK_PRIMITIVE_TOPOLOGY_LINE_LIST);
         break;
@@ -221,7 +221,7 @@ void dvz_imgui_init(DvzCanvas* canvas)
     dvz_event_callback(canvas, DVZ_EVENT_PRE_SEND, 0, DVZ_EVENT_MODE_SYNC, _presend, cmds);
 
     // Make the colormap texture available.
-    DvzTexture* texture = canvas->gpu->context->color_texture.texture;
+    DvzTexture* texture = dvz_ctx_color_texture(canvas->gpu->context);
     VkSampler sampler = texture->sampler->sampler;
     VkImageView image_view = texture->image->image_views[0];
 
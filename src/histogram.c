@@ -0,0 +1,498 @@
+#include "../include/datoviz/histogram.h"
+#include "../include/datoviz/canvas.h"
+#include "../include/datoviz/context.h"
+#include "../include/datoviz/graphics.h"
+#include "../include/datoviz/transfers.h"
+#include <inttypes.h>
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+// The shader loops over the items with a stride, so that the number of workgroups can be capped
+// to the device limit.
+static uint32_t _group_count(DvzGpu* gpu, uint64_t item_count)
+{
+    ASSERT(gpu != NULL);
+    uint64_t n = (item_count + DVZ_HISTOGRAM_GROUP_SIZE - 1) / DVZ_HISTOGRAM_GROUP_SIZE;
+    return (uint32_t)CLIP(n, 1, gpu->device_properties.limits.maxComputeWorkGroupCount[0]);
+}
+
+
+
+// Create a dedicated buffer, and return its single region.
+static DvzBufferRegions _histogram_buffer(
+    DvzGpu* gpu, DvzBuffer* buffer, DvzBufferType type, VkBufferUsageFlags usage,
+    VkDeviceSize size)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(buffer != NULL);
+    ASSERT(size > 0);
+    *buffer = dvz_buffer(gpu);
+    dvz_buffer_type(buffer, type);
+    dvz_buffer_size(buffer, size);
+    dvz_buffer_usage(
+        buffer, usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    dvz_buffer_memory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    dvz_buffer_queue_access(buffer, DVZ_DEFAULT_QUEUE_TRANSFER);
+    dvz_buffer_queue_access(buffer, DVZ_DEFAULT_QUEUE_COMPUTE);
+    dvz_buffer_queue_access(buffer, DVZ_DEFAULT_QUEUE_RENDER);
+    dvz_buffer_create(buffer);
+    return dvz_buffer_regions(buffer, 1, 0, size, 0);
+}
+
+
+
+// Return the region of a dedicated buffer with a new size, reallocating the buffer if it is too
+// small. The data is only kept when a command buffer is passed for the copy.
+static DvzBufferRegions _histogram_region(DvzBuffer* buffer, VkDeviceSize size, DvzCommands* cmds)
+{
+    ASSERT(buffer != NULL);
+    ASSERT(size > 0);
+    if (size > buffer->size)
+        dvz_buffer_resize(buffer, size, cmds);
+    return dvz_buffer_regions(buffer, 1, 0, size, 0);
+}
+
+
+
+static void _histogram_bindings(DvzHistogram* histogram)
+{
+    ASSERT(histogram != NULL);
+    dvz_bindings_buffer(&histogram->bindings, 0, histogram->br_samples);
+    dvz_bindings_buffer(&histogram->bindings, 1, histogram->br_counts);
+    dvz_bindings_buffer(&histogram->bindings, 2, histogram->br_vertex);
+    dvz_bindings_update(&histogram->bindings);
+}
+
+
+
+// Allocate the counts and the bar vertices for the current number of bins.
+static void _histogram_bars(DvzHistogram* histogram)
+{
+    ASSERT(histogram != NULL);
+    ASSERT(histogram->bin_count > 0);
+    DvzGpu* gpu = histogram->canvas->gpu;
+    DvzBuffer* buffers = histogram->buffers;
+    VkDeviceSize counts_size = (2 + histogram->bin_count) * sizeof(uint32_t);
+    VkDeviceSize vertex_size =
+        histogram->bin_count * DVZ_HISTOGRAM_BAR_VERTICES * sizeof(DvzVertex);
+
+    if (histogram->br_counts.buffer == NULL)
+    {
+        histogram->br_counts =
+            _histogram_buffer(gpu, &buffers[1], DVZ_BUFFER_TYPE_STORAGE, 0, counts_size);
+        histogram->br_vertex = _histogram_buffer(
+            gpu, &buffers[2], DVZ_BUFFER_TYPE_VERTEX, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            vertex_size);
+        return;
+    }
+
+    // The frames in flight may still draw the bars of a vertex buffer about to be reallocated.
+    if (vertex_size > buffers[2].size)
+        dvz_gpu_wait(gpu);
+    histogram->br_counts = _histogram_region(&buffers[1], counts_size, NULL);
+    histogram->br_vertex = _histogram_region(&buffers[2], vertex_size, NULL);
+}
+
+
+
+/*************************************************************************************************/
+/*  Compute commands                                                                             */
+/*************************************************************************************************/
+
+static void _histogram_dispatch(
+    DvzHistogram* histogram, DvzHistogramParams* params, DvzHistogramStage stage,
+    uint64_t item_count)
+{
+    ASSERT(histogram != NULL);
+    ASSERT(params != NULL);
+    DvzCompute* compute = histogram->compute;
+
+    params->stage = (uint32_t)stage;
+    dvz_cmd_push(
+        &histogram->cmds, 0, &compute->slots, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+        sizeof(DvzHistogramParams), params);
+    dvz_cmd_compute(
+        &histogram->cmds, 0, compute,
+        (uvec3){_group_count(histogram->canvas->gpu, item_count), 1, 1});
+}
+
+
+
+// Make the counts written by a stage visible to the next one.
+static void _histogram_barrier(DvzHistogram* histogram)
+{
+    ASSERT(histogram != NULL);
+    DvzBarrier barrier = dvz_barrier(histogram->canvas->gpu);
+    dvz_barrier_stages(
+        &barrier, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    dvz_barrier_buffer(&barrier, histogram->br_counts);
+    dvz_barrier_buffer_access(
+        &barrier, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    dvz_cmd_barrier(&histogram->cmds, 0, &barrier);
+}
+
+
+
+// Bin the samples from first to count, and compute the bars.
+static void _histogram_compute(DvzHistogram* histogram, uint32_t first, uint32_t count)
+{
+    ASSERT(histogram != NULL);
+    ASSERT(first <= count);
+    DvzGpu* gpu = histogram->canvas->gpu;
+    DvzCommands* cmds = &histogram->cmds;
+
+    DvzHistogramParams params = {0};
+    memcpy(params.box, histogram->box, sizeof(vec4));
+    memcpy(params.range, histogram->range, sizeof(vec2));
+    params.bin_count = histogram->bin_count;
+    params.first = first;
+    params.count = count;
+    params.max_count = histogram->max_count;
+    memcpy(params.color, histogram->color, sizeof(cvec4));
+
+    // The last update must be done before its command buffer is recorded again.
+    dvz_fences_wait(&histogram->fences, 0);
+    dvz_cmd_reset(cmds, 0);
+    dvz_cmd_begin(cmds, 0);
+
+    _histogram_dispatch(histogram, &params, DVZ_HISTOGRAM_STAGE_CLEAR, histogram->bin_count);
+    _histogram_barrier(histogram);
+    // The workgroups merge their shared histograms, so each invocation bins several samples.
+    _histogram_dispatch(
+        histogram, &params, DVZ_HISTOGRAM_STAGE_BIN,
+        (count - first + DVZ_HISTOGRAM_ITEMS - 1) / DVZ_HISTOGRAM_ITEMS);
+    _histogram_barrier(histogram);
+    _histogram_dispatch(histogram, &params, DVZ_HISTOGRAM_STAGE_REDUCE, histogram->bin_count);
+    _histogram_barrier(histogram);
+
+    // The previous frames must have read the bar vertices before they are written again.
+    DvzBarrier barrier = dvz_barrier(gpu);
+    dvz_barrier_stages(
+        &barrier, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    dvz_barrier_buffer(&barrier, histogram->br_vertex);
+    dvz_barrier_buffer_access(
+        &barrier, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    dvz_cmd_barrier(cmds, 0, &barrier);
+
+    _histogram_dispatch(histogram, &params, DVZ_HISTOGRAM_STAGE_BARS, histogram->bin_count);
+
+    barrier = dvz_barrier(gpu);
+    dvz_barrier_stages(
+        &barrier, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+    dvz_barrier_buffer(&barrier, histogram->br_vertex);
+    dvz_barrier_buffer_access(
+        &barrier, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+    dvz_cmd_barrier(cmds, 0, &barrier);
+
+    dvz_cmd_end(cmds, 0);
+
+    // NOTE: the commands are submitted to the render queue without waiting, so that the frames
+    // submitted afterwards draw the updated bars, as with the density maps.
+    DvzSubmit submit = dvz_submit(gpu);
+    dvz_submit_commands(&submit, cmds);
+    dvz_submit_send(&submit, 0, &histogram->fences, 0);
+    histogram->dispatches++;
+}
+
+
+
+/*************************************************************************************************/
+/*  Histogram                                                                                    */
+/*************************************************************************************************/
+
+DvzHistogram* dvz_histogram(DvzCanvas* canvas, uint32_t bin_count)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(canvas->gpu != NULL);
+    ASSERT(bin_count > 0);
+    DvzGpu* gpu = canvas->gpu;
+    DvzContext* context = gpu->context;
+    ASSERT(context != NULL);
+
+    DvzHistogram* histogram = calloc(1, sizeof(DvzHistogram));
+    histogram->canvas = canvas;
+    histogram->bin_count = bin_count;
+    histogram->range[0] = 0;
+    histogram->range[1] = 1;
+    histogram->box[0] = histogram->box[1] = -1;
+    histogram->box[2] = histogram->box[3] = +1;
+    memcpy(histogram->color, (cvec4)DVZ_HISTOGRAM_DEFAULT_COLOR, sizeof(cvec4));
+
+    // Storage buffers. The sample buffer grows with the data.
+    histogram->br_samples = _histogram_buffer(
+        gpu, &histogram->buffers[0], DVZ_BUFFER_TYPE_STORAGE, 0, sizeof(float));
+    histogram->capacity = 1;
+    _histogram_bars(histogram);
+
+    // Compute pipeline, with the shader embedded in the library.
+    unsigned long size = 0;
+    const unsigned char* spirv = dvz_resource_shader("histogram_comp", &size);
+    ASSERT(size > 0);
+    ASSERT(spirv != NULL);
+    histogram->compute = dvz_ctx_compute(context, NULL);
+    dvz_compute_spirv(histogram->compute, size, (const uint32_t*)spirv);
+    for (uint32_t i = 0; i < 3; i++)
+        dvz_compute_slot(histogram->compute, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    dvz_compute_push(
+        histogram->compute, 0, sizeof(DvzHistogramParams), VK_SHADER_STAGE_COMPUTE_BIT);
+    histogram->bindings = dvz_bindings(&histogram->compute->slots, 1);
+    _histogram_bindings(histogram);
+    dvz_compute_bindings(histogram->compute, &histogram->bindings);
+    dvz_compute_create(histogram->compute);
+
+    histogram->cmds = dvz_commands(gpu, DVZ_DEFAULT_QUEUE_RENDER, 1);
+    histogram->fences = dvz_fences(gpu, 1, true);
+
+    // The bars are computed at the first update, even without samples.
+    histogram->rebin = true;
+
+    log_debug("histogram with %d bins", bin_count);
+    dvz_obj_created(&histogram->obj);
+    return histogram;
+}
+
+
+
+// Upload samples at a given position, in chunks so that the staging buffer does not grow with
+// the data.
+static void
+_histogram_upload(DvzHistogram* histogram, uint32_t first, uint32_t count, const float* samples)
+{
+    ASSERT(histogram != NULL);
+    VkDeviceSize size = count * sizeof(float);
+    VkDeviceSize chunk = 0;
+    for (VkDeviceSize offset = 0; offset < size; offset += chunk)
+    {
+        chunk = MIN(DVZ_HISTOGRAM_UPLOAD_CHUNK, size - offset);
+        dvz_upload_buffers(
+            histogram->canvas, histogram->br_samples, first * sizeof(float) + offset, chunk,
+            (uint8_t*)samples + offset);
+    }
+}
+
+
+
+// Make room for a number of samples, keeping the first ones.
+static void _histogram_reserve(DvzHistogram* histogram, uint32_t count, uint32_t keep)
+{
+    ASSERT(histogram != NULL);
+    ASSERT(keep <= count);
+    if (count <= histogram->capacity)
+        return;
+    DvzCanvas* canvas = histogram->canvas;
+
+    // The last update may still read the samples.
+    dvz_fences_wait(&histogram->fences, 0);
+
+    // The capacity doubles, so that appending samples at every frame rarely reallocates them.
+    uint64_t capacity = MAX(count, 2 * (uint64_t)histogram->capacity);
+    uint64_t max_count =
+        canvas->gpu->device_properties.limits.maxStorageBufferRange / sizeof(float);
+    capacity = MIN(capacity, max_count);
+
+    // NOTE: the kept samples are copied synchronously, before the uploads of this frame that
+    // are processed later, and that write to the new buffer.
+    DvzCommands* cmds = keep > 0 ? &canvas->gpu->context->transfer_cmd : NULL;
+    histogram->br_samples =
+        _histogram_region(&histogram->buffers[0], capacity * sizeof(float), cmds);
+    histogram->capacity = (uint32_t)capacity;
+    _histogram_bindings(histogram);
+}
+
+
+
+// Clamp a number of samples to the maximum storage buffer size.
+static uint32_t _histogram_clamp(DvzHistogram* histogram, uint32_t first, uint32_t count)
+{
+    ASSERT(histogram != NULL);
+    uint64_t max_count =
+        histogram->canvas->gpu->device_properties.limits.maxStorageBufferRange / sizeof(float);
+    if ((uint64_t)first + count > max_count)
+    {
+        log_error(
+            "%d samples exceed the maximum storage buffer size, keeping the first %" PRIu64,
+            first + count, max_count);
+        count = first < max_count ? (uint32_t)(max_count - first) : 0;
+    }
+    return count;
+}
+
+
+
+void dvz_histogram_data(DvzHistogram* histogram, uint32_t count, const float* samples)
+{
+    ASSERT(histogram != NULL);
+    ASSERT(samples != NULL || count == 0);
+
+    count = _histogram_clamp(histogram, 0, count);
+    _histogram_reserve(histogram, count, 0);
+    _histogram_upload(histogram, 0, count, samples);
+    histogram->count = count;
+
+    // The uploads are synchronous when the app is not running.
+    if (histogram->canvas->app->is_running)
+        histogram->replaced = true;
+    else
+    {
+        histogram->gpu_count = count;
+        histogram->gpu_replaced = true;
+    }
+}
+
+
+
+void dvz_histogram_append(DvzHistogram* histogram, uint32_t count, const float* samples)
+{
+    ASSERT(histogram != NULL);
+    ASSERT(samples != NULL || count == 0);
+
+    uint32_t first = histogram->count;
+    count = _histogram_clamp(histogram, first, count);
+    if (count == 0)
+        return;
+    _histogram_reserve(histogram, first + count, first);
+    _histogram_upload(histogram, first, count, samples);
+    histogram->count = first + count;
+    if (!histogram->canvas->app->is_running)
+        histogram->gpu_count = histogram->count;
+}
+
+
+
+void dvz_histogram_range(DvzHistogram* histogram, float vmin, float vmax)
+{
+    ASSERT(histogram != NULL);
+    ASSERT(vmin < vmax);
+    histogram->range[0] = vmin;
+    histogram->range[1] = vmax;
+    histogram->rebin = true;
+}
+
+
+
+void dvz_histogram_bins(DvzHistogram* histogram, uint32_t bin_count)
+{
+    ASSERT(histogram != NULL);
+    ASSERT(bin_count > 0);
+    if (bin_count == histogram->bin_count)
+        return;
+
+    // The last update may still use the counts and the bar vertices.
+    dvz_fences_wait(&histogram->fences, 0);
+    histogram->bin_count = bin_count;
+    _histogram_bars(histogram);
+    _histogram_bindings(histogram);
+    if (histogram->visual != NULL)
+        dvz_visual_buffer(histogram->visual, DVZ_SOURCE_TYPE_VERTEX, 0, histogram->br_vertex);
+    histogram->rebin = true;
+    histogram->refill = true;
+}
+
+
+
+void dvz_histogram_max_count(DvzHistogram* histogram, uint32_t max_count)
+{
+    ASSERT(histogram != NULL);
+    histogram->max_count = max_count;
+    histogram->rebar = true;
+}
+
+
+
+void dvz_histogram_style(DvzHistogram* histogram, vec4 box, cvec4 color)
+{
+    ASSERT(histogram != NULL);
+    memcpy(histogram->box, box, sizeof(vec4));
+    memcpy(histogram->color, color, sizeof(cvec4));
+    histogram->rebar = true;
+}
+
+
+
+void dvz_histogram_visual(DvzHistogram* histogram, DvzVisual* visual)
+{
+    ASSERT(histogram != NULL);
+    ASSERT(visual != NULL);
+    histogram->visual = visual;
+    dvz_visual_buffer(visual, DVZ_SOURCE_TYPE_VERTEX, 0, histogram->br_vertex);
+    histogram->refill = true;
+}
+
+
+
+bool dvz_histogram_update(DvzHistogram* histogram)
+{
+    ASSERT(histogram != NULL);
+
+    // Samples on the GPU, and the samples that will be on the GPU at the next update, once the
+    // uploads of this frame have been processed.
+    uint32_t count = histogram->gpu_count;
+    bool replaced = histogram->gpu_replaced;
+    histogram->gpu_count = histogram->count;
+    histogram->gpu_replaced = histogram->replaced;
+    histogram->replaced = false;
+
+    // The visual must draw the bars of a new vertex buffer region.
+    bool refill = histogram->refill && histogram->visual != NULL;
+    if (refill)
+        histogram->refill = false;
+
+    bool rebin = histogram->rebin || replaced;
+    uint32_t first = rebin ? 0 : MIN(histogram->binned, count);
+    if (!rebin && !histogram->rebar && first == count)
+        return refill;
+
+    _histogram_compute(histogram, first, count);
+    histogram->binned = count;
+    histogram->rebin = false;
+    histogram->rebar = false;
+    return refill;
+}
+
+
+
+uint32_t dvz_histogram_counts(DvzHistogram* histogram, uint32_t* counts)
+{
+    ASSERT(histogram != NULL);
+    ASSERT(counts != NULL);
+    // When the app is running, the download would only be enqueued and would write to the
+    // output after this function returns.
+    ASSERT(!histogram->canvas->app->is_running);
+    uint32_t* data = calloc(2 + histogram->bin_count, sizeof(uint32_t));
+
+    // The download only waits for the compute queue, the updates are submitted to the render
+    // queue.
+    dvz_fences_wait(&histogram->fences, 0);
+    dvz_download_buffers(
+        histogram->canvas, histogram->br_counts, 0, (2 + histogram->bin_count) * sizeof(uint32_t),
+        data);
+    memcpy(counts, &data[2], histogram->bin_count * sizeof(uint32_t));
+    uint32_t total = data[1];
+    FREE(data);
+    return total;
+}
+
+
+
+void dvz_histogram_destroy(DvzHistogram* histogram)
+{
+    if (histogram == NULL || !dvz_obj_is_created(&histogram->obj))
+        return;
+
+    // The compute pipeline belongs to the context.
+    dvz_fences_wait(&histogram->fences, 0);
+    dvz_fences_destroy(&histogram->fences);
+    dvz_cmd_free(&histogram->cmds);
+    dvz_bindings_destroy(&histogram->bindings);
+    for (uint32_t i = 0; i < 3; i++)
+        dvz_buffer_destroy(&histogram->buffers[i]);
+
+    dvz_obj_destroyed(&histogram->obj);
+    FREE(histogram);
+}
@@ -0,0 +1,137 @@
+#include "../include/datoviz/jobs.h"
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+static void* _jobs_worker(void* user_data)
+{
+    DvzJobsWorker* worker = (DvzJobsWorker*)user_data;
+    ASSERT(worker != NULL);
+    DvzJobs* jobs = worker->jobs;
+    ASSERT(jobs != NULL);
+
+    uint64_t batch = 0;
+    uint32_t job_count = 0;
+    DvzJobCallback callback = NULL;
+    void* callback_data = NULL;
+
+    while (true)
+    {
+        // Wait for the next batch.
+        pthread_mutex_lock(&jobs->lock);
+        while (!jobs->is_stopping && jobs->batch == batch)
+            pthread_cond_wait(&jobs->cond_start, &jobs->lock);
+        if (jobs->is_stopping)
+        {
+            pthread_mutex_unlock(&jobs->lock);
+            break;
+        }
+        batch = jobs->batch;
+        job_count = jobs->job_count;
+        callback = jobs->callback;
+        callback_data = jobs->user_data;
+        pthread_mutex_unlock(&jobs->lock);
+
+        // Run the jobs assigned to this worker.
+        ASSERT(callback != NULL);
+        for (uint32_t i = worker->idx; i < job_count; i += jobs->thread_count)
+            callback(jobs, i, worker->idx, callback_data);
+
+        // The last worker to finish wakes up the calling thread.
+        pthread_mutex_lock(&jobs->lock);
+        ASSERT(jobs->running > 0);
+        jobs->running--;
+        if (jobs->running == 0)
+            pthread_cond_signal(&jobs->cond_done);
+        pthread_mutex_unlock(&jobs->lock);
+    }
+
+    log_trace("job worker #%d stopped", worker->idx);
+    return NULL;
+}
+
+
+
+/*************************************************************************************************/
+/*  Job system                                                                                   */
+/*************************************************************************************************/
+
+DvzJobs* dvz_jobs(uint32_t thread_count)
+{
+    ASSERT(thread_count <= DVZ_JOBS_MAX_THREADS);
+    log_debug("creating job system with %d worker thread(s)", thread_count);
+
+    DvzJobs* jobs = calloc(1, sizeof(DvzJobs));
+    jobs->thread_count = thread_count;
+
+    if (pthread_mutex_init(&jobs->lock, NULL) != 0)
+        log_error("mutex creation failed");
+    if (pthread_cond_init(&jobs->cond_start, NULL) != 0)
+        log_error("cond creation failed");
+    if (pthread_cond_init(&jobs->cond_done, NULL) != 0)
+        log_error("cond creation failed");
+
+    for (uint32_t i = 0; i < thread_count; i++)
+    {
+        jobs->workers[i].jobs = jobs;
+        jobs->workers[i].idx = i;
+        jobs->workers[i].thread = dvz_thread(_jobs_worker, &jobs->workers[i]);
+    }
+
+    return jobs;
+}
+
+
+
+void dvz_jobs_run(DvzJobs* jobs, uint32_t job_count, DvzJobCallback callback, void* user_data)
+{
+    ASSERT(jobs != NULL);
+    ASSERT(callback != NULL);
+    if (job_count == 0)
+        return;
+
+    // Without worker threads, the jobs run on the calling thread.
+    if (jobs->thread_count == 0)
+    {
+        for (uint32_t i = 0; i < job_count; i++)
+            callback(jobs, i, 0, user_data);
+        return;
+    }
+
+    pthread_mutex_lock(&jobs->lock);
+    ASSERT(jobs->running == 0);
+    jobs->job_count = job_count;
+    jobs->callback = callback;
+    jobs->user_data = user_data;
+    jobs->running = jobs->thread_count;
+    jobs->batch++;
+    pthread_cond_broadcast(&jobs->cond_start);
+
+    // Wait until all workers have run their jobs.
+    while (jobs->running > 0)
+        pthread_cond_wait(&jobs->cond_done, &jobs->lock);
+    pthread_mutex_unlock(&jobs->lock);
+}
+
+
+
+void dvz_jobs_destroy(DvzJobs* jobs)
+{
+    ASSERT(jobs != NULL);
+
+    pthread_mutex_lock(&jobs->lock);
+    jobs->is_stopping = true;
+    pthread_cond_broadcast(&jobs->cond_start);
+    pthread_mutex_unlock(&jobs->lock);
+
+    for (uint32_t i = 0; i < jobs->thread_count; i++)
+        dvz_thread_join(&jobs->workers[i].thread);
+
+    pthread_mutex_destroy(&jobs->lock);
+    pthread_cond_destroy(&jobs->cond_start);
+    pthread_cond_destroy(&jobs->cond_done);
+    FREE(jobs);
+}
@@ -20,7 +20,11 @@
  * IN THE SOFTWARE.
  */
 
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,15 +39,73 @@ BEGIN_INCL_NO_WARN
 END_INCL_NO_WARN
 #endif
 
+#if defined(_MSC_VER)
+#define LOG_THREAD_LOCAL __declspec(thread)
+#else
+#define LOG_THREAD_LOCAL _Thread_local
+#endif
+
+#define LOG_BUFFER_SIZE    256 // number of records in each per-thread buffer, a power of 2
+#define LOG_MESSAGE_SIZE   224 // maximum length of a formatted message, longer ones are truncated
+#define LOG_FLUSH_INTERVAL 10  // maximum delay before the messages are written, in milliseconds
+
+typedef struct LogRecord LogRecord;
+typedef struct LogBuffer LogBuffer;
+
+struct LogRecord
+{
+    struct timespec time;
+    const char* file;
+    int line;
+    int level;
+    char msg[LOG_MESSAGE_SIZE];
+};
+
+// Single-producer single-consumer ring of records. The producer is the thread owning the buffer,
+// the consumer is whoever holds the write lock (normally the flusher thread). The buffers are
+// never freed: the buffer of an exited thread is reused by the next thread that logs a message.
+struct LogBuffer
+{
+    atomic_uint head;   // next record to write, only modified by the owner thread
+    atomic_uint tail;   // next record to write out, only modified under the write lock
+    atomic_bool in_use; // whether a thread owns the buffer
+    LogBuffer* next;    // next buffer in the global list
+    LogRecord records[LOG_BUFFER_SIZE];
+};
+
+int log_level_runtime = LOG_TRACE;
+
 static struct
 {
     void* udata;
     log_LockFn lock;
     FILE* fp;
-    int level;
     int quiet;
+    atomic_bool is_sync;
+
+    // Global lock-free list of the per-thread buffers.
+    _Atomic(LogBuffer*) buffers;
+    atomic_uint dropped;
+
+    // Flusher thread.
+    pthread_t flusher;
+    bool is_stopping;
+
+    // Local time of the last written record, only recomputed every second.
+    time_t last_sec;
+    char time_str[16];
+    char date_str[32];
 } L;
 
+// The write lock protects the output streams and the consumer side of the buffers.
+static pthread_mutex_t write_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t flusher_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flusher_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t flusher_once = PTHREAD_ONCE_INIT;
+static pthread_key_t buffer_key;
+
+static LOG_THREAD_LOCAL LogBuffer* thread_buffer;
+
 static const char* level_names[] = {"T", "D", "I", "W", "E", "F"};
 
 #ifdef LOG_USE_COLOR
@@ -71,72 +133,289 @@ void log_set_udata(void* udata) { L.udata = udata; }
 
 void log_set_lock(log_LockFn fn) { L.lock = fn; }
 
-void log_set_fp(FILE* fp) { L.fp = fp; }
-
 void log_set_level(int level)
 {
     // log_debug("set log level to %d", level);
-    L.level = level;
+    log_level_runtime = level;
 }
 
 void log_set_quiet(int enable) { L.quiet = enable ? 1 : 0; }
 
-void log_log(int level, const char* file, int line, const char* fmt, ...)
+void log_set_async(int enable)
 {
-    if (level < L.level)
-    {
-        return;
-    }
+    log_flush();
+    atomic_store(&L.is_sync, !enable);
+}
+
 
-    /* Acquire lock */
-    lock();
 
-    /* Get current time */
-    time_t t = time(NULL);
-    struct tm* lt = localtime(&t);
+/*************************************************************************************************/
+/*  Records                                                                                      */
+/*************************************************************************************************/
+
+static void
+_record(LogRecord* rec, int level, const char* file, int line, const char* fmt, va_list args)
+{
+    timespec_get(&rec->time, TIME_UTC);
+    rec->level = level;
+    rec->file = file;
+    rec->line = line;
+    int n = vsnprintf(rec->msg, LOG_MESSAGE_SIZE, fmt, args);
+    if (n >= LOG_MESSAGE_SIZE)
+        memcpy(&rec->msg[LOG_MESSAGE_SIZE - 4], "...", 4);
+}
+
+// Must be called with the write lock.
+static void _write_record(LogRecord* rec)
+{
+    int level = rec->level;
+    if (rec->time.tv_sec != L.last_sec)
+    {
+        L.last_sec = rec->time.tv_sec;
+        struct tm* lt = localtime(&L.last_sec);
+        L.time_str[strftime(L.time_str, sizeof(L.time_str), "%H:%M:%S", lt)] = '\0';
+        L.date_str[strftime(L.date_str, sizeof(L.date_str), "%Y-%m-%d %H:%M:%S", lt)] = '\0';
+    }
+    int ms = (int)(rec->time.tv_nsec / 1000000);
 
     /* Log to stderr */
     if (!L.quiet)
     {
-        va_list args;
-        char buf[16];
-        clock_t uptime = (clock() / (CLOCKS_PER_SEC / 1000)) % 1000;
-        buf[strftime(buf, sizeof(buf), "%H:%M:%S.    ", lt)] = '\0';
-        snprintf(&buf[9], 4, "%03d", (int)uptime);
-
 #ifdef LOG_USE_COLOR
         fprintf(
-            stderr, "%s %s%-1s\x1b[0m \x1b[90m%18s:%04d:\x1b[0m %s", buf, level_colors[level],
-            level_names[level], file, line, level_colors[level]);
+            stderr, "%s.%03d %s%-1s\x1b[0m \x1b[90m%18s:%04d:\x1b[0m %s%s\x1b[0m\n", L.time_str,
+            ms, level_colors[level], level_names[level], rec->file, rec->line,
+            level_colors[level], rec->msg);
 #else
-        fprintf(stderr, "%s %-5s %s:%d: ", buf, level_names[level], file, line);
-#endif
-        va_start(args, fmt);
-        vfprintf(stderr, fmt, args);
-        va_end(args);
-#ifdef LOG_USE_COLOR
-        fprintf(stderr, "\x1b[0m");
+        fprintf(
+            stderr, "%s.%03d %-5s %s:%d: %s\n", L.time_str, ms, level_names[level], rec->file,
+            rec->line, rec->msg);
 #endif
-        fprintf(stderr, "\n");
-        fflush(stderr);
     }
 
     /* Log to file */
     if (L.fp)
     {
-        va_list args;
-        char buf[32];
-        buf[strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", lt)] = '\0';
-        fprintf(L.fp, "%s %-5s %s:%d: ", buf, level_names[level], file, line);
+        fprintf(
+            L.fp, "%s %-5s %s:%d: %s\n", L.date_str, level_names[level], rec->file, rec->line,
+            rec->msg);
+    }
+}
+
+
+
+/*************************************************************************************************/
+/*  Per-thread buffers                                                                           */
+/*************************************************************************************************/
+
+static void _buffer_release(void* user_data)
+{
+    LogBuffer* buf = (LogBuffer*)user_data;
+    atomic_store(&buf->in_use, false);
+}
+
+static LogBuffer* _buffer_acquire(void)
+{
+    // Reuse the buffer of an exited thread.
+    LogBuffer* buf = atomic_load(&L.buffers);
+    bool expected = false;
+    for (; buf != NULL; buf = buf->next)
+    {
+        expected = false;
+        if (atomic_compare_exchange_strong(&buf->in_use, &expected, true))
+            break;
+    }
+
+    // Or push a new buffer at the head of the global list.
+    if (buf == NULL)
+    {
+        buf = calloc(1, sizeof(LogBuffer));
+        atomic_store(&buf->in_use, true);
+        LogBuffer* head = atomic_load(&L.buffers);
+        do
+            buf->next = head;
+        while (!atomic_compare_exchange_weak(&L.buffers, &head, buf));
+    }
+
+    // The buffer is released when the thread exits.
+    pthread_setspecific(buffer_key, buf);
+    return buf;
+}
+
+// Write out the pending records of all threads, sorted by time. Return the number of records.
+static uint32_t _drain(void)
+{
+    uint32_t count = 0;
+    while (true)
+    {
+        LogBuffer* next = NULL;
+        LogRecord* rec = NULL;
+        LogRecord* cur = NULL;
+        for (LogBuffer* buf = atomic_load(&L.buffers); buf != NULL; buf = buf->next)
+        {
+            uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_relaxed);
+            if (tail == atomic_load_explicit(&buf->head, memory_order_acquire))
+                continue;
+            cur = &buf->records[tail % LOG_BUFFER_SIZE];
+            if (rec == NULL || cur->time.tv_sec < rec->time.tv_sec ||
+                (cur->time.tv_sec == rec->time.tv_sec && cur->time.tv_nsec < rec->time.tv_nsec))
+            {
+                rec = cur;
+                next = buf;
+            }
+        }
+        if (rec == NULL)
+            break;
+
+        _write_record(rec);
+        atomic_fetch_add_explicit(&next->tail, 1, memory_order_release);
+        count++;
+    }
+
+    uint32_t dropped = atomic_exchange(&L.dropped, 0);
+    if (dropped > 0 && !L.quiet)
+        fprintf(stderr, "%u log message(s) dropped, the log buffer was full\n", dropped);
+    return count;
+}
+
+void log_flush(void)
+{
+    pthread_mutex_lock(&write_lock);
+    lock();
+    if (_drain() > 0)
+    {
+        fflush(stderr);
+        if (L.fp)
+            fflush(L.fp);
+    }
+    unlock();
+    pthread_mutex_unlock(&write_lock);
+}
+
+void log_set_fp(FILE* fp)
+{
+    // The pending messages go to the previous stream. The swap happens under the write lock as
+    // the flusher thread reads L.fp.
+    pthread_mutex_lock(&write_lock);
+    lock();
+    _drain();
+    fflush(stderr);
+    if (L.fp)
+        fflush(L.fp);
+    L.fp = fp;
+    unlock();
+    pthread_mutex_unlock(&write_lock);
+}
+
+
+
+/*************************************************************************************************/
+/*  Flusher thread                                                                               */
+/*************************************************************************************************/
+
+static void* _flusher(void* user_data)
+{
+    struct timespec ts = {0};
+    pthread_mutex_lock(&flusher_lock);
+    while (!L.is_stopping)
+    {
+        timespec_get(&ts, TIME_UTC);
+        ts.tv_nsec += LOG_FLUSH_INTERVAL * 1000000L;
+        ts.tv_sec += ts.tv_nsec / 1000000000L;
+        ts.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&flusher_cond, &flusher_lock, &ts);
+
+        pthread_mutex_unlock(&flusher_lock);
+        log_flush();
+        pthread_mutex_lock(&flusher_lock);
+    }
+    pthread_mutex_unlock(&flusher_lock);
+    return NULL;
+}
+
+static void _flusher_stop(void)
+{
+    pthread_mutex_lock(&flusher_lock);
+    L.is_stopping = true;
+    pthread_cond_signal(&flusher_cond);
+    pthread_mutex_unlock(&flusher_lock);
+    pthread_join(L.flusher, NULL);
+    log_flush();
+}
+
+static void _flusher_start(void)
+{
+    pthread_key_create(&buffer_key, _buffer_release);
+    pthread_create(&L.flusher, NULL, _flusher, NULL);
+    atexit(_flusher_stop);
+}
+
+
+
+/*************************************************************************************************/
+/*  Logging                                                                                      */
+/*************************************************************************************************/
+
+void log_log(int level, const char* file, int line, const char* fmt, ...)
+{
+    if (level < log_level_runtime)
+    {
+        return;
+    }
+
+    va_list args;
+
+    // Synchronous mode: write the message on the calling thread, after the pending ones.
+    if (atomic_load_explicit(&L.is_sync, memory_order_relaxed))
+    {
+        LogRecord rec = {0};
         va_start(args, fmt);
-        vfprintf(L.fp, fmt, args);
+        _record(&rec, level, file, line, fmt, args);
         va_end(args);
-        fprintf(L.fp, "\n");
-        fflush(L.fp);
+
+        pthread_mutex_lock(&write_lock);
+        lock();
+        _drain();
+        _write_record(&rec);
+        fflush(stderr);
+        if (L.fp)
+            fflush(L.fp);
+        unlock();
+        pthread_mutex_unlock(&write_lock);
+        return;
     }
 
-    /* Release lock */
-    unlock();
+    pthread_once(&flusher_once, _flusher_start);
+    LogBuffer* buf = thread_buffer;
+    if (buf == NULL)
+        buf = thread_buffer = _buffer_acquire();
+
+    uint32_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
+    if (head - tail >= LOG_BUFFER_SIZE)
+    {
+        // When the buffer is full, the least important messages are dropped rather than
+        // blocking the calling thread, the other ones are written out by the calling thread.
+        if (level < LOG_INFO)
+        {
+            atomic_fetch_add(&L.dropped, 1);
+            return;
+        }
+        while (head - atomic_load_explicit(&buf->tail, memory_order_acquire) >= LOG_BUFFER_SIZE)
+            log_flush();
+    }
+
+    // Format the message directly into the next record.
+    va_start(args, fmt);
+    _record(&buf->records[head % LOG_BUFFER_SIZE], level, file, line, fmt, args);
+    va_end(args);
+    atomic_store_explicit(&buf->head, head + 1, memory_order_release);
+
+    // Errors are written immediately, in case the process aborts.
+    if (level >= LOG_ERROR)
+        log_flush();
+    else if (head + 1 - tail >= LOG_BUFFER_SIZE / 2)
+        pthread_cond_signal(&flusher_cond);
 }
 
 void log_set_level_env(void)
@@ -146,4 +425,9 @@ void log_set_level_env(void)
     if (level != NULL)
         level_int = strtol(level, NULL, 10);
     log_set_level(level_int);
+
+    // DVZ_LOG_ASYNC=0 writes the messages on the calling threads, for debugging crashes.
+    const char* async = getenv("DVZ_LOG_ASYNC");
+    if (async != NULL)
+        log_set_async(strtol(async, NULL, 10) != 0);
 }
@@ -0,0 +1,48 @@
+#include "../include/datoviz/memory.h"
+
+
+
+/*************************************************************************************************/
+/*  Arrays                                                                                       */
+/*************************************************************************************************/
+
+// The arrays may be created and destroyed from any thread.
+static atomic(int64_t, array_bytes);
+static atomic(int32_t, array_count);
+
+
+
+void dvz_memory_arrays_track(int64_t size, int32_t count)
+{
+    if (size != 0)
+        atomic_fetch_add(&array_bytes, size);
+    if (count != 0)
+        atomic_fetch_add(&array_count, count);
+}
+
+
+
+DvzMemoryUsage dvz_memory_arrays(void)
+{
+    DvzMemoryUsage usage = {0};
+    int64_t bytes = atomic_load(&array_bytes);
+    int32_t count = atomic_load(&array_count);
+    ASSERT(bytes >= 0);
+    ASSERT(count >= 0);
+    usage.host = (uint64_t)bytes;
+    usage.array_count = (uint32_t)count;
+    return usage;
+}
+
+
+
+void dvz_memory_add(DvzMemoryUsage* total, DvzMemoryUsage usage)
+{
+    ASSERT(total != NULL);
+    total->host += usage.host;
+    total->device += usage.device;
+    total->device_total += usage.device_total;
+    total->array_count += usage.array_count;
+    total->region_count += usage.region_count;
+    total->texture_count += usage.texture_count;
+}
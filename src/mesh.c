@@ -1,5 +1,10 @@
 #include "../include/datoviz/mesh.h"
 #include "../include/datoviz/common.h"
+#include "mesh_utils.h"
+
+#if !OS_WIN32
+#include <sys/mman.h>
+#endif
 
 
 
@@ -145,47 +150,518 @@ void dvz_mesh_normalize(DvzMesh* mesh)
 
 
 
+/*************************************************************************************************/
+/*  Mesh normals                                                                                 */
+/*************************************************************************************************/
+
+// Per-thread partial sums of the face normals. The first chunk accumulates directly into the
+// vertex normals, the other ones into their own zero-initialized buffer.
+typedef struct MeshNormals MeshNormals;
+
+struct MeshNormals
+{
+    DvzMesh* mesh;
+    vec3* partial[DVZ_MESH_MAX_THREADS];
+    uint32_t thread_count;
+};
+
+
+
+static void _face_normals(void* user_data, uint32_t chunk, uint32_t begin, uint32_t end)
+{
+    MeshNormals* normals = (MeshNormals*)user_data;
+    DvzMesh* mesh = normals->mesh;
+    const DvzIndex* indices = (const DvzIndex*)mesh->indices.data;
+    DvzGraphicsMeshVertex* vertices = (DvzGraphicsMeshVertex*)mesh->vertices.data;
+    vec3* partial = normals->partial[chunk];
+
+    DvzIndex i0, i1, i2;
+    vec3 u, v, n;
+    for (uint32_t i = begin; i < end; i++)
+    {
+        i0 = indices[3 * i + 0];
+        i1 = indices[3 * i + 1];
+        i2 = indices[3 * i + 2];
+
+        glm_vec3_sub(vertices[i1].pos, vertices[i0].pos, u);
+        glm_vec3_sub(vertices[i2].pos, vertices[i0].pos, v);
+        // n is the normalized vector orthogonal to the current face
+        glm_vec3_crossn(u, v, n);
+
+        // Add the face normal to the current vertex normal.
+        if (partial == NULL)
+        {
+            glm_vec3_add(vertices[i0].normal, n, vertices[i0].normal);
+            glm_vec3_add(vertices[i1].normal, n, vertices[i1].normal);
+            glm_vec3_add(vertices[i2].normal, n, vertices[i2].normal);
+        }
+        else
+        {
+            glm_vec3_add(partial[i0], n, partial[i0]);
+            glm_vec3_add(partial[i1], n, partial[i1]);
+            glm_vec3_add(partial[i2], n, partial[i2]);
+        }
+    }
+}
+
+
+
+static void _vertex_normals(void* user_data, uint32_t chunk, uint32_t begin, uint32_t end)
+{
+    MeshNormals* normals = (MeshNormals*)user_data;
+    DvzGraphicsMeshVertex* vertices = (DvzGraphicsMeshVertex*)normals->mesh->vertices.data;
+    for (uint32_t i = begin; i < end; i++)
+    {
+        // Reduce the partial sums in a fixed order, so that the result does not depend on the
+        // thread scheduling.
+        for (uint32_t k = 1; k < normals->thread_count; k++)
+            glm_vec3_add(vertices[i].normal, normals->partial[k][i], vertices[i].normal);
+        glm_vec3_normalize(vertices[i].normal);
+    }
+}
+
+
+
 void dvz_mesh_normals(DvzMesh* mesh)
 {
     ASSERT(mesh != NULL);
     log_debug("recompute mesh normals");
 
-    DvzIndex i0, i1, i2;
-    DvzGraphicsMeshVertex *v0, *v1, *v2;
-    vec3 u, v, n;
+    uint32_t vertex_count = mesh->vertices.item_count;
+    uint32_t face_count = mesh->indices.item_count / 3;
+    uint32_t thread_count = _mesh_thread_count(face_count, DVZ_MESH_PARALLEL_FACES);
+
+    // Each thread scatters the normals of a range of faces into its own buffer, then each thread
+    // reduces the buffers for a range of vertices and normalizes the result. Small meshes are
+    // processed serially, directly in the vertex normals.
+    if (thread_count > 1)
+        log_debug("compute the normals of %d faces with %d threads", face_count, thread_count);
+    MeshNormals normals = {0};
+    normals.mesh = mesh;
+    normals.thread_count = thread_count;
+    for (uint32_t k = 1; k < thread_count; k++)
+        normals.partial[k] = calloc(vertex_count, sizeof(vec3));
+
+    _mesh_parallel(face_count, thread_count, _face_normals, &normals);
+    _mesh_parallel(vertex_count, thread_count, _vertex_normals, &normals);
+
+    for (uint32_t k = 1; k < thread_count; k++)
+        FREE(normals.partial[k]);
+}
+
+
+
+/*************************************************************************************************/
+/*  Mesh optimization                                                                            */
+/*************************************************************************************************/
+
+// Vertex-to-face adjacency in compressed sparse row format: the faces adjacent to vertex i are
+// faces[offsets[i]:offsets[i + 1]], in increasing order.
+typedef struct MeshAdjacency MeshAdjacency;
+
+struct MeshAdjacency
+{
+    uint32_t* offsets;
+    uint32_t* faces;
+};
+
+
+
+static MeshAdjacency _mesh_adjacency(const DvzIndex* indices, uint32_t face_count, uint32_t nv)
+{
+    MeshAdjacency adj = {0};
+    adj.offsets = calloc(nv + 1, sizeof(uint32_t));
+    adj.faces = calloc(MAX(3 * face_count, 1), sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < 3 * face_count; i++)
+    {
+        ASSERT(indices[i] < nv);
+        adj.offsets[indices[i] + 1]++;
+    }
+    for (uint32_t i = 0; i < nv; i++)
+        adj.offsets[i + 1] += adj.offsets[i];
+
+    // Fill in increasing face order, using a per-vertex write cursor.
+    uint32_t* cursor = calloc(MAX(nv, 1), sizeof(uint32_t));
+    memcpy(cursor, adj.offsets, nv * sizeof(uint32_t));
+    for (uint32_t i = 0; i < 3 * face_count; i++)
+        adj.faces[cursor[indices[i]]++] = i / 3;
+    FREE(cursor);
+
+    return adj;
+}
+
+
+
+static void _mesh_adjacency_destroy(MeshAdjacency* adj)
+{
+    ASSERT(adj != NULL);
+    FREE(adj->offsets);
+    FREE(adj->faces);
+}
+
+
+
+// Simulate a FIFO vertex cache with timestamps: a vertex is in the cache if it was added less
+// than cache_size misses ago. Return the number of misses of a triangle.
+static inline uint32_t _fifo_triangle(
+    const DvzIndex* tri, uint32_t* timestamps, uint32_t* timestamp, uint32_t cache_size)
+{
+    uint32_t misses = 0;
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        if (*timestamp - timestamps[tri[k]] > cache_size)
+        {
+            timestamps[tri[k]] = (*timestamp)++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+
+
+// Reset the FIFO cache without clearing the timestamps.
+static inline void _fifo_reset(uint32_t* timestamp, uint32_t cache_size)
+{
+    *timestamp += cache_size + 1;
+}
+
+
+
+double dvz_mesh_acmr(DvzMesh* mesh, uint32_t cache_size)
+{
+    ASSERT(mesh != NULL);
+    ASSERT(cache_size > 0);
 
     uint32_t vertex_count = mesh->vertices.item_count;
     uint32_t face_count = mesh->indices.item_count / 3;
+    if (face_count == 0)
+        return 0;
 
-    // Go through all triangle faces.
+    const DvzIndex* indices = (const DvzIndex*)mesh->indices.data;
+    uint32_t* timestamps = calloc(MAX(vertex_count, 1), sizeof(uint32_t));
+    uint32_t timestamp = cache_size + 1;
+    uint64_t misses = 0;
     for (uint32_t i = 0; i < face_count; i++)
-    {
-        i0 = ((DvzIndex*)mesh->indices.data)[3 * i + 0];
-        i1 = ((DvzIndex*)mesh->indices.data)[3 * i + 1];
-        i2 = ((DvzIndex*)mesh->indices.data)[3 * i + 2];
+        misses += _fifo_triangle(&indices[3 * i], timestamps, &timestamp, cache_size);
+    FREE(timestamps);
 
-        v0 = &((DvzGraphicsMeshVertex*)mesh->vertices.data)[i0];
-        v1 = &((DvzGraphicsMeshVertex*)mesh->vertices.data)[i1];
-        v2 = &((DvzGraphicsMeshVertex*)mesh->vertices.data)[i2];
+    return misses / (double)face_count;
+}
 
-        glm_vec3_sub(v1->pos, v0->pos, u);
-        glm_vec3_sub(v2->pos, v0->pos, v);
-        // n is the normalized vector orthogonal to the current face
-        glm_vec3_crossn(u, v, n);
 
-        // Add the face normal to the current vertex normal.
-        glm_vec3_add(v0->normal, n, v0->normal);
-        glm_vec3_add(v1->normal, n, v1->normal);
-        glm_vec3_add(v2->normal, n, v2->normal);
+
+// Vertex score from "Linear-Speed Vertex Cache Optimisation", Tom Forsyth, 2006.
+static float _forsyth_score(int32_t cache_pos, uint32_t live_count)
+{
+    if (live_count == 0)
+        return -1;
+
+    float score = 0;
+    if (cache_pos >= 0)
+    {
+        // The vertices of the last triangle get a fixed score, whatever their order.
+        if (cache_pos < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - (cache_pos - 3) / (float)(DVZ_MESH_CACHE_SIZE - 3), 1.5f);
     }
 
-    // Normalize all normals since every vertex might contain the sum of many normals.
-    vec3* normal = NULL;
+    // Boost the vertices with few remaining triangles, to avoid leaving lone triangles behind.
+    score += 2.0f / sqrtf((float)live_count);
+    return score;
+}
+
+
+
+void dvz_mesh_optimize_cache(DvzMesh* mesh)
+{
+    ASSERT(mesh != NULL);
+    log_debug("optimize the mesh index buffer for the vertex cache");
+
+    uint32_t vertex_count = mesh->vertices.item_count;
+    uint32_t face_count = mesh->indices.item_count / 3;
+    if (face_count == 0)
+        return;
+
+    DvzIndex* indices = (DvzIndex*)mesh->indices.data;
+    MeshAdjacency adj = _mesh_adjacency(indices, face_count, vertex_count);
+
+    // Per-vertex state. The live faces of vertex i are adj.faces[offsets[i]:offsets[i]+live[i]],
+    // emitted faces are swapped to the end of the range.
+    uint32_t* live = calloc(vertex_count, sizeof(uint32_t));
+    int32_t* cache_pos = calloc(vertex_count, sizeof(int32_t));
+    float* vertex_score = calloc(vertex_count, sizeof(float));
     for (uint32_t i = 0; i < vertex_count; i++)
     {
-        normal = &((DvzGraphicsMeshVertex*)dvz_array_item(&mesh->vertices, i))->normal;
-        glm_vec3_normalize(*normal);
+        live[i] = adj.offsets[i + 1] - adj.offsets[i];
+        cache_pos[i] = -1;
+        vertex_score[i] = _forsyth_score(-1, live[i]);
+    }
+
+    // Per-face state.
+    float* face_score = calloc(face_count, sizeof(float));
+    bool* emitted = calloc(face_count, sizeof(bool));
+    for (uint32_t i = 0; i < face_count; i++)
+    {
+        face_score[i] = vertex_score[indices[3 * i + 0]] + vertex_score[indices[3 * i + 1]] +
+                        vertex_score[indices[3 * i + 2]];
+    }
+
+    DvzIndex* output = calloc(3 * face_count, sizeof(DvzIndex));
+    uint32_t cache[DVZ_MESH_CACHE_SIZE + 3] = {0};
+    uint32_t cache_new[DVZ_MESH_CACHE_SIZE + 3] = {0};
+    uint32_t cache_count = 0, cache_new_count = 0;
+
+    // When no face in the cache has live faces left, continue with the next face in input order.
+    uint32_t cursor = 0;
+    int64_t best = -1;
+    float best_score = -1;
+    for (uint32_t i = 0; i < face_count; i++)
+        if (face_score[i] > best_score)
+        {
+            best = i;
+            best_score = face_score[i];
+        }
+
+    DvzIndex v = 0;
+    uint32_t f = 0;
+    for (uint32_t n = 0; n < face_count; n++)
+    {
+        if (best < 0)
+        {
+            while (emitted[cursor])
+                cursor++;
+            best = cursor;
+        }
+        f = (uint32_t)best;
+        ASSERT(!emitted[f]);
+        emitted[f] = true;
+        memcpy(&output[3 * n], &indices[3 * f], 3 * sizeof(DvzIndex));
+
+        // Remove the face from the live faces of its vertices.
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            v = indices[3 * f + k];
+            uint32_t* faces = &adj.faces[adj.offsets[v]];
+            for (uint32_t l = 0; l < live[v]; l++)
+            {
+                if (faces[l] == f)
+                {
+                    faces[l] = faces[live[v] - 1];
+                    faces[live[v] - 1] = f;
+                    live[v]--;
+                    break;
+                }
+            }
+        }
+
+        // New cache: the face vertices first, then the previous cache contents.
+        cache_new_count = 0;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            v = indices[3 * f + k];
+            bool found = false;
+            for (uint32_t l = 0; l < cache_new_count; l++)
+                found |= cache_new[l] == v;
+            if (!found)
+                cache_new[cache_new_count++] = v;
+        }
+        for (uint32_t l = 0; l < cache_count; l++)
+        {
+            v = cache[l];
+            if (v != indices[3 * f + 0] && v != indices[3 * f + 1] && v != indices[3 * f + 2])
+                cache_new[cache_new_count++] = v;
+        }
+
+        // Update the scores of the vertices in the cache, or pushed out of it, and of their
+        // live faces. The next face is the best live face touching the cache.
+        best = -1;
+        best_score = -1;
+        for (uint32_t l = 0; l < cache_new_count; l++)
+        {
+            v = cache_new[l];
+            cache_pos[v] = l < DVZ_MESH_CACHE_SIZE ? (int32_t)l : -1;
+            float score = _forsyth_score(cache_pos[v], live[v]);
+            float delta = score - vertex_score[v];
+            vertex_score[v] = score;
+            for (uint32_t k = 0; k < live[v]; k++)
+            {
+                uint32_t g = adj.faces[adj.offsets[v] + k];
+                face_score[g] += delta;
+                if (face_score[g] > best_score)
+                {
+                    best = g;
+                    best_score = face_score[g];
+                }
+            }
+        }
+
+        cache_count = MIN(cache_new_count, DVZ_MESH_CACHE_SIZE);
+        memcpy(cache, cache_new, cache_count * sizeof(uint32_t));
+    }
+
+    memcpy(indices, output, 3 * face_count * sizeof(DvzIndex));
+
+    FREE(output);
+    FREE(emitted);
+    FREE(face_score);
+    FREE(vertex_score);
+    FREE(cache_pos);
+    FREE(live);
+    _mesh_adjacency_destroy(&adj);
+}
+
+
+
+typedef struct MeshCluster MeshCluster;
+
+struct MeshCluster
+{
+    uint32_t first, count; // range of faces
+    float sort_key;
+};
+
+
+
+static int _cluster_compare(const void* a, const void* b)
+{
+    // Decreasing sort key, then increasing first face for a deterministic order.
+    const MeshCluster* ca = (const MeshCluster*)a;
+    const MeshCluster* cb = (const MeshCluster*)b;
+    if (ca->sort_key != cb->sort_key)
+        return ca->sort_key < cb->sort_key ? +1 : -1;
+    return ca->first < cb->first ? -1 : (ca->first > cb->first ? +1 : 0);
+}
+
+
+
+void dvz_mesh_optimize_overdraw(DvzMesh* mesh, float threshold)
+{
+    ASSERT(mesh != NULL);
+    ASSERT(threshold >= 1);
+    log_debug("optimize the mesh index buffer for overdraw with threshold %.2f", threshold);
+
+    uint32_t vertex_count = mesh->vertices.item_count;
+    uint32_t face_count = mesh->indices.item_count / 3;
+    if (face_count == 0)
+        return;
+
+    DvzIndex* indices = (DvzIndex*)mesh->indices.data;
+    const DvzGraphicsMeshVertex* vertices = (const DvzGraphicsMeshVertex*)mesh->vertices.data;
+    const uint32_t cache_size = DVZ_MESH_FIFO_SIZE;
+
+    uint32_t* timestamps = calloc(vertex_count, sizeof(uint32_t));
+    uint32_t timestamp = cache_size + 1;
+
+    // Hard boundaries: the faces where all vertices miss the cache. Reordering the clusters
+    // between these boundaries does not change the cache efficiency much.
+    uint32_t* hard = calloc(face_count + 1, sizeof(uint32_t));
+    uint32_t hard_count = 0;
+    for (uint32_t i = 0; i < face_count; i++)
+    {
+        if (_fifo_triangle(&indices[3 * i], timestamps, &timestamp, cache_size) == 3 || i == 0)
+            hard[hard_count++] = i;
+    }
+    hard[hard_count] = face_count;
+
+    // Soft boundaries: within each hard cluster, split as soon as the ACMR of the current
+    // cluster, with a cold cache, is below the threshold times the ACMR of the hard cluster.
+    MeshCluster* clusters = calloc(face_count, sizeof(MeshCluster));
+    uint32_t cluster_count = 0;
+    for (uint32_t c = 0; c < hard_count; c++)
+    {
+        uint32_t start = hard[c], end = hard[c + 1];
+
+        _fifo_reset(&timestamp, cache_size);
+        uint32_t misses = 0;
+        for (uint32_t i = start; i < end; i++)
+            misses += _fifo_triangle(&indices[3 * i], timestamps, &timestamp, cache_size);
+        float cluster_threshold = threshold * misses / (float)(end - start);
+
+        _fifo_reset(&timestamp, cache_size);
+        uint32_t running_misses = 0, first = start;
+        for (uint32_t i = start; i < end; i++)
+        {
+            running_misses += _fifo_triangle(&indices[3 * i], timestamps, &timestamp, cache_size);
+            if (running_misses <= cluster_threshold * (i - first + 1) || i == end - 1)
+            {
+                clusters[cluster_count].first = first;
+                clusters[cluster_count].count = i - first + 1;
+                cluster_count++;
+                first = i + 1;
+                running_misses = 0;
+                _fifo_reset(&timestamp, cache_size);
+            }
+        }
+    }
+    FREE(hard);
+    FREE(timestamps);
+
+    // Sort the clusters so that those facing away from the mesh center are drawn first, as they
+    // are the most likely to occlude the others.
+    vec3 center = {0}, centroid, normal, u, v, n;
+    float area = 0, total_area = 0;
+    const float *p0, *p1, *p2;
+    for (uint32_t i = 0; i < face_count; i++)
+    {
+        p0 = vertices[indices[3 * i + 0]].pos;
+        p1 = vertices[indices[3 * i + 1]].pos;
+        p2 = vertices[indices[3 * i + 2]].pos;
+        glm_vec3_sub((float*)p1, (float*)p0, u);
+        glm_vec3_sub((float*)p2, (float*)p0, v);
+        glm_vec3_cross(u, v, n);
+        area = glm_vec3_norm(n);
+        for (uint32_t k = 0; k < 3; k++)
+            center[k] += area * (p0[k] + p1[k] + p2[k]) / 3.0f;
+        total_area += area;
     }
+    if (total_area > 0)
+        glm_vec3_scale(center, 1.0f / total_area, center);
+
+    for (uint32_t c = 0; c < cluster_count; c++)
+    {
+        glm_vec3_zero(centroid);
+        glm_vec3_zero(normal);
+        total_area = 0;
+        for (uint32_t i = clusters[c].first; i < clusters[c].first + clusters[c].count; i++)
+        {
+            p0 = vertices[indices[3 * i + 0]].pos;
+            p1 = vertices[indices[3 * i + 1]].pos;
+            p2 = vertices[indices[3 * i + 2]].pos;
+            glm_vec3_sub((float*)p1, (float*)p0, u);
+            glm_vec3_sub((float*)p2, (float*)p0, v);
+            glm_vec3_cross(u, v, n);
+            // The cross product norm is twice the face area, which weighs the face normal.
+            area = glm_vec3_norm(n);
+            for (uint32_t k = 0; k < 3; k++)
+                centroid[k] += area * (p0[k] + p1[k] + p2[k]) / 3.0f;
+            glm_vec3_add(normal, n, normal);
+            total_area += area;
+        }
+        if (total_area > 0)
+            glm_vec3_scale(centroid, 1.0f / total_area, centroid);
+        glm_vec3_normalize(normal);
+        glm_vec3_sub(centroid, center, centroid);
+        clusters[c].sort_key = glm_vec3_dot(centroid, normal);
+    }
+    qsort(clusters, cluster_count, sizeof(MeshCluster), _cluster_compare);
+
+    DvzIndex* output = calloc(3 * face_count, sizeof(DvzIndex));
+    uint32_t offset = 0;
+    for (uint32_t c = 0; c < cluster_count; c++)
+    {
+        memcpy(
+            &output[offset], &indices[3 * clusters[c].first],
+            3 * clusters[c].count * sizeof(DvzIndex));
+        offset += 3 * clusters[c].count;
+    }
+    ASSERT(offset == 3 * face_count);
+    memcpy(indices, output, 3 * face_count * sizeof(DvzIndex));
+
+    FREE(output);
+    FREE(clusters);
 }
 
 
@@ -587,6 +1063,18 @@ DvzMesh dvz_mesh_disc(uint32_t count)
 void dvz_mesh_destroy(DvzMesh* mesh)
 {
     ASSERT(mesh != NULL);
+    if (mesh->mapped != NULL)
+    {
+        // The arrays point to the memory-mapped cache file, they do not own their data.
+        dvz_memory_arrays_track(-(int64_t)mesh->vertices.buffer_size, 0);
+        dvz_memory_arrays_track(-(int64_t)mesh->indices.buffer_size, 0);
+        mesh->vertices.data = NULL;
+        mesh->indices.data = NULL;
+#if !OS_WIN32
+        munmap(mesh->mapped, mesh->mapped_size);
+#endif
+        mesh->mapped = NULL;
+    }
     dvz_array_destroy(&mesh->vertices);
     dvz_array_destroy(&mesh->indices);
 }
@@ -0,0 +1,1551 @@
+#include "../include/datoviz/colormaps.h"
+#include "../include/datoviz/mesh.h"
+#include "mesh_utils.h"
+
+#include <ctype.h>
+#include <sys/stat.h>
+#if !OS_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define MESH_NONE          UINT32_MAX
+#define MESH_CACHE_MAGIC   "DVZMESH"
+#define MESH_CACHE_VERSION 1
+#define MESH_CACHE_ALIGN   64
+#define PLY_MAX_PROPERTIES 32
+#define PLY_MAX_ELEMENTS   8
+
+
+
+/*************************************************************************************************/
+/*  File                                                                                         */
+/*************************************************************************************************/
+
+typedef struct MeshFile MeshFile;
+
+struct MeshFile
+{
+    const char* data;
+    size_t size;
+    bool mapped;
+};
+
+
+
+static bool _mesh_file_open(const char* path, MeshFile* file)
+{
+    ASSERT(path != NULL);
+    ASSERT(file != NULL);
+    memset(file, 0, sizeof(MeshFile));
+
+#if OS_WIN32
+    // NOTE: no memory mapping on Windows yet, the whole file is read in memory.
+    file->data = (const char*)dvz_read_file(path, &file->size);
+    return file->data != NULL;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st = {0};
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+    file->size = (size_t)st.st_size;
+    void* data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping remains valid after the file descriptor is closed.
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    madvise(data, file->size, MADV_SEQUENTIAL);
+    file->data = (const char*)data;
+    file->mapped = true;
+    return true;
+#endif
+}
+
+
+
+static void _mesh_file_close(MeshFile* file)
+{
+    ASSERT(file != NULL);
+#if !OS_WIN32
+    if (file->mapped && file->data != NULL)
+        munmap((void*)file->data, file->size);
+#endif
+    if (!file->mapped)
+        free((void*)file->data);
+    file->data = NULL;
+}
+
+
+
+static bool _mesh_file_stat(const char* path, uint64_t* size, int64_t* mtime)
+{
+    struct stat st = {0};
+    if (stat(path, &st) != 0)
+        return false;
+    *size = (uint64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+
+
+/*************************************************************************************************/
+/*  Parsing utils                                                                                */
+/*************************************************************************************************/
+
+static inline const char* _skip_spaces(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p;
+}
+
+
+
+static inline const char* _next_line(const char* p, const char* end)
+{
+    const char* eol = (const char*)memchr(p, '\n', (size_t)(end - p));
+    return eol != NULL ? eol + 1 : end;
+}
+
+
+
+static inline bool _is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+
+
+static const double POW10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+
+
+// Parse a decimal number bounded by the end pointer (the file is not null-terminated). This is
+// much faster than strtod(), with an error of a few ulps in double precision.
+static bool _parse_double(const char** pp, const char* end, double* out)
+{
+    const char* p = _skip_spaces(*pp, end);
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int32_t exponent = 0, digits = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+    {
+        if (mantissa < 1000000000000000000ULL)
+            mantissa = 10 * mantissa + (uint64_t)(*p - '0');
+        else
+            exponent++;
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+        {
+            if (mantissa < 1000000000000000000ULL)
+            {
+                mantissa = 10 * mantissa + (uint64_t)(*p - '0');
+                exponent--;
+            }
+        }
+    }
+    if (digits == 0)
+        return false;
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+        bool exp_neg = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            exp_neg = *q++ == '-';
+        int32_t e = 0;
+        if (q < end && *q >= '0' && *q <= '9')
+        {
+            for (; q < end && *q >= '0' && *q <= '9'; q++)
+                e = MIN(10 * e + (*q - '0'), 10000);
+            exponent += exp_neg ? -e : e;
+            p = q;
+        }
+    }
+
+    double value = (double)mantissa;
+    if (exponent < 0)
+        value = -exponent <= 22 ? value / POW10[-exponent] : value * pow(10, exponent);
+    else if (exponent > 0)
+        value = exponent <= 22 ? value * POW10[exponent] : value * pow(10, exponent);
+    *out = neg ? -value : value;
+    *pp = p;
+    return true;
+}
+
+
+
+static inline bool _parse_float(const char** pp, const char* end, float* out)
+{
+    double value = 0;
+    if (!_parse_double(pp, end, &value))
+        return false;
+    *out = (float)value;
+    return true;
+}
+
+
+
+static inline bool _parse_int(const char** pp, const char* end, int64_t* out)
+{
+    const char* p = *pp;
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = *p++ == '-';
+    if (p >= end || *p < '0' || *p > '9')
+        return false;
+    int64_t value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+        value = 10 * value + (*p - '0');
+    *out = neg ? -value : value;
+    *pp = p;
+    return true;
+}
+
+
+
+/*************************************************************************************************/
+/*  Vertex deduplication                                                                         */
+/*************************************************************************************************/
+
+static inline uint64_t _key_hash(const uint32_t* key)
+{
+    uint64_t h = key[0] * 0x9E3779B97F4A7C15ULL;
+    h ^= (key[1] + 0x632BE59BD9B4E019ULL) * 0xC2B2AE3D27D4EB4FULL;
+    h ^= (key[2] + 0x165667B19E3779F9ULL) * 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+
+
+// Merge the items with the same 3-uint32 key. remap[i] is the vertex of item i, and first[v] is
+// the first item of vertex v. Return the number of vertices.
+static uint32_t _dedup(const uint32_t* keys, uint32_t count, uint32_t* remap, uint32_t* first)
+{
+    ASSERT(keys != NULL);
+    ASSERT(remap != NULL);
+    ASSERT(first != NULL);
+
+    uint64_t capacity = dvz_next_pow2(2 * (uint64_t)MAX(count, 1));
+    uint64_t mask = capacity - 1;
+    uint32_t* table = malloc(capacity * sizeof(uint32_t));
+    memset(table, 0xFF, capacity * sizeof(uint32_t)); // MESH_NONE
+
+    uint32_t vertex_count = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t* key = &keys[3 * i];
+        // Linear probing.
+        uint64_t slot = _key_hash(key) & mask;
+        while (true)
+        {
+            uint32_t v = table[slot];
+            if (v == MESH_NONE)
+            {
+                table[slot] = vertex_count;
+                first[vertex_count] = i;
+                remap[i] = vertex_count++;
+                break;
+            }
+            if (memcmp(&keys[3 * first[v]], key, 3 * sizeof(uint32_t)) == 0)
+            {
+                remap[i] = v;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+    FREE(table);
+    return vertex_count;
+}
+
+
+
+/*************************************************************************************************/
+/*  Mesh creation                                                                                */
+/*************************************************************************************************/
+
+// Allocate an array with the exact number of items, discarding the existing data.
+static void _mesh_array(DvzArray* array, uint32_t count)
+{
+    ASSERT(array != NULL);
+    ASSERT(array->item_size > 0);
+    if (array->data != NULL)
+        dvz_memory_arrays_track(-(int64_t)array->buffer_size, 0);
+    FREE(array->data);
+    array->item_count = count;
+    array->buffer_size = count * array->item_size;
+    if (count > 0)
+    {
+        array->data = calloc(count, array->item_size);
+        dvz_memory_arrays_track((int64_t)array->buffer_size, 0);
+    }
+}
+
+
+
+// Wrap a buffer in an array without copying it.
+static void _mesh_wrap(DvzArray* array, void* data, uint32_t count)
+{
+    ASSERT(array != NULL);
+    if (array->data != NULL)
+        dvz_memory_arrays_track(-(int64_t)array->buffer_size, 0);
+    FREE(array->data);
+    array->item_count = count;
+    array->buffer_size = count * array->item_size;
+    array->data = count > 0 ? data : NULL;
+    if (array->data != NULL)
+        dvz_memory_arrays_track((int64_t)array->buffer_size, 0);
+}
+
+
+
+static void _mesh_finish(DvzMesh* mesh, bool has_normals)
+{
+    ASSERT(mesh != NULL);
+    if (mesh->vertices.item_count == 0 || mesh->indices.item_count == 0)
+        return;
+    if (!has_normals)
+    {
+        DvzGraphicsMeshVertex* vertices = (DvzGraphicsMeshVertex*)mesh->vertices.data;
+        for (uint32_t i = 0; i < mesh->vertices.item_count; i++)
+            glm_vec3_zero(vertices[i].normal);
+        dvz_mesh_normals(mesh);
+    }
+    dvz_mesh_normalize(mesh);
+}
+
+
+
+/*************************************************************************************************/
+/*  OBJ                                                                                          */
+/*************************************************************************************************/
+
+// A byte range of the OBJ file parsed by one thread. The face corners are (v, vt, vn) indices.
+typedef struct ObjChunk ObjChunk;
+
+struct ObjChunk
+{
+    const char* begin;
+    const char* end;
+
+    uint32_t v_count, vt_count, vn_count;    // number of items in the chunk
+    uint32_t v_offset, vt_offset, vn_offset; // number of items in the previous chunks
+    bool has_colors;
+
+    uint32_t* corners;
+    uint32_t corner_count, corner_capacity;
+    uint32_t skipped; // number of invalid faces
+};
+
+
+
+typedef struct ObjParser ObjParser;
+
+struct ObjParser
+{
+    ObjChunk chunks[DVZ_MESH_MAX_THREADS];
+    uint32_t chunk_count;
+    uint32_t v_count, vt_count, vn_count;
+    bool has_colors;
+
+    vec3* positions;
+    vec3* colors;
+    vec3* normals;
+    vec2* texcoords;
+};
+
+
+
+// First pass: count the vertices, texture coordinates, and normals in the chunk.
+static void _obj_count(void* user_data, uint32_t chunk_idx, uint32_t begin, uint32_t end)
+{
+    ObjParser* parser = (ObjParser*)user_data;
+    for (uint32_t c = begin; c < end; c++)
+    {
+        ObjChunk* chunk = &parser->chunks[c];
+        bool first = true;
+        for (const char* p = chunk->begin; p < chunk->end; p = _next_line(p, chunk->end))
+        {
+            p = _skip_spaces(p, chunk->end);
+            if (p + 1 >= chunk->end || p[0] != 'v')
+                continue;
+            if (p[1] == ' ' || p[1] == '\t')
+            {
+                // Vertex colors are an extension with 6 numbers on the vertex lines.
+                if (first)
+                {
+                    const char* q = p + 1;
+                    double x = 0;
+                    uint32_t n = 0;
+                    while (_parse_double(&q, chunk->end, &x))
+                        n++;
+                    chunk->has_colors = n >= 6;
+                    first = false;
+                }
+                chunk->v_count++;
+            }
+            else if (p[1] == 't')
+                chunk->vt_count++;
+            else if (p[1] == 'n')
+                chunk->vn_count++;
+        }
+    }
+}
+
+
+
+static inline void _obj_corner(ObjChunk* chunk, uint32_t* corner)
+{
+    if (chunk->corner_count + 1 > chunk->corner_capacity)
+    {
+        chunk->corner_capacity = MAX(1024, 2 * chunk->corner_capacity);
+        REALLOC(chunk->corners, 3 * (size_t)chunk->corner_capacity * sizeof(uint32_t));
+    }
+    memcpy(&chunk->corners[3 * chunk->corner_count++], corner, 3 * sizeof(uint32_t));
+}
+
+
+
+// Resolve a 1-based OBJ index, or a negative index relative to the current item count.
+static inline uint32_t _obj_index(int64_t idx, uint32_t current, uint32_t total)
+{
+    if (idx > 0 && idx <= total)
+        return (uint32_t)(idx - 1);
+    if (idx < 0 && -idx <= current)
+        return (uint32_t)(current + idx);
+    return MESH_NONE;
+}
+
+
+
+static void
+_obj_face(ObjParser* parser, ObjChunk* chunk, const char* p, const char* end, uvec3 cur)
+{
+    uint32_t polygon[3][3] = {0}; // first corner, previous corner, current corner
+    uint32_t n = 0;
+    int64_t idx = 0;
+    bool valid = true;
+    while (true)
+    {
+        p = _skip_spaces(p, end);
+        if (p >= end || *p == '\n' || *p == '#')
+            break;
+
+        // Corner v, v/vt, v//vn, or v/vt/vn.
+        uint32_t corner[3] = {MESH_NONE, MESH_NONE, MESH_NONE};
+        if (!_parse_int(&p, end, &idx))
+        {
+            valid = false;
+            break;
+        }
+        corner[0] = _obj_index(idx, cur[0], parser->v_count);
+        if (p < end && *p == '/')
+        {
+            p++;
+            if (_parse_int(&p, end, &idx))
+                corner[1] = _obj_index(idx, cur[1], parser->vt_count);
+            if (p < end && *p == '/')
+            {
+                p++;
+                if (_parse_int(&p, end, &idx))
+                    corner[2] = _obj_index(idx, cur[2], parser->vn_count);
+            }
+        }
+        if (corner[0] == MESH_NONE || (p < end && !_is_space(*p)))
+        {
+            valid = false;
+            break;
+        }
+
+        // Fan triangulation of polygons.
+        memcpy(polygon[MIN(n, 2)], corner, sizeof(corner));
+        if (n >= 2)
+        {
+            _obj_corner(chunk, polygon[0]);
+            _obj_corner(chunk, polygon[1]);
+            _obj_corner(chunk, polygon[2]);
+            memcpy(polygon[1], polygon[2], sizeof(corner));
+        }
+        n++;
+    }
+    if (!valid || n < 3)
+        chunk->skipped++;
+}
+
+
+
+// Second pass: parse the chunk, with the item offsets of the previous chunks.
+static void _obj_parse(void* user_data, uint32_t chunk_idx, uint32_t begin, uint32_t end)
+{
+    ObjParser* parser = (ObjParser*)user_data;
+    for (uint32_t c = begin; c < end; c++)
+    {
+        ObjChunk* chunk = &parser->chunks[c];
+        uvec3 cur = {chunk->v_offset, chunk->vt_offset, chunk->vn_offset};
+        const char* q = NULL;
+        double x = 0;
+        for (const char* p = chunk->begin; p < chunk->end; p = _next_line(p, chunk->end))
+        {
+            p = _skip_spaces(p, chunk->end);
+            if (p + 1 >= chunk->end)
+                continue;
+            q = p + 2;
+
+            if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+            {
+                float* pos = parser->positions[cur[0]];
+                _parse_float(&q, chunk->end, &pos[0]);
+                _parse_float(&q, chunk->end, &pos[1]);
+                _parse_float(&q, chunk->end, &pos[2]);
+                if (parser->colors != NULL)
+                {
+                    float* color = parser->colors[cur[0]];
+                    for (uint32_t k = 0; k < 3; k++)
+                        color[k] = _parse_double(&q, chunk->end, &x) ? (float)x : 1;
+                }
+                cur[0]++;
+            }
+            else if (p[0] == 'v' && p[1] == 't')
+            {
+                float* uv = parser->texcoords[cur[1]];
+                _parse_float(&q, chunk->end, &uv[0]);
+                _parse_float(&q, chunk->end, &uv[1]);
+                cur[1]++;
+            }
+            else if (p[0] == 'v' && p[1] == 'n')
+            {
+                float* normal = parser->normals[cur[2]];
+                _parse_float(&q, chunk->end, &normal[0]);
+                _parse_float(&q, chunk->end, &normal[1]);
+                _parse_float(&q, chunk->end, &normal[2]);
+                cur[2]++;
+            }
+            else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+            {
+                _obj_face(parser, chunk, p + 2, chunk->end, cur);
+            }
+        }
+    }
+}
+
+
+
+DvzMesh dvz_mesh_obj(const char* file_path)
+{
+    ASSERT(file_path != NULL);
+    log_trace("loading file %s", file_path);
+    DvzMesh mesh = dvz_mesh();
+
+    MeshFile file = {0};
+    if (!_mesh_file_open(file_path, &file))
+    {
+        log_error("error loading obj file %s", file_path);
+        return mesh;
+    }
+    const char* end = file.data + file.size;
+
+    // Split the file into chunks ending on line boundaries.
+    ObjParser parser = {0};
+    parser.chunk_count = _mesh_thread_count(file.size, DVZ_MESH_PARALLEL_BYTES);
+    const char* p = file.data;
+    for (uint32_t c = 0; c < parser.chunk_count; c++)
+    {
+        parser.chunks[c].begin = p;
+        if (c < parser.chunk_count - 1)
+            p = _next_line(file.data + file.size * (c + 1) / parser.chunk_count, end);
+        else
+            p = end;
+        parser.chunks[c].end = MAX(p, parser.chunks[c].begin);
+        p = parser.chunks[c].end;
+    }
+    uint32_t n = parser.chunk_count;
+
+    // First pass and allocation of the vertex attributes.
+    _mesh_parallel(n, n, _obj_count, &parser);
+    for (uint32_t c = 0; c < n; c++)
+    {
+        ObjChunk* chunk = &parser.chunks[c];
+        chunk->v_offset = parser.v_count;
+        chunk->vt_offset = parser.vt_count;
+        chunk->vn_offset = parser.vn_count;
+        parser.v_count += chunk->v_count;
+        parser.vt_count += chunk->vt_count;
+        parser.vn_count += chunk->vn_count;
+        parser.has_colors |= chunk->has_colors;
+    }
+    parser.positions = calloc(MAX(parser.v_count, 1), sizeof(vec3));
+    parser.texcoords = calloc(MAX(parser.vt_count, 1), sizeof(vec2));
+    parser.normals = calloc(MAX(parser.vn_count, 1), sizeof(vec3));
+    if (parser.has_colors)
+        parser.colors = calloc(MAX(parser.v_count, 1), sizeof(vec3));
+
+    // Second pass.
+    _mesh_parallel(n, n, _obj_parse, &parser);
+    _mesh_file_close(&file);
+
+    uint32_t corner_count = 0, skipped = 0;
+    for (uint32_t c = 0; c < n; c++)
+    {
+        corner_count += parser.chunks[c].corner_count;
+        skipped += parser.chunks[c].skipped;
+    }
+    if (skipped > 0)
+        log_warn("skipped %d invalid faces in %s", skipped, file_path);
+    log_debug(
+        "parsed %s with %d thread(s): %d vertices, %d texcoords, %d normals, %d triangles",
+        file_path, n, parser.v_count, parser.vt_count, parser.vn_count, corner_count / 3);
+
+    // Concatenate the face corners of all chunks.
+    uint32_t* corners = calloc(3 * (size_t)MAX(corner_count, 1), sizeof(uint32_t));
+    uint32_t offset = 0;
+    for (uint32_t c = 0; c < n; c++)
+    {
+        ObjChunk* chunk = &parser.chunks[c];
+        memcpy(&corners[3 * offset], chunk->corners, 3 * chunk->corner_count * sizeof(uint32_t));
+        offset += chunk->corner_count;
+        FREE(chunk->corners);
+    }
+
+    // Merge the corners with the same (v, vt, vn) indices. Without texture coordinates and
+    // normals, the OBJ vertices are used as they are.
+    uint32_t vertex_count = 0;
+    uint32_t* first = NULL;
+    _mesh_array(&mesh.indices, corner_count);
+    DvzIndex* indices = (DvzIndex*)mesh.indices.data;
+    bool has_normals = parser.vn_count > 0;
+    if (parser.vt_count == 0 && parser.vn_count == 0)
+    {
+        vertex_count = parser.v_count;
+        for (uint32_t i = 0; i < corner_count; i++)
+            indices[i] = corners[3 * i];
+    }
+    else
+    {
+        first = calloc(MAX(corner_count, 1), sizeof(uint32_t));
+        vertex_count = _dedup(corners, corner_count, indices, first);
+    }
+
+    _mesh_array(&mesh.vertices, vertex_count);
+    DvzGraphicsMeshVertex* vertex = (DvzGraphicsMeshVertex*)mesh.vertices.data;
+    uint32_t* corner = NULL;
+    uint32_t v = 0;
+    cvec3 color = {0};
+    for (uint32_t i = 0; i < vertex_count; i++, vertex++)
+    {
+        corner = first != NULL ? &corners[3 * first[i]] : (uint32_t[]){i, MESH_NONE, MESH_NONE};
+        v = corner[0];
+        _vec3_copy(parser.positions[v], vertex->pos);
+
+        if (corner[2] != MESH_NONE)
+            _vec3_copy(parser.normals[corner[2]], vertex->normal);
+        else
+            has_normals = false;
+
+        if (corner[1] != MESH_NONE)
+        {
+            _vec2_copy(parser.texcoords[corner[1]], vertex->uv);
+        }
+        else if (parser.colors != NULL)
+        {
+            color[0] = TO_BYTE(parser.colors[v][0]);
+            color[1] = TO_BYTE(parser.colors[v][1]);
+            color[2] = TO_BYTE(parser.colors[v][2]);
+            dvz_colormap_packuv(color, vertex->uv);
+        }
+
+        vertex->alpha = 255;
+    }
+
+    FREE(first);
+    FREE(corners);
+    FREE(parser.positions);
+    FREE(parser.texcoords);
+    FREE(parser.normals);
+    FREE(parser.colors);
+
+    _mesh_finish(&mesh, has_normals);
+    return mesh;
+}
+
+
+
+/*************************************************************************************************/
+/*  PLY                                                                                          */
+/*************************************************************************************************/
+
+typedef enum
+{
+    PLY_ASCII,
+    PLY_BINARY_LE,
+    PLY_BINARY_BE,
+} PlyFormat;
+
+
+
+typedef enum
+{
+    PLY_NONE,
+    PLY_INT8,
+    PLY_UINT8,
+    PLY_INT16,
+    PLY_UINT16,
+    PLY_INT32,
+    PLY_UINT32,
+    PLY_FLOAT32,
+    PLY_FLOAT64,
+} PlyType;
+
+
+
+// Vertex attributes recognized in PLY files.
+typedef enum
+{
+    PLY_ATTR_NONE,
+    PLY_ATTR_X,
+    PLY_ATTR_Y,
+    PLY_ATTR_Z,
+    PLY_ATTR_NX,
+    PLY_ATTR_NY,
+    PLY_ATTR_NZ,
+    PLY_ATTR_U,
+    PLY_ATTR_V,
+    PLY_ATTR_RED,
+    PLY_ATTR_GREEN,
+    PLY_ATTR_BLUE,
+    PLY_ATTR_ALPHA,
+    PLY_ATTR_COUNT,
+} PlyAttr;
+
+
+
+typedef struct PlyProperty PlyProperty;
+typedef struct PlyElement PlyElement;
+typedef struct PlyReader PlyReader;
+
+struct PlyProperty
+{
+    char name[64];
+    PlyType type;
+    PlyType count_type; // for lists
+    uint32_t offset;    // byte offset in binary elements without lists
+};
+
+struct PlyElement
+{
+    char name[64];
+    uint32_t count;
+    PlyProperty props[PLY_MAX_PROPERTIES];
+    uint32_t prop_count;
+    uint32_t stride; // byte size of binary elements without lists, 0 otherwise
+};
+
+struct PlyReader
+{
+    PlyFormat format;
+    const char* p;
+    const char* end;
+    bool error;
+};
+
+
+
+static PlyType _ply_type(const char* name)
+{
+    const char* names[][2] = {
+        {"char", "int8"},     {"uchar", "uint8"},    {"short", "int16"},
+        {"ushort", "uint16"}, {"int", "int32"},      {"uint", "uint32"},
+        {"float", "float32"}, {"double", "float64"},
+    };
+    for (uint32_t i = 0; i < 8; i++)
+        if (strcmp(name, names[i][0]) == 0 || strcmp(name, names[i][1]) == 0)
+            return (PlyType)(PLY_INT8 + i);
+    return PLY_NONE;
+}
+
+
+
+static uint32_t _ply_size(PlyType type)
+{
+    switch (type)
+    {
+    case PLY_INT8:
+    case PLY_UINT8:
+        return 1;
+    case PLY_INT16:
+    case PLY_UINT16:
+        return 2;
+    case PLY_INT32:
+    case PLY_UINT32:
+    case PLY_FLOAT32:
+        return 4;
+    case PLY_FLOAT64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+
+
+static PlyAttr _ply_attr(const char* name)
+{
+    const char* names[][3] = {
+        {"", "", ""},
+        {"x", "", ""},
+        {"y", "", ""},
+        {"z", "", ""},
+        {"nx", "", ""},
+        {"ny", "", ""},
+        {"nz", "", ""},
+        {"u", "s", "texture_u"},
+        {"v", "t", "texture_v"},
+        {"red", "r", "diffuse_red"},
+        {"green", "g", "diffuse_green"},
+        {"blue", "b", "diffuse_blue"},
+        {"alpha", "a", ""},
+    };
+    for (uint32_t i = 1; i < PLY_ATTR_COUNT; i++)
+        for (uint32_t k = 0; k < 3; k++)
+            if (names[i][k][0] != 0 && strcmp(name, names[i][k]) == 0)
+                return (PlyAttr)i;
+    return PLY_ATTR_NONE;
+}
+
+
+
+static inline bool _host_big_endian(void)
+{
+    const uint16_t x = 1;
+    return *(const uint8_t*)&x == 0;
+}
+
+
+
+// Read a binary value at a given position, swapping the bytes if needed.
+static inline double _ply_binary(const char* p, PlyType type, bool swap)
+{
+    uint8_t bytes[8] = {0};
+    uint32_t size = _ply_size(type);
+    memcpy(bytes, p, size);
+    if (swap)
+    {
+        for (uint32_t i = 0; i < size / 2; i++)
+        {
+            uint8_t b = bytes[i];
+            bytes[i] = bytes[size - 1 - i];
+            bytes[size - 1 - i] = b;
+        }
+    }
+    switch (type)
+    {
+    case PLY_INT8:
+        return (double)*(int8_t*)bytes;
+    case PLY_UINT8:
+        return (double)*(uint8_t*)bytes;
+    case PLY_INT16:
+        return (double)*(int16_t*)bytes;
+    case PLY_UINT16:
+        return (double)*(uint16_t*)bytes;
+    case PLY_INT32:
+        return (double)*(int32_t*)bytes;
+    case PLY_UINT32:
+        return (double)*(uint32_t*)bytes;
+    case PLY_FLOAT32:
+        return (double)*(float*)bytes;
+    case PLY_FLOAT64:
+        return *(double*)bytes;
+    default:
+        return 0;
+    }
+}
+
+
+
+// Read the next value in the file.
+static double _ply_read(PlyReader* reader, PlyType type)
+{
+    ASSERT(reader != NULL);
+    double value = 0;
+    if (reader->format == PLY_ASCII)
+    {
+        // Skip the line breaks between elements.
+        while (reader->p < reader->end && _is_space(*reader->p))
+            reader->p++;
+        if (!_parse_double(&reader->p, reader->end, &value))
+            reader->error = true;
+        return value;
+    }
+    uint32_t size = _ply_size(type);
+    if (reader->p + size > reader->end)
+    {
+        reader->error = true;
+        return 0;
+    }
+    value = _ply_binary(reader->p, type, (reader->format == PLY_BINARY_BE) != _host_big_endian());
+    reader->p += size;
+    return value;
+}
+
+
+
+static bool _ply_header(PlyReader* reader, PlyElement* elements, uint32_t* element_count)
+{
+    const char* p = reader->p;
+    const char* end = reader->end;
+    if (end - p < 4 || memcmp(p, "ply", 3) != 0)
+        return false;
+
+    char line[256], a[64], b[64], c[64], d[64];
+    PlyElement* element = NULL;
+    *element_count = 0;
+    bool has_format = false;
+    while (p < end)
+    {
+        const char* next = _next_line(p, end);
+        size_t len = MIN((size_t)(next - p), sizeof(line) - 1);
+        memcpy(line, p, len);
+        line[len] = 0;
+        p = next;
+
+        a[0] = b[0] = c[0] = d[0] = 0;
+        int n = sscanf(line, "%63s %63s %63s %63s", a, b, c, d);
+        if (n <= 0)
+            continue;
+        if (strcmp(a, "end_header") == 0)
+        {
+            reader->p = p;
+            return has_format;
+        }
+        else if (strcmp(a, "format") == 0 && n >= 2)
+        {
+            has_format = true;
+            if (strcmp(b, "ascii") == 0)
+                reader->format = PLY_ASCII;
+            else if (strcmp(b, "binary_little_endian") == 0)
+                reader->format = PLY_BINARY_LE;
+            else if (strcmp(b, "binary_big_endian") == 0)
+                reader->format = PLY_BINARY_BE;
+            else
+                return false;
+        }
+        else if (strcmp(a, "element") == 0 && n >= 3)
+        {
+            if (*element_count >= PLY_MAX_ELEMENTS)
+                return false;
+            element = &elements[(*element_count)++];
+            memset(element, 0, sizeof(PlyElement));
+            memcpy(element->name, b, sizeof(element->name));
+            element->count = (uint32_t)strtoul(c, NULL, 10);
+        }
+        else if (strcmp(a, "property") == 0 && n >= 3)
+        {
+            if (element == NULL || element->prop_count >= PLY_MAX_PROPERTIES)
+                return false;
+            PlyProperty* prop = &element->props[element->prop_count++];
+            if (strcmp(b, "list") == 0 && n >= 4)
+            {
+                // property list <count type> <item type> <name>
+                prop->count_type = _ply_type(c);
+                prop->type = _ply_type(d);
+                sscanf(line, "%*s %*s %*s %*s %63s", prop->name);
+                if (prop->count_type == PLY_NONE)
+                    return false;
+            }
+            else
+            {
+                prop->type = _ply_type(b);
+                memcpy(prop->name, c, sizeof(prop->name));
+            }
+            if (prop->type == PLY_NONE)
+                return false;
+        }
+    }
+    return false;
+}
+
+
+
+// Vertex element context.
+typedef struct PlyVertices PlyVertices;
+
+struct PlyVertices
+{
+    const char* data;
+    const PlyElement* element;
+    PlyAttr attrs[PLY_MAX_PROPERTIES];
+    bool swap;
+    bool pack_colors; // pack the vertex colors in the texture coordinates
+    DvzGraphicsMeshVertex* vertices;
+};
+
+
+
+// Store a property value, with the colors between 0 and 255.
+static inline void _ply_value(PlyVertices* ply, uint32_t k, double value, double* values)
+{
+    PlyAttr attr = ply->attrs[k];
+    if (attr == PLY_ATTR_NONE)
+        return;
+    PlyType type = ply->element->props[k].type;
+    if (attr >= PLY_ATTR_RED && (type == PLY_FLOAT32 || type == PLY_FLOAT64))
+        value *= 255;
+    values[attr] = value;
+}
+
+
+
+static void _ply_vertex(PlyVertices* ply, uint32_t i, double* values)
+{
+    DvzGraphicsMeshVertex* vertex = &ply->vertices[i];
+    vertex->pos[0] = (float)values[PLY_ATTR_X];
+    vertex->pos[1] = (float)values[PLY_ATTR_Y];
+    vertex->pos[2] = (float)values[PLY_ATTR_Z];
+    vertex->normal[0] = (float)values[PLY_ATTR_NX];
+    vertex->normal[1] = (float)values[PLY_ATTR_NY];
+    vertex->normal[2] = (float)values[PLY_ATTR_NZ];
+    if (ply->pack_colors)
+    {
+        cvec3 color = {0};
+        for (uint32_t k = 0; k < 3; k++)
+            color[k] = (uint8_t)CLIP(round(values[PLY_ATTR_RED + k]), 0, 255);
+        dvz_colormap_packuv(color, vertex->uv);
+    }
+    else
+    {
+        vertex->uv[0] = (float)values[PLY_ATTR_U];
+        vertex->uv[1] = (float)values[PLY_ATTR_V];
+    }
+    vertex->alpha = (uint8_t)CLIP(round(values[PLY_ATTR_ALPHA]), 0, 255);
+
+    // Reset the values for the next vertex.
+    memset(values, 0, PLY_ATTR_COUNT * sizeof(double));
+    values[PLY_ATTR_ALPHA] = 255;
+}
+
+
+
+// Binary vertices have a fixed stride, they are converted in parallel.
+static void _ply_vertices(void* user_data, uint32_t chunk, uint32_t begin, uint32_t end)
+{
+    PlyVertices* ply = (PlyVertices*)user_data;
+    const PlyElement* element = ply->element;
+    double values[PLY_ATTR_COUNT] = {0};
+    values[PLY_ATTR_ALPHA] = 255;
+    for (uint32_t i = begin; i < end; i++)
+    {
+        const char* item = ply->data + (uint64_t)i * element->stride;
+        for (uint32_t k = 0; k < element->prop_count; k++)
+        {
+            const PlyProperty* prop = &element->props[k];
+            _ply_value(ply, k, _ply_binary(item + prop->offset, prop->type, ply->swap), values);
+        }
+        _ply_vertex(ply, i, values);
+    }
+}
+
+
+
+DvzMesh dvz_mesh_ply(const char* file_path)
+{
+    ASSERT(file_path != NULL);
+    log_trace("loading file %s", file_path);
+    DvzMesh mesh = dvz_mesh();
+
+    MeshFile file = {0};
+    if (!_mesh_file_open(file_path, &file))
+    {
+        log_error("error loading ply file %s", file_path);
+        return mesh;
+    }
+    PlyReader reader = {0};
+    reader.p = file.data;
+    reader.end = file.data + file.size;
+
+    PlyElement elements[PLY_MAX_ELEMENTS] = {0};
+    uint32_t element_count = 0;
+    if (!_ply_header(&reader, elements, &element_count))
+    {
+        log_error("invalid ply header in %s", file_path);
+        _mesh_file_close(&file);
+        return mesh;
+    }
+
+    bool has_normals = false;
+    DvzIndex* indices = NULL;
+    uint32_t index_count = 0, index_capacity = 0;
+    for (uint32_t e = 0; e < element_count && !reader.error; e++)
+    {
+        PlyElement* element = &elements[e];
+        bool is_vertex = strcmp(element->name, "vertex") == 0;
+        bool is_face = strcmp(element->name, "face") == 0;
+
+        // Byte offsets of the properties of binary elements without lists.
+        element->stride = 0;
+        for (uint32_t k = 0; k < element->prop_count; k++)
+        {
+            if (element->props[k].count_type != PLY_NONE || reader.format == PLY_ASCII)
+            {
+                element->stride = 0;
+                break;
+            }
+            element->props[k].offset = element->stride;
+            element->stride += _ply_size(element->props[k].type);
+        }
+
+        // Vertex attributes. The colors are packed in the texture coordinates, like in the OBJ
+        // loader, unless the file has texture coordinates.
+        PlyVertices ply = {0};
+        ply.element = element;
+        ply.swap = (reader.format == PLY_BINARY_BE) != _host_big_endian();
+        if (is_vertex)
+        {
+            bool has_colors = false, has_texcoords = false;
+            for (uint32_t k = 0; k < element->prop_count; k++)
+            {
+                ply.attrs[k] = _ply_attr(element->props[k].name);
+                has_normals |= ply.attrs[k] == PLY_ATTR_NX;
+                has_texcoords |= ply.attrs[k] == PLY_ATTR_U;
+                has_colors |= ply.attrs[k] == PLY_ATTR_RED;
+            }
+            ply.pack_colors = has_colors && !has_texcoords;
+            _mesh_array(&mesh.vertices, element->count);
+            ply.vertices = (DvzGraphicsMeshVertex*)mesh.vertices.data;
+        }
+
+        if (is_vertex && element->stride > 0)
+        {
+            // Fast path for binary vertices.
+            if ((uint64_t)element->count * element->stride > (uint64_t)(reader.end - reader.p))
+            {
+                reader.error = true;
+                break;
+            }
+            ply.data = reader.p;
+            uint32_t n = _mesh_thread_count(element->count, DVZ_MESH_PARALLEL_FACES);
+            _mesh_parallel(element->count, n, _ply_vertices, &ply);
+            reader.p += (uint64_t)element->count * element->stride;
+            continue;
+        }
+
+        double values[PLY_ATTR_COUNT] = {0};
+        values[PLY_ATTR_ALPHA] = 255;
+        DvzIndex polygon[3] = {0};
+        for (uint32_t i = 0; i < element->count && !reader.error; i++)
+        {
+            for (uint32_t k = 0; k < element->prop_count; k++)
+            {
+                PlyProperty* prop = &element->props[k];
+                if (prop->count_type == PLY_NONE)
+                {
+                    double value = _ply_read(&reader, prop->type);
+                    if (is_vertex)
+                        _ply_value(&ply, k, value, values);
+                    continue;
+                }
+
+                // Lists: fan triangulation of the face polygons, other lists are skipped.
+                uint32_t count = (uint32_t)_ply_read(&reader, prop->count_type);
+                bool is_indices = is_face && (strcmp(prop->name, "vertex_indices") == 0 ||
+                                              strcmp(prop->name, "vertex_index") == 0);
+                for (uint32_t l = 0; l < count && !reader.error; l++)
+                {
+                    DvzIndex idx = (DvzIndex)_ply_read(&reader, prop->type);
+                    if (!is_indices)
+                        continue;
+                    polygon[MIN(l, 2)] = idx;
+                    if (l < 2)
+                        continue;
+                    if (index_count + 3 > index_capacity)
+                    {
+                        index_capacity = MAX(1024, 2 * index_capacity);
+                        REALLOC(indices, index_capacity * sizeof(DvzIndex));
+                    }
+                    memcpy(&indices[index_count], polygon, sizeof(polygon));
+                    index_count += 3;
+                    polygon[1] = polygon[2];
+                }
+            }
+            if (is_vertex)
+                _ply_vertex(&ply, i, values);
+        }
+    }
+    _mesh_file_close(&file);
+
+    if (reader.error)
+    {
+        log_error("error parsing ply file %s", file_path);
+        FREE(indices);
+        dvz_mesh_destroy(&mesh);
+        return dvz_mesh();
+    }
+
+    // Check the indices.
+    uint32_t vertex_count = mesh.vertices.item_count;
+    for (uint32_t i = 0; i < index_count; i++)
+    {
+        if (indices[i] >= vertex_count)
+        {
+            log_error("invalid vertex index %d in ply file %s", indices[i], file_path);
+            FREE(indices);
+            dvz_mesh_destroy(&mesh);
+            return dvz_mesh();
+        }
+    }
+    _mesh_wrap(&mesh.indices, indices, index_count);
+    if (index_count == 0)
+        FREE(indices);
+    log_debug("parsed %s: %d vertices, %d triangles", file_path, vertex_count, index_count / 3);
+
+    _mesh_finish(&mesh, has_normals);
+    return mesh;
+}
+
+
+
+/*************************************************************************************************/
+/*  STL                                                                                          */
+/*************************************************************************************************/
+
+// Position key for the deduplication, with -0 and +0 merged.
+static inline void _stl_key(const float* pos, uint32_t* key)
+{
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        float x = pos[k] == 0 ? 0 : pos[k];
+        memcpy(&key[k], &x, sizeof(float));
+    }
+}
+
+
+
+// Read the positions of the triangle corners of a binary or ASCII STL file.
+static uint32_t _stl_corners(const char* data, size_t size, float** out)
+{
+    ASSERT(data != NULL);
+    float* positions = NULL;
+
+    // Binary STL: 80-byte header, triangle count, and 50 bytes per triangle (normal, 3 corners,
+    // attribute byte count). Some binary files start with "solid", so the size is checked first.
+    if (size >= 84)
+    {
+        uint32_t count = 0;
+        memcpy(&count, data + 80, sizeof(uint32_t));
+        if (84 + 50 * (uint64_t)count == size)
+        {
+            positions = calloc(9 * (size_t)MAX(count, 1), sizeof(float));
+            for (uint32_t i = 0; i < count; i++)
+                memcpy(&positions[9 * i], data + 84 + 50 * (uint64_t)i + 12, 9 * sizeof(float));
+            *out = positions;
+            return 3 * count;
+        }
+    }
+
+    // ASCII STL: only the "vertex x y z" lines matter.
+    const char* end = data + size;
+    const char* p = _skip_spaces(data, end);
+    if ((size_t)(end - p) < 5 || memcmp(p, "solid", 5) != 0)
+        return 0;
+    uint32_t count = 0, capacity = 0;
+    for (; p < end; p = _next_line(p, end))
+    {
+        p = _skip_spaces(p, end);
+        if ((size_t)(end - p) < 6 || memcmp(p, "vertex", 6) != 0)
+            continue;
+        if (count + 1 > capacity)
+        {
+            capacity = MAX(1024, 2 * capacity);
+            REALLOC(positions, 3 * (size_t)capacity * sizeof(float));
+        }
+        const char* q = p + 6;
+        for (uint32_t k = 0; k < 3; k++)
+            if (!_parse_float(&q, end, &positions[3 * count + k]))
+                positions[3 * count + k] = 0;
+        count++;
+    }
+    *out = positions;
+    return count - count % 3;
+}
+
+
+
+DvzMesh dvz_mesh_stl(const char* file_path)
+{
+    ASSERT(file_path != NULL);
+    log_trace("loading file %s", file_path);
+    DvzMesh mesh = dvz_mesh();
+
+    MeshFile file = {0};
+    if (!_mesh_file_open(file_path, &file))
+    {
+        log_error("error loading stl file %s", file_path);
+        return mesh;
+    }
+    float* positions = NULL;
+    uint32_t corner_count = _stl_corners(file.data, file.size, &positions);
+    _mesh_file_close(&file);
+    if (corner_count == 0)
+    {
+        log_error("invalid stl file %s", file_path);
+        FREE(positions);
+        return mesh;
+    }
+
+    // STL files store the 3 corners of every triangle, merge the corners at the same position.
+    uint32_t* keys = calloc(3 * (size_t)corner_count, sizeof(uint32_t));
+    for (uint32_t i = 0; i < corner_count; i++)
+        _stl_key(&positions[3 * i], &keys[3 * i]);
+    uint32_t* first = calloc(corner_count, sizeof(uint32_t));
+    _mesh_array(&mesh.indices, corner_count);
+    uint32_t vertex_count = _dedup(keys, corner_count, (uint32_t*)mesh.indices.data, first);
+    log_debug(
+        "parsed %s: %d triangles, %d unique vertices", file_path, corner_count / 3, vertex_count);
+
+    _mesh_array(&mesh.vertices, vertex_count);
+    DvzGraphicsMeshVertex* vertex = (DvzGraphicsMeshVertex*)mesh.vertices.data;
+    for (uint32_t i = 0; i < vertex_count; i++, vertex++)
+    {
+        _vec3_copy(&positions[3 * first[i]], vertex->pos);
+        vertex->alpha = 255;
+    }
+
+    FREE(first);
+    FREE(keys);
+    FREE(positions);
+
+    _mesh_finish(&mesh, false);
+    return mesh;
+}
+
+
+
+/*************************************************************************************************/
+/*  Binary cache                                                                                 */
+/*************************************************************************************************/
+
+// The cache file contains the header, then the vertices and the indices at aligned offsets, so
+// that the arrays can point directly to the memory-mapped file.
+typedef struct MeshCacheHeader MeshCacheHeader;
+
+struct MeshCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t vertex_size;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t vertex_offset;
+    uint64_t index_offset;
+};
+
+
+
+static inline uint64_t _cache_align(uint64_t offset)
+{
+    return (offset + MESH_CACHE_ALIGN - 1) / MESH_CACHE_ALIGN * MESH_CACHE_ALIGN;
+}
+
+
+
+static bool _mesh_cache_write(DvzMesh* mesh, const char* cache_path, const char* file_path)
+{
+    ASSERT(mesh != NULL);
+    ASSERT(cache_path != NULL);
+
+    MeshCacheHeader header = {0};
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.version = MESH_CACHE_VERSION;
+    header.vertex_size = sizeof(DvzGraphicsMeshVertex);
+    header.vertex_count = mesh->vertices.item_count;
+    header.index_count = mesh->indices.item_count;
+    if (!_mesh_file_stat(file_path, &header.source_size, &header.source_mtime))
+        return false;
+    uint64_t vertex_bytes = (uint64_t)header.vertex_count * header.vertex_size;
+    uint64_t index_bytes = (uint64_t)header.index_count * sizeof(DvzIndex);
+    header.vertex_offset = _cache_align(sizeof(MeshCacheHeader));
+    header.index_offset = _cache_align(header.vertex_offset + vertex_bytes);
+
+    // Write to a temporary file first, so that a concurrent reader never sees a partial cache.
+    char tmp_path[1024] = {0};
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache_path);
+    FILE* fp = fopen(tmp_path, "wb");
+    if (fp == NULL)
+        return false;
+    uint8_t padding[MESH_CACHE_ALIGN] = {0};
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    ok &= fwrite(padding, header.vertex_offset - sizeof(header), 1, fp) == 1;
+    if (vertex_bytes > 0)
+        ok &= fwrite(mesh->vertices.data, vertex_bytes, 1, fp) == 1;
+    uint64_t pad = header.index_offset - header.vertex_offset - vertex_bytes;
+    if (pad > 0)
+        ok &= fwrite(padding, pad, 1, fp) == 1;
+    if (index_bytes > 0)
+        ok &= fwrite(mesh->indices.data, index_bytes, 1, fp) == 1;
+    ok &= fclose(fp) == 0;
+
+    if (!ok)
+    {
+        remove(tmp_path);
+        return false;
+    }
+#if OS_WIN32
+    remove(cache_path);
+#endif
+    if (rename(tmp_path, cache_path) != 0)
+    {
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+
+
+static bool _mesh_cache_read(DvzMesh* mesh, const char* cache_path, const char* file_path)
+{
+    ASSERT(mesh != NULL);
+    ASSERT(cache_path != NULL);
+
+    // Check the header before mapping the file.
+    MeshCacheHeader header = {0};
+    FILE* fp = fopen(cache_path, "rb");
+    if (fp == NULL)
+        return false;
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1;
+    fclose(fp);
+    if (!ok || memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 ||
+        header.version != MESH_CACHE_VERSION ||
+        header.vertex_size != sizeof(DvzGraphicsMeshVertex))
+    {
+        log_warn("ignoring invalid mesh cache file %s", cache_path);
+        return false;
+    }
+
+    // A stale cache is ignored. The cache is used as is if the mesh file does not exist.
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    if (_mesh_file_stat(file_path, &size, &mtime) &&
+        (size != header.source_size || mtime != header.source_mtime))
+    {
+        log_debug("mesh cache file %s is out of date", cache_path);
+        return false;
+    }
+
+    MeshFile file = {0};
+    if (!_mesh_file_open(cache_path, &file))
+        return false;
+    uint64_t vertex_bytes = (uint64_t)header.vertex_count * header.vertex_size;
+    uint64_t index_bytes = (uint64_t)header.index_count * sizeof(DvzIndex);
+    if (header.vertex_offset + vertex_bytes > file.size ||
+        header.index_offset + index_bytes > file.size)
+    {
+        log_warn("ignoring truncated mesh cache file %s", cache_path);
+        _mesh_file_close(&file);
+        return false;
+    }
+
+    // A corrupted index would make the GPU read outside of the vertex buffer.
+    const DvzIndex* indices = (const DvzIndex*)(file.data + header.index_offset);
+    for (uint32_t i = 0; i < header.index_count; i++)
+    {
+        if (indices[i] >= header.vertex_count)
+        {
+            log_warn("ignoring mesh cache file %s with out-of-range indices", cache_path);
+            _mesh_file_close(&file);
+            return false;
+        }
+    }
+
+#if OS_WIN32
+    // The file was read in memory, copy the arrays.
+    _mesh_array(&mesh->vertices, header.vertex_count);
+    _mesh_array(&mesh->indices, header.index_count);
+    memcpy(mesh->vertices.data, file.data + header.vertex_offset, vertex_bytes);
+    memcpy(mesh->indices.data, file.data + header.index_offset, index_bytes);
+    _mesh_file_close(&file);
+#else
+    // Map the file again with write access: the pages are copied on write, so that the mesh can
+    // be modified without changing the file.
+    munmap((void*)file.data, file.size);
+    int fd = open(cache_path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    void* data = mmap(NULL, file.size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    mesh->mapped = data;
+    mesh->mapped_size = file.size;
+    _mesh_wrap(&mesh->vertices, (char*)data + header.vertex_offset, header.vertex_count);
+    _mesh_wrap(&mesh->indices, (char*)data + header.index_offset, header.index_count);
+#endif
+    return true;
+}
+
+
+
+/*************************************************************************************************/
+/*  Mesh loading                                                                                 */
+/*************************************************************************************************/
+
+static bool _has_extension(const char* path, const char* ext)
+{
+    const char* dot = strrchr(path, '.');
+    if (dot == NULL || strlen(dot) != strlen(ext))
+        return false;
+    for (uint32_t i = 0; ext[i] != 0; i++)
+        if (tolower((unsigned char)dot[i]) != ext[i])
+            return false;
+    return true;
+}
+
+
+
+DvzMesh dvz_mesh_load(const char* file_path, const char* cache_path)
+{
+    ASSERT(file_path != NULL);
+
+    DvzMesh mesh = dvz_mesh();
+    if (cache_path != NULL && _mesh_cache_read(&mesh, cache_path, file_path))
+    {
+        log_debug("loaded mesh %s from the cache file %s", file_path, cache_path);
+        return mesh;
+    }
+    dvz_mesh_destroy(&mesh);
+
+    if (_has_extension(file_path, ".obj"))
+        mesh = dvz_mesh_obj(file_path);
+    else if (_has_extension(file_path, ".ply"))
+        mesh = dvz_mesh_ply(file_path);
+    else if (_has_extension(file_path, ".stl"))
+        mesh = dvz_mesh_stl(file_path);
+    else
+    {
+        log_error("unsupported mesh file format %s", file_path);
+        return dvz_mesh();
+    }
+
+    if (cache_path != NULL && mesh.indices.item_count > 0 &&
+        !_mesh_cache_write(&mesh, cache_path, file_path))
+        log_warn("unable to write the mesh cache file %s", cache_path);
+    return mesh;
+}
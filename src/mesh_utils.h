@@ -0,0 +1,76 @@
+#ifndef DVZ_MESH_UTILS_HEADER
+#define DVZ_MESH_UTILS_HEADER
+
+#include "../include/datoviz/common.h"
+#include "../include/datoviz/mesh.h"
+
+
+
+/*************************************************************************************************/
+/*  Parallel loops                                                                               */
+/*************************************************************************************************/
+
+typedef void (*MeshTask)(void* user_data, uint32_t chunk, uint32_t begin, uint32_t end);
+
+typedef struct MeshJob MeshJob;
+
+struct MeshJob
+{
+    MeshTask task;
+    void* user_data;
+    uint32_t chunk, begin, end;
+};
+
+
+
+// Number of threads for a loop over count items, 1 below min_count.
+static uint32_t _mesh_thread_count(uint64_t count, uint64_t min_count)
+{
+    if (count < min_count)
+        return 1;
+    long n = 1;
+#if !OS_WIN32
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return (uint32_t)CLIP(n, 1, DVZ_MESH_MAX_THREADS);
+}
+
+
+
+static void* _mesh_job(void* user_data)
+{
+    MeshJob* job = (MeshJob*)user_data;
+    ASSERT(job != NULL);
+    job->task(job->user_data, job->chunk, job->begin, job->end);
+    return NULL;
+}
+
+
+
+// Split [0, count) into contiguous chunks, one per thread, the calling thread runs the first one.
+static void _mesh_parallel(uint32_t count, uint32_t thread_count, MeshTask task, void* user_data)
+{
+    ASSERT(task != NULL);
+    ASSERT(thread_count >= 1 && thread_count <= DVZ_MESH_MAX_THREADS);
+
+    MeshJob jobs[DVZ_MESH_MAX_THREADS] = {0};
+    DvzThread threads[DVZ_MESH_MAX_THREADS] = {0};
+    uint32_t chunk = (count + thread_count - 1) / thread_count;
+    for (uint32_t k = 0; k < thread_count; k++)
+    {
+        jobs[k].task = task;
+        jobs[k].user_data = user_data;
+        jobs[k].chunk = k;
+        jobs[k].begin = MIN(k * chunk, count);
+        jobs[k].end = MIN((k + 1) * chunk, count);
+    }
+    for (uint32_t k = 1; k < thread_count; k++)
+        threads[k] = dvz_thread(_mesh_job, &jobs[k]);
+    _mesh_job(&jobs[0]);
+    for (uint32_t k = 1; k < thread_count; k++)
+        dvz_thread_join(&threads[k]);
+}
+
+
+
+#endif
@@ -0,0 +1,412 @@
+#include "../include/datoviz/profiler.h"
+#include "vklite_utils.h"
+#include <inttypes.h>
+#include <stdlib.h>
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+static const char* DVZ_PROFILE_ZONE_NAMES[] = {
+    "frame",     "interact", "frame_callbacks", "timer",        "transfers", "refill",
+    "submit",    "event",    "gpu_draw",        "gpu_transfer", "custom",
+};
+
+#define DVZ_PROFILER_GPU_TID 100
+
+
+
+static inline bool _is_gpu_zone(DvzProfileZoneType type)
+{
+    return type == DVZ_PROFILE_GPU_DRAW || type == DVZ_PROFILE_GPU_TRANSFER;
+}
+
+
+
+// Return the ring of the calling thread, registering it if needed. Lock-free: a thread only
+// registers once, by atomically reserving a slot.
+static DvzProfilerRing* _profiler_ring(DvzProfiler* profiler)
+{
+    ASSERT(profiler != NULL);
+    pthread_t self = pthread_self();
+    uint32_t count = MIN(atomic_load(&profiler->ring_count), DVZ_PROFILER_MAX_THREADS);
+    DvzProfilerRing* ring = NULL;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ring = &profiler->rings[i];
+        if (atomic_load(&ring->registered) && pthread_equal(ring->thread, self))
+            return ring;
+    }
+
+    uint32_t idx = atomic_fetch_add(&profiler->ring_count, 1);
+    if (idx >= DVZ_PROFILER_MAX_THREADS)
+    {
+        if (idx == DVZ_PROFILER_MAX_THREADS)
+            log_warn("maximum number of profiled threads reached");
+        return NULL;
+    }
+    ring = &profiler->rings[idx];
+    ring->thread = self;
+    atomic_store(&ring->registered, true);
+    return ring;
+}
+
+
+
+static void _profiler_push(DvzProfiler* profiler, DvzProfileZone zone)
+{
+    DvzProfilerRing* ring = _profiler_ring(profiler);
+    if (ring == NULL)
+        return;
+
+    uint64_t head = atomic_load(&ring->head);
+    uint64_t tail = atomic_load(&ring->tail);
+    if (head - tail >= DVZ_PROFILER_RING_SIZE)
+    {
+        atomic_fetch_add(&ring->dropped, 1);
+        return;
+    }
+    ring->zones[head % DVZ_PROFILER_RING_SIZE] = zone;
+    // Publish the zone to the reader.
+    atomic_store(&ring->head, head + 1);
+
+    // Only the main thread updates the frame summary.
+    if (pthread_equal(pthread_self(), profiler->main_thread))
+    {
+        ASSERT(zone.type < DVZ_PROFILE_COUNT);
+        profiler->current.durations[zone.type] += zone.duration;
+        profiler->current.counts[zone.type]++;
+    }
+}
+
+
+
+static void _profiler_queries(DvzProfiler* profiler)
+{
+    ASSERT(profiler != NULL);
+    DvzGpu* gpu = profiler->gpu;
+    ASSERT(gpu != NULL);
+
+    if (gpu->device_properties.limits.timestampPeriod <= 0)
+    {
+        log_debug("GPU timestamp queries not supported, profiling the CPU only");
+        return;
+    }
+
+    // Check which queue families support timestamps.
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(gpu->physical_device, &family_count, NULL);
+    VkQueueFamilyProperties* families = calloc(family_count, sizeof(VkQueueFamilyProperties));
+    vkGetPhysicalDeviceQueueFamilyProperties(gpu->physical_device, &family_count, families);
+
+    uint32_t render = gpu->queues.queue_families[DVZ_DEFAULT_QUEUE_RENDER];
+    uint32_t transfer = gpu->queues.queue_families[DVZ_DEFAULT_QUEUE_TRANSFER];
+    uint32_t valid_bits = 0;
+    if (render < family_count && families[render].timestampValidBits > 0)
+    {
+        profiler->gpu_render = true;
+        valid_bits = families[render].timestampValidBits;
+    }
+    // NOTE: resetting queries requires a graphics or compute queue.
+    if (transfer < family_count && families[transfer].timestampValidBits > 0 &&
+        (families[transfer].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) != 0)
+    {
+        profiler->gpu_transfer = true;
+        valid_bits = MAX(valid_bits, families[transfer].timestampValidBits);
+    }
+    FREE(families);
+    if (!profiler->gpu_render && !profiler->gpu_transfer)
+    {
+        log_debug("GPU timestamp queries not supported by the queues, profiling the CPU only");
+        return;
+    }
+
+    profiler->timestamp_period = gpu->device_properties.limits.timestampPeriod;
+    profiler->timestamp_mask = valid_bits >= 64 ? UINT64_MAX : ((1ULL << valid_bits) - 1);
+
+    VkQueryPoolCreateInfo info = {0};
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    info.queryCount = DVZ_PROFILER_MAX_BLOCKS * DVZ_PROFILER_MAX_QUERIES;
+    VK_CHECK_RESULT(vkCreateQueryPool(gpu->device, &info, NULL, &profiler->query_pool));
+}
+
+
+
+static bool _block_enabled(DvzProfiler* profiler, uint32_t block)
+{
+    if (profiler == NULL || profiler->query_pool == VK_NULL_HANDLE)
+        return false;
+    ASSERT(block < DVZ_PROFILER_MAX_BLOCKS);
+    return block == DVZ_PROFILER_TRANSFER_BLOCK ? profiler->gpu_transfer : profiler->gpu_render;
+}
+
+
+
+/*************************************************************************************************/
+/*  Profiler                                                                                     */
+/*************************************************************************************************/
+
+DvzProfiler* dvz_profiler(DvzGpu* gpu)
+{
+    ASSERT(gpu != NULL);
+    DvzProfiler* profiler = calloc(1, sizeof(DvzProfiler));
+    ASSERT(profiler != NULL);
+    profiler->gpu = gpu;
+    profiler->main_thread = pthread_self();
+    _clock_init(&profiler->clock);
+
+    atomic_init(&profiler->ring_count, 0);
+    for (uint32_t i = 0; i < DVZ_PROFILER_MAX_THREADS; i++)
+    {
+        atomic_init(&profiler->rings[i].registered, false);
+        atomic_init(&profiler->rings[i].head, 0);
+        atomic_init(&profiler->rings[i].tail, 0);
+        atomic_init(&profiler->rings[i].dropped, 0);
+    }
+
+    _profiler_queries(profiler);
+
+    dvz_obj_created(&profiler->obj);
+    return profiler;
+}
+
+
+
+double dvz_profiler_begin(DvzProfiler* profiler)
+{
+    if (profiler == NULL)
+        return 0;
+    return _clock_get(&profiler->clock) * 1000000.0;
+}
+
+
+
+void dvz_profiler_end(
+    DvzProfiler* profiler, DvzProfileZoneType type, const char* name, double start)
+{
+    if (profiler == NULL)
+        return;
+    ASSERT(type < DVZ_PROFILE_COUNT);
+    double end = dvz_profiler_begin(profiler);
+
+    DvzProfileZone zone = {0};
+    zone.type = type;
+    zone.name = name != NULL ? name : DVZ_PROFILE_ZONE_NAMES[type];
+    zone.frame_idx = profiler->frame_idx;
+    zone.start = start;
+    zone.duration = end >= start ? end - start : 0;
+    _profiler_push(profiler, zone);
+}
+
+
+
+void dvz_profiler_frame(DvzProfiler* profiler, uint64_t frame_idx)
+{
+    if (profiler == NULL)
+        return;
+    profiler->current.frame_idx = frame_idx;
+    profiler->last = profiler->current;
+    memset(&profiler->current, 0, sizeof(DvzFrameProfile));
+    profiler->frame_idx = frame_idx + 1;
+}
+
+
+
+DvzFrameProfile dvz_profiler_summary(DvzProfiler* profiler)
+{
+    ASSERT(profiler != NULL);
+    return profiler->last;
+}
+
+
+
+int dvz_profiler_dump(DvzProfiler* profiler, const char* path)
+{
+    ASSERT(profiler != NULL);
+    ASSERT(path != NULL);
+
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        log_error("unable to open %s", path);
+        return 1;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(
+        fp,
+        "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, "
+        "\"args\": {\"name\": \"GPU\"}}",
+        DVZ_PROFILER_GPU_TID);
+
+    uint32_t count = MIN(atomic_load(&profiler->ring_count), DVZ_PROFILER_MAX_THREADS);
+    DvzProfilerRing* ring = NULL;
+    DvzProfileZone* zone = NULL;
+    uint64_t head = 0, tail = 0, dropped = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ring = &profiler->rings[i];
+        if (!atomic_load(&ring->registered))
+            continue;
+        fprintf(
+            fp,
+            ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, "
+            "\"args\": {\"name\": \"%s %d\"}}",
+            i + 1, pthread_equal(ring->thread, profiler->main_thread) ? "main" : "thread", i);
+
+        head = atomic_load(&ring->head);
+        tail = atomic_load(&ring->tail);
+        for (uint64_t k = tail; k < head; k++)
+        {
+            zone = &ring->zones[k % DVZ_PROFILER_RING_SIZE];
+            fprintf(
+                fp,
+                ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, "
+                "\"dur\": %.3f, \"pid\": 0, \"tid\": %d, "
+                "\"args\": {\"frame\": %" PRIu64 ", \"id\": %d}}",
+                zone->name, _is_gpu_zone(zone->type) ? "gpu" : "cpu", zone->start,
+                zone->duration, _is_gpu_zone(zone->type) ? DVZ_PROFILER_GPU_TID : (int)i + 1,
+                zone->frame_idx, zone->id);
+        }
+        // Release the consumed zones to the owner thread.
+        atomic_store(&ring->tail, head);
+        dropped += atomic_load(&ring->dropped);
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+
+    if (dropped > 0)
+        log_warn("%" PRIu64 " profiler zones were dropped as the rings were full", dropped);
+    log_info("profiler trace written to %s", path);
+    return 0;
+}
+
+
+
+void dvz_profiler_destroy(DvzProfiler* profiler)
+{
+    if (profiler == NULL || !dvz_obj_is_created(&profiler->obj))
+    {
+        log_trace("skip destruction of already-destroyed profiler");
+        return;
+    }
+    if (profiler->query_pool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(profiler->gpu->device, profiler->query_pool, NULL);
+    dvz_obj_destroyed(&profiler->obj);
+    FREE(profiler);
+}
+
+
+
+/*************************************************************************************************/
+/*  GPU timestamp queries                                                                        */
+/*************************************************************************************************/
+
+void dvz_profiler_gpu_reset(DvzProfiler* profiler, DvzCommands* cmds, uint32_t idx, uint32_t block)
+{
+    if (!_block_enabled(profiler, block))
+        return;
+    ASSERT(cmds != NULL);
+    ASSERT(idx < cmds->count);
+    // Collect the pending results of the block before its queries are recorded again.
+    dvz_profiler_gpu_collect(profiler, block);
+    profiler->query_pending[block] = false;
+    vkCmdResetQueryPool(
+        cmds->cmds[idx], profiler->query_pool, block * DVZ_PROFILER_MAX_QUERIES,
+        DVZ_PROFILER_MAX_QUERIES);
+    profiler->query_count[block] = 0;
+    profiler->query_types[block] =
+        block == DVZ_PROFILER_TRANSFER_BLOCK ? DVZ_PROFILE_GPU_TRANSFER : DVZ_PROFILE_GPU_DRAW;
+}
+
+
+
+uint32_t dvz_profiler_gpu_begin(
+    DvzProfiler* profiler, DvzCommands* cmds, uint32_t idx, uint32_t block, const char* name)
+{
+    if (!_block_enabled(profiler, block))
+        return UINT32_MAX;
+    ASSERT(cmds != NULL);
+    ASSERT(idx < cmds->count);
+
+    // Each zone uses a pair of queries.
+    uint32_t query = profiler->query_count[block];
+    if (query + 2 > DVZ_PROFILER_MAX_QUERIES)
+    {
+        log_trace("maximum number of GPU queries reached in block %d", block);
+        return UINT32_MAX;
+    }
+    profiler->query_count[block] += 2;
+    profiler->query_names[block][query / 2] = name;
+    vkCmdWriteTimestamp(
+        cmds->cmds[idx], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, profiler->query_pool,
+        block * DVZ_PROFILER_MAX_QUERIES + query);
+    return query / 2;
+}
+
+
+
+void dvz_profiler_gpu_end(
+    DvzProfiler* profiler, DvzCommands* cmds, uint32_t idx, uint32_t block, uint32_t zone)
+{
+    if (!_block_enabled(profiler, block) || zone == UINT32_MAX)
+        return;
+    ASSERT(cmds != NULL);
+    ASSERT(idx < cmds->count);
+    ASSERT(2 * zone + 1 < profiler->query_count[block]);
+    vkCmdWriteTimestamp(
+        cmds->cmds[idx], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, profiler->query_pool,
+        block * DVZ_PROFILER_MAX_QUERIES + 2 * zone + 1);
+}
+
+
+
+void dvz_profiler_gpu_submit(DvzProfiler* profiler, uint32_t block)
+{
+    if (!_block_enabled(profiler, block) || profiler->query_count[block] == 0)
+        return;
+    profiler->query_submit[block] = dvz_profiler_begin(profiler);
+    profiler->query_pending[block] = true;
+}
+
+
+
+void dvz_profiler_gpu_collect(DvzProfiler* profiler, uint32_t block)
+{
+    if (!_block_enabled(profiler, block) || !profiler->query_pending[block])
+        return;
+    uint32_t count = profiler->query_count[block];
+    if (count == 0)
+        return;
+
+    uint64_t ts[DVZ_PROFILER_MAX_QUERIES] = {0};
+    VkResult res = vkGetQueryPoolResults(
+        profiler->gpu->device, profiler->query_pool, block * DVZ_PROFILER_MAX_QUERIES, count,
+        count * sizeof(uint64_t), ts, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    // The results are not available yet, try again later.
+    if (res != VK_SUCCESS)
+        return;
+    profiler->query_pending[block] = false;
+
+    // The GPU timeline is aligned on the CPU time of the submission.
+    uint64_t mask = profiler->timestamp_mask;
+    uint64_t t0 = ts[0] & mask;
+    double period = profiler->timestamp_period / 1000.0; // microseconds per tick
+    DvzProfileZone zone = {0};
+    zone.type = profiler->query_types[block];
+    zone.frame_idx = profiler->frame_idx;
+    uint64_t start = 0, end = 0;
+    for (uint32_t k = 0; k < count / 2; k++)
+    {
+        start = ts[2 * k] & mask;
+        end = ts[2 * k + 1] & mask;
+        zone.name = profiler->query_names[block][k];
+        zone.id = k;
+        zone.start = profiler->query_submit[block] + (start >= t0 ? (start - t0) * period : 0);
+        zone.duration = end >= start ? (end - start) * period : 0;
+        _profiler_push(profiler, zone);
+    }
+}
@@ -0,0 +1,393 @@
+#include "../include/datoviz/replay.h"
+#include <inttypes.h>
+#include <stdlib.h>
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+
+
+
+static bool _is_recorded_event(DvzEventType type)
+{
+    switch (type)
+    {
+    case DVZ_EVENT_FRAME:
+    case DVZ_EVENT_MOUSE_PRESS:
+    case DVZ_EVENT_MOUSE_RELEASE:
+    case DVZ_EVENT_MOUSE_MOVE:
+    case DVZ_EVENT_MOUSE_WHEEL:
+    case DVZ_EVENT_KEY_PRESS:
+    case DVZ_EVENT_KEY_RELEASE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+
+static DvzEventRecord _event_record(DvzEvent ev)
+{
+    DvzEventRecord record = {0};
+    record.type = (int32_t)ev.type;
+    switch (ev.type)
+    {
+    case DVZ_EVENT_MOUSE_PRESS:
+    case DVZ_EVENT_MOUSE_RELEASE:
+        record.code = (int32_t)ev.u.b.button;
+        record.modifiers = ev.u.b.modifiers;
+        break;
+    case DVZ_EVENT_MOUSE_MOVE:
+        record.pos[0] = ev.u.m.pos[0];
+        record.pos[1] = ev.u.m.pos[1];
+        record.modifiers = ev.u.m.modifiers;
+        break;
+    case DVZ_EVENT_MOUSE_WHEEL:
+        record.pos[0] = ev.u.w.dir[0];
+        record.pos[1] = ev.u.w.dir[1];
+        record.modifiers = ev.u.w.modifiers;
+        break;
+    case DVZ_EVENT_KEY_PRESS:
+    case DVZ_EVENT_KEY_RELEASE:
+        record.code = (int32_t)ev.u.k.key_code;
+        record.modifiers = ev.u.k.modifiers;
+        break;
+    default:
+        break;
+    }
+    return record;
+}
+
+
+
+// Raise an input event with the public functions, so that the mouse and keyboard states are
+// updated exactly as with a backend.
+static void _event_inject(DvzCanvas* canvas, DvzEventRecord* record)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(record != NULL);
+    vec2 pos = {record->pos[0], record->pos[1]};
+    switch ((DvzEventType)record->type)
+    {
+    case DVZ_EVENT_MOUSE_PRESS:
+        dvz_event_mouse_press(canvas, (DvzMouseButton)record->code, record->modifiers);
+        break;
+    case DVZ_EVENT_MOUSE_RELEASE:
+        dvz_event_mouse_release(canvas, (DvzMouseButton)record->code, record->modifiers);
+        break;
+    case DVZ_EVENT_MOUSE_MOVE:
+        dvz_event_mouse_move(canvas, pos, record->modifiers);
+        break;
+    case DVZ_EVENT_MOUSE_WHEEL:
+        dvz_event_mouse_wheel(canvas, pos, record->modifiers);
+        break;
+    case DVZ_EVENT_KEY_PRESS:
+        dvz_event_key_press(canvas, (DvzKeyCode)record->code, record->modifiers);
+        break;
+    case DVZ_EVENT_KEY_RELEASE:
+        dvz_event_key_release(canvas, (DvzKeyCode)record->code, record->modifiers);
+        break;
+    default:
+        log_warn("skip unexpected event type %d in the event file", record->type);
+        break;
+    }
+}
+
+
+
+// 64-bit FNV-1a hash.
+static uint64_t _checksum(const uint8_t* data, uint64_t size)
+{
+    ASSERT(data != NULL);
+    uint64_t hash = FNV_OFFSET;
+    for (uint64_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+
+
+static uint64_t _frame_checksum(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    DvzImages* images = canvas->swapchain.images;
+    ASSERT(images != NULL);
+    uint8_t* rgb = dvz_screenshot(canvas, false);
+    if (rgb == NULL)
+        return 0;
+    uint64_t checksum = _checksum(rgb, (uint64_t)images->width * images->height * 3);
+    FREE(rgb);
+    return checksum;
+}
+
+
+
+/*************************************************************************************************/
+/*  Recording                                                                                    */
+/*************************************************************************************************/
+
+DvzEventRecorder* dvz_event_record(DvzCanvas* canvas, const char* path)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(path != NULL);
+
+    if (canvas->recorder != NULL)
+    {
+        log_warn("the canvas events are already being recorded, stopping the previous recording");
+        dvz_event_record_stop(canvas);
+    }
+
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        log_error("unable to open %s", path);
+        return NULL;
+    }
+
+    uvec2 size = {0};
+    dvz_canvas_size(canvas, DVZ_CANVAS_SIZE_SCREEN, size);
+    DvzEventFileHeader header = {0};
+    memcpy(header.magic, DVZ_EVENT_FILE_MAGIC, sizeof(header.magic));
+    header.version = DVZ_EVENT_FILE_VERSION;
+    header.width = size[0];
+    header.height = size[1];
+    fwrite(&header, sizeof(header), 1, fp);
+
+    DvzEventRecorder* recorder = calloc(1, sizeof(DvzEventRecorder));
+    ASSERT(recorder != NULL);
+    recorder->fp = fp;
+    _clock_init(&recorder->clock);
+    dvz_obj_created(&recorder->obj);
+
+    log_debug("start recording the canvas events to %s", path);
+    canvas->recorder = recorder;
+    return recorder;
+}
+
+
+
+void dvz_event_record_write(DvzEventRecorder* recorder, DvzEvent ev)
+{
+    ASSERT(recorder != NULL);
+    ASSERT(recorder->fp != NULL);
+    if (!_is_recorded_event(ev.type))
+        return;
+
+    DvzEventRecord record = _event_record(ev);
+    record.time = _clock_get(&recorder->clock);
+    fwrite(&record, sizeof(record), 1, recorder->fp);
+    recorder->count++;
+}
+
+
+
+void dvz_event_record_stop(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    DvzEventRecorder* recorder = canvas->recorder;
+    if (recorder == NULL)
+        return;
+
+    // Stop recording before closing the file.
+    canvas->recorder = NULL;
+    fclose(recorder->fp);
+    log_debug("%" PRIu64 " events recorded", recorder->count);
+    dvz_obj_destroyed(&recorder->obj);
+    FREE(recorder);
+}
+
+
+
+/*************************************************************************************************/
+/*  Replay                                                                                       */
+/*************************************************************************************************/
+
+DvzEventReplay* dvz_event_replay(DvzCanvas* canvas, const char* path)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(path != NULL);
+
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        log_error("unable to open %s", path);
+        return NULL;
+    }
+
+    DvzEventFileHeader header = {0};
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, DVZ_EVENT_FILE_MAGIC, sizeof(header.magic)) != 0)
+    {
+        log_error("%s is not an event file", path);
+        fclose(fp);
+        return NULL;
+    }
+    if (header.version != DVZ_EVENT_FILE_VERSION)
+    {
+        log_error("unsupported event file version %d", header.version);
+        fclose(fp);
+        return NULL;
+    }
+
+    // The number of records is given by the file size.
+    long size = fseek(fp, 0, SEEK_END) == 0 ? ftell(fp) : -1;
+    if (size < (long)sizeof(header) || fseek(fp, (long)sizeof(header), SEEK_SET) != 0)
+    {
+        log_error("unable to get the size of %s", path);
+        fclose(fp);
+        return NULL;
+    }
+    uint64_t count = (uint64_t)(size - (long)sizeof(header)) / sizeof(DvzEventRecord);
+
+    DvzEventReplay* replay = calloc(1, sizeof(DvzEventReplay));
+    ASSERT(replay != NULL);
+    replay->canvas = canvas;
+    replay->header = header;
+    if (count > 0)
+    {
+        replay->records = calloc(count, sizeof(DvzEventRecord));
+        ASSERT(replay->records != NULL);
+        replay->record_count = fread(replay->records, sizeof(DvzEventRecord), count, fp);
+    }
+    fclose(fp);
+
+    uvec2 screen = {0};
+    dvz_canvas_size(canvas, DVZ_CANVAS_SIZE_SCREEN, screen);
+    if (screen[0] != header.width || screen[1] != header.height)
+        log_warn(
+            "the events were recorded in a %dx%d canvas, replaying them in a %dx%d canvas",
+            header.width, header.height, screen[0], screen[1]);
+
+    log_debug("loaded %" PRIu64 " events from %s", replay->record_count, path);
+    dvz_obj_created(&replay->obj);
+    return replay;
+}
+
+
+
+int dvz_event_replay_run(DvzEventReplay* replay, int flags)
+{
+    ASSERT(replay != NULL);
+    DvzCanvas* canvas = replay->canvas;
+    ASSERT(canvas != NULL);
+    ASSERT(canvas->app != NULL);
+    if (canvas->app->is_running)
+    {
+        log_error("cannot replay events while the app is running");
+        return 1;
+    }
+
+    bool max_speed = (flags & DVZ_REPLAY_FLAGS_MAX_SPEED) != 0;
+    bool checksum = (flags & DVZ_REPLAY_FLAGS_CHECKSUM) != 0;
+
+    // One result per recorded frame, plus one for the input events after the last frame.
+    FREE(replay->frames);
+    replay->frames = calloc(replay->record_count + 1, sizeof(DvzReplayFrame));
+    replay->frame_count = 0;
+
+    DvzClock clock = {0};
+    _clock_init(&clock);
+    // The mouse state machine uses the canvas clock to detect clicks and double clicks. The
+    // clock is shifted to the recorded times before every input event, it is updated again at
+    // the next frame.
+    double t0 = canvas->clock.elapsed;
+
+    DvzEventRecord* record = NULL;
+    DvzReplayFrame* frame = NULL;
+    double t = _clock_get(&clock);
+    uint64_t pending = 0; // number of input events injected since the last frame
+    for (uint64_t i = 0; i <= replay->record_count; i++)
+    {
+        record = i < replay->record_count ? &replay->records[i] : NULL;
+        if (record != NULL && record->type != DVZ_EVENT_FRAME)
+        {
+            canvas->clock.elapsed = t0 + record->time;
+            _event_inject(canvas, record);
+            pending++;
+            continue;
+        }
+        if (record == NULL && pending == 0)
+            break;
+
+        // Wait until the recorded time of the frame.
+        if (!max_speed && record != NULL)
+        {
+            while (_clock_get(&clock) < record->time)
+                dvz_sleep(1);
+        }
+
+        frame = &replay->frames[replay->frame_count++];
+        frame->time = record != NULL ? record->time : 0;
+        frame->events = _clock_get(&clock) - t;
+        t = _clock_get(&clock);
+        dvz_canvas_request_frame(canvas);
+        dvz_app_run(canvas->app, 1);
+        frame->duration = _clock_get(&clock) - t;
+
+        // The hash is computed after the frame timing, as a screenshot synchronizes the GPU.
+        if (checksum)
+            frame->checksum = _frame_checksum(canvas);
+        t = _clock_get(&clock);
+        pending = 0;
+    }
+
+    log_debug(
+        "replayed %" PRIu64 " events in %" PRIu64 " frames", replay->record_count,
+        replay->frame_count);
+    return 0;
+}
+
+
+
+int dvz_event_replay_dump(DvzEventReplay* replay, const char* path)
+{
+    ASSERT(replay != NULL);
+    ASSERT(path != NULL);
+
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        log_error("unable to open %s", path);
+        return 1;
+    }
+
+    DvzReplayFrame* frame = NULL;
+    fprintf(fp, "{\"events\": %" PRIu64 ", \"frames\": [", replay->record_count);
+    for (uint64_t i = 0; i < replay->frame_count; i++)
+    {
+        frame = &replay->frames[i];
+        fprintf(
+            fp,
+            "%s\n{\"time\": %.6f, \"events\": %.9f, \"duration\": %.9f, "
+            "\"checksum\": \"%016" PRIx64 "\"}",
+            i > 0 ? "," : "", frame->time, frame->events, frame->duration, frame->checksum);
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    log_info("replay timings written to %s", path);
+    return 0;
+}
+
+
+
+void dvz_event_replay_destroy(DvzEventReplay* replay)
+{
+    if (replay == NULL || !dvz_obj_is_created(&replay->obj))
+    {
+        log_trace("skip destruction of already-destroyed replay");
+        return;
+    }
+    FREE(replay->records);
+    FREE(replay->frames);
+    dvz_obj_destroyed(&replay->obj);
+    FREE(replay);
+}
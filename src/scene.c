@@ -11,6 +11,7 @@
 #include "scene_utils.h"
 #include "visuals_utils.h"
 #include "vklite_utils.h"
+#include <inttypes.h>
 
 
 
@@ -34,6 +35,9 @@ DvzScene* dvz_scene(DvzCanvas* canvas, uint32_t n_rows, uint32_t n_cols)
     // Scene update FIFO queue.
     canvas->scene->update_fifo = dvz_fifo(DVZ_MAX_FIFO_CAPACITY);
 
+    if (pthread_mutex_init(&canvas->scene->data_lock, NULL) != 0)
+        log_error("mutex creation failed");
+
     // INIT callback
     dvz_event_callback(canvas, DVZ_EVENT_INIT, 0, DVZ_EVENT_MODE_SYNC, _scene_init, canvas->scene);
 
@@ -64,6 +68,46 @@ DvzScene* dvz_scene(DvzCanvas* canvas, uint32_t n_rows, uint32_t n_cols)
 
 
 
+void dvz_scene_threads(DvzScene* scene, uint32_t thread_count)
+{
+    ASSERT(scene != NULL);
+    DvzCanvas* canvas = scene->canvas;
+    ASSERT(canvas != NULL);
+    ASSERT(thread_count <= DVZ_JOBS_MAX_THREADS);
+    log_debug("record the scene panels with %d worker thread(s)", thread_count);
+
+    // The visual command buffers may be pending execution.
+    dvz_gpu_wait(canvas->gpu);
+    _scene_threads_reset(scene);
+
+    if (thread_count > 0)
+    {
+        scene->jobs = dvz_jobs(thread_count);
+        for (uint32_t i = 0; i < thread_count; i++)
+            scene->cmd_pools[i] = dvz_command_pool(canvas->gpu, DVZ_DEFAULT_QUEUE_RENDER);
+    }
+
+    dvz_canvas_to_refill(canvas);
+}
+
+
+
+void dvz_scene_lock(DvzScene* scene)
+{
+    ASSERT(scene != NULL);
+    pthread_mutex_lock(&scene->data_lock);
+}
+
+
+
+void dvz_scene_unlock(DvzScene* scene)
+{
+    ASSERT(scene != NULL);
+    pthread_mutex_unlock(&scene->data_lock);
+}
+
+
+
 /*************************************************************************************************/
 /*  Controller                                                                                   */
 /*************************************************************************************************/
@@ -278,6 +322,23 @@ DvzVisual* dvz_scene_visual(DvzPanel* panel, DvzVisualType type, int flags)
 
 
 
+void dvz_panel_box(DvzPanel* panel, DvzBox box)
+{
+    ASSERT(panel != NULL);
+
+    // Make the box square if needed.
+    if (_is_aspect_fixed(&panel->data_coords))
+        box = _box_cube(box);
+    _check_box(box);
+
+    if (!_has_coords_changed(&panel->data_coords, &box))
+        return;
+    panel->data_coords.box = box;
+    _enqueue_coords_changed(panel);
+}
+
+
+
 void dvz_custom_visual(DvzPanel* panel, DvzVisual* visual)
 {
     ASSERT(panel != NULL);
@@ -358,6 +419,7 @@ void dvz_camera_pos(DvzPanel* panel, vec3 pos)
     DvzCamera* camera = &panel->controller->interacts[0].u.c;
     glm_vec3_copy(pos, camera->eye);
     _camera_update_mvp(panel->viewport, camera, mvp);
+    dvz_canvas_request_frame(panel->grid->canvas);
 }
 
 
@@ -370,6 +432,7 @@ void dvz_camera_look(DvzPanel* panel, vec3 center)
     DvzCamera* camera = &panel->controller->interacts[0].u.c;
     glm_vec3_sub(center, camera->eye, camera->forward);
     _camera_update_mvp(panel->viewport, camera, mvp);
+    dvz_canvas_request_frame(panel->grid->canvas);
 }
 
 
@@ -382,6 +445,7 @@ void dvz_arcball_rotate(DvzPanel* panel, float angle, vec3 axis)
     DvzArcball* arcball = &panel->controller->interacts[0].u.a;
     glm_quatv(arcball->rotation, angle, axis);
     _arcball_update_mvp(panel->viewport, arcball, mvp);
+    dvz_canvas_request_frame(panel->grid->canvas);
 }
 
 
@@ -410,6 +474,9 @@ void dvz_scene_destroy(DvzScene* scene)
     DvzGrid* grid = &scene->grid;
     ASSERT(grid != NULL);
 
+    // Free the visual command buffers before their command pools are destroyed.
+    _scene_threads_reset(scene);
+
     // Destroy all panels.
     DvzContainerIterator iter = dvz_container_iterator(&grid->panels);
     DvzPanel* panel = NULL;
@@ -428,8 +495,148 @@ void dvz_scene_destroy(DvzScene* scene)
     dvz_container_destroy(&scene->controllers);
 
     dvz_fifo_destroy(&scene->update_fifo);
+    pthread_mutex_destroy(&scene->data_lock);
 
     dvz_container_destroy(&scene->visuals);
     dvz_obj_destroyed(&scene->obj);
     FREE(scene);
 }
+
+
+
+/*************************************************************************************************/
+/*  Memory accounting                                                                            */
+/*************************************************************************************************/
+
+static void _memory_json(FILE* fp, DvzMemoryUsage usage)
+{
+    ASSERT(fp != NULL);
+    fprintf(
+        fp,
+        "\"host\": %" PRIu64 ", \"device\": %" PRIu64 ", \"device_total\": %" PRIu64 ", "
+        "\"arrays\": %d, \"regions\": %d, \"textures\": %d",
+        usage.host, usage.device, usage.device_total, usage.array_count, usage.region_count,
+        usage.texture_count);
+}
+
+
+
+static void _visual_memory_json(FILE* fp, DvzVisual* visual)
+{
+    ASSERT(fp != NULL);
+    ASSERT(visual != NULL);
+
+    fprintf(fp, "{");
+    _memory_json(fp, dvz_visual_memory(visual));
+
+    fprintf(fp, ",\n     \"props\": [");
+    DvzContainerIterator iter = dvz_container_iterator(&visual->props);
+    DvzProp* prop = NULL;
+    bool first = true;
+    while (iter.item != NULL)
+    {
+        prop = iter.item;
+        fprintf(
+            fp, "%s\n      {\"type\": %d, \"idx\": %d, ", first ? "" : ",", prop->prop_type,
+            prop->prop_idx);
+        _memory_json(fp, dvz_prop_memory(prop));
+        fprintf(fp, "}");
+        first = false;
+        dvz_container_iter(&iter);
+    }
+
+    fprintf(fp, "],\n     \"sources\": [");
+    iter = dvz_container_iterator(&visual->sources);
+    DvzSource* source = NULL;
+    first = true;
+    while (iter.item != NULL)
+    {
+        source = iter.item;
+        fprintf(
+            fp, "%s\n      {\"type\": %d, \"idx\": %d, \"kind\": %d, \"origin\": %d, ",
+            first ? "" : ",", source->source_type, source->source_idx, source->source_kind,
+            source->origin);
+        _memory_json(fp, dvz_source_memory(source));
+        fprintf(fp, "}");
+        first = false;
+        dvz_container_iter(&iter);
+    }
+    fprintf(fp, "]}");
+}
+
+
+
+DvzMemoryUsage dvz_canvas_memory(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    DvzMemoryUsage usage = {0};
+    if (canvas->scene == NULL)
+        return usage;
+
+    // NOTE: the panels also reference the custom visuals, which are not in the scene container.
+    DvzContainerIterator iter = dvz_container_iterator(&canvas->scene->grid.panels);
+    DvzPanel* panel = NULL;
+    while (iter.item != NULL)
+    {
+        panel = iter.item;
+        for (uint32_t i = 0; i < panel->visual_count; i++)
+            dvz_memory_add(&usage, dvz_visual_memory(panel->visuals[i]));
+        dvz_container_iter(&iter);
+    }
+    return usage;
+}
+
+
+
+int dvz_memory_dump(DvzCanvas* canvas, const char* path)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(canvas->gpu != NULL);
+    ASSERT(path != NULL);
+
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        log_error("unable to open %s", path);
+        return 1;
+    }
+
+    fprintf(fp, "{\"arrays\": {");
+    _memory_json(fp, dvz_memory_arrays());
+
+    DvzContext* context = canvas->gpu->context;
+    ASSERT(context != NULL);
+    fprintf(fp, "},\n \"context\": {");
+    _memory_json(fp, dvz_context_memory(context));
+
+    fprintf(fp, "},\n \"canvas\": {");
+    _memory_json(fp, dvz_canvas_memory(canvas));
+
+    fprintf(fp, ",\n  \"panels\": [");
+    if (canvas->scene != NULL)
+    {
+        DvzContainerIterator iter = dvz_container_iterator(&canvas->scene->grid.panels);
+        DvzPanel* panel = NULL;
+        bool first = true;
+        while (iter.item != NULL)
+        {
+            panel = iter.item;
+            fprintf(
+                fp, "%s\n   {\"row\": %d, \"col\": %d, \"visuals\": [", first ? "" : ",",
+                panel->row, panel->col);
+            for (uint32_t i = 0; i < panel->visual_count; i++)
+            {
+                fprintf(fp, "%s\n    ", i > 0 ? "," : "");
+                _visual_memory_json(fp, panel->visuals[i]);
+            }
+            fprintf(fp, "]}");
+            first = false;
+            dvz_container_iter(&iter);
+        }
+    }
+    fprintf(fp, "]}}\n");
+    fclose(fp);
+
+    log_info("memory usage written to %s", path);
+    return 0;
+}
@@ -20,6 +20,13 @@ static inline bool _is_visual_to_transform(DvzVisual* visual)
 
 
 
+static inline bool _is_visual_double(DvzVisual* visual)
+{
+    return (visual->flags & DVZ_GRAPHICS_FLAGS_POS_DOUBLE) != 0;
+}
+
+
+
 static inline bool _is_aspect_fixed(DvzDataCoords* coords)
 {
     return (coords->flags & DVZ_TRANSFORM_FLAGS_FIXED_ASPECT) != 0;
@@ -147,12 +154,73 @@ static void _transform_pos_prop(DvzDataCoords coords, DvzProp* prop)
     // Create the transformed prop array.
     log_trace("normalizing POS prop, %d items", arr->item_count);
     // _box_print(coords.box);
+    dvz_array_destroy(arr_tr);
     *arr_tr = dvz_array(arr->item_count, arr->dtype);
     dvz_transform_pos(coords, arr, arr_tr, false);
 }
 
 
 
+// Upload the MVP of a panel without interact, with the data transform of the emulated double
+// precision positions. The MVP of the panels with an interact is uploaded at every frame.
+static void _upload_mvp_data(DvzPanel* panel)
+{
+    ASSERT(panel != NULL);
+    if (!panel->has_data_origin)
+        return;
+    if (panel->controller != NULL && panel->controller->interact_count > 0)
+        return;
+
+    DvzMVP mvp = {0};
+    glm_mat4_identity(mvp.model);
+    glm_mat4_identity(mvp.view);
+    glm_mat4_identity(mvp.proj);
+    dvz_transform_mvp_double(panel->data_coords, panel->data_origin, &mvp);
+    dvz_upload_buffers(panel->scene->canvas, panel->br_mvp, 0, panel->br_mvp.size, &mvp);
+}
+
+
+
+// Transform a POS prop with emulated double precision: only the origin is subtracted on the CPU,
+// the rescaling to NDC is done in the vertex shader, so that the prop does not need to be
+// transformed again when the panel box changes.
+static void _transform_pos_prop_double(DvzPanel* panel, DvzProp* prop)
+{
+    ASSERT(panel != NULL);
+    ASSERT(prop != NULL);
+    ASSERT(prop->prop_type == DVZ_PROP_POS);
+
+    DvzArray* arr = &prop->arr_orig;
+    DvzArray* arr_tr = &prop->arr_trans;
+    if (arr->item_count == 0)
+    {
+        log_warn("empty POS prop, skipping renormalization");
+        return;
+    }
+
+    if (arr_tr->item_count != arr->item_count || arr_tr->dtype != arr->dtype)
+    {
+        dvz_array_destroy(arr_tr);
+        *arr_tr = dvz_array(arr->item_count, arr->dtype);
+    }
+
+    // The panel origin is set once, at the center of the first transformed positions.
+    if (!panel->has_data_origin)
+    {
+        dvz_transform_pos_double(panel->data_coords, (dvec3){0, 0, 0}, arr, arr_tr);
+        DvzBox box = _box_bounding(arr_tr);
+        for (uint32_t j = 0; j < 3; j++)
+            panel->data_origin[j] = .5 * (box.p0[j] + box.p1[j]);
+        panel->has_data_origin = true;
+        _upload_mvp_data(panel);
+    }
+
+    log_trace("transforming double POS prop, %d items", arr->item_count);
+    dvz_transform_pos_double(panel->data_coords, panel->data_origin, arr, arr_tr);
+}
+
+
+
 static DvzBox _compute_panel_box(DvzPanel* panel)
 {
     ASSERT(panel != NULL);
@@ -411,7 +479,10 @@ static void _process_prop_changed(DvzSceneUpdate up)
     ASSERT(up.visual != NULL);
     if (up.prop->prop_type == DVZ_PROP_POS && _is_visual_to_transform(up.visual))
     {
-        _transform_pos_prop(coords, up.prop);
+        if (_is_visual_double(up.visual))
+            _transform_pos_prop_double(up.panel, up.prop);
+        else
+            _transform_pos_prop(coords, up.prop);
 
         if ((up.visual->flags & DVZ_VISUAL_FLAGS_TRANSFORM_BOX_INIT) == 0)
         {
@@ -467,6 +538,11 @@ static void _process_coords_changed(DvzSceneUpdate up)
             continue;
         }
 
+        // NOTE: the positions with emulated double precision are rescaled in the vertex shader,
+        // only the MVP needs to be updated.
+        if (_is_visual_double(visual))
+            continue;
+
         // Go through all visual props.
         iter = dvz_container_iterator(&visual->props);
         while (iter.item != NULL)
@@ -484,6 +560,9 @@ static void _process_coords_changed(DvzSceneUpdate up)
         }
     }
 
+    // Update the data transform of the emulated double precision positions.
+    _upload_mvp_data(panel);
+
     // Update the axes.
     if (panel->controller->type == DVZ_CONTROLLER_AXES_2D)
     {
@@ -825,6 +904,141 @@ static void _process_scene_updates(DvzScene* scene)
 
 
 
+/*************************************************************************************************/
+/*  Parallel recording                                                                           */
+/*************************************************************************************************/
+
+typedef struct SceneFillJob SceneFillJob;
+
+struct SceneFillJob
+{
+    DvzScene* scene;
+    VkClearColorValue clear_color;
+    DvzCommands* cmds;
+    uint32_t img_idx;
+
+    // One job per panel, each panel has a contiguous range of secondary command buffers.
+    DvzPanel** panels;
+    uint32_t* offsets;  // index of the first secondary command buffer of each panel
+    uint32_t* counts;   // number of secondary command buffers of each panel
+    uint32_t* recorded; // number of secondary command buffers recorded by each panel
+    DvzCommands** secondaries;
+};
+
+
+
+// Command pool of the thread recording a panel, the jobs are statically assigned to the threads.
+static VkCommandPool _scene_fill_pool(DvzScene* scene, uint32_t panel_idx)
+{
+    ASSERT(scene != NULL);
+    if (scene->jobs == NULL)
+        return VK_NULL_HANDLE;
+    ASSERT(scene->jobs->thread_count > 0);
+    return scene->cmd_pools[panel_idx % scene->jobs->thread_count];
+}
+
+
+
+// Free the visual command buffers, and destroy the worker threads and their command pools.
+// NOTE: the GPU must be idle.
+static void _scene_threads_reset(DvzScene* scene)
+{
+    ASSERT(scene != NULL);
+    DvzCanvas* canvas = scene->canvas;
+    ASSERT(canvas != NULL);
+
+    DvzPanel* panel = NULL;
+    DvzVisual* visual = NULL;
+    DvzContainerIterator iter = dvz_container_iterator(&scene->grid.panels);
+    while (iter.item != NULL)
+    {
+        panel = iter.item;
+        for (uint32_t k = 0; k < panel->visual_count; k++)
+        {
+            visual = panel->visuals[k];
+            if (visual->cmds_fill.count > 0)
+                dvz_cmd_free(&visual->cmds_fill);
+            memset(&visual->cmds_fill, 0, sizeof(visual->cmds_fill));
+            memset(visual->fill_keys, 0, sizeof(visual->fill_keys));
+        }
+        dvz_container_iter(&iter);
+    }
+
+    if (scene->jobs == NULL)
+        return;
+    for (uint32_t i = 0; i < scene->jobs->thread_count; i++)
+    {
+        dvz_command_pool_destroy(canvas->gpu, scene->cmd_pools[i]);
+        scene->cmd_pools[i] = VK_NULL_HANDLE;
+    }
+    dvz_jobs_destroy(scene->jobs);
+    scene->jobs = NULL;
+}
+
+
+
+// Free, on the main thread, the visual command buffers allocated from the command pool of
+// another thread, as a command pool must not be used by two threads at the same time.
+static void _scene_fill_release(SceneFillJob* job, uint32_t panel_count)
+{
+    ASSERT(job != NULL);
+    VkCommandPool pool = VK_NULL_HANDLE;
+    DvzPanel* panel = NULL;
+    DvzVisual* visual = NULL;
+    for (uint32_t i = 0; i < panel_count; i++)
+    {
+        panel = job->panels[i];
+        pool = _scene_fill_pool(job->scene, i);
+        for (uint32_t k = 0; k < panel->visual_count; k++)
+        {
+            visual = panel->visuals[k];
+            if (visual->cmds_fill.count == 0 || visual->cmds_fill.pool == pool)
+                continue;
+            dvz_cmd_free(&visual->cmds_fill);
+            memset(&visual->cmds_fill, 0, sizeof(visual->cmds_fill));
+        }
+    }
+}
+
+
+
+// Record the secondary command buffers of the visuals of one panel.
+static void
+_scene_fill_panel(DvzJobs* jobs, uint32_t job_idx, uint32_t thread_idx, void* user_data)
+{
+    SceneFillJob* job = (SceneFillJob*)user_data;
+    ASSERT(job != NULL);
+    DvzPanel* panel = job->panels[job_idx];
+    ASSERT(panel != NULL);
+
+    DvzViewport viewport = dvz_panel_viewport(panel);
+    VkCommandPool pool = _scene_fill_pool(job->scene, job_idx);
+    DvzCommands** secondaries = &job->secondaries[job->offsets[job_idx]];
+    DvzVisual* visual = NULL;
+    uint32_t n = 0;
+    uint32_t recorded = 0;
+
+    for (int priority = -panel->prority_max; priority <= panel->prority_max; priority++)
+    {
+        for (uint32_t k = 0; k < panel->visual_count; k++)
+        {
+            visual = panel->visuals[k];
+            if (visual->priority != priority)
+                continue;
+            if (dvz_visual_fill_cached(
+                    visual, job->clear_color, job->cmds, job->img_idx, viewport, pool))
+                recorded++;
+            ASSERT(n < panel->visual_count);
+            secondaries[n++] = &visual->cmds_fill;
+        }
+    }
+
+    job->counts[job_idx] = n;
+    job->recorded[job_idx] = recorded;
+}
+
+
+
 /*************************************************************************************************/
 /*  Scene callbacks                                                                              */
 /*************************************************************************************************/
@@ -844,6 +1058,7 @@ static void _scene_init(DvzCanvas* canvas, DvzEvent ev)
     // Go through all panels in the scene.
     DvzPanel* panel = NULL;
     DvzContainerIterator iter = dvz_container_iterator(&grid->panels);
+    pthread_mutex_lock(&scene->data_lock);
     while (iter.item != NULL)
     {
         panel = iter.item;
@@ -860,6 +1075,18 @@ static void _scene_init(DvzCanvas* canvas, DvzEvent ev)
         }
         dvz_container_iter(&iter);
     }
+    pthread_mutex_unlock(&scene->data_lock);
+}
+
+
+
+// Whether the visuals are recorded in cached secondary command buffers. The GPU timestamps of
+// the profiler are recorded around each visual in the primary command buffers, so they require
+// the visuals to be recorded inline.
+static bool _scene_fill_cached(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    return canvas->profiler == NULL || !canvas->profiler->gpu_render;
 }
 
 
@@ -882,6 +1109,44 @@ static void _scene_fill(DvzCanvas* canvas, DvzEvent ev)
     DvzVisual* visual = NULL;
     uint32_t img_idx = 0;
 
+    // Each visual is recorded in its own secondary command buffer, which is only recorded again
+    // when the visual has changed. The panels may be recorded in parallel by the worker threads,
+    // and the primary command buffer just executes all of them.
+    bool cached = _scene_fill_cached(canvas);
+    SceneFillJob job = {0};
+    uint32_t panel_count = 0;
+    if (cached)
+    {
+        iter = dvz_container_iterator(&grid->panels);
+        while (iter.item != NULL)
+        {
+            panel_count++;
+            dvz_container_iter(&iter);
+        }
+        job.scene = scene;
+        job.clear_color = ev.u.rf.clear_color;
+        job.panels = calloc(MAX(1, panel_count), sizeof(DvzPanel*));
+        job.offsets = calloc(MAX(1, panel_count), sizeof(uint32_t));
+        job.counts = calloc(MAX(1, panel_count), sizeof(uint32_t));
+        job.recorded = calloc(MAX(1, panel_count), sizeof(uint32_t));
+
+        uint32_t visual_count = 0;
+        uint32_t p = 0;
+        iter = dvz_container_iterator(&grid->panels);
+        while (iter.item != NULL)
+        {
+            panel = iter.item;
+            ASSERT(p < panel_count);
+            job.panels[p] = panel;
+            job.offsets[p++] = visual_count;
+            visual_count += panel->visual_count;
+            dvz_container_iter(&iter);
+        }
+        job.secondaries = calloc(MAX(1, visual_count), sizeof(DvzCommands*));
+        _scene_fill_release(&job, panel_count);
+    }
+    uint32_t n = 0;
+
     // Go through all the current command buffers.
     for (uint32_t i = 0; i < ev.u.rf.cmd_count; i++)
     {
@@ -889,8 +1154,37 @@ static void _scene_fill(DvzCanvas* canvas, DvzEvent ev)
         img_idx = ev.u.rf.img_idx;
 
         log_trace("visual fill cmd %d begin %d", i, img_idx);
-        dvz_visual_fill_begin(canvas, cmds, img_idx);
+        if (cached)
+        {
+            dvz_cmd_begin(cmds, img_idx);
+            dvz_cmd_begin_renderpass_secondary(
+                cmds, img_idx, &canvas->renderpass, &canvas->framebuffers);
+
+            job.cmds = cmds;
+            job.img_idx = img_idx;
+            if (scene->jobs != NULL)
+                dvz_jobs_run(scene->jobs, panel_count, _scene_fill_panel, &job);
+            else
+            {
+                for (uint32_t p = 0; p < panel_count; p++)
+                    _scene_fill_panel(NULL, p, 0, &job);
+            }
 
+            // Gather the secondary command buffers of all panels, in order.
+            n = 0;
+            for (uint32_t p = 0; p < panel_count; p++)
+            {
+                for (uint32_t k = 0; k < job.counts[p]; k++)
+                    job.secondaries[n++] = job.secondaries[job.offsets[p] + k];
+                scene->fill_recorded += job.recorded[p];
+            }
+
+            dvz_cmd_execute(cmds, img_idx, n, job.secondaries);
+            dvz_visual_fill_end(canvas, cmds, img_idx);
+            continue;
+        }
+
+        dvz_visual_fill_begin(canvas, cmds, img_idx);
         iter = dvz_container_iterator(&grid->panels);
         while (iter.item != NULL)
         {
@@ -909,7 +1203,6 @@ static void _scene_fill(DvzCanvas* canvas, DvzEvent ev)
                     visual = panel->visuals[k];
                     if (visual->priority != priority)
                         continue;
-
                     dvz_visual_fill_event(
                         visual, ev.u.rf.clear_color, cmds, img_idx, viewport, NULL);
                 }
@@ -919,6 +1212,12 @@ static void _scene_fill(DvzCanvas* canvas, DvzEvent ev)
         }
         dvz_visual_fill_end(canvas, cmds, img_idx);
     }
+
+    FREE(job.panels);
+    FREE(job.offsets);
+    FREE(job.counts);
+    FREE(job.recorded);
+    FREE(job.secondaries);
 }
 
 
@@ -960,11 +1259,17 @@ static void _scene_frame(DvzCanvas* canvas, DvzEvent ev)
     DvzScene* scene = (DvzScene*)ev.user_data;
     ASSERT(scene != NULL);
 
+    // The controllers may update the visual data, and the updates bake it: other threads may
+    // update it concurrently with dvz_visual_data(), while holding the same lock.
+    pthread_mutex_lock(&scene->data_lock);
+
     // Call the controller callbacks of all panels.
     _callback_controllers(scene);
 
     // Process the scene updates.
     _process_scene_updates(scene);
+
+    pthread_mutex_unlock(&scene->data_lock);
 }
 
 
@@ -981,6 +1286,7 @@ static void _upload_mvp(DvzCanvas* canvas, DvzEvent ev)
 
     DvzInteract* interact = NULL;
     DvzController* controller = NULL;
+    DvzMVP mvp = {0};
 
     // Go through all panels that need to be updated.
     DvzPanel* panel = NULL;
@@ -1010,7 +1316,16 @@ static void _upload_mvp(DvzCanvas* canvas, DvzEvent ev)
             // buffer region directly here, although one should make sure that GPU synchronization
             // is properly taken care of.
 
-            dvz_upload_buffers(canvas, panel->br_mvp, 0, panel->br_mvp.size, &interact->mvp);
+            // The data transform of the emulated double precision positions is set here, so
+            // that a change of the panel box does not require any other upload.
+            if (panel->has_data_origin)
+            {
+                mvp = interact->mvp;
+                dvz_transform_mvp_double(panel->data_coords, panel->data_origin, &mvp);
+                dvz_upload_buffers(canvas, panel->br_mvp, 0, panel->br_mvp.size, &mvp);
+            }
+            else
+                dvz_upload_buffers(canvas, panel->br_mvp, 0, panel->br_mvp.size, &interact->mvp);
         }
         dvz_container_iter(&iter);
     }
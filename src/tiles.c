@@ -0,0 +1,876 @@
+#include "../include/datoviz/tiles.h"
+#include "../include/datoviz/canvas.h"
+#include "../include/datoviz/context.h"
+#include "../include/datoviz/transfers.h"
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+static inline uint32_t _tile_index(DvzTiles* tiles, uint32_t level, uint32_t i, uint32_t j)
+{
+    return tiles->level_offset[level] + j * tiles->level_grid[level][0] + i;
+}
+
+
+
+static inline uint32_t _tile_coords(DvzTiles* tiles, uint32_t idx, uvec2 out)
+{
+    uint32_t level = tiles->level_count - 1;
+    while (idx < tiles->level_offset[level])
+        level--;
+    idx -= tiles->level_offset[level];
+    out[0] = idx % tiles->level_grid[level][0];
+    out[1] = idx / tiles->level_grid[level][0];
+    return level;
+}
+
+
+
+static inline VkDeviceSize _slot_bytes(DvzTiles* tiles)
+{
+    VkDeviceSize s = tiles->slot_size;
+    return s * s * sizeof(cvec4);
+}
+
+
+
+// Tiles of a level covering a rectangle in full-resolution pixels, returns the number of tiles.
+static uint32_t _tiles_range(
+    DvzTiles* tiles, uint32_t level, double x0, double y0, double x1, double y1, uvec4 out)
+{
+    double ts = tiles->tile_size * pow(2, level);
+    out[0] = (uint32_t)floor(x0 / ts);
+    out[1] = (uint32_t)floor(y0 / ts);
+    out[2] = MIN((uint32_t)ceil(x1 / ts), tiles->level_grid[level][0]);
+    out[3] = MIN((uint32_t)ceil(y1 / ts), tiles->level_grid[level][1]);
+    if (out[0] >= out[2] || out[1] >= out[3])
+        return 0;
+    return (out[2] - out[0]) * (out[3] - out[1]);
+}
+
+
+
+static int _compare_keys(const void* a, const void* b)
+{
+    uint64_t u = *(const uint64_t*)a;
+    uint64_t v = *(const uint64_t*)b;
+    return (u > v) - (u < v);
+}
+
+
+
+/*************************************************************************************************/
+/*  Pyramid                                                                                      */
+/*************************************************************************************************/
+
+static void _tiles_layout(DvzTiles* tiles)
+{
+    ASSERT(tiles != NULL);
+    const uint64_t T = tiles->tile_size;
+    uint64_t w = 0, h = 0;
+    uint32_t count = 0;
+    for (uint32_t level = 0; level < DVZ_TILE_MAX_LEVELS; level++)
+    {
+        // Each level halves the resolution, rounding up.
+        w = ((uint64_t)tiles->shape[0] + (1ull << level) - 1) >> level;
+        h = ((uint64_t)tiles->shape[1] + (1ull << level) - 1) >> level;
+        tiles->level_shape[level][0] = (uint32_t)w;
+        tiles->level_shape[level][1] = (uint32_t)h;
+        tiles->level_grid[level][0] = (uint32_t)((w + T - 1) / T);
+        tiles->level_grid[level][1] = (uint32_t)((h + T - 1) / T);
+        tiles->level_offset[level] = count;
+        count += tiles->level_grid[level][0] * tiles->level_grid[level][1];
+        tiles->level_count = level + 1;
+        // The coarsest level fits in a single tile.
+        if (w <= T && h <= T)
+            break;
+    }
+    if (w > T || h > T)
+        log_warn("image too large for %d pyramid levels", DVZ_TILE_MAX_LEVELS);
+    tiles->tile_count = count;
+}
+
+
+
+// Average the 2x2 blocks of pixels of a level.
+static void _tiles_downsample(const cvec4* src, uvec2 src_shape, cvec4* dst, uvec2 dst_shape)
+{
+    ASSERT(src != NULL);
+    ASSERT(dst != NULL);
+    uint32_t x0 = 0, x1 = 0, y0 = 0, y1 = 0, v = 0;
+    for (uint32_t y = 0; y < dst_shape[1]; y++)
+    {
+        y0 = 2 * y;
+        y1 = MIN(2 * y + 1, src_shape[1] - 1);
+        for (uint32_t x = 0; x < dst_shape[0]; x++)
+        {
+            x0 = 2 * x;
+            x1 = MIN(2 * x + 1, src_shape[0] - 1);
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                v = src[y0 * src_shape[0] + x0][c] + src[y0 * src_shape[0] + x1][c] +
+                    src[y1 * src_shape[0] + x0][c] + src[y1 * src_shape[0] + x1][c];
+                dst[y * dst_shape[0] + x][c] = (uint8_t)((v + 2) / 4);
+            }
+        }
+    }
+}
+
+
+
+// Tile loader of the in-memory pyramid.
+static void
+_tiles_image_loader(DvzTiles* tiles, uint32_t level, uvec2 tile, cvec4* out, void* user_data)
+{
+    ASSERT(tiles != NULL);
+    ASSERT(tiles->levels[level] != NULL);
+
+    const uint32_t T = tiles->tile_size;
+    const uint32_t w = tiles->level_shape[level][0];
+    const uint32_t h = tiles->level_shape[level][1];
+    uint32_t x0 = tile[0] * T;
+    uint32_t y0 = tile[1] * T;
+    uint32_t vw = MIN(T, w - x0);
+    uint32_t vh = MIN(T, h - y0);
+    const cvec4* src = tiles->levels[level];
+    for (uint32_t j = 0; j < vh; j++)
+        memcpy(&out[j * T], &src[(uint64_t)(y0 + j) * w + x0], vw * sizeof(cvec4));
+}
+
+
+
+// Copy a loaded tile with its apron. The pixels outside the image are clamped to the image
+// border.
+static void _tiles_apron(DvzTiles* tiles, uint32_t tile_idx, const cvec4* tile, cvec4* out)
+{
+    ASSERT(tiles != NULL);
+
+    const int64_t T = tiles->tile_size;
+    const int64_t S = tiles->slot_size;
+    const int64_t A = DVZ_TILE_APRON;
+
+    uvec2 coords = {0};
+    uint32_t level = _tile_coords(tiles, tile_idx, coords);
+    const int64_t vw = MIN(T, (int64_t)tiles->level_shape[level][0] - coords[0] * T);
+    const int64_t vh = MIN(T, (int64_t)tiles->level_shape[level][1] - coords[1] * T);
+    ASSERT(vw > 0 && vh > 0);
+
+    cvec4* row = NULL;
+    for (int64_t j = 0; j < S; j++)
+    {
+        row = &out[j * S];
+        memcpy(&row[A], &tile[CLIP(j - A, 0, vh - 1) * T], (size_t)vw * sizeof(cvec4));
+        for (int64_t i = 0; i < A; i++)
+            memcpy(row[i], row[A], sizeof(cvec4));
+        for (int64_t i = A + vw; i < S; i++)
+            memcpy(row[i], row[A + vw - 1], sizeof(cvec4));
+    }
+}
+
+
+
+/*************************************************************************************************/
+/*  Loader thread                                                                                */
+/*************************************************************************************************/
+
+// Take the next requested tile and a free buffer. Must be called with the lock.
+static DvzTileBuffer* _tiles_next(DvzTiles* tiles)
+{
+    ASSERT(tiles != NULL);
+
+    DvzTileBuffer* buffer = NULL;
+    for (uint32_t i = 0; i < tiles->buffer_count; i++)
+    {
+        if (tiles->buffers[i].state == DVZ_TILE_BUFFER_FREE)
+        {
+            buffer = &tiles->buffers[i];
+            break;
+        }
+    }
+    if (buffer == NULL)
+        return NULL;
+
+    // The queue is sorted by priority.
+    uint32_t tile_idx = 0;
+    while (tiles->queue_pos < tiles->queue_count)
+    {
+        tile_idx = tiles->queue[tiles->queue_pos++];
+        if (tiles->state[tile_idx] != DVZ_TILE_QUEUED)
+            continue;
+        tiles->state[tile_idx] = DVZ_TILE_LOADING;
+        buffer->state = DVZ_TILE_BUFFER_LOADING;
+        buffer->tile_idx = tile_idx;
+        return buffer;
+    }
+    return NULL;
+}
+
+
+
+static void* _tiles_loader(void* user_data)
+{
+    DvzTiles* tiles = (DvzTiles*)user_data;
+    ASSERT(tiles != NULL);
+
+    DvzTileBuffer* buffer = NULL;
+    uvec2 coords = {0};
+    uint32_t level = 0;
+    while (true)
+    {
+        pthread_mutex_lock(&tiles->lock);
+        while (atomic_load(&tiles->is_running) && (buffer = _tiles_next(tiles)) == NULL)
+            pthread_cond_wait(&tiles->cond, &tiles->lock);
+        pthread_mutex_unlock(&tiles->lock);
+        if (!atomic_load(&tiles->is_running))
+            break;
+        ASSERT(buffer != NULL);
+
+        // Load the tile outside of the lock.
+        level = _tile_coords(tiles, buffer->tile_idx, coords);
+        tiles->loader(tiles, level, coords, buffer->tile, tiles->user_data);
+        _tiles_apron(tiles, buffer->tile_idx, buffer->tile, buffer->data);
+
+        pthread_mutex_lock(&tiles->lock);
+        buffer->state = DVZ_TILE_BUFFER_LOADED;
+        tiles->state[buffer->tile_idx] = DVZ_TILE_LOADED;
+        tiles->stats.loads++;
+        pthread_cond_broadcast(&tiles->cond);
+        pthread_mutex_unlock(&tiles->lock);
+
+        // Canvases rendering on demand need a frame to upload the tile.
+        dvz_canvas_request_frame(tiles->canvas);
+    }
+    return NULL;
+}
+
+
+
+/*************************************************************************************************/
+/*  Tile selection                                                                               */
+/*************************************************************************************************/
+
+// Select the pyramid level matching the view resolution, and request the tiles covering the
+// view at this level and at all coarser levels, coarsest first. The coarser tiles are drawn
+// until the finer ones are in the atlas.
+static void _tiles_select(DvzTiles* tiles, dvec4 view, uvec2 size)
+{
+    ASSERT(tiles != NULL);
+
+    // The image occupies [-1, +1]^2 in normalized coordinates, the pixel rows go downwards.
+    const double W = tiles->shape[0];
+    const double H = tiles->shape[1];
+    double x0 = .5 * (view[0] + 1) * W;
+    double x1 = .5 * (view[2] + 1) * W;
+    double y0 = .5 * (1 - view[3]) * H;
+    double y1 = .5 * (1 - view[1]) * H;
+
+    // Number of full-resolution pixels per screen pixel.
+    double scale = MIN((x1 - x0) / MAX(size[0], 1), (y1 - y0) / MAX(size[1], 1));
+    int32_t level = scale > 1 ? (int32_t)floor(log2(scale)) : 0;
+    level = CLIP(level, 0, (int32_t)tiles->level_count - 1);
+
+    x0 = CLIP(x0, 0, W);
+    x1 = CLIP(x1, 0, W);
+    y0 = CLIP(y0, 0, H);
+    y1 = CLIP(y1, 0, H);
+    tiles->is_visible = x0 < x1 && y0 < y1;
+
+    tiles->epoch++;
+    tiles->wanted_count = 0;
+    if (tiles->is_visible)
+    {
+        // Use a coarser level if the tiles do not fit in the atlas. This always terminates as
+        // the coarsest level has a single tile.
+        uvec4 range = {0};
+        uint32_t n = 0;
+        for (; level < (int32_t)tiles->level_count; level++)
+        {
+            n = 0;
+            for (uint32_t m = (uint32_t)level; m < tiles->level_count; m++)
+                n += _tiles_range(tiles, m, x0, y0, x1, y1, range);
+            if (n <= tiles->slot_count)
+                break;
+        }
+        ASSERT(level < (int32_t)tiles->level_count);
+
+        // Coarsest levels first.
+        uint32_t first = 0;
+        for (int32_t m = (int32_t)tiles->level_count - 1; m >= level; m--)
+        {
+            first = tiles->wanted_count;
+            _tiles_range(tiles, (uint32_t)m, x0, y0, x1, y1, range);
+            for (uint32_t j = range[1]; j < range[3]; j++)
+                for (uint32_t i = range[0]; i < range[2]; i++)
+                    tiles->wanted[tiles->wanted_count++] = _tile_index(tiles, (uint32_t)m, i, j);
+        }
+        ASSERT(tiles->wanted_count <= tiles->slot_count);
+        memcpy(tiles->range, range, sizeof(uvec4));
+
+        // Selected level: the tiles closest to the view center first. The sort key is the
+        // squared distance in tiles, in 1/16 units, followed by the tile index.
+        double ts = tiles->tile_size * pow(2, level);
+        double cx = .5 * (x0 + x1) / ts, cy = .5 * (y0 + y1) / ts;
+        double dx = 0, dy = 0;
+        uvec2 coords = {0};
+        for (uint32_t k = first; k < tiles->wanted_count; k++)
+        {
+            _tile_coords(tiles, tiles->wanted[k], coords);
+            dx = coords[0] + .5 - cx;
+            dy = coords[1] + .5 - cy;
+            tiles->wanted_keys[k] =
+                ((uint64_t)MIN(16 * (dx * dx + dy * dy), UINT32_MAX) << 32) | tiles->wanted[k];
+        }
+        qsort(
+            &tiles->wanted_keys[first], tiles->wanted_count - first, sizeof(uint64_t),
+            _compare_keys);
+        for (uint32_t k = first; k < tiles->wanted_count; k++)
+            tiles->wanted[k] = (uint32_t)(tiles->wanted_keys[k] & 0xFFFFFFFF);
+    }
+    tiles->level = (uint32_t)level;
+    for (uint32_t k = 0; k < tiles->wanted_count; k++)
+        tiles->wanted_epoch[tiles->wanted[k]] = tiles->epoch;
+
+    // Replace the request queue.
+    double now = _clock_get(&tiles->clock);
+    pthread_mutex_lock(&tiles->lock);
+    uint32_t tile_idx = 0;
+    for (uint32_t i = tiles->queue_pos; i < tiles->queue_count; i++)
+    {
+        tile_idx = tiles->queue[i];
+        if (tiles->state[tile_idx] == DVZ_TILE_QUEUED)
+            tiles->state[tile_idx] = DVZ_TILE_EMPTY;
+    }
+    tiles->queue_pos = 0;
+    tiles->queue_count = 0;
+    for (uint32_t k = 0; k < tiles->wanted_count; k++)
+    {
+        tile_idx = tiles->wanted[k];
+        if (tiles->state[tile_idx] != DVZ_TILE_EMPTY)
+            continue;
+        tiles->state[tile_idx] = DVZ_TILE_QUEUED;
+        tiles->requested[tile_idx] = now;
+        tiles->queue[tiles->queue_count++] = tile_idx;
+    }
+    pthread_cond_broadcast(&tiles->cond);
+    pthread_mutex_unlock(&tiles->lock);
+
+    memcpy(tiles->view, view, sizeof(dvec4));
+    memcpy(tiles->view_size, size, sizeof(uvec2));
+    tiles->has_view = true;
+}
+
+
+
+/*************************************************************************************************/
+/*  LRU cache                                                                                    */
+/*************************************************************************************************/
+
+static void _lru_remove(DvzTiles* tiles, int32_t slot)
+{
+    int32_t prev = tiles->lru_prev[slot];
+    int32_t next = tiles->lru_next[slot];
+    if (prev >= 0)
+        tiles->lru_next[prev] = next;
+    else
+        tiles->lru_head = next;
+    if (next >= 0)
+        tiles->lru_prev[next] = prev;
+    else
+        tiles->lru_tail = prev;
+    tiles->lru_prev[slot] = -1;
+    tiles->lru_next[slot] = -1;
+}
+
+
+
+static void _lru_push_head(DvzTiles* tiles, int32_t slot)
+{
+    tiles->lru_prev[slot] = -1;
+    tiles->lru_next[slot] = tiles->lru_head;
+    if (tiles->lru_head >= 0)
+        tiles->lru_prev[tiles->lru_head] = slot;
+    tiles->lru_head = slot;
+    if (tiles->lru_tail < 0)
+        tiles->lru_tail = slot;
+}
+
+
+
+static void _lru_touch(DvzTiles* tiles, int32_t slot)
+{
+    if (tiles->lru_head == slot)
+        return;
+    _lru_remove(tiles, slot);
+    _lru_push_head(tiles, slot);
+}
+
+
+
+// Mark the resident tiles that are still wanted as recently used, the coarsest tiles last so
+// that they are evicted last.
+static void _tiles_touch(DvzTiles* tiles)
+{
+    uint32_t tile_idx = 0;
+    for (int64_t k = (int64_t)tiles->wanted_count - 1; k >= 0; k--)
+    {
+        tile_idx = tiles->wanted[k];
+        if (tiles->tile_slot[tile_idx] >= 0)
+            _lru_touch(tiles, tiles->tile_slot[tile_idx]);
+    }
+}
+
+
+
+// Return a free atlas slot, evicting the least recently used tile if the atlas is full.
+static int32_t _tiles_slot_alloc(DvzTiles* tiles)
+{
+    if (tiles->slot_used < tiles->slot_count)
+        return (int32_t)tiles->slot_used++;
+
+    int32_t slot = tiles->lru_tail;
+    ASSERT(slot >= 0);
+    _lru_remove(tiles, slot);
+
+    int32_t evicted = tiles->slot_tile[slot];
+    ASSERT(evicted >= 0);
+    tiles->state[evicted] = DVZ_TILE_EMPTY;
+    tiles->tile_slot[evicted] = -1;
+    tiles->slot_tile[slot] = -1;
+    tiles->stats.evictions++;
+    return slot;
+}
+
+
+
+static void _tiles_upload(DvzTiles* tiles, DvzTileBuffer* buffer)
+{
+    uint32_t tile_idx = buffer->tile_idx;
+    int32_t slot = _tiles_slot_alloc(tiles);
+
+    // Upload the tile to its atlas slot.
+    const uint32_t S = tiles->slot_size;
+    uvec3 offset = {(slot % tiles->atlas_grid[0]) * S, (slot / tiles->atlas_grid[0]) * S, 0};
+    dvz_upload_texture(
+        tiles->canvas, tiles->atlas, offset, (uvec3){S, S, 1}, _slot_bytes(tiles), buffer->data);
+
+    tiles->state[tile_idx] = DVZ_TILE_RESIDENT;
+    tiles->tile_slot[tile_idx] = slot;
+    tiles->slot_tile[slot] = (int32_t)tile_idx;
+    _lru_push_head(tiles, slot);
+
+    double latency = _clock_get(&tiles->clock) - tiles->requested[tile_idx];
+    tiles->stats.latency_total += latency;
+    tiles->stats.latency_max = MAX(tiles->stats.latency_max, latency);
+    tiles->stats.uploads++;
+}
+
+
+
+/*************************************************************************************************/
+/*  Tile quads                                                                                   */
+/*************************************************************************************************/
+
+// Compute one quad per tile covering the view at the selected level, textured with the finest
+// resident tile at this level or at a coarser one.
+static void _tiles_quads(DvzTiles* tiles)
+{
+    ASSERT(tiles != NULL);
+
+    tiles->quad_count = 0;
+    tiles->stats.fallback = 0;
+    if (!tiles->is_visible)
+        return;
+
+    const double W = tiles->shape[0];
+    const double H = tiles->shape[1];
+    const uint32_t T = tiles->tile_size;
+    const uint32_t S = tiles->slot_size;
+    const uint32_t L = tiles->level;
+    const double aw = tiles->atlas_grid[0] * S;
+    const double ah = tiles->atlas_grid[1] * S;
+    const double ts = T * pow(2, L);
+
+    uint32_t m = 0, ai = 0, aj = 0, n = 0;
+    int32_t slot = -1;
+    double x0 = 0, x1 = 0, y0 = 0, y1 = 0, scale = 0, u0 = 0, u1 = 0, v0 = 0, v1 = 0;
+    for (uint32_t j = tiles->range[1]; j < tiles->range[3]; j++)
+    {
+        for (uint32_t i = tiles->range[0]; i < tiles->range[2]; i++)
+        {
+            // Finest resident tile containing this tile.
+            slot = -1;
+            for (m = L; m < tiles->level_count; m++)
+            {
+                ai = i >> (m - L);
+                aj = j >> (m - L);
+                slot = tiles->tile_slot[_tile_index(tiles, m, ai, aj)];
+                if (slot >= 0)
+                    break;
+            }
+            if (slot < 0)
+                continue;
+            if (m > L)
+                tiles->stats.fallback++;
+
+            // Tile rectangle in full-resolution pixels.
+            x0 = i * ts;
+            x1 = MIN((i + 1) * ts, W);
+            y0 = j * ts;
+            y1 = MIN((j + 1) * ts, H);
+
+            // Texture coordinates within the atlas slot, after the apron.
+            scale = pow(2, m);
+            u0 = (slot % tiles->atlas_grid[0]) * S + DVZ_TILE_APRON - (double)ai * T;
+            v0 = (slot / tiles->atlas_grid[0]) * S + DVZ_TILE_APRON - (double)aj * T;
+            u1 = (u0 + x1 / scale) / aw;
+            v1 = (v0 + y1 / scale) / ah;
+            u0 = (u0 + x0 / scale) / aw;
+            v0 = (v0 + y0 / scale) / ah;
+
+            // Top left, top right, bottom right, bottom left.
+            n = tiles->quad_count++;
+            x0 = -1 + 2 * x0 / W;
+            x1 = -1 + 2 * x1 / W;
+            y0 = +1 - 2 * y0 / H;
+            y1 = +1 - 2 * y1 / H;
+            _dvec3_copy((dvec3){x0, y0, 0}, tiles->quad_pos[0][n]);
+            _dvec3_copy((dvec3){x1, y0, 0}, tiles->quad_pos[1][n]);
+            _dvec3_copy((dvec3){x1, y1, 0}, tiles->quad_pos[2][n]);
+            _dvec3_copy((dvec3){x0, y1, 0}, tiles->quad_pos[3][n]);
+            _vec2_copy((vec2){u0, v0}, tiles->quad_uv[0][n]);
+            _vec2_copy((vec2){u1, v0}, tiles->quad_uv[1][n]);
+            _vec2_copy((vec2){u1, v1}, tiles->quad_uv[2][n]);
+            _vec2_copy((vec2){u0, v1}, tiles->quad_uv[3][n]);
+        }
+    }
+}
+
+
+
+/*************************************************************************************************/
+/*  Tiled image                                                                                  */
+/*************************************************************************************************/
+
+DvzTiles* dvz_tiles(
+    DvzCanvas* canvas, uvec2 shape, uint32_t tile_size, uvec2 atlas_grid, DvzTileLoader loader,
+    void* user_data)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(canvas->gpu != NULL);
+    ASSERT(loader != NULL);
+    ASSERT(tile_size > 0);
+    ASSERT(shape[0] > 0 && shape[1] > 0);
+
+    DvzTiles* tiles = calloc(1, sizeof(DvzTiles));
+    tiles->canvas = canvas;
+    tiles->loader = loader;
+    tiles->user_data = user_data;
+
+    // Pyramid layout.
+    memcpy(tiles->shape, shape, sizeof(uvec2));
+    tiles->tile_size = tile_size;
+    tiles->slot_size = tile_size + 2 * DVZ_TILE_APRON;
+    _tiles_layout(tiles);
+
+    // Atlas layout, within the maximum texture size.
+    DvzGpu* gpu = canvas->gpu;
+    uint32_t max_slots = gpu->device_properties.limits.maxImageDimension2D / tiles->slot_size;
+    ASSERT(max_slots > 0);
+    for (uint32_t i = 0; i < 2; i++)
+        tiles->atlas_grid[i] = CLIP(atlas_grid[i], 1, max_slots);
+    tiles->slot_count = tiles->atlas_grid[0] * tiles->atlas_grid[1];
+    tiles->upload_budget = DVZ_TILE_UPLOAD_BUDGET;
+    log_debug(
+        "tiled image %dx%d, %d levels, %d tiles of %d pixels, atlas with %d slots", //
+        shape[0], shape[1], tiles->level_count, tiles->tile_count, tile_size,
+        tiles->slot_count);
+
+    // Atlas texture, with linear interpolation within each tile thanks to the apron.
+    const uint32_t S = tiles->slot_size;
+    tiles->atlas = dvz_ctx_texture(
+        gpu->context, 2, (uvec3){tiles->atlas_grid[0] * S, tiles->atlas_grid[1] * S, 1},
+        VK_FORMAT_R8G8B8A8_UNORM);
+    dvz_texture_filter(tiles->atlas, DVZ_FILTER_MIN, VK_FILTER_LINEAR);
+    dvz_texture_filter(tiles->atlas, DVZ_FILTER_MAG, VK_FILTER_LINEAR);
+
+    // Per-tile data.
+    tiles->state = calloc(tiles->tile_count, sizeof(uint8_t));
+    tiles->tile_slot = malloc(tiles->tile_count * sizeof(int32_t));
+    memset(tiles->tile_slot, 0xFF, tiles->tile_count * sizeof(int32_t)); // -1
+    tiles->wanted_epoch = calloc(tiles->tile_count, sizeof(uint32_t));
+    tiles->requested = calloc(tiles->tile_count, sizeof(double));
+
+    // Per-slot data.
+    tiles->slot_tile = malloc(tiles->slot_count * sizeof(int32_t));
+    tiles->lru_prev = malloc(tiles->slot_count * sizeof(int32_t));
+    tiles->lru_next = malloc(tiles->slot_count * sizeof(int32_t));
+    memset(tiles->slot_tile, 0xFF, tiles->slot_count * sizeof(int32_t));
+    memset(tiles->lru_prev, 0xFF, tiles->slot_count * sizeof(int32_t));
+    memset(tiles->lru_next, 0xFF, tiles->slot_count * sizeof(int32_t));
+    tiles->lru_head = -1;
+    tiles->lru_tail = -1;
+
+    // Tile selection, request queue, and quads: at most one tile per slot.
+    tiles->wanted = calloc(tiles->slot_count, sizeof(uint32_t));
+    tiles->wanted_keys = calloc(tiles->slot_count, sizeof(uint64_t));
+    tiles->queue = calloc(tiles->slot_count, sizeof(uint32_t));
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        tiles->quad_pos[i] = calloc(tiles->slot_count, sizeof(dvec3));
+        tiles->quad_uv[i] = calloc(tiles->slot_count, sizeof(vec2));
+    }
+
+    // Loader buffers: the uploads of an update go through the canvas transfers, so that the
+    // buffers can only be reused at the next update.
+    tiles->buffer_count = 2 * DVZ_TILE_UPLOAD_BUDGET;
+    tiles->buffers = calloc(tiles->buffer_count, sizeof(DvzTileBuffer));
+    for (uint32_t i = 0; i < tiles->buffer_count; i++)
+    {
+        tiles->buffers[i].tile = calloc((size_t)tile_size * tile_size, sizeof(cvec4));
+        tiles->buffers[i].data = malloc(_slot_bytes(tiles));
+    }
+
+    // Loader thread.
+    _clock_init(&tiles->clock);
+    pthread_mutex_init(&tiles->lock, NULL);
+    pthread_cond_init(&tiles->cond, NULL);
+    atomic_init(&tiles->is_running, true);
+    dvz_obj_created(&tiles->obj);
+    tiles->thread = dvz_thread(_tiles_loader, tiles);
+
+    return tiles;
+}
+
+
+
+DvzTiles* dvz_tiles_image(
+    DvzCanvas* canvas, uvec2 shape, uint32_t tile_size, uvec2 atlas_grid, const cvec4* image)
+{
+    ASSERT(image != NULL);
+
+    // NOTE: the loader thread only accesses the pyramid once tiles have been requested.
+    DvzTiles* tiles = dvz_tiles(canvas, shape, tile_size, atlas_grid, _tiles_image_loader, NULL);
+    ASSERT(tiles != NULL);
+
+    uint64_t size = (uint64_t)shape[0] * shape[1] * sizeof(cvec4);
+    tiles->levels[0] = malloc(size);
+    memcpy(tiles->levels[0], image, size);
+    for (uint32_t level = 1; level < tiles->level_count; level++)
+    {
+        size = (uint64_t)tiles->level_shape[level][0] * tiles->level_shape[level][1];
+        tiles->levels[level] = calloc(size, sizeof(cvec4));
+        _tiles_downsample(
+            tiles->levels[level - 1], tiles->level_shape[level - 1], tiles->levels[level],
+            tiles->level_shape[level]);
+    }
+    return tiles;
+}
+
+
+
+void dvz_tiles_budget(DvzTiles* tiles, uint32_t budget)
+{
+    ASSERT(tiles != NULL);
+    // NOTE: the number of uploads is bounded by the number of loader buffers.
+    tiles->upload_budget = CLIP(budget, 1, tiles->buffer_count);
+}
+
+
+
+void dvz_tiles_visual(DvzTiles* tiles, DvzVisual* visual)
+{
+    ASSERT(tiles != NULL);
+    ASSERT(visual != NULL);
+    tiles->visual = visual;
+
+    // The image visual blends up to 4 textures with the TEXCOEFS prop, which defaults to the
+    // first one. The atlas is bound to all of them to avoid the default texture.
+    for (uint32_t i = 0; i < 4; i++)
+        dvz_visual_texture(visual, DVZ_SOURCE_TYPE_IMAGE, i, tiles->atlas);
+}
+
+
+
+bool dvz_tiles_update(DvzTiles* tiles, dvec4 view, uvec2 size)
+{
+    ASSERT(tiles != NULL);
+
+    // The transfers only keep a pointer to the data of the buffers: the buffers are released once
+    // all pending transfers have been processed, usually at the end of the last frame.
+    DvzFifo* transfers = &tiles->canvas->transfers;
+    bool uploaded = dvz_fifo_size(transfers) == 0 && !transfers->is_processing;
+
+    pthread_mutex_lock(&tiles->lock);
+    for (uint32_t i = 0; i < tiles->buffer_count && uploaded; i++)
+        if (tiles->buffers[i].state == DVZ_TILE_BUFFER_UPLOADING)
+            tiles->buffers[i].state = DVZ_TILE_BUFFER_FREE;
+    pthread_cond_broadcast(&tiles->cond);
+    pthread_mutex_unlock(&tiles->lock);
+
+    // Select the tiles when the view changes.
+    bool changed = !tiles->has_view || memcmp(view, tiles->view, sizeof(dvec4)) != 0 ||
+                   memcmp(size, tiles->view_size, sizeof(uvec2)) != 0;
+    if (changed)
+        _tiles_select(tiles, view, size);
+    _tiles_touch(tiles);
+
+    // Upload the loaded tiles, within the budget.
+    pthread_mutex_lock(&tiles->lock);
+    DvzTileBuffer* buffer = NULL;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < tiles->buffer_count && n < tiles->upload_budget; i++)
+    {
+        buffer = &tiles->buffers[i];
+        if (buffer->state != DVZ_TILE_BUFFER_LOADED)
+            continue;
+        // Discard the tiles that were requested before the last selection and that are no
+        // longer needed.
+        if (tiles->wanted_epoch[buffer->tile_idx] != tiles->epoch)
+        {
+            tiles->state[buffer->tile_idx] = DVZ_TILE_EMPTY;
+            buffer->state = DVZ_TILE_BUFFER_FREE;
+            tiles->stats.discards++;
+            continue;
+        }
+        _tiles_upload(tiles, buffer);
+        buffer->state = DVZ_TILE_BUFFER_UPLOADING;
+        n++;
+    }
+    tiles->stats.resident = tiles->slot_used;
+    pthread_cond_broadcast(&tiles->cond);
+    pthread_mutex_unlock(&tiles->lock);
+
+    // The quads only change when the view changes or when new tiles are in the atlas.
+    changed |= n > 0;
+    if (changed)
+    {
+        _tiles_quads(tiles);
+        tiles->stats.level = tiles->level;
+        tiles->stats.drawn = tiles->quad_count;
+        // NOTE: when nothing is visible, the previous quads are outside of the view.
+        if (tiles->visual != NULL && tiles->quad_count > 0)
+        {
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                dvz_visual_data(
+                    tiles->visual, DVZ_PROP_POS, i, tiles->quad_count, tiles->quad_pos[i]);
+                dvz_visual_data(
+                    tiles->visual, DVZ_PROP_TEXCOORDS, i, tiles->quad_count, tiles->quad_uv[i]);
+            }
+        }
+    }
+    return changed && tiles->quad_count > 0;
+}
+
+
+
+bool dvz_tiles_panzoom(DvzTiles* tiles, DvzPanzoom* panzoom, DvzViewport viewport)
+{
+    ASSERT(tiles != NULL);
+    ASSERT(panzoom != NULL);
+    ASSERT(panzoom->zoom[0] > 0 && panzoom->zoom[1] > 0);
+
+    // Visible rectangle of the orthographic projection of the panzoom.
+    double cx = panzoom->camera_pos[0], cy = panzoom->camera_pos[1];
+    double hx = 1.0 / panzoom->zoom[0], hy = 1.0 / panzoom->zoom[1];
+    return dvz_tiles_update(
+        tiles, (dvec4){cx - hx, cy - hy, cx + hx, cy + hy}, viewport.size_framebuffer);
+}
+
+
+
+void dvz_tiles_wait(DvzTiles* tiles)
+{
+    ASSERT(tiles != NULL);
+
+    pthread_mutex_lock(&tiles->lock);
+    bool busy = true;
+    bool has_free = false;
+    while (busy)
+    {
+        busy = false;
+        has_free = false;
+        for (uint32_t i = 0; i < tiles->buffer_count; i++)
+        {
+            busy |= tiles->buffers[i].state == DVZ_TILE_BUFFER_LOADING;
+            has_free |= tiles->buffers[i].state == DVZ_TILE_BUFFER_FREE;
+        }
+        // The loader thread is idle when the queue is empty, or when all buffers are waiting
+        // for the next update.
+        busy |= has_free && tiles->queue_pos < tiles->queue_count;
+        if (busy)
+            pthread_cond_wait(&tiles->cond, &tiles->lock);
+    }
+    pthread_mutex_unlock(&tiles->lock);
+}
+
+
+
+int32_t dvz_tiles_slot(DvzTiles* tiles, uint32_t level, uvec2 tile)
+{
+    ASSERT(tiles != NULL);
+    if (level >= tiles->level_count || tile[0] >= tiles->level_grid[level][0] ||
+        tile[1] >= tiles->level_grid[level][1])
+        return -1;
+    return tiles->tile_slot[_tile_index(tiles, level, tile[0], tile[1])];
+}
+
+
+
+DvzTileStats dvz_tiles_stats(DvzTiles* tiles)
+{
+    ASSERT(tiles != NULL);
+    pthread_mutex_lock(&tiles->lock);
+    DvzTileStats stats = tiles->stats;
+    pthread_mutex_unlock(&tiles->lock);
+    return stats;
+}
+
+
+
+void dvz_tiles_destroy(DvzTiles* tiles)
+{
+    if (tiles == NULL || !dvz_obj_is_created(&tiles->obj))
+        return;
+
+    // Stop the loader thread.
+    pthread_mutex_lock(&tiles->lock);
+    atomic_store(&tiles->is_running, false);
+    pthread_cond_broadcast(&tiles->cond);
+    pthread_mutex_unlock(&tiles->lock);
+    dvz_thread_join(&tiles->thread);
+    pthread_cond_destroy(&tiles->cond);
+    pthread_mutex_destroy(&tiles->lock);
+
+    dvz_texture_destroy(tiles->atlas);
+
+    for (uint32_t i = 0; i < tiles->buffer_count; i++)
+    {
+        FREE(tiles->buffers[i].tile);
+        FREE(tiles->buffers[i].data);
+    }
+    FREE(tiles->buffers);
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        FREE(tiles->quad_pos[i]);
+        FREE(tiles->quad_uv[i]);
+    }
+    for (uint32_t level = 0; level < tiles->level_count; level++)
+        FREE(tiles->levels[level]);
+    FREE(tiles->queue);
+    FREE(tiles->wanted);
+    FREE(tiles->wanted_keys);
+    FREE(tiles->slot_tile);
+    FREE(tiles->lru_prev);
+    FREE(tiles->lru_next);
+    FREE(tiles->requested);
+    FREE(tiles->wanted_epoch);
+    FREE(tiles->tile_slot);
+    FREE(tiles->state);
+
+    dvz_obj_destroyed(&tiles->obj);
+    FREE(tiles);
+}
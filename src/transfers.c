@@ -202,6 +202,7 @@ static void _process_buffer_copy(DvzCanvas* canvas, DvzTransfer tr)
     DvzCommands* cmds = &context->transfer_cmd;
     dvz_cmd_reset(cmds, 0);
     dvz_cmd_begin(cmds, 0);
+    uint32_t zone = _transfer_zone_begin(context, cmds, "copy_buffer");
 
     // Copy buffer command.
     VkBufferCopy* regions = (VkBufferCopy*)calloc(src->count, sizeof(VkBufferCopy));
@@ -213,6 +214,7 @@ static void _process_buffer_copy(DvzCanvas* canvas, DvzTransfer tr)
     }
     vkCmdCopyBuffer(cmds->cmds[0], src->buffer->buffer, dst->buffer->buffer, src->count, regions);
 
+    _transfer_zone_end(context, cmds, zone);
     dvz_cmd_end(cmds, 0);
     FREE(regions);
 
@@ -223,10 +225,48 @@ static void _process_buffer_copy(DvzCanvas* canvas, DvzTransfer tr)
     DvzSubmit submit = dvz_submit(gpu);
     dvz_submit_commands(&submit, cmds);
     log_debug("copy %s between 2 buffers", pretty_size(size));
+    dvz_profiler_gpu_submit(context->profiler, DVZ_PROFILER_TRANSFER_BLOCK);
     dvz_submit_send(&submit, 0, NULL, 0);
 
     // Wait for the transfer queue to be idle.
     dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+    dvz_profiler_gpu_collect(context->profiler, DVZ_PROFILER_TRANSFER_BLOCK);
+}
+
+
+
+/*************************************************************************************************/
+/*  Texture streams                                                                              */
+/*************************************************************************************************/
+
+static void _process_texture_stream(DvzCanvas* canvas, DvzTransfer tr)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(tr.type == DVZ_TRANSFER_TEXTURE_STREAM);
+    ASSERT(tr.u.stream != NULL);
+
+    if (canvas->stream_count >= DVZ_MAX_TEXTURE_STREAMS)
+    {
+        log_warn("too many texture streams in progress, uploading the texture synchronously");
+        dvz_texture_stream_wait(tr.u.stream);
+        return;
+    }
+    canvas->streams[canvas->stream_count++] = tr.u.stream;
+}
+
+
+
+// Submit the next chunks of the streams in progress, and detach the finished streams.
+static void _step_texture_streams(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < canvas->stream_count; i++)
+    {
+        if (!dvz_texture_stream_step(canvas->streams[i]))
+            canvas->streams[k++] = canvas->streams[i];
+    }
+    canvas->stream_count = k;
 }
 
 
@@ -248,10 +288,18 @@ void dvz_process_transfers(DvzCanvas* canvas)
     DvzContext* context = canvas->gpu->context;
     ASSERT(context != NULL);
     DvzFifo* fifo = &canvas->transfers;
+
+    // The texture streams do not block: they upload a few chunks at every frame.
+    if (canvas->stream_count > 0)
+        _step_texture_streams(canvas);
+
     // Do nothing if there are no pending transfers.
     if (fifo->is_empty)
         return;
 
+    // Time the transfer command buffers with the canvas profiler, if any.
+    context->profiler = canvas->profiler;
+
     // Process all pending transfer tasks.
     DvzTransfer tr = {0};
     while (true)
@@ -280,9 +328,12 @@ void dvz_process_transfers(DvzCanvas* canvas)
             dvz_texture_copy(
                 tr.u.tex_copy.src, tr.u.tex_copy.src_offset, tr.u.tex_copy.dst,
                 tr.u.tex_copy.dst_offset, tr.u.tex_copy.shape);
+        if (tr.type == DVZ_TRANSFER_TEXTURE_STREAM)
+            _process_texture_stream(canvas, tr);
 
         fifo->is_processing = false;
     }
+    context->profiler = NULL;
 }
 
 
@@ -319,6 +370,9 @@ static void _enqueue_buffers_transfer(
     tr.u.buf.update_all_buffers = !canvas->app->is_running;
 
     _transfer_enqueue(&canvas->transfers, tr);
+
+    // The transfer is processed at the next frame, the main loop may be waiting for events.
+    dvz_app_wakeup(canvas->app);
 }
 
 
@@ -414,6 +468,7 @@ static void _enqueue_texture_transfer(
     tr.u.tex.texture = texture;
 
     _transfer_enqueue(&canvas->transfers, tr);
+    dvz_app_wakeup(canvas->app);
 }
 
 
@@ -473,3 +528,25 @@ void dvz_copy_texture(
     if (!canvas->app->is_running)
         dvz_process_transfers(canvas);
 }
+
+
+
+void dvz_stream_texture(DvzCanvas* canvas, DvzTextureStream* stream)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(canvas->transfers.capacity > 0);
+    ASSERT(stream != NULL);
+    ASSERT(dvz_obj_is_created(&stream->obj));
+
+    if (!canvas->app->is_running)
+    {
+        dvz_texture_stream_wait(stream);
+        return;
+    }
+
+    DvzTransfer tr = {0};
+    tr.type = DVZ_TRANSFER_TEXTURE_STREAM;
+    tr.u.stream = stream;
+    _transfer_enqueue(&canvas->transfers, tr);
+    dvz_app_wakeup(canvas->app);
+}
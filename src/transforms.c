@@ -77,6 +77,72 @@ void dvz_transform_pos(DvzDataCoords coords, DvzArray* pos_in, DvzArray* pos_out
 
 
 
+void dvz_transform_pos_double(
+    DvzDataCoords coords, dvec3 origin, DvzArray* pos_in, DvzArray* pos_out)
+{
+    ASSERT(pos_in != NULL);
+    ASSERT(pos_out != NULL);
+    ASSERT(pos_out->item_count == pos_in->item_count);
+    ASSERT(pos_in->dtype == DVZ_DTYPE_DVEC3);
+    ASSERT(pos_out->dtype == DVZ_DTYPE_DVEC3);
+
+    log_debug(
+        "double precision data transform on %d position elements, transform %d",
+        pos_in->item_count, coords.transform);
+
+    DvzArray* pos_temp = pos_in;
+
+    // First, handle non-cartesian transforms.
+    if (coords.transform == DVZ_TRANSFORM_EARTH_MERCATOR_WEB)
+    {
+        DvzTransform tr = _transform(coords.transform);
+        _transform_array(&tr, pos_in, pos_out);
+        pos_temp = pos_out;
+    }
+
+    // Then, subtract the origin. The rescaling to NDC is done on the GPU.
+    dvec3* in = (dvec3*)pos_temp->data;
+    dvec3* out = (dvec3*)pos_out->data;
+    for (uint32_t i = 0; i < pos_in->item_count; i++)
+    {
+        out[i][0] = in[i][0] - origin[0];
+        out[i][1] = in[i][1] - origin[1];
+        out[i][2] = in[i][2] - origin[2];
+    }
+}
+
+
+
+void dvz_transform_mvp_double(DvzDataCoords coords, dvec3 origin, DvzMVP* mvp)
+{
+    ASSERT(mvp != NULL);
+
+    // Transform the box.
+    DvzTransform tr = _transform(DVZ_TRANSFORM_CARTESIAN);
+    if (coords.transform == DVZ_TRANSFORM_EARTH_MERCATOR_WEB)
+        tr = _transform(coords.transform);
+    DvzBox box = {0};
+    _transform_apply(&tr, coords.box.p0, box.p0);
+    _transform_apply(&tr, coords.box.p1, box.p1);
+
+    // The box center relative to the origin is split into a (hi, lo) float pair, like the
+    // positions, so that the subtraction in the vertex shader keeps the double precision.
+    double center = 0, extent = 0;
+    for (uint32_t j = 0; j < 3; j++)
+    {
+        center = .5 * (box.p0[j] + box.p1[j]) - origin[j];
+        extent = box.p1[j] - box.p0[j];
+        mvp->data_offset_hi[j] = (float)center;
+        mvp->data_offset_lo[j] = (float)(center - (double)mvp->data_offset_hi[j]);
+        mvp->data_scale[j] = extent != 0 ? (float)(2. / extent) : 1;
+    }
+    mvp->data_offset_hi[3] = 0;
+    mvp->data_offset_lo[3] = 0;
+    mvp->data_scale[3] = 1; // enable the data transform in the vertex shader
+}
+
+
+
 void dvz_transform(DvzPanel* panel, DvzCDS source, dvec3 pos_in, DvzCDS target, dvec3 pos_out)
 {
     ASSERT(panel != NULL);
@@ -27,6 +27,7 @@ DvzVisual dvz_visual(DvzCanvas* canvas)
     // Default callbacks.
     visual.callback_fill = _default_visual_fill;
     visual.callback_bake = _default_visual_bake;
+    visual.fill_version = 1;
 
     dvz_obj_created(&visual.obj);
     return visual;
@@ -71,6 +72,10 @@ void dvz_visual_destroy(DvzVisual* visual)
     CONTAINER_DESTROY_ITEMS(DvzBindings, visual->bindings, dvz_bindings_destroy)
     CONTAINER_DESTROY_ITEMS(DvzBindings, visual->bindings_comp, dvz_bindings_destroy)
 
+    // Free the cached command buffers.
+    if (visual->cmds_fill.count > 0)
+        dvz_cmd_free(&visual->cmds_fill);
+
     dvz_obj_destroyed(&visual->obj);
 }
 
@@ -232,6 +237,7 @@ void dvz_visual_graphics(DvzVisual* visual, DvzGraphics* graphics)
     ASSERT(visual->bindings.count == visual->graphics_count + 1);
     *bindings = dvz_bindings(&graphics->slots, visual->canvas->swapchain.img_count);
     visual->graphics_count++;
+    visual->fill_version++;
 }
 
 
@@ -274,6 +280,30 @@ void dvz_visual_group(DvzVisual* visual, uint32_t group_idx, uint32_t size)
 
 
 
+// Mark a prop, and its source, as to be uploaded at the next frame.
+static void _prop_changed(DvzVisual* visual, DvzProp* prop)
+{
+    ASSERT(visual != NULL);
+    ASSERT(prop != NULL);
+    DvzSource* source = prop->source;
+
+    prop->obj.request = DVZ_VISUAL_REQUEST_UPLOAD;
+
+    if (source != NULL)
+    {
+        log_trace("source type %d #%d handled by lib", source->source_type, source->source_idx);
+        source->origin = DVZ_SOURCE_ORIGIN_LIB;
+        // source->obj.status = DVZ_OBJECT_STATUS_NEED_UPDATE;
+        // visual->obj.status = DVZ_OBJECT_STATUS_NEED_UPDATE;
+        _source_set_changed(source, true);
+    }
+
+    // The new data will be uploaded at the next frame.
+    dvz_canvas_request_frame(visual->canvas);
+}
+
+
+
 void dvz_visual_data(
     DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count, const void* data)
 {
@@ -316,16 +346,34 @@ void dvz_visual_data_partial(
     // Copy the specified array to the prop array.
     dvz_array_data(&prop->arr_orig, first_item, item_count, data_item_count, data);
 
-    prop->obj.request = DVZ_VISUAL_REQUEST_UPLOAD;
+    _prop_changed(visual, prop);
+}
 
-    if (source != NULL)
+
+
+void dvz_visual_data_strided(
+    DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count, const void* data,
+    DvzDataType dtype, int64_t item_stride, int64_t component_stride)
+{
+    ASSERT(visual != NULL);
+    ASSERT(count > 0);
+
+    // Get the associated prop.
+    DvzProp* prop = dvz_prop_get(visual, prop_type, prop_idx);
+    ASSERT(prop != NULL);
+
+    DvzSource* source = prop->source;
+    if (source != NULL && source->source_kind == DVZ_SOURCE_KIND_UNIFORM && count > 1)
     {
-        log_trace("source type %d #%d handled by lib", source->source_type, source->source_idx);
-        source->origin = DVZ_SOURCE_ORIGIN_LIB;
-        // source->obj.status = DVZ_OBJECT_STATUS_NEED_UPDATE;
-        // visual->obj.status = DVZ_OBJECT_STATUS_NEED_UPDATE;
-        _source_set_changed(source, true);
+        log_debug("discarding uniform data after the first item (number of items was %d)", count);
+        count = 1;
     }
+
+    // Convert and copy the specified array to the prop array in a single pass.
+    dvz_array_resize(&prop->arr_orig, count);
+    dvz_array_data_strided(&prop->arr_orig, 0, count, data, dtype, item_stride, component_stride);
+
+    _prop_changed(visual, prop);
 }
 
 
@@ -398,6 +446,7 @@ void dvz_visual_data_source(
     // source->obj.status = DVZ_OBJECT_STATUS_NEED_UPDATE;
     // visual->obj.status = DVZ_OBJECT_STATUS_NEED_UPDATE;
     _source_set_changed(source, true);
+    dvz_canvas_request_frame(visual->canvas);
 }
 
 
@@ -424,6 +473,7 @@ void dvz_visual_buffer(
 
     // Set the pipeline bindings with the source buffer.
     _set_source_bindings(visual, source);
+    dvz_canvas_request_frame(visual->canvas);
 }
 
 
@@ -448,6 +498,7 @@ void dvz_visual_texture(
     ASSERT(texture->image != NULL);
     ASSERT(texture->sampler != NULL);
     dvz_bindings_texture(bindings, source->slot_idx, texture);
+    dvz_canvas_request_frame(visual->canvas);
 }
 
 
@@ -459,6 +510,7 @@ void dvz_visual_flags(DvzVisual* visual, int flags)
     // Update the vertex buffer at the next call to dvz_visual_update().
     DvzSource* source = _get_pipeline_source(visual, DVZ_SOURCE_TYPE_VERTEX, 0);
     _source_set_changed(source, true);
+    dvz_canvas_request_frame(visual->canvas);
 }
 
 
@@ -481,6 +533,7 @@ void dvz_visual_fill_callback(DvzVisual* visual, DvzVisualFillCallback callback)
     DvzCanvas* canvas = visual->canvas;
     ASSERT(canvas != NULL);
     visual->callback_fill = callback;
+    visual->fill_version++;
 }
 
 
@@ -499,7 +552,56 @@ void dvz_visual_fill_event(
     ev.viewport = viewport;
     ev.user_data = user_data;
 
+    // GPU timestamps are only recorded in the canvas render command buffers, with one query
+    // block per swapchain image.
+    DvzCanvas* canvas = visual->canvas;
+    DvzProfiler* profiler =
+        canvas != NULL && cmds == &canvas->cmds_render ? canvas->profiler : NULL;
+    uint32_t zone = dvz_profiler_gpu_begin(profiler, cmds, cmd_idx, cmd_idx, "visual");
     visual->callback_fill(visual, ev);
+    dvz_profiler_gpu_end(profiler, cmds, cmd_idx, cmd_idx, zone);
+}
+
+
+
+bool dvz_visual_fill_cached(
+    DvzVisual* visual, VkClearColorValue clear_color, DvzCommands* cmds, uint32_t cmd_idx,
+    DvzViewport viewport, VkCommandPool pool)
+{
+    ASSERT(visual != NULL);
+    ASSERT(cmds != NULL);
+    ASSERT(cmd_idx < cmds->count);
+    DvzCanvas* canvas = visual->canvas;
+    ASSERT(canvas != NULL);
+    DvzGpu* gpu = canvas->gpu;
+    ASSERT(gpu != NULL);
+    if (pool == VK_NULL_HANDLE)
+        pool = gpu->queues.cmd_pools[gpu->queues.queue_families[cmds->queue_idx]];
+
+    // Allocate one secondary command buffer per primary command buffer.
+    DvzCommands* secondary = &visual->cmds_fill;
+    if (secondary->count != cmds->count || secondary->pool != pool)
+    {
+        if (secondary->count > 0)
+            dvz_cmd_free(secondary);
+        *secondary = dvz_commands_secondary(gpu, cmds->queue_idx, pool, cmds->count);
+        memset(visual->fill_keys, 0, sizeof(visual->fill_keys));
+    }
+
+    // Skip the recording if the visual has not changed since the last one.
+    DvzVisualFillKey key = _visual_fill_key(visual, viewport);
+    if (visual->callback_fill == _default_visual_fill &&
+        memcmp(&key, &visual->fill_keys[cmd_idx], sizeof(key)) == 0)
+        return false;
+
+    dvz_cmd_begin_secondary(secondary, cmd_idx, &canvas->renderpass);
+    // The dynamic viewport is not inherited from the primary command buffer.
+    dvz_cmd_viewport(secondary, cmd_idx, viewport.viewport);
+    dvz_visual_fill_event(visual, clear_color, secondary, cmd_idx, viewport, NULL);
+    dvz_cmd_end(secondary, cmd_idx);
+
+    visual->fill_keys[cmd_idx] = key;
+    return true;
 }
 
 
@@ -508,6 +610,9 @@ void dvz_visual_fill_begin(DvzCanvas* canvas, DvzCommands* cmds, uint32_t idx)
 {
     ASSERT(canvas != NULL);
     dvz_cmd_begin(cmds, idx);
+    // The GPU queries must be reset outside of the render pass.
+    if (cmds == &canvas->cmds_render)
+        dvz_profiler_gpu_reset(canvas->profiler, cmds, idx, idx);
     dvz_cmd_begin_renderpass(cmds, idx, &canvas->renderpass, &canvas->framebuffers);
 }
 
@@ -668,14 +773,14 @@ void dvz_visual_update(
                 log_warn(
                     "source type %d #%d is not set, using default texture (colormap array)",
                     source->source_type, source->source_idx);
-                ASSERT(ctx->color_texture.texture != NULL);
-                ASSERT(ctx->color_texture.texture->image != NULL);
-                ASSERT(ctx->color_texture.texture->image->images[0] != VK_NULL_HANDLE);
-                ASSERT(ctx->color_texture.texture->sampler != NULL);
-                ASSERT(dvz_obj_is_created(&ctx->color_texture.texture->obj));
-
-                dvz_visual_texture(
-                    visual, source->source_type, source->source_idx, ctx->color_texture.texture);
+                texture = dvz_ctx_color_texture(ctx);
+                ASSERT(texture != NULL);
+                ASSERT(texture->image != NULL);
+                ASSERT(texture->image->images[0] != VK_NULL_HANDLE);
+                ASSERT(texture->sampler != NULL);
+                ASSERT(dvz_obj_is_created(&texture->obj));
+
+                dvz_visual_texture(visual, source->source_type, source->source_idx, texture);
             }
             else if (_source_is_buffer(source->source_kind))
             {
@@ -821,7 +926,11 @@ void dvz_visual_update(
         bindings = dvz_container_get(&visual->bindings, i);
         ASSERT(bindings != NULL);
         if (bindings->obj.status == DVZ_OBJECT_STATUS_NEED_UPDATE)
+        {
             dvz_bindings_update(bindings);
+            // The command buffers that bound the descriptor sets must be recorded again.
+            visual->fill_version++;
+        }
     }
     for (uint32_t i = 0; i < visual->compute_count; i++)
     {
@@ -831,3 +940,84 @@ void dvz_visual_update(
             dvz_bindings_update(bindings);
     }
 }
+
+
+
+/*************************************************************************************************/
+/*  Memory accounting                                                                            */
+/*************************************************************************************************/
+
+static void _array_memory(DvzArray* arr, DvzMemoryUsage* usage)
+{
+    ASSERT(arr != NULL);
+    ASSERT(usage != NULL);
+    if (!dvz_obj_is_created(&arr->obj))
+        return;
+    usage->array_count++;
+    if (arr->data != NULL)
+        usage->host += arr->buffer_size;
+}
+
+
+
+DvzMemoryUsage dvz_prop_memory(DvzProp* prop)
+{
+    ASSERT(prop != NULL);
+    DvzMemoryUsage usage = {0};
+    _array_memory(&prop->arr_orig, &usage);
+    _array_memory(&prop->arr_trans, &usage);
+    _array_memory(&prop->arr_staging, &usage);
+    return usage;
+}
+
+
+
+DvzMemoryUsage dvz_source_memory(DvzSource* source)
+{
+    ASSERT(source != NULL);
+    DvzMemoryUsage usage = {0};
+    _array_memory(&source->arr, &usage);
+
+    // The GPU objects of the user sources are not owned by the visual.
+    if (source->origin != DVZ_SOURCE_ORIGIN_LIB && source->origin != DVZ_SOURCE_ORIGIN_NOBAKE)
+        return usage;
+
+    if (_source_is_buffer(source->source_kind) && source->u.br.buffer != NULL)
+    {
+        DvzBufferRegions* br = &source->u.br;
+        usage.device = br->count * (br->aligned_size > 0 ? br->aligned_size : br->size);
+        usage.device_total = usage.device;
+        usage.region_count = 1;
+    }
+    else if (_source_is_texture(source->source_kind) && source->u.tex != NULL)
+    {
+        usage.device = dvz_texture_memory(source->u.tex);
+        usage.device_total = usage.device;
+        usage.texture_count = 1;
+    }
+    return usage;
+}
+
+
+
+DvzMemoryUsage dvz_visual_memory(DvzVisual* visual)
+{
+    ASSERT(visual != NULL);
+    DvzMemoryUsage usage = {0};
+
+    DvzContainerIterator iter = dvz_container_iterator(&visual->props);
+    while (iter.item != NULL)
+    {
+        dvz_memory_add(&usage, dvz_prop_memory((DvzProp*)iter.item));
+        dvz_container_iter(&iter);
+    }
+
+    iter = dvz_container_iterator(&visual->sources);
+    while (iter.item != NULL)
+    {
+        dvz_memory_add(&usage, dvz_source_memory((DvzSource*)iter.item));
+        dvz_container_iter(&iter);
+    }
+
+    return usage;
+}
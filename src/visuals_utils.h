@@ -204,6 +204,18 @@ static VkFormat _get_texture_format(DvzVisual* visual, DvzSource* source)
 
 
 
+// Largest shift of the vertex bindings of a graphics pipeline.
+static uint32_t _graphics_max_shift(DvzGraphics* graphics)
+{
+    ASSERT(graphics != NULL);
+    uint32_t shift = 0;
+    for (uint32_t i = 0; i < graphics->vertex_binding_count; i++)
+        shift = MAX(shift, graphics->vertex_bindings[i].shift);
+    return shift;
+}
+
+
+
 static DvzBindings* _get_bindings(DvzVisual* visual, DvzSource* source)
 {
     ASSERT(source != NULL);
@@ -268,6 +280,9 @@ static uint32_t _source_size(DvzVisual* visual, DvzSource* source)
 
 static void _set_source_bindings(DvzVisual* visual, DvzSource* source)
 {
+    // The cached draw commands refer to the source buffers, directly or through the bindings.
+    visual->fill_version++;
+
     // Set bindings except for VERTEX and INDEX sources.
     if (_source_needs_binding(source->source_kind))
     {
@@ -435,9 +450,12 @@ static void _prop_copy(DvzVisual* visual, DvzProp* prop)
     // Implement DPI scaling here.
     if (prop->dpi_scaling != 1)
     {
-        prop->arr_staging = dvz_array_copy(arr);
+        // NOTE: the source array may be the previous staging array, which is replaced.
+        DvzArray scaled = dvz_array_copy(arr);
+        dvz_array_scale(&scaled, prop->dpi_scaling);
+        dvz_array_destroy(&prop->arr_staging);
+        prop->arr_staging = scaled;
         arr = &prop->arr_staging;
-        dvz_array_scale(arr, prop->dpi_scaling);
     }
 
     log_debug("copy prop type %d to source buffer", prop->prop_type);
@@ -589,6 +607,48 @@ static void _default_visual_bake(DvzVisual* visual, DvzVisualDataEvent ev)
 
 
 
+// Buffer bound by the draw commands for a vertex or index source. The handle changes when the
+// shared buffer is recreated to grow.
+static void _visual_fill_key_buffer(DvzSource* source, VkBuffer* buffer, VkDeviceSize* offset)
+{
+    ASSERT(source != NULL);
+    DvzBufferRegions* br = &source->u.br;
+    if (br->buffer == NULL || br->count == 0)
+        return;
+    *buffer = br->buffer->buffer;
+    *offset = br->offsets[0];
+}
+
+// State of the visual used by the default fill callback, identifying its draw commands.
+static DvzVisualFillKey _visual_fill_key(DvzVisual* visual, DvzViewport viewport)
+{
+    ASSERT(visual != NULL);
+    DvzVisualFillKey key;
+    memset(&key, 0, sizeof(key));
+    key.version = visual->fill_version;
+    key.viewport = viewport.viewport;
+
+    DvzSource* source = NULL;
+    for (uint32_t pidx = 0; pidx < visual->graphics_count; pidx++)
+    {
+        source = _get_pipeline_source(visual, DVZ_SOURCE_TYPE_VERTEX, pidx);
+        if (source != NULL)
+        {
+            key.vertex_count[pidx] = source->arr.item_count;
+            _visual_fill_key_buffer(source, &key.vertex_buffer[pidx], &key.vertex_offset[pidx]);
+        }
+        source = _get_pipeline_source(visual, DVZ_SOURCE_TYPE_INDEX, pidx);
+        if (source != NULL)
+        {
+            key.index_count[pidx] = source->arr.item_count;
+            _visual_fill_key_buffer(source, &key.index_buffer[pidx], &key.index_offset[pidx]);
+        }
+    }
+    return key;
+}
+
+
+
 static void _default_visual_fill(DvzVisual* visual, DvzVisualFillEvent ev)
 {
     ASSERT(visual != NULL);
@@ -624,10 +684,11 @@ static void _default_visual_fill(DvzVisual* visual, DvzVisualFillEvent ev)
         }
         ASSERT(vertex_count > 0);
 
-        // Bind the vertex buffer.
+        // Bind the vertex buffer, to all vertex bindings of the graphics pipeline.
+        DvzGraphics* graphics = visual->graphics[pipeline_idx];
         DvzBufferRegions* vertex_buf = &vertex_source->u.br;
         ASSERT(vertex_buf != NULL);
-        dvz_cmd_bind_vertex_buffer(cmds, idx, *vertex_buf, 0);
+        dvz_cmd_bind_vertex_buffers(cmds, idx, graphics, *vertex_buf, 0);
 
         // Index buffer?
         DvzSource* index_source =
@@ -653,7 +714,16 @@ static void _default_visual_fill(DvzVisual* visual, DvzVisualFillEvent ev)
             log_debug("draw %d vertices", vertex_count);
             // Make sure the bound vertex buffer is large enough.
             ASSERT(vertex_buf->size >= vertex_count * vertex_source->arr.item_size);
-            dvz_cmd_draw(cmds, idx, 0, vertex_count);
+            // Instanced graphics: the vertex buffer contains one item per instance.
+            if (graphics->instance_vertex_count > 0)
+            {
+                uint32_t shift = _graphics_max_shift(graphics);
+                if (vertex_count > shift)
+                    dvz_cmd_draw_instanced(
+                        cmds, idx, 0, graphics->instance_vertex_count, 0, vertex_count - shift);
+            }
+            else
+                dvz_cmd_draw(cmds, idx, 0, vertex_count);
         }
         else
         {
@@ -1,6 +1,7 @@
 #include "../include/datoviz/vklite.h"
 #include "spirv.h"
 #include "vklite_utils.h"
+#include <inttypes.h>
 #include <stdlib.h>
 
 
@@ -21,6 +22,15 @@ DvzApp* dvz_app(DvzBackend backend)
     // Initialize the global clock.
     _clock_init(&app->clock);
 
+    // Initialize the startup timeline.
+    _trace_init(&app->startup);
+    uint64_t t = _trace_now(&app->startup);
+
+    // Main loop wait, used by the canvases rendering on demand.
+    atomic_init(&app->is_waiting, false);
+    pthread_mutex_init(&app->wait_lock, NULL);
+    pthread_cond_init(&app->wait_cond, NULL);
+
     app->gpus = dvz_container(DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzGpu), DVZ_OBJECT_TYPE_GPU);
     app->windows =
         dvz_container(DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzWindow), DVZ_OBJECT_TYPE_WINDOW);
@@ -35,6 +45,7 @@ DvzApp* dvz_app(DvzBackend backend)
         &app->n_errors);
     // debug_messenger != VK_NULL_HANDLE means validation enabled
     dvz_obj_created(&app->obj);
+    _trace_phase(&app->startup, "instance", t);
 
     // Count the number of devices.
     uint32_t gpu_count = 0;
@@ -48,6 +59,7 @@ DvzApp* dvz_app(DvzBackend backend)
 
     // Discover the available GPUs.
     // ----------------------------
+    t = _trace_now(&app->startup);
     {
         // Initialize the GPU(s).
         VkPhysicalDevice* physical_devices = calloc(gpu_count, sizeof(VkPhysicalDevice));
@@ -66,12 +78,29 @@ DvzApp* dvz_app(DvzBackend backend)
 
         FREE(physical_devices);
     }
+    _trace_phase(&app->startup, "gpu_discovery", t);
 
     return app;
 }
 
 
 
+void dvz_app_startup_trace(DvzApp* app)
+{
+    ASSERT(app != NULL);
+    DvzTracePhase* phase = NULL;
+    log_info("startup timeline (%d phases)", app->startup.count);
+    for (uint32_t i = 0; i < app->startup.count; i++)
+    {
+        phase = &app->startup.phases[i];
+        log_info(
+            "%-24s start %10" PRIu64 " us  duration %10" PRIu64 " us", //
+            phase->name, phase->start, phase->duration);
+    }
+}
+
+
+
 int dvz_app_destroy(DvzApp* app)
 {
     log_debug("starting destruction of app...");
@@ -103,6 +132,9 @@ int dvz_app_destroy(DvzApp* app)
         app->instance = 0;
     }
 
+    pthread_cond_destroy(&app->wait_cond);
+    pthread_mutex_destroy(&app->wait_lock);
+
     // Free the App memory.
     int res = (int)app->n_errors;
     FREE(app);
@@ -617,7 +649,42 @@ DvzCommands dvz_commands(DvzGpu* gpu, uint32_t queue, uint32_t count)
     commands.gpu = gpu;
     commands.queue_idx = queue;
     commands.count = count;
-    allocate_command_buffers(gpu->device, gpu->queues.cmd_pools[qf], count, commands.cmds);
+    commands.pool = gpu->queues.cmd_pools[qf];
+    allocate_command_buffers(
+        gpu->device, gpu->queues.cmd_pools[qf], VK_COMMAND_BUFFER_LEVEL_PRIMARY, count,
+        commands.cmds);
+
+    dvz_obj_init(&commands.obj);
+
+    return commands;
+}
+
+
+
+DvzCommands
+dvz_commands_secondary(DvzGpu* gpu, uint32_t queue, VkCommandPool pool, uint32_t count)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(dvz_obj_is_created(&gpu->obj));
+
+    ASSERT(count <= DVZ_MAX_COMMAND_BUFFERS_PER_SET);
+    ASSERT(queue < gpu->queues.queue_count);
+    ASSERT(count > 0);
+    uint32_t qf = gpu->queues.queue_families[queue];
+    ASSERT(qf < gpu->queues.queue_family_count);
+    if (pool == VK_NULL_HANDLE)
+        pool = gpu->queues.cmd_pools[qf];
+    ASSERT(pool != VK_NULL_HANDLE);
+    log_trace("creating secondary commands on queue #%d, queue family #%d", queue, qf);
+
+    DvzCommands commands = {0};
+    commands.gpu = gpu;
+    commands.queue_idx = queue;
+    commands.count = count;
+    commands.secondary = true;
+    commands.pool = pool;
+    allocate_command_buffers(
+        gpu->device, pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, count, commands.cmds);
 
     dvz_obj_init(&commands.obj);
 
@@ -626,6 +693,31 @@ DvzCommands dvz_commands(DvzGpu* gpu, uint32_t queue, uint32_t count)
 
 
 
+VkCommandPool dvz_command_pool(DvzGpu* gpu, uint32_t queue)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(dvz_obj_is_created(&gpu->obj));
+    ASSERT(queue < gpu->queues.queue_count);
+
+    VkCommandPool pool = VK_NULL_HANDLE;
+    create_command_pool(gpu->device, gpu->queues.queue_families[queue], &pool);
+    return pool;
+}
+
+
+
+void dvz_command_pool_destroy(DvzGpu* gpu, VkCommandPool pool)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(gpu->device != VK_NULL_HANDLE);
+    if (pool == VK_NULL_HANDLE)
+        return;
+    log_trace("destroy command pool");
+    vkDestroyCommandPool(gpu->device, pool, NULL);
+}
+
+
+
 void dvz_cmd_begin(DvzCommands* cmds, uint32_t idx)
 {
     ASSERT(cmds != NULL);
@@ -638,6 +730,31 @@ void dvz_cmd_begin(DvzCommands* cmds, uint32_t idx)
 
 
 
+void dvz_cmd_begin_secondary(DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass)
+{
+    ASSERT(cmds != NULL);
+    ASSERT(cmds->count > 0);
+    ASSERT(cmds->secondary);
+    ASSERT(renderpass != NULL);
+    ASSERT(renderpass->renderpass != VK_NULL_HANDLE);
+
+    // The framebuffer is left unspecified so that the command buffer remains valid when the
+    // framebuffers are recreated.
+    VkCommandBufferInheritanceInfo inheritance = {0};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = renderpass->renderpass;
+    inheritance.subpass = 0;
+    inheritance.framebuffer = VK_NULL_HANDLE;
+
+    VkCommandBufferBeginInfo begin_info = {0};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(cmds->cmds[idx], &begin_info));
+}
+
+
+
 void dvz_cmd_end(DvzCommands* cmds, uint32_t idx)
 {
     ASSERT(cmds != NULL);
@@ -670,10 +787,9 @@ void dvz_cmd_free(DvzCommands* cmds)
     ASSERT(cmds->gpu != NULL);
     ASSERT(cmds->gpu->device != VK_NULL_HANDLE);
 
+    ASSERT(cmds->pool != VK_NULL_HANDLE);
     log_trace("free %d command buffer(s)", cmds->count);
-    vkFreeCommandBuffers(
-        cmds->gpu->device, cmds->gpu->queues.cmd_pools[cmds->queue_idx], //
-        cmds->count, cmds->cmds);
+    vkFreeCommandBuffers(cmds->gpu->device, cmds->pool, cmds->count, cmds->cmds);
 
     dvz_obj_init(&cmds->obj);
 }
@@ -1150,6 +1266,7 @@ DvzImages dvz_images(DvzGpu* gpu, VkImageType type, uint32_t count)
     images.tiling = VK_IMAGE_TILING_OPTIMAL;
     images.memory = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
     images.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    images.mip_levels = 1;
 
     return images;
 }
@@ -1227,6 +1344,15 @@ void dvz_images_queue_access(DvzImages* images, uint32_t queue_idx)
 
 
 
+void dvz_images_mip_levels(DvzImages* images, uint32_t mip_levels)
+{
+    ASSERT(images != NULL);
+    uint32_t full = mip_count(images->width, images->height, images->depth);
+    images->mip_levels = mip_levels == 0 ? full : MIN(mip_levels, full);
+}
+
+
+
 static void _images_create(DvzImages* images)
 {
     DvzGpu* gpu = images->gpu;
@@ -1235,15 +1361,15 @@ static void _images_create(DvzImages* images)
         if (!images->is_swapchain)
             create_image2(
                 gpu->device, &gpu->queues, images->queue_count, images->queues, images->image_type,
-                images->width, images->height, images->depth, images->format, images->tiling,
-                images->usage, images->memory, gpu->memory_properties, &images->images[i],
-                &images->memories[i]);
+                images->width, images->height, images->depth, images->format,
+                images->mip_levels, images->tiling, images->usage, images->memory,
+                gpu->memory_properties, &images->images[i], &images->memories[i]);
 
         // HACK: staging images do not require an image view
         if (images->tiling != VK_IMAGE_TILING_LINEAR)
             create_image_view2(
-                gpu->device, images->images[i], images->view_type, images->format, images->aspect,
-                &images->image_views[i]);
+                gpu->device, images->images[i], images->view_type, images->format,
+                images->mip_levels, images->aspect, &images->image_views[i]);
     }
 }
 
@@ -1320,6 +1446,7 @@ void dvz_images_resize(DvzImages* images, uint32_t width, uint32_t height, uint3
         "[SLOW] resize images to size %dx%dx%d, losing the data in it", width, height, depth);
     _images_destroy(images);
     dvz_images_size(images, width, height, depth);
+    images->mip_levels = MIN(MAX(1, images->mip_levels), mip_count(width, height, depth));
     _images_create(images);
 }
 
@@ -1450,6 +1577,15 @@ void dvz_sampler_address_mode(
 
 
 
+void dvz_sampler_max_lod(DvzSampler* sampler, float max_lod)
+{
+    ASSERT(sampler != NULL);
+    ASSERT(max_lod >= 0);
+    sampler->max_lod = max_lod;
+}
+
+
+
 void dvz_sampler_create(DvzSampler* sampler)
 {
     ASSERT(sampler != NULL);
@@ -1460,7 +1596,7 @@ void dvz_sampler_create(DvzSampler* sampler)
 
     create_texture_sampler2(
         sampler->gpu->device, sampler->mag_filter, sampler->min_filter, //
-        sampler->address_modes, false, &sampler->sampler);
+        sampler->address_modes, sampler->max_lod, false, &sampler->sampler);
 
     dvz_obj_created(&sampler->obj);
     log_trace("sampler created");
@@ -1656,6 +1792,7 @@ void dvz_bindings_texture(DvzBindings* bindings, uint32_t idx, DvzTexture* textu
     log_trace("set bindings with texture for binding #%d", idx);
     bindings->images[idx] = images;
     bindings->samplers[idx] = sampler;
+    texture->is_bound = true;
 
     if (bindings->obj.status == DVZ_OBJECT_STATUS_CREATED)
         bindings->obj.status = DVZ_OBJECT_STATUS_NEED_UPDATE;
@@ -1732,6 +1869,17 @@ void dvz_compute_code(DvzCompute* compute, const char* code)
 
 
 
+void dvz_compute_spirv(DvzCompute* compute, VkDeviceSize size, const uint32_t* buffer)
+{
+    ASSERT(compute != NULL);
+    ASSERT(compute->gpu != NULL);
+    ASSERT(compute->gpu->device != VK_NULL_HANDLE);
+    ASSERT(buffer != NULL);
+    compute->shader_module = create_shader_module(compute->gpu->device, size, buffer);
+}
+
+
+
 void dvz_compute_slot(DvzCompute* compute, uint32_t idx, VkDescriptorType type)
 {
     ASSERT(compute != NULL);
@@ -1775,7 +1923,11 @@ void dvz_compute_create(DvzCompute* compute)
 
     log_trace("starting creation of compute...");
 
-    if (compute->shader_code != NULL)
+    if (compute->shader_module != VK_NULL_HANDLE)
+    {
+        log_trace("compute shader module already created from SPIRV code");
+    }
+    else if (compute->shader_code != NULL)
     {
         compute->shader_module =
             dvz_shader_compile(compute->gpu, compute->shader_code, VK_SHADER_STAGE_COMPUTE_BIT);
@@ -1919,6 +2071,25 @@ void dvz_graphics_vertex_binding(DvzGraphics* graphics, uint32_t binding, VkDevi
 
 
 
+void dvz_graphics_vertex_binding_shift(
+    DvzGraphics* graphics, uint32_t binding, VkDeviceSize stride, uint32_t shift)
+{
+    ASSERT(graphics != NULL);
+    dvz_graphics_vertex_binding(graphics, binding, stride);
+    graphics->vertex_bindings[graphics->vertex_binding_count - 1].shift = shift;
+}
+
+
+
+void dvz_graphics_instanced(DvzGraphics* graphics, uint32_t vertex_count)
+{
+    ASSERT(graphics != NULL);
+    ASSERT(vertex_count > 0);
+    graphics->instance_vertex_count = vertex_count;
+}
+
+
+
 void dvz_graphics_vertex_attr(
     DvzGraphics* graphics, uint32_t binding, uint32_t location, VkFormat format,
     VkDeviceSize offset)
@@ -2012,7 +2183,9 @@ void dvz_graphics_create(DvzGraphics* graphics)
     {
         bindings_info[i].binding = graphics->vertex_bindings[i].binding;
         bindings_info[i].stride = graphics->vertex_bindings[i].stride;
-        bindings_info[i].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        bindings_info[i].inputRate = graphics->instance_vertex_count > 0
+                                         ? VK_VERTEX_INPUT_RATE_INSTANCE
+                                         : VK_VERTEX_INPUT_RATE_VERTEX;
     }
     vertex_input_info.vertexBindingDescriptionCount = graphics->vertex_binding_count;
     vertex_input_info.pVertexBindingDescriptions = bindings_info;
@@ -2929,12 +3102,62 @@ void dvz_cmd_begin_renderpass(
     ASSERT(framebuffers->framebuffers[iclip] != VK_NULL_HANDLE);
     begin_render_pass(
         renderpass->renderpass, cb, framebuffers->framebuffers[iclip], //
-        width, height, renderpass->clear_count, renderpass->clear_values);
+        width, height, renderpass->clear_count, renderpass->clear_values,
+        VK_SUBPASS_CONTENTS_INLINE);
     CMD_END
 }
 
 
 
+void dvz_cmd_begin_renderpass_secondary(
+    DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers)
+{
+    ASSERT(renderpass != NULL);
+    ASSERT(framebuffers != NULL);
+
+    ASSERT(dvz_obj_is_created(&renderpass->obj));
+    ASSERT(dvz_obj_is_created(&framebuffers->obj));
+    ASSERT(renderpass->renderpass != VK_NULL_HANDLE);
+
+    ASSERT(framebuffers->attachment_count > 0);
+    uint32_t width = framebuffers->attachments[0]->width;
+    uint32_t height = framebuffers->attachments[0]->height;
+
+    CMD_START_CLIP(cmds->count)
+    ASSERT(framebuffers->framebuffers[iclip] != VK_NULL_HANDLE);
+    begin_render_pass(
+        renderpass->renderpass, cb, framebuffers->framebuffers[iclip], //
+        width, height, renderpass->clear_count, renderpass->clear_values,
+        VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    CMD_END
+}
+
+
+
+void dvz_cmd_execute(
+    DvzCommands* cmds, uint32_t idx, uint32_t secondary_count, DvzCommands** secondaries)
+{
+    ASSERT(secondaries != NULL);
+    if (secondary_count == 0)
+        return;
+
+    VkCommandBuffer* cbs = calloc(secondary_count, sizeof(VkCommandBuffer));
+    for (uint32_t k = 0; k < secondary_count; k++)
+    {
+        ASSERT(secondaries[k] != NULL);
+        ASSERT(secondaries[k]->secondary);
+        ASSERT(idx < secondaries[k]->count);
+        cbs[k] = secondaries[k]->cmds[idx];
+    }
+
+    CMD_START
+    vkCmdExecuteCommands(cb, secondary_count, cbs);
+    CMD_END
+    FREE(cbs);
+}
+
+
+
 void dvz_cmd_end_renderpass(DvzCommands* cmds, uint32_t idx)
 {
     CMD_START
@@ -2979,7 +3202,7 @@ void dvz_cmd_barrier(DvzCommands* cmds, uint32_t idx, DvzBarrier* barrier)
         buffer_barrier = &buffer_barriers[j];
         buffer_info = &barrier->buffer_barriers[j];
 
-        buffer_barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        buffer_barrier->sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
         buffer_barrier->buffer = buffer_info->br.buffer->buffer;
         buffer_barrier->size = buffer_info->br.size;
         ASSERT(i < buffer_info->br.count);
@@ -3031,7 +3254,7 @@ void dvz_cmd_barrier(DvzCommands* cmds, uint32_t idx, DvzBarrier* barrier)
         }
         image_barrier->subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         image_barrier->subresourceRange.baseMipLevel = 0;
-        image_barrier->subresourceRange.levelCount = 1;
+        image_barrier->subresourceRange.levelCount = MAX(1, image_info->images->mip_levels);
         image_barrier->subresourceRange.baseArrayLayer = 0;
         image_barrier->subresourceRange.layerCount = 1;
     }
@@ -3147,6 +3370,95 @@ void dvz_cmd_copy_image(DvzCommands* cmds, uint32_t idx, DvzImages* src_img, Dvz
 
 
 
+void dvz_cmd_copy_buffer_to_image_region(
+    DvzCommands* cmds, uint32_t idx, DvzBuffer* buffer, VkDeviceSize buf_offset,
+    DvzImages* images, uvec3 offset, uvec3 shape)
+{
+    ASSERT(buffer != NULL);
+    ASSERT(images != NULL);
+    ASSERT(offset[0] + shape[0] <= images->width);
+    ASSERT(offset[1] + shape[1] <= images->height);
+    ASSERT(offset[2] + shape[2] <= images->depth);
+
+    CMD_START_CLIP(images->count)
+
+    VkBufferImageCopy region = {0};
+    region.bufferOffset = buf_offset;
+
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+
+    region.imageOffset.x = (int32_t)offset[0];
+    region.imageOffset.y = (int32_t)offset[1];
+    region.imageOffset.z = (int32_t)offset[2];
+
+    region.imageExtent.width = shape[0];
+    region.imageExtent.height = shape[1];
+    region.imageExtent.depth = shape[2];
+
+    vkCmdCopyBufferToImage(
+        cb, buffer->buffer, images->images[iclip], //
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    CMD_END
+}
+
+
+
+void dvz_cmd_blit_mips(DvzCommands* cmds, uint32_t idx, DvzImages* images, VkFilter filter)
+{
+    ASSERT(images != NULL);
+    ASSERT(images->mip_levels >= 1);
+
+    CMD_START_CLIP(images->count)
+
+    VkImage image = images->images[iclip];
+    VkOffset3D size = {(int32_t)images->width, (int32_t)images->height, (int32_t)images->depth};
+    VkImageBlit blit = {0};
+    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.layerCount = 1;
+    blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.dstSubresource.layerCount = 1;
+
+    // Each level is downsampled from the previous one, which is then transitioned to the final
+    // layout.
+    for (uint32_t level = 1; level < images->mip_levels; level++)
+    {
+        mip_barrier(
+            cb, image, level - 1, //
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcOffsets[1] = size;
+        size.x = MAX(1, size.x / 2);
+        size.y = MAX(1, size.y / 2);
+        size.z = MAX(1, size.z / 2);
+        blit.dstSubresource.mipLevel = level;
+        blit.dstOffsets[1] = size;
+        vkCmdBlitImage(
+            cb, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, //
+            image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, filter);
+
+        mip_barrier(
+            cb, image, level - 1, //
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, images->layout, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_ACCESS_MEMORY_READ_BIT);
+    }
+
+    // The last level has only been written to.
+    mip_barrier(
+        cb, image, images->mip_levels - 1, //
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, images->layout, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_ACCESS_MEMORY_READ_BIT);
+
+    CMD_END
+}
+
+
+
 void dvz_cmd_viewport(DvzCommands* cmds, uint32_t idx, VkViewport viewport)
 {
     CMD_START
@@ -3203,6 +3515,32 @@ void dvz_cmd_bind_vertex_buffer(
 
 
 
+void dvz_cmd_bind_vertex_buffers(
+    DvzCommands* cmds, uint32_t idx, DvzGraphics* graphics, DvzBufferRegions br,
+    VkDeviceSize offset)
+{
+    ASSERT(graphics != NULL);
+    uint32_t n = graphics->vertex_binding_count;
+    ASSERT(n <= DVZ_MAX_VERTEX_BINDINGS);
+    DvzVertexBinding* vb = NULL;
+    VkBuffer buffers[DVZ_MAX_VERTEX_BINDINGS] = {0};
+    VkDeviceSize offsets[DVZ_MAX_VERTEX_BINDINGS] = {0};
+
+    CMD_START_CLIP(br.count)
+    for (uint32_t k = 0; k < n; k++)
+    {
+        vb = &graphics->vertex_bindings[k];
+        // NOTE: the bindings are expected to be numbered from 0 to n-1.
+        ASSERT(vb->binding == k);
+        buffers[k] = br.buffer->buffer;
+        offsets[k] = br.offsets[iclip] + offset + vb->shift * vb->stride;
+    }
+    vkCmdBindVertexBuffers(cb, 0, n, buffers, offsets);
+    CMD_END
+}
+
+
+
 void dvz_cmd_bind_index_buffer(
     DvzCommands* cmds, uint32_t idx, DvzBufferRegions br, VkDeviceSize offset)
 {
@@ -3223,6 +3561,19 @@ void dvz_cmd_draw(DvzCommands* cmds, uint32_t idx, uint32_t first_vertex, uint32
 
 
 
+void dvz_cmd_draw_instanced(
+    DvzCommands* cmds, uint32_t idx, uint32_t first_vertex, uint32_t vertex_count,
+    uint32_t first_instance, uint32_t instance_count)
+{
+    ASSERT(vertex_count > 0);
+    ASSERT(instance_count > 0);
+    CMD_START
+    vkCmdDraw(cb, vertex_count, instance_count, first_vertex, first_instance);
+    CMD_END
+}
+
+
+
 void dvz_cmd_draw_indexed(
     DvzCommands* cmds, uint32_t idx, uint32_t first_index, uint32_t vertex_offset,
     uint32_t index_count)
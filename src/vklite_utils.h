@@ -372,6 +372,39 @@ static void backend_poll_events(DvzBackend backend, DvzWindow* window)
 
 
 
+// Block until an event is received, or until the timeout in seconds (if non-negative) expires.
+static void backend_wait_events(DvzBackend backend, double timeout)
+{
+    switch (backend)
+    {
+    case DVZ_BACKEND_GLFW:
+        if (timeout < 0)
+            glfwWaitEvents();
+        else
+            glfwWaitEventsTimeout(timeout);
+        break;
+    default:
+        break;
+    }
+}
+
+
+
+// Wake up backend_wait_events(), may be called from any thread.
+static void backend_post_empty_event(DvzBackend backend)
+{
+    switch (backend)
+    {
+    case DVZ_BACKEND_GLFW:
+        glfwPostEmptyEvent();
+        break;
+    default:
+        break;
+    }
+}
+
+
+
 static void
 backend_window_destroy(VkInstance instance, DvzBackend backend, void* window, VkSurfaceKHR surface)
 {
@@ -979,7 +1012,8 @@ static void create_swapchain(
 /*************************************************************************************************/
 
 static void allocate_command_buffers(
-    VkDevice device, VkCommandPool command_pool, uint32_t count, VkCommandBuffer* cmd_bufs)
+    VkDevice device, VkCommandPool command_pool, VkCommandBufferLevel level, uint32_t count,
+    VkCommandBuffer* cmd_bufs)
 {
     ASSERT(count > 0);
     log_trace("allocate %d command buffer(s)", count);
@@ -989,7 +1023,7 @@ static void allocate_command_buffers(
     VkCommandBufferAllocateInfo alloc_info = {0};
     alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     alloc_info.commandPool = command_pool;
-    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.level = level;
     alloc_info.commandBufferCount = count;
     VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &alloc_info, cmd_bufs));
 }
@@ -1132,11 +1166,26 @@ static void check_dims(VkImageType image_type, uint32_t width, uint32_t height,
 
 
 
+// Number of mip levels of the full mip chain of an image, down to 1x1x1.
+static uint32_t mip_count(uint32_t width, uint32_t height, uint32_t depth)
+{
+    uint32_t size = MAX(MAX(width, height), depth);
+    uint32_t count = 1;
+    while (size > 1)
+    {
+        size >>= 1;
+        count++;
+    }
+    return count;
+}
+
+
+
 static void create_image2(
     VkDevice device, DvzQueues* queues, uint32_t queue_count, uint32_t* queue_indices,        //
     VkImageType image_type, uint32_t width, uint32_t height, uint32_t depth, VkFormat format, //
-    VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,          //
-    VkPhysicalDeviceMemoryProperties memory_properties,                                       //
+    uint32_t mip_levels, VkImageTiling tiling, VkImageUsageFlags usage,                       //
+    VkMemoryPropertyFlags properties, VkPhysicalDeviceMemoryProperties memory_properties,     //
     VkImage* image, VkDeviceMemory* imageMemory)                                              //
 {
     log_trace("create image %dD %dx%dx%d", image_type + 1, width, height, depth);
@@ -1148,7 +1197,7 @@ static void create_image2(
     info.extent.width = width;
     info.extent.height = height;
     info.extent.depth = depth;
-    info.mipLevels = 1;
+    info.mipLevels = MAX(1, mip_levels);
     info.arrayLayers = 1;
     info.format = format;
     info.tiling = tiling;
@@ -1183,7 +1232,7 @@ static void create_image2(
 
 static void create_image_view2(
     VkDevice device, VkImage image, VkImageViewType view_type, VkFormat format,
-    VkImageAspectFlags aspect_flags, VkImageView* image_view)
+    uint32_t mip_levels, VkImageAspectFlags aspect_flags, VkImageView* image_view)
 {
     log_trace("create image view %dD", view_type + 1);
 
@@ -1197,7 +1246,7 @@ static void create_image_view2(
     viewInfo.viewType = view_type;
     viewInfo.format = format;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = MAX(1, mip_levels);
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
     viewInfo.subresourceRange.aspectMask = aspect_flags;
@@ -1207,13 +1256,40 @@ static void create_image_view2(
 
 
 
+// Record a layout transition of a single mip level of an image.
+static void mip_barrier(
+    VkCommandBuffer cb, VkImage image, uint32_t level, VkImageLayout old_layout,
+    VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access)
+{
+    VkImageMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = image;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = level;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(
+        cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, //
+        0, NULL, 0, NULL, 1, &barrier);
+}
+
+
+
 /*************************************************************************************************/
 /*  Sampler                                                                                      */
 /*************************************************************************************************/
 
 static void create_texture_sampler2(
     VkDevice device, VkFilter mag_filter, VkFilter min_filter, //
-    VkSamplerAddressMode* address_modes, bool anisotropy, VkSampler* sampler)
+    VkSamplerAddressMode* address_modes, float max_lod, bool anisotropy, VkSampler* sampler)
 {
     log_trace("create texture sampler");
     VkSamplerCreateInfo sampler_info = {0};
@@ -1235,7 +1311,7 @@ static void create_texture_sampler2(
     sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     sampler_info.mipLodBias = 0.0f;
     sampler_info.minLod = 0.0f;
-    sampler_info.maxLod = 0.0f;
+    sampler_info.maxLod = max_lod;
 
     VK_CHECK_RESULT(vkCreateSampler(device, &sampler_info, NULL, sampler));
 }
@@ -1642,7 +1718,8 @@ static VkAttachmentReference create_attachment_ref(uint32_t attachment, VkImageL
 
 static void begin_render_pass(
     VkRenderPass renderpass, VkCommandBuffer cmd_buf, VkFramebuffer framebuffer, //
-    uint32_t width, uint32_t height, uint32_t clear_count, VkClearValue* clear_colors)
+    uint32_t width, uint32_t height, uint32_t clear_count, VkClearValue* clear_colors,
+    VkSubpassContents contents)
 {
     ASSERT(renderpass != VK_NULL_HANDLE);
     ASSERT(framebuffer != VK_NULL_HANDLE);
@@ -1657,7 +1734,7 @@ static void begin_render_pass(
     render_pass_info.renderArea = renderArea;
     render_pass_info.clearValueCount = clear_count;
     render_pass_info.pClearValues = clear_colors;
-    vkCmdBeginRenderPass(cmd_buf, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(cmd_buf, &render_pass_info, contents);
 }
 
 #endif